@@ -3,6 +3,7 @@
 #include "async/CAsyncQueue.hpp"
 #include "event/Event.hpp"
 #include "util/SFile.hpp"
+#include <algorithm>
 #include <common/Prop.hpp>
 #include <common/Time.hpp>
 
@@ -25,19 +26,34 @@ CAsyncObject* AsyncFileReadAllocObject() {
     object->userArg = nullptr;
     object->userPostloadCallback = nullptr;
     object->userFailedCallback = nullptr;
+    object->userReadCallback = nullptr;
     object->queue = nullptr;
     object->isProcessed = 0;
     object->isRead = 0;
     object->isCurrent = 0;
+    object->isFailed = 0;
     object->char24 = 0;
     object->char25 = 0;
     object->ptr1C = 0;
     object->priority = 126;
+    object->heapIndex = ASYNC_OBJECT_NOT_QUEUED;
 
     return object;
 }
 
+void AsyncFileReadUnqueueObject(CAsyncObject* object) {
+    if (auto queue = AsyncFileReadLockObjectQueue(object)) {
+        queue->Unlink(object);
+        object->link.Unlink();
+        object->queue = nullptr;
+
+        queue->lock.Leave();
+    }
+}
+
 void AsyncFileReadDestroyObject(CAsyncObject* object) {
+    AsyncFileReadUnqueueObject(object);
+
     AsyncFileRead::s_queueLock.Enter();
 
     if (object->isCurrent) {
@@ -89,7 +105,12 @@ void AsyncFileReadInitialize(uint32_t threadSleep, uint32_t handlerTimeout) {
         const char* queueName = AsyncFileRead::s_asyncQueueNames[i];
 
         AsyncFileRead::s_asyncQueues[i] = queue;
-        AsyncFileReadCreateThread(queue, queueName);
+
+        auto threadCount = std::min(std::max(AsyncFileRead::s_threadCount[i], 1u), static_cast<uint32_t>(ASYNC_MAX_QUEUE_THREADS));
+
+        for (uint32_t j = 0; j < threadCount; j++) {
+            AsyncFileReadCreateThread(queue, queueName);
+        }
     }
 
     if (SFile::IsStreamingMode()) {
@@ -104,37 +125,43 @@ void AsyncFileReadObject(CAsyncObject* object, int32_t a2) {
     CAsyncQueue* queue = AsyncFileRead::s_asyncQueues[0];
 
     if (SFile::IsStreamingMode()) {
-        // TODO
-        // int32_t v3 = SFile::FileIsLocal(object->file, 6);
-        //
-        // if (!v3 || v3 == 2) {
-        //     int32_t v4 = object->priority <= 127;
-        //     object->char24 = 1;
-        //     queue = AsyncFileRead::s_asyncQueues[1];
-        //
-        //     if (!v4) {
-        //         queue = AsyncFileRead::s_asyncQueues[2];
-        //     }
-        // }
+        int32_t v3 = SFile::FileIsLocal(object->file, 6);
+
+        // Priorities above 127 are texture reads
+        if (!v3 || v3 == 2) {
+            int32_t v4 = object->priority <= 127;
+            object->char24 = 1;
+            queue = AsyncFileRead::s_asyncQueues[1];
+
+            if (!v4) {
+                queue = AsyncFileRead::s_asyncQueues[2];
+            }
+        }
     }
 
-    AsyncFileRead::s_queueLock.Enter();
+    queue->lock.Enter();
+
+    if (object->queue != queue) {
+        queue->lock.Leave();
+        AsyncFileReadUnqueueObject(object);
+        queue->lock.Enter();
+    }
 
     object->queue = queue;
+    object->queueTime = OsGetAsyncTimeMsPrecise();
 
     if (AsyncFileRead::s_asyncWaitObject == object) {
         object->priority = object->priority > 127 ? 128 : 0;
         // TODO
         // object->ptr1C = g_theGxDevicePtr + 3944;
         object->char25 = 0;
-    } else if (queue->int20) {
-        // TODO
-        // Sub4BA530(object, a2);
     } else {
         AsyncFileReadLinkObject(object, a2);
     }
 
-    AsyncFileRead::s_queueLock.Leave();
+    AsyncFileReadWakeQueue(queue);
+
+    queue->lock.Leave();
 
     if (SFile::IsStreamingMode()) {
         // TODO
@@ -11,4 +11,6 @@ void AsyncFileReadInitialize(uint32_t threadSleep, uint32_t handlerTimeout);
 
 void AsyncFileReadObject(CAsyncObject* object, int32_t a2);
 
+void AsyncFileReadUnqueueObject(CAsyncObject* object);
+
 #endif
@@ -20,6 +20,7 @@ const char* AsyncFileRead::s_asyncQueueNames[NUM_ASYNC_QUEUES] = {
     "Net Texture Queue"
 };
 CAsyncQueue* AsyncFileRead::s_asyncQueues[NUM_ASYNC_QUEUES];
+uint32_t AsyncFileRead::s_threadCount[NUM_ASYNC_QUEUES] = { 1, 1, 1 };
 SCritSect AsyncFileRead::s_queueLock;
 SCritSect AsyncFileRead::s_userQueueLock;
 TSList<CAsyncQueue, TSGetLink<CAsyncQueue>> AsyncFileRead::s_asyncQueueList;
@@ -38,33 +39,44 @@ void AsyncFileReadCreateThread(CAsyncQueue* queue, const char* queueName) {
 
     thread->queue = queue;
     thread->currentObject = nullptr;
+    thread->io.Initialize(ASYNC_IO_QUEUE_DEPTH);
 
     SThread::Create(AsyncFileReadThread, thread, thread->thread, const_cast<char*>(queueName), 0);
 }
 
+// Expects the object's queue lock to be held. Linking an object that is
+// already queued updates its position for the new priority.
 void AsyncFileReadLinkObject(CAsyncObject* object, int32_t a2) {
     if (!object->queue) {
         return;
     }
 
     object->link.Unlink();
+    object->queue->Link(object, a2);
+    object->char25 = 0;
+}
 
-    auto& readList = object->queue->readList;
+// Workers clear an object's queue pointer under the queue lock when they take
+// it, so the pointer is only read with a queue lock held. Returns the queue
+// holding the object with its lock entered, or nullptr if it isn't queued.
+CAsyncQueue* AsyncFileReadLockObjectQueue(CAsyncObject* object) {
+    for (int32_t i = 0; i < NUM_ASYNC_QUEUES; i++) {
+        auto queue = AsyncFileRead::s_asyncQueues[i];
 
-    for (auto currentObject = readList.Head(); currentObject; currentObject = readList.Link(currentObject)->Next()) {
-        uint8_t priority = object->priority;
-        uint8_t currentPriority = currentObject->priority;
+        if (!queue) {
+            continue;
+        }
 
-        if (priority <= currentPriority && (a2 || priority != currentPriority)) {
-            readList.LinkNode(object, 2, currentObject);
-            object->char25 = 0;
+        queue->lock.Enter();
 
-            return;
+        if (object->queue == queue) {
+            return queue;
         }
+
+        queue->lock.Leave();
     }
 
-    readList.LinkToTail(object);
-    object->char25 = 0;
+    return nullptr;
 }
 
 int32_t AsyncFileReadPollHandler(const void* a1, void* a2) {
@@ -90,7 +102,11 @@ int32_t AsyncFileReadPollHandler(const void* a1, void* a2) {
 
         AsyncFileRead::s_queueLock.Leave();
 
-        object->userPostloadCallback(object->userArg);
+        if (object->isFailed && object->userFailedCallback) {
+            object->userFailedCallback(object->userArg);
+        } else {
+            object->userPostloadCallback(object->userArg);
+        }
 
         AsyncFileRead::s_progressCount--;
 
@@ -108,78 +124,165 @@ int32_t AsyncFileReadPollHandler(const void* a1, void* a2) {
     return 1;
 }
 
-uint32_t AsyncFileReadThread(void* param) {
-    CAsyncThread* thread = static_cast<CAsyncThread*>(param);
+// Queues flagged with int20 (the net texture queue) hold back while net
+// geometry reads are waiting, so a burst of large textures can't delay the
+// geometry they're drawn on
+static int32_t AsyncFileReadYield(CAsyncQueue* queue) {
+    auto geometryQueue = AsyncFileRead::s_asyncQueues[1];
 
-    PropSelectContext(AsyncFileRead::s_propContext);
+    if (!queue->int20 || !geometryQueue || geometryQueue == queue) {
+        return 0;
+    }
 
-    while (AsyncFileRead::s_shutdownEvent.Wait(0)) {
-        uint32_t sleep = 0;
-        CAsyncObject* object;
+    // readCount is guarded by the geometry queue's own lock. Taken before
+    // this queue's lock, never inside it.
+    geometryQueue->lock.Enter();
+    auto waiting = geometryQueue->readCount != 0;
+    geometryQueue->lock.Leave();
+
+    return waiting;
+}
 
-        while (1) {
-            AsyncFileRead::s_queueLock.Enter();
+static CAsyncObject* AsyncFileReadNextObject(CAsyncThread* thread) {
+    CAsyncObject* object;
 
-            object = thread->queue->readList.Head();
+    auto queue = thread->queue;
 
-            if (object && thread->queue->int20 && /* TODO */ true) {
-                // TODO
-                // Sub4BA530(object, 1);
+    if (AsyncFileReadYield(queue)) {
+        return nullptr;
+    }
 
-                AsyncFileRead::s_queueLock.Leave();
-                continue;
-            }
+    queue->lock.Enter();
 
-            if (!object) {
-                object = thread->queue->list14.Head();
-            }
+    object = queue->Head();
 
-            if (!object) {
-                AsyncFileRead::s_queueLock.Leave();
-                break;
+    if (object) {
+        queue->Unlink(object);
+    } else {
+        object = queue->list14.Head();
+    }
+
+    if (!object) {
+        queue->lock.Leave();
+        return nullptr;
+    }
+
+    object->link.Unlink();
+    object->queue = nullptr;
+    object->isCurrent = 1;
+
+    queue->inFlight++;
+    queue->dequeued++;
+    queue->waitTime += OsGetAsyncTimeMsPrecise() - object->queueTime;
+
+    auto drained = queue->readCount == 0;
+
+    queue->lock.Leave();
+
+    // Let yielding queues pick their work back up
+    if (drained && queue == AsyncFileRead::s_asyncQueues[1]) {
+        for (int32_t i = 0; i < NUM_ASYNC_QUEUES; i++) {
+            auto yieldQueue = AsyncFileRead::s_asyncQueues[i];
+
+            if (yieldQueue && yieldQueue->int20) {
+                AsyncFileReadWakeQueue(yieldQueue);
             }
+        }
+    }
 
-            object->link.Unlink();
-            object->queue = nullptr;
-            object->isCurrent = 1;
-            thread->currentObject = object;
+    return object;
+}
 
-            AsyncFileRead::s_queueLock.Leave();
+static void AsyncFileReadPostObject(CAsyncThread* thread, CAsyncObject* object, int32_t result) {
+    if (result && object->userReadCallback) {
+        object->userReadCallback(object->userArg);
+    }
 
-            int32_t tries = 10;
-            while (1) {
-                if (SFile::IsStreamingMode() && object->file) {
-                    // TODO
-                    // Sub421820(object->file, (object->priority > 127) + 1, 1);
-                }
+    thread->queue->lock.Enter();
 
-                if (SFile::Read(object->file, object->buffer, object->size, nullptr, nullptr, nullptr)) {
-                    break;
-                }
+    thread->queue->inFlight--;
+    thread->queue->completed++;
 
-                tries--;
+    thread->queue->lock.Leave();
 
-                // Handle failure
-                if (tries == 0) {
-                    // TODO
-                    // Sub421850((object->file, v17, 512);
-                    // v10 = Sub7717E0();
-                    // Sub771A80(v10, v18, 512);
-                    // nullsub_3(v17);
+    AsyncFileRead::s_queueLock.Enter();
 
-                    break;
-                }
+    AsyncFileRead::s_asyncFileReadPostList.LinkToTail(object);
+
+    if (thread->currentObject == object) {
+        thread->currentObject = nullptr;
+    }
+
+    object->isCurrent = 0;
+    object->isRead = 1;
+    object->isFailed = !result;
+
+    AsyncFileRead::s_queueLock.Leave();
+}
+
+static int32_t AsyncFileReadSync(CAsyncObject* object) {
+    int32_t tries = 10;
+    while (1) {
+        if (SFile::IsStreamingMode() && object->file) {
+            // TODO
+            // Sub421820(object->file, (object->priority > 127) + 1, 1);
+        }
+
+        size_t bytesRead = 0;
+
+        if (SFile::Read(object->file, object->buffer, object->size, &bytesRead, nullptr, nullptr)) {
+            // A file shorter than the request won't grow on a retry
+            return bytesRead == object->size;
+        }
+
+        tries--;
+
+        // Handle failure
+        if (tries == 0) {
+            // TODO
+            // Sub421850((object->file, v17, 512);
+            // v10 = Sub7717E0();
+            // Sub771A80(v10, v18, 512);
+            // nullsub_3(v17);
+
+            return 0;
+        }
+    }
+}
+
+uint32_t AsyncFileReadThread(void* param) {
+    CAsyncThread* thread = static_cast<CAsyncThread*>(param);
+
+    PropSelectContext(AsyncFileRead::s_propContext);
+
+    CAsyncObject* completed[ASYNC_IO_QUEUE_DEPTH];
+    int32_t results[ASYNC_IO_QUEUE_DEPTH];
+
+    while (AsyncFileRead::s_shutdownEvent.Wait(0)) {
+        uint32_t sleep = 0;
+        uint32_t dequeued = 0;
+
+        // Keep the reader topped up. Files the platform reader can't handle
+        // are read synchronously as before.
+        while (thread->io.CanSubmit()) {
+            auto object = AsyncFileReadNextObject(thread);
+
+            if (!object) {
+                break;
             }
 
-            AsyncFileRead::s_queueLock.Enter();
+            dequeued++;
 
-            AsyncFileRead::s_asyncFileReadPostList.LinkToTail(object);
+            if (thread->io.Submit(object)) {
+                continue;
+            }
 
-            thread->currentObject = nullptr;
-            object->isCurrent = 0;
-            object->isRead = 1;
+            // Only the synchronous read is tracked as the thread's current
+            // object; submitted reads are marked by isCurrent alone
+            thread->currentObject = object;
 
-            AsyncFileRead::s_queueLock.Leave();
+            auto result = AsyncFileReadSync(object);
+            AsyncFileReadPostObject(thread, object, result);
 
             if (AsyncFileRead::s_threadSleep) {
                 sleep++;
@@ -191,12 +294,53 @@ uint32_t AsyncFileReadThread(void* param) {
             }
         }
 
-        OsSleep(1);
+        auto reaped = thread->io.Reap(completed, results, ASYNC_IO_QUEUE_DEPTH);
+
+        for (uint32_t i = 0; i < reaped; i++) {
+            // Failed reads get the synchronous retry path
+            if (!results[i]) {
+                thread->currentObject = completed[i];
+                results[i] = AsyncFileReadSync(completed[i]);
+            }
+
+            AsyncFileReadPostObject(thread, completed[i], results[i]);
+        }
+
+        // Sleep until new work is queued or an in-flight read completes
+        if (!dequeued && !reaped) {
+            thread->io.Wait(ASYNC_THREAD_WAIT_TIMEOUT);
+        }
     }
 
+    // Reads nobody has started are cancelled and the rest drained, and every
+    // one is posted, failed or not, so nothing waiting on them hangs
+    thread->io.Cancel();
+
+    while (thread->io.m_inFlight) {
+        auto reaped = thread->io.Reap(completed, results, ASYNC_IO_QUEUE_DEPTH);
+
+        for (uint32_t i = 0; i < reaped; i++) {
+            AsyncFileReadPostObject(thread, completed[i], results[i]);
+        }
+
+        if (!reaped) {
+            thread->io.Wait(ASYNC_THREAD_WAIT_TIMEOUT);
+        }
+    }
+
+    thread->io.Destroy();
+
     return 0;
 }
 
+void AsyncFileReadWakeQueue(CAsyncQueue* queue) {
+    for (auto thread = AsyncFileRead::s_asyncThreadList.Head(); thread; thread = AsyncFileRead::s_asyncThreadList.Next(thread)) {
+        if (thread->queue == queue) {
+            thread->io.Wake();
+        }
+    }
+}
+
 void AsyncFileReadWait(CAsyncObject* object) {
     STORM_ASSERT(object);
 
@@ -211,13 +355,17 @@ void AsyncFileReadWait(CAsyncObject* object) {
 
     AsyncFileRead::s_asyncWaitObject = object;
 
-    if (!object->isCurrent && !object->isRead) {
-        object->link.Unlink();
-        object->queue->readList.LinkToHead(object);
-    }
-
     AsyncFileRead::s_queueLock.Leave();
 
+    if (auto queue = AsyncFileReadLockObjectQueue(object)) {
+        if (!object->isCurrent && !object->isRead) {
+            queue->LinkToHead(object);
+            AsyncFileReadWakeQueue(queue);
+        }
+
+        queue->lock.Leave();
+    }
+
     if (SFile::IsStreamingMode()) {
         // TODO
     }
@@ -8,6 +8,10 @@
 
 #define NUM_ASYNC_QUEUES 3
 
+#define ASYNC_THREAD_WAIT_TIMEOUT 100
+
+#define ASYNC_MAX_QUEUE_THREADS 8
+
 class CAsyncObject;
 
 class AsyncFileRead {
@@ -25,6 +29,7 @@ class AsyncFileRead {
         static SEvent s_shutdownEvent;
         static const char* s_asyncQueueNames[];
         static CAsyncQueue* s_asyncQueues[];
+        static uint32_t s_threadCount[];
         static SCritSect s_queueLock;
         static SCritSect s_userQueueLock;
         static TSList<CAsyncQueue, TSGetLink<CAsyncQueue>> s_asyncQueueList;
@@ -40,10 +45,14 @@ void AsyncFileReadCreateThread(CAsyncQueue* queue, const char* queueName);
 
 void AsyncFileReadLinkObject(CAsyncObject* object, int32_t a2);
 
+CAsyncQueue* AsyncFileReadLockObjectQueue(CAsyncObject* object);
+
 int32_t AsyncFileReadPollHandler(const void* a1, void* a2);
 
 uint32_t AsyncFileReadThread(void* thread);
 
 void AsyncFileReadWait(CAsyncObject* object);
 
+void AsyncFileReadWakeQueue(CAsyncQueue* queue);
+
 #endif
@@ -0,0 +1,35 @@
+#ifndef ASYNC_C_ASYNC_IO_HPP
+#define ASYNC_C_ASYNC_IO_HPP
+
+#include <cstdint>
+
+#define ASYNC_IO_QUEUE_DEPTH 64
+
+class CAsyncObject;
+struct CAsyncIoPlatform;
+
+// Per worker thread reader. Platforms that can issue reads asynchronously
+// keep up to ASYNC_IO_QUEUE_DEPTH of them in flight; everything else is
+// read synchronously by the worker through SFile::Read. On Linux that's
+// io_uring, or a few pread reader threads where io_uring is unavailable.
+class CAsyncIo {
+    public:
+        // Static variables
+        static int32_t s_disableRing;
+
+        // Member variables
+        CAsyncIoPlatform* m_platform = nullptr;
+        uint32_t m_inFlight = 0;
+
+        // Member functions
+        int32_t CanSubmit();
+        void Cancel();
+        void Destroy();
+        int32_t Initialize(uint32_t depth);
+        uint32_t Reap(CAsyncObject** objects, int32_t* results, uint32_t count);
+        int32_t Submit(CAsyncObject* object);
+        void Wait(uint32_t timeout);
+        void Wake();
+};
+
+#endif
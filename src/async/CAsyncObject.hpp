@@ -1,8 +1,11 @@
 #ifndef ASYNC_C_ASYNC_OBJECT_HPP
 #define ASYNC_C_ASYNC_OBJECT_HPP
 
+#include <cstdint>
 #include <storm/List.hpp>
 
+#define ASYNC_OBJECT_NOT_QUEUED 0xFFFFFFFF
+
 class SFile;
 class CAsyncQueue;
 
@@ -25,6 +28,15 @@ class CAsyncObject {
         uint8_t char25;
         uint8_t padding[2];
         TSLink<CAsyncObject> link;
+        uint32_t heapIndex = ASYNC_OBJECT_NOT_QUEUED;
+        uint64_t heapKey;
+        uint32_t queueTime = 0;
+        // Runs on the read thread once the buffer is filled, before the
+        // object is posted to the main thread
+        void (*userReadCallback)(void*) = nullptr;
+        // Set when the read never filled the buffer; the object is posted to
+        // userFailedCallback instead, where there is one
+        uint8_t isFailed = 0;
 };
 
 #endif
@@ -0,0 +1,125 @@
+#include "async/CAsyncQueue.hpp"
+
+void CAsyncQueue::GetStats(CAsyncQueueStats* stats) {
+    this->lock.Enter();
+
+    stats->queued = this->readCount;
+    stats->inFlight = this->inFlight;
+    stats->completed = this->completed;
+    stats->averageWait = this->dequeued ? static_cast<float>(this->waitTime) / this->dequeued : 0.0f;
+
+    this->lock.Leave();
+}
+
+CAsyncObject* CAsyncQueue::Head() {
+    return this->readCount ? this->readHeap[0] : nullptr;
+}
+
+void CAsyncQueue::Link(CAsyncObject* object, int32_t front) {
+    // Among equal priorities new objects go behind existing ones, or ahead of
+    // them when front is set
+    auto order = front ? --this->frontOrder : ++this->backOrder;
+
+    this->SetKey(object, (static_cast<uint64_t>(object->priority) << ASYNC_QUEUE_ORDER_BITS) | order);
+}
+
+void CAsyncQueue::LinkToHead(CAsyncObject* object) {
+    this->SetKey(object, --this->frontOrder);
+}
+
+void CAsyncQueue::Place(CAsyncObject* object, uint32_t index) {
+    this->readHeap[index] = object;
+    object->heapIndex = index;
+}
+
+CAsyncObject* CAsyncQueue::Pop() {
+    auto object = this->Head();
+
+    if (object) {
+        this->Unlink(object);
+    }
+
+    return object;
+}
+
+void CAsyncQueue::SetKey(CAsyncObject* object, uint64_t key) {
+    object->heapKey = key;
+
+    // Already queued: this is a priority change, so restore heap order from
+    // the object's current slot
+    if (object->heapIndex != ASYNC_OBJECT_NOT_QUEUED) {
+        this->SiftUp(object->heapIndex);
+        this->SiftDown(object->heapIndex);
+
+        return;
+    }
+
+    if (this->readCount == this->readHeap.Count()) {
+        this->readHeap.SetCount(this->readCount ? this->readCount * 2 : 64);
+    }
+
+    this->Place(object, this->readCount++);
+    this->SiftUp(object->heapIndex);
+}
+
+void CAsyncQueue::SiftDown(uint32_t index) {
+    auto object = this->readHeap[index];
+
+    while (true) {
+        auto child = index * 2 + 1;
+
+        if (child >= this->readCount) {
+            break;
+        }
+
+        if (child + 1 < this->readCount && this->readHeap[child + 1]->heapKey < this->readHeap[child]->heapKey) {
+            child++;
+        }
+
+        if (object->heapKey <= this->readHeap[child]->heapKey) {
+            break;
+        }
+
+        this->Place(this->readHeap[child], index);
+        index = child;
+    }
+
+    this->Place(object, index);
+}
+
+void CAsyncQueue::SiftUp(uint32_t index) {
+    auto object = this->readHeap[index];
+
+    while (index > 0) {
+        auto parent = (index - 1) / 2;
+
+        if (this->readHeap[parent]->heapKey <= object->heapKey) {
+            break;
+        }
+
+        this->Place(this->readHeap[parent], index);
+        index = parent;
+    }
+
+    this->Place(object, index);
+}
+
+void CAsyncQueue::Unlink(CAsyncObject* object) {
+    auto index = object->heapIndex;
+
+    if (index == ASYNC_OBJECT_NOT_QUEUED) {
+        return;
+    }
+
+    object->heapIndex = ASYNC_OBJECT_NOT_QUEUED;
+
+    auto last = this->readHeap[--this->readCount];
+
+    if (last == object) {
+        return;
+    }
+
+    this->Place(last, index);
+    this->SiftUp(index);
+    this->SiftDown(last->heapIndex);
+}
@@ -3,14 +3,52 @@
 
 #include "async/CAsyncObject.hpp"
 #include <cstdint>
+#include <storm/Array.hpp>
 #include <storm/List.hpp>
+#include <storm/Thread.hpp>
 
+#define ASYNC_QUEUE_ORDER_BITS 40
+#define ASYNC_QUEUE_ORDER_START (1ull << (ASYNC_QUEUE_ORDER_BITS - 1))
+
+struct CAsyncQueueStats {
+    uint32_t queued;
+    uint32_t inFlight;
+    uint32_t completed;
+    float averageWait;
+};
+
+// Read requests are kept in a binary min-heap ordered by priority (lower is
+// more urgent), then by the order they were linked. Each queue has its own
+// lock so submitters and workers on different queues don't contend.
 class CAsyncQueue : public TSLinkedNode<CAsyncQueue> {
     public:
         // Member variables
-        STORM_EXPLICIT_LIST(CAsyncObject, link) readList;
+        SCritSect lock;
+        TSGrowableArray<CAsyncObject*> readHeap;
+        uint32_t readCount = 0;
+        uint64_t frontOrder = ASYNC_QUEUE_ORDER_START;
+        uint64_t backOrder = ASYNC_QUEUE_ORDER_START;
         STORM_EXPLICIT_LIST(CAsyncObject, link) list14;
-        int32_t int20;
+        int32_t int20 = 0;
+        uint32_t inFlight = 0;
+        uint32_t completed = 0;
+        uint32_t dequeued = 0;
+        uint64_t waitTime = 0;
+
+        // Member functions
+        void GetStats(CAsyncQueueStats* stats);
+        CAsyncObject* Head();
+        void Link(CAsyncObject* object, int32_t front);
+        void LinkToHead(CAsyncObject* object);
+        CAsyncObject* Pop();
+        void Unlink(CAsyncObject* object);
+
+    private:
+        // Member functions
+        void Place(CAsyncObject* object, uint32_t index);
+        void SetKey(CAsyncObject* object, uint64_t key);
+        void SiftDown(uint32_t index);
+        void SiftUp(uint32_t index);
 };
 
 #endif
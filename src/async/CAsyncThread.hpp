@@ -1,6 +1,7 @@
 #ifndef ASYNC_C_ASYNC_THREAD_HPP
 #define ASYNC_C_ASYNC_THREAD_HPP
 
+#include "async/CAsyncIo.hpp"
 #include <cstdint>
 #include <storm/List.hpp>
 #include <storm/Thread.hpp>
@@ -14,6 +15,7 @@ class CAsyncThread : public TSLinkedNode<CAsyncThread> {
         SThread thread;
         CAsyncQueue* queue;
         CAsyncObject* currentObject;
+        CAsyncIo io;
 };
 
 #endif
@@ -0,0 +1,55 @@
+#include "async/CAsyncIo.hpp"
+#include <new>
+#include <storm/Memory.hpp>
+#include <storm/Thread.hpp>
+
+struct CAsyncIoPlatform {
+    SEvent wakeEvent = SEvent(0, 0);
+};
+
+int32_t CAsyncIo::s_disableRing;
+
+int32_t CAsyncIo::CanSubmit() {
+    return 1;
+}
+
+void CAsyncIo::Cancel() {
+    // Nothing is ever in flight
+}
+
+void CAsyncIo::Destroy() {
+    if (!this->m_platform) {
+        return;
+    }
+
+    this->m_platform->~CAsyncIoPlatform();
+    SMemFree(this->m_platform, __FILE__, __LINE__, 0);
+
+    this->m_platform = nullptr;
+}
+
+int32_t CAsyncIo::Initialize(uint32_t depth) {
+    auto m = SMemAlloc(sizeof(CAsyncIoPlatform), __FILE__, __LINE__, 0x0);
+    this->m_platform = new (m) CAsyncIoPlatform();
+
+    return 1;
+}
+
+uint32_t CAsyncIo::Reap(CAsyncObject** objects, int32_t* results, uint32_t count) {
+    return 0;
+}
+
+int32_t CAsyncIo::Submit(CAsyncObject* object) {
+    // Reads are always issued synchronously by the worker
+    return 0;
+}
+
+void CAsyncIo::Wait(uint32_t timeout) {
+    this->m_platform->wakeEvent.Wait(timeout);
+}
+
+void CAsyncIo::Wake() {
+    if (this->m_platform) {
+        this->m_platform->wakeEvent.Set();
+    }
+}
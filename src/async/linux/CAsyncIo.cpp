@@ -0,0 +1,609 @@
+#include "async/CAsyncIo.hpp"
+#include "async/CAsyncObject.hpp"
+#include "util/SFile.hpp"
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <common/Time.hpp>
+#include <storm/Memory.hpp>
+
+#define ASYNC_IO_READER_THREADS 4
+
+struct CAsyncIoRequest {
+    CAsyncObject* object;
+    int32_t fd;
+    uint64_t offset;
+    iovec iov;
+    int32_t result;
+    CAsyncIoRequest* next;
+};
+
+struct CAsyncIoPlatform {
+    int32_t wakeFd = -1;
+    int32_t ringFd = -1;
+    uint32_t depth = 0;
+    uint32_t pendingSubmit = 0;
+
+    // Submission ring
+    void* sqRing = MAP_FAILED;
+    size_t sqRingSize = 0;
+    uint32_t* sqTail = nullptr;
+    uint32_t* sqMask = nullptr;
+    uint32_t* sqArray = nullptr;
+    io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    size_t sqesSize = 0;
+
+    // Completion ring
+    void* cqRing = MAP_FAILED;
+    size_t cqRingSize = 0;
+    uint32_t* cqHead = nullptr;
+    uint32_t* cqTail = nullptr;
+    uint32_t* cqMask = nullptr;
+    io_uring_cqe* cqes = nullptr;
+
+    CAsyncIoRequest* requests = nullptr;
+    CAsyncIoRequest** freeRequests = nullptr;
+    uint32_t freeCount = 0;
+
+    // pread reader threads, used when io_uring is unavailable
+    pthread_t readers[ASYNC_IO_READER_THREADS];
+    uint32_t readerCount = 0;
+    pthread_mutex_t readLock = PTHREAD_MUTEX_INITIALIZER;
+    pthread_cond_t readCond = PTHREAD_COND_INITIALIZER;
+    CAsyncIoRequest* readHead = nullptr;
+    CAsyncIoRequest* readTail = nullptr;
+    CAsyncIoRequest* doneHead = nullptr;
+    CAsyncIoRequest* doneTail = nullptr;
+    int32_t stopReaders = 0;
+};
+
+int32_t CAsyncIo::s_disableRing;
+
+static void AsyncIoSignal(int32_t fd) {
+    uint64_t value = 1;
+
+    while (write(fd, &value, sizeof(value)) < 0) {
+        // EAGAIN means the counter is saturated, so the reader is already due
+        // to wake
+        if (errno != EINTR) {
+            break;
+        }
+    }
+}
+
+static void AsyncIoAllocRequests(CAsyncIoPlatform* platform, uint32_t depth) {
+    platform->depth = depth;
+
+    platform->requests = static_cast<CAsyncIoRequest*>(SMemAlloc(platform->depth * sizeof(CAsyncIoRequest), __FILE__, __LINE__, 0x0));
+    platform->freeRequests = static_cast<CAsyncIoRequest**>(SMemAlloc(platform->depth * sizeof(CAsyncIoRequest*), __FILE__, __LINE__, 0x0));
+
+    for (uint32_t i = 0; i < platform->depth; i++) {
+        platform->freeRequests[i] = &platform->requests[i];
+    }
+
+    platform->freeCount = platform->depth;
+}
+
+static int32_t AsyncIoSetup(CAsyncIoPlatform* platform, uint32_t depth) {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    // Fails with ENOSYS on old kernels and EPERM under restrictive seccomp
+    // profiles, in which case workers fall back to synchronous reads
+    int32_t ringFd = syscall(__NR_io_uring_setup, depth, &params);
+
+    if (ringFd < 0) {
+        return 0;
+    }
+
+    platform->ringFd = ringFd;
+
+    platform->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    platform->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+    auto singleMap = params.features & IORING_FEAT_SINGLE_MMAP;
+
+    if (singleMap) {
+        platform->sqRingSize = std::max(platform->sqRingSize, platform->cqRingSize);
+        platform->cqRingSize = platform->sqRingSize;
+    }
+
+    platform->sqRing = mmap(nullptr, platform->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+
+    if (platform->sqRing == MAP_FAILED) {
+        return 0;
+    }
+
+    if (singleMap) {
+        platform->cqRing = platform->sqRing;
+    } else {
+        platform->cqRing = mmap(nullptr, platform->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+
+        if (platform->cqRing == MAP_FAILED) {
+            return 0;
+        }
+    }
+
+    platform->sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    platform->sqes = static_cast<io_uring_sqe*>(mmap(nullptr, platform->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES));
+
+    if (platform->sqes == MAP_FAILED) {
+        return 0;
+    }
+
+    auto sq = static_cast<uint8_t*>(platform->sqRing);
+    platform->sqTail = reinterpret_cast<uint32_t*>(sq + params.sq_off.tail);
+    platform->sqMask = reinterpret_cast<uint32_t*>(sq + params.sq_off.ring_mask);
+    platform->sqArray = reinterpret_cast<uint32_t*>(sq + params.sq_off.array);
+
+    auto cq = static_cast<uint8_t*>(platform->cqRing);
+    platform->cqHead = reinterpret_cast<uint32_t*>(cq + params.cq_off.head);
+    platform->cqTail = reinterpret_cast<uint32_t*>(cq + params.cq_off.tail);
+    platform->cqMask = reinterpret_cast<uint32_t*>(cq + params.cq_off.ring_mask);
+    platform->cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+    // Completions bump the same eventfd that new work does, so an idle worker
+    // sleeps on a single descriptor
+    if (syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_EVENTFD, &platform->wakeFd, 1) < 0) {
+        return 0;
+    }
+
+    AsyncIoAllocRequests(platform, std::min(depth, params.sq_entries));
+
+    return 1;
+}
+
+static void* AsyncIoReaderThread(void* param) {
+    auto platform = static_cast<CAsyncIoPlatform*>(param);
+
+    pthread_mutex_lock(&platform->readLock);
+
+    while (true) {
+        while (!platform->readHead && !platform->stopReaders) {
+            pthread_cond_wait(&platform->readCond, &platform->readLock);
+        }
+
+        if (platform->stopReaders) {
+            break;
+        }
+
+        auto request = platform->readHead;
+        platform->readHead = request->next;
+
+        if (!platform->readHead) {
+            platform->readTail = nullptr;
+        }
+
+        pthread_mutex_unlock(&platform->readLock);
+
+        // Short reads are finished off by AsyncIoFinishRead on the worker
+        ssize_t bytes;
+        do {
+            bytes = pread(request->fd, request->iov.iov_base, request->iov.iov_len, request->offset);
+        } while (bytes < 0 && errno == EINTR);
+
+        request->result = bytes < 0 ? -errno : static_cast<int32_t>(bytes);
+        request->next = nullptr;
+
+        pthread_mutex_lock(&platform->readLock);
+
+        if (platform->doneTail) {
+            platform->doneTail->next = request;
+        } else {
+            platform->doneHead = request;
+        }
+
+        platform->doneTail = request;
+
+        AsyncIoSignal(platform->wakeFd);
+    }
+
+    pthread_mutex_unlock(&platform->readLock);
+
+    return nullptr;
+}
+
+static int32_t AsyncIoSetupReaders(CAsyncIoPlatform* platform, uint32_t depth) {
+    AsyncIoAllocRequests(platform, depth);
+
+    for (uint32_t i = 0; i < ASYNC_IO_READER_THREADS; i++) {
+        if (pthread_create(&platform->readers[i], nullptr, &AsyncIoReaderThread, platform)) {
+            break;
+        }
+
+        platform->readerCount++;
+    }
+
+    return platform->readerCount > 0;
+}
+
+static void AsyncIoStopReaders(CAsyncIoPlatform* platform) {
+    if (!platform->readerCount) {
+        return;
+    }
+
+    pthread_mutex_lock(&platform->readLock);
+    platform->stopReaders = 1;
+    pthread_cond_broadcast(&platform->readCond);
+    pthread_mutex_unlock(&platform->readLock);
+
+    // Readers finish the pread they're in before exiting, so no request is
+    // touched after its buffer is handed back
+    for (uint32_t i = 0; i < platform->readerCount; i++) {
+        pthread_join(platform->readers[i], nullptr);
+    }
+
+    platform->readerCount = 0;
+    platform->readHead = nullptr;
+    platform->readTail = nullptr;
+    platform->doneHead = nullptr;
+    platform->doneTail = nullptr;
+}
+
+static void AsyncIoTeardown(CAsyncIoPlatform* platform) {
+    AsyncIoStopReaders(platform);
+
+    if (platform->sqes != MAP_FAILED) {
+        munmap(platform->sqes, platform->sqesSize);
+    }
+
+    if (platform->cqRing != MAP_FAILED && platform->cqRing != platform->sqRing) {
+        munmap(platform->cqRing, platform->cqRingSize);
+    }
+
+    if (platform->sqRing != MAP_FAILED) {
+        munmap(platform->sqRing, platform->sqRingSize);
+    }
+
+    // The kernel keeps the ring alive until outstanding reads complete
+    if (platform->ringFd >= 0) {
+        close(platform->ringFd);
+    }
+
+    if (platform->requests) {
+        SMemFree(platform->requests, __FILE__, __LINE__, 0);
+    }
+
+    if (platform->freeRequests) {
+        SMemFree(platform->freeRequests, __FILE__, __LINE__, 0);
+    }
+
+    platform->sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    platform->cqRing = MAP_FAILED;
+    platform->sqRing = MAP_FAILED;
+    platform->ringFd = -1;
+    platform->requests = nullptr;
+    platform->freeRequests = nullptr;
+    platform->freeCount = 0;
+    platform->depth = 0;
+}
+
+static void AsyncIoFlush(CAsyncIoPlatform* platform) {
+    while (platform->pendingSubmit) {
+        int32_t submitted = syscall(__NR_io_uring_enter, platform->ringFd, platform->pendingSubmit, 0, 0, nullptr, 0);
+
+        if (submitted < 0) {
+            // EAGAIN and EBUSY clear up once completions are reaped
+            if (errno == EINTR) {
+                continue;
+            }
+
+            break;
+        }
+
+        platform->pendingSubmit -= submitted;
+    }
+}
+
+static int32_t AsyncIoFinishRead(CAsyncIoRequest* request, int32_t result) {
+    if (result < 0) {
+        return 0;
+    }
+
+    // Pick up any short read synchronously
+    size_t total = result;
+    auto buffer = static_cast<uint8_t*>(request->iov.iov_base);
+
+    while (total < request->iov.iov_len) {
+        auto bytes = pread(request->fd, buffer + total, request->iov.iov_len - total, request->offset + total);
+
+        if (bytes < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (bytes <= 0) {
+            return 0;
+        }
+
+        total += bytes;
+    }
+
+    SFile::SetFilePointer(request->object->file, request->offset + total);
+
+    return 1;
+}
+
+int32_t CAsyncIo::CanSubmit() {
+    auto platform = this->m_platform;
+
+    return !platform->depth || platform->freeCount > 0;
+}
+
+// Reads the reader threads haven't started complete at once as failures.
+// Reads already handed to the kernel can't be recalled and finish as usual.
+void CAsyncIo::Cancel() {
+    auto platform = this->m_platform;
+
+    if (!platform || !platform->readerCount) {
+        return;
+    }
+
+    pthread_mutex_lock(&platform->readLock);
+
+    for (auto request = platform->readHead; request; request = request->next) {
+        request->result = -ECANCELED;
+    }
+
+    if (platform->readHead) {
+        if (platform->doneTail) {
+            platform->doneTail->next = platform->readHead;
+        } else {
+            platform->doneHead = platform->readHead;
+        }
+
+        platform->doneTail = platform->readTail;
+        platform->readHead = nullptr;
+        platform->readTail = nullptr;
+    }
+
+    pthread_mutex_unlock(&platform->readLock);
+
+    AsyncIoSignal(platform->wakeFd);
+}
+
+void CAsyncIo::Destroy() {
+    auto platform = this->m_platform;
+
+    if (!platform) {
+        return;
+    }
+
+    AsyncIoTeardown(platform);
+
+    if (platform->wakeFd >= 0) {
+        close(platform->wakeFd);
+    }
+
+    platform->~CAsyncIoPlatform();
+    SMemFree(platform, __FILE__, __LINE__, 0);
+
+    this->m_platform = nullptr;
+    this->m_inFlight = 0;
+}
+
+int32_t CAsyncIo::Initialize(uint32_t depth) {
+    auto m = SMemAlloc(sizeof(CAsyncIoPlatform), __FILE__, __LINE__, 0x0);
+    auto platform = new (m) CAsyncIoPlatform();
+
+    this->m_platform = platform;
+    this->m_inFlight = 0;
+
+    platform->wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    if (platform->wakeFd < 0) {
+        return 0;
+    }
+
+    if (CAsyncIo::s_disableRing || !AsyncIoSetup(platform, depth)) {
+        AsyncIoTeardown(platform);
+
+        // Without io_uring, a few reader threads still keep several reads in
+        // flight. Failing that, the worker reads synchronously.
+        if (!AsyncIoSetupReaders(platform, depth)) {
+            AsyncIoTeardown(platform);
+        }
+    }
+
+    return 1;
+}
+
+static uint32_t AsyncIoReapReaders(CAsyncIoPlatform* platform, CAsyncObject** objects, int32_t* results, uint32_t count) {
+    pthread_mutex_lock(&platform->readLock);
+
+    auto done = platform->doneHead;
+    platform->doneHead = nullptr;
+    platform->doneTail = nullptr;
+
+    pthread_mutex_unlock(&platform->readLock);
+
+    uint32_t reaped = 0;
+
+    while (done && reaped < count) {
+        auto request = done;
+        done = request->next;
+
+        objects[reaped] = request->object;
+        results[reaped] = AsyncIoFinishRead(request, request->result);
+        reaped++;
+
+        platform->freeRequests[platform->freeCount++] = request;
+    }
+
+    // Put back whatever didn't fit, ahead of anything finished since
+    if (done) {
+        pthread_mutex_lock(&platform->readLock);
+
+        auto tail = done;
+        while (tail->next) {
+            tail = tail->next;
+        }
+
+        tail->next = platform->doneHead;
+        platform->doneHead = done;
+
+        if (!platform->doneTail) {
+            platform->doneTail = tail;
+        }
+
+        pthread_mutex_unlock(&platform->readLock);
+    }
+
+    return reaped;
+}
+
+uint32_t CAsyncIo::Reap(CAsyncObject** objects, int32_t* results, uint32_t count) {
+    auto platform = this->m_platform;
+
+    if (platform->readerCount) {
+        auto reaped = AsyncIoReapReaders(platform, objects, results, count);
+        this->m_inFlight -= reaped;
+
+        return reaped;
+    }
+
+    if (platform->ringFd < 0) {
+        return 0;
+    }
+
+    AsyncIoFlush(platform);
+
+    uint32_t reaped = 0;
+    uint32_t head = *platform->cqHead;
+    uint32_t tail = __atomic_load_n(platform->cqTail, __ATOMIC_ACQUIRE);
+
+    while (head != tail && reaped < count) {
+        auto cqe = &platform->cqes[head & *platform->cqMask];
+        auto request = reinterpret_cast<CAsyncIoRequest*>(cqe->user_data);
+
+        objects[reaped] = request->object;
+        results[reaped] = AsyncIoFinishRead(request, cqe->res);
+        reaped++;
+
+        platform->freeRequests[platform->freeCount++] = request;
+        this->m_inFlight--;
+
+        head++;
+    }
+
+    __atomic_store_n(platform->cqHead, head, __ATOMIC_RELEASE);
+
+    return reaped;
+}
+
+int32_t CAsyncIo::Submit(CAsyncObject* object) {
+    auto platform = this->m_platform;
+
+    int32_t fd;
+    uint64_t offset;
+
+    if (!platform->freeCount || !SFile::GetNativeHandle(object->file, &fd, &offset)) {
+        return 0;
+    }
+
+    auto request = platform->freeRequests[--platform->freeCount];
+    request->object = object;
+    request->fd = fd;
+    request->offset = offset;
+    request->iov.iov_base = object->buffer;
+    request->iov.iov_len = object->size;
+    request->result = 0;
+    request->next = nullptr;
+
+    if (platform->readerCount) {
+        pthread_mutex_lock(&platform->readLock);
+
+        if (platform->readTail) {
+            platform->readTail->next = request;
+        } else {
+            platform->readHead = request;
+        }
+
+        platform->readTail = request;
+
+        pthread_cond_signal(&platform->readCond);
+        pthread_mutex_unlock(&platform->readLock);
+
+        this->m_inFlight++;
+
+        return 1;
+    }
+
+    uint32_t tail = *platform->sqTail;
+    uint32_t index = tail & *platform->sqMask;
+
+    auto sqe = &platform->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READV;
+    sqe->fd = fd;
+    sqe->off = offset;
+    sqe->addr = reinterpret_cast<uintptr_t>(&request->iov);
+    sqe->len = 1;
+    sqe->user_data = reinterpret_cast<uintptr_t>(request);
+
+    platform->sqArray[index] = index;
+
+    __atomic_store_n(platform->sqTail, tail + 1, __ATOMIC_RELEASE);
+
+    platform->pendingSubmit++;
+    this->m_inFlight++;
+
+    return 1;
+}
+
+void CAsyncIo::Wait(uint32_t timeout) {
+    auto platform = this->m_platform;
+
+    if (platform->ringFd >= 0) {
+        AsyncIoFlush(platform);
+
+        // Completions may have landed before the eventfd was last drained
+        if (*platform->cqHead != __atomic_load_n(platform->cqTail, __ATOMIC_ACQUIRE)) {
+            return;
+        }
+    }
+
+    if (platform->readerCount) {
+        pthread_mutex_lock(&platform->readLock);
+        auto done = platform->doneHead != nullptr;
+        pthread_mutex_unlock(&platform->readLock);
+
+        if (done) {
+            return;
+        }
+    }
+
+    if (platform->wakeFd < 0) {
+        OsSleep(1);
+        return;
+    }
+
+    // An interrupted poll just returns early; the worker loop checks for
+    // work and waits again
+    pollfd pfd = { platform->wakeFd, POLLIN, 0 };
+
+    if (poll(&pfd, 1, timeout) <= 0) {
+        return;
+    }
+
+    // EAGAIN means another wakeup already drained the counter
+    uint64_t value;
+    while (read(platform->wakeFd, &value, sizeof(value)) < 0 && errno == EINTR) {
+    }
+}
+
+void CAsyncIo::Wake() {
+    if (!this->m_platform || this->m_platform->wakeFd < 0) {
+        return;
+    }
+
+    AsyncIoSignal(this->m_platform->wakeFd);
+}
@@ -1,5 +1,6 @@
 #include "client/Client.hpp"
 #include "async/AsyncFile.hpp"
+#include "async/AsyncFileRead.hpp"
 #include "client/ClientHandlers.hpp"
 #include "client/ClientServices.hpp"
 #include "console/CVar.hpp"
@@ -14,16 +15,64 @@
 #include "net/Poll.hpp"
 #include "ui/FrameScript.hpp"
 #include "ui/FrameXML.hpp"
+#include "util/SFile.hpp"
 #include "world/World.hpp"
+#include <algorithm>
 #include <bc/Debug.hpp>
 #include <common/Prop.hpp>
 #include <storm/Error.hpp>
+#include <storm/String.hpp>
 
 CVar* Client::g_accountListVar;
 HEVENTCONTEXT Client::g_clientEventContext;
 
+static CVar* s_localeVar;
+
 void AsyncFileInitialize() {
     // TODO
+
+    auto streamingVar = CVar::Register(
+        "streamingMode",
+        "Stream game data through separate disk, geometry and texture queues",
+        0,
+        "0",
+        nullptr,
+        5,
+        false,
+        nullptr,
+        false
+    );
+
+    SFile::EnableStreamingMode(streamingVar->GetInt());
+
+    static const char* s_threadVarNames[] = {
+        "asyncDiskThreads",
+        "asyncGeometryThreads",
+        "asyncTextureThreads",
+    };
+
+    static const char* s_threadVarHelp[] = {
+        "Number of threads reading from the disk queue",
+        "Number of threads reading from the net geometry queue",
+        "Number of threads reading from the net texture queue",
+    };
+
+    for (int32_t i = 0; i < NUM_ASYNC_QUEUES; i++) {
+        auto threadVar = CVar::Register(
+            s_threadVarNames[i],
+            s_threadVarHelp[i],
+            0,
+            "1",
+            nullptr,
+            5,
+            false,
+            nullptr,
+            false
+        );
+
+        AsyncFileRead::s_threadCount[i] = std::max(threadVar->GetInt(), 1);
+    }
+
     AsyncFileReadInitialize(0, 100);
 }
 
@@ -31,6 +80,73 @@ void BaseInitializeGlobal() {
     PropInitialize();
 }
 
+void OpenArchives(const char* locale) {
+    // Listed from lowest to highest priority
+    static const char* s_baseArchives[] = {
+        "common.MPQ",
+        "common-2.MPQ",
+        "expansion.MPQ",
+        "lichking.MPQ",
+        "patch.MPQ",
+        "patch-2.MPQ",
+        "patch-3.MPQ",
+    };
+
+    static const char* s_localeArchives[] = {
+        "locale-%s.MPQ",
+        "expansion-locale-%s.MPQ",
+        "lichking-locale-%s.MPQ",
+        "patch-%s.MPQ",
+        "patch-%s-2.MPQ",
+        "patch-%s-3.MPQ",
+    };
+
+    // Archive entries are tagged with Windows language IDs
+    static const struct {
+        const char* name;
+        uint16_t id;
+    } s_localeIds[] = {
+        { "enUS", 0x409 },
+        { "enGB", 0x809 },
+        { "koKR", 0x412 },
+        { "frFR", 0x40C },
+        { "deDE", 0x407 },
+        { "zhCN", 0x804 },
+        { "zhTW", 0x404 },
+        { "esES", 0x40A },
+        { "esMX", 0x80A },
+        { "ruRU", 0x419 },
+    };
+
+    uint16_t localeId = 0;
+
+    for (auto& entry : s_localeIds) {
+        if (!SStrCmp(entry.name, locale, STORM_MAX_STR)) {
+            localeId = entry.id;
+            break;
+        }
+    }
+
+    SFile::SetLocale(localeId);
+
+    int32_t priority = 0;
+    char path[STORM_MAX_PATH];
+    char name[STORM_MAX_PATH];
+    SArchive* archive;
+
+    // Missing archives are skipped so loose data directories keep working
+    for (auto filename : s_baseArchives) {
+        SStrPrintf(path, sizeof(path), "Data\\%s", filename);
+        SFile::OpenArchive(path, priority++, 0, &archive);
+    }
+
+    for (auto filename : s_localeArchives) {
+        SStrPrintf(name, sizeof(name), filename, locale);
+        SStrPrintf(path, sizeof(path), "Data\\%s\\%s", locale, name);
+        SFile::OpenArchive(path, priority++, 0, &archive);
+    }
+}
+
 int32_t ClientIdle(const void* data, void* param) {
     // TODO
     // ClientGameTimeTickHandler(data, param);
@@ -84,9 +200,30 @@ void ClientPostClose(int32_t a1) {
 int32_t DestroyEngineCallback(const void* a1, void* a2) {
     // TODO
 
+    M2Destroy();
+
     return 1;
 }
 
+bool TextureAsyncLoadCallback(CVar* cvar, const char* oldValue, const char* newValue, void* userArg) {
+    Texture::s_createBlpAsync = SStrToInt(newValue) != 0;
+
+    return true;
+}
+
+// Megabytes to bytes, clamped to what the 32-bit budget can hold
+static uint32_t TextureCacheSizeBytes(int32_t megabytes) {
+    auto bytes = static_cast<uint64_t>(megabytes > 0 ? megabytes : 0) << 20;
+
+    return bytes > UINT32_MAX ? UINT32_MAX : static_cast<uint32_t>(bytes);
+}
+
+bool TextureCacheSizeCallback(CVar* cvar, const char* oldValue, const char* newValue, void* userArg) {
+    TextureCacheSetSize(TextureCacheSizeBytes(SStrToInt(newValue)));
+
+    return true;
+}
+
 int32_t InitializeEngineCallback(const void* a1, void* a2) {
     // TODO
     // sub_4D2A30();
@@ -127,19 +264,33 @@ int32_t InitializeEngineCallback(const void* a1, void* a2) {
     //     0
     // );
 
-    // s_cvarTextureCacheSize = CVar::Register(
-    //     "textureCacheSize",
-    //     "Texture cache size in bytes",
-    //     1,
-    //     "32",
-    //     &TextureCacheSizeCallback,
-    //     1,
-    //     0,
-    //     0,
-    //     0
-    // );
+    auto textureCacheSizeVar = CVar::Register(
+        "textureCacheSize",
+        "Texture cache size in megabytes, 0 for no limit",
+        1,
+        "32",
+        &TextureCacheSizeCallback,
+        1,
+        false,
+        nullptr,
+        false
+    );
 
-    // sub_4B6580(*(_DWORD *)(dword_B2F9FC + 48) << 20);
+    TextureCacheSetSize(TextureCacheSizeBytes(textureCacheSizeVar->GetInt()));
+
+    auto textureAsyncLoadVar = CVar::Register(
+        "textureAsyncLoad",
+        "Read and decode BLP textures on the async file threads",
+        1,
+        "1",
+        &TextureAsyncLoadCallback,
+        1,
+        false,
+        nullptr,
+        false
+    );
+
+    Texture::s_createBlpAsync = textureAsyncLoadVar->GetInt() != 0;
 
     // AddConsoleDeviceDefaultCallback(SetDefaults);
 
@@ -167,8 +318,8 @@ int32_t InitializeEngineCallback(const void* a1, void* a2) {
 void Sub405DD0() {
     // TODO
 
-    // TODO get this from the soupy mess of locale checks above
-    auto locale = "enUS";
+    // TODO the soupy mess of locale checks above
+    auto locale = s_localeVar->GetString();
 
     ClientServices::InitLoginServerCVars(1, locale);
 
@@ -215,11 +366,22 @@ int32_t InitializeGlobal() {
 
     // CVar::Register("dbCompress", "Database compression", 0, "-1", 0, 5, 0, 0, 0);
 
-    // v2 = CVar::Register("locale", "Set the game locale", 0, "****", &LocaleChangedCallback, 5, 0, 0, 0);
+    // TODO LocaleChangedCallback
+    s_localeVar = CVar::Register(
+        "locale",
+        "Set the game locale",
+        0,
+        "****",
+        nullptr,
+        5,
+        false,
+        nullptr,
+        false
+    );
 
-    // if (!SStrCmp(v2->m_stringValue.m_str, "****", 0x7FFFFFFFu)) {
-    //     CVar::Set(v2, "enUS", 1, 0, 0, 1);
-    // }
+    if (!SStrCmp(s_localeVar->GetString(), "****", STORM_MAX_STR)) {
+        s_localeVar->Set("enUS", true, false, false, true);
+    }
 
     // CVar::Register("useEnglishAudio", "override the locale and use English audio", 0, "0", 0, 5, 0, 0, 0);
 
@@ -237,6 +399,8 @@ int32_t InitializeGlobal() {
 
     // sub_421B50(dest);
 
+    OpenArchives(s_localeVar->GetString());
+
     // sub_423D70();
 
     Sub405DD0();
@@ -1,9 +1,12 @@
 #include "console/Device.hpp"
 #include "client/Gui.hpp"
+#include "console/Command.hpp"
 #include "console/Console.hpp"
 #include "console/CVar.hpp"
 #include "event/Input.hpp"
 #include "gx/Device.hpp"
+#include "gx/Texture.hpp"
+#include "util/Log.hpp"
 #include <cstring>
 
 CVar* s_cvGxMaximize;
@@ -15,6 +18,23 @@ bool s_hwDetect;
 bool s_hwChanged;
 CGxFormat s_requestedFormat;
 
+int32_t CCTextureStats(const char* command, const char* arguments) {
+    TextureCacheStats stats;
+    TextureCacheGetStats(stats);
+
+    SysMsgPrintf(
+        SYSMSG_INFO,
+        "Textures: %u cached, %u KB resident of %u KB, %u evictions, %u reloads",
+        stats.textures,
+        stats.residentBytes >> 10,
+        stats.cacheSize >> 10,
+        stats.evictions,
+        stats.reloads
+    );
+
+    return 1;
+}
+
 bool CVGxMaximizeCallback(CVar*, const char*, const char*, void*) {
     // TODO
     return true;
@@ -157,6 +177,8 @@ void ConsoleDeviceInitialize(const char* title) {
 
     // TODO ConsoleCommandRegister("gxRestart", &CCGxRestart, 1, nullptr);
 
+    ConsoleCommandRegister("textureStats", &CCTextureStats, GRAPHICS, "Show texture cache usage");
+
     // TODO
 
     // TODO
@@ -1,5 +1,10 @@
 #include "db/Db.hpp"
 #include "db/WowClientDB_Base.hpp"
+#include "db/WowClientDB_Cache.hpp"
+#include "db/WowClientDB_Loader.hpp"
+#include <storm/Error.hpp>
+
+#define DB_LOADER_THREADS 4
 
 WowClientDB<AchievementRec> g_achievementDB;
 WowClientDB<Cfg_CategoriesRec> g_cfg_CategoriesDB;
@@ -7,8 +12,18 @@ WowClientDB<Cfg_ConfigsRec> g_cfg_ConfigsDB;
 WowClientDB<ChrRacesRec> g_chrRacesDB;
 WowClientDB<MapRec> g_mapDB;
 
+static WowClientDB_Loader s_staticDBLoader;
+
 void LoadDB(WowClientDB_Base* db, const char* filename, int32_t linenumber) {
     db->Load(filename, linenumber);
+
+    if (db->m_error[0]) {
+        SErrDisplayAppFatal("%s", db->m_error);
+    }
+};
+
+void QueueDB(WowClientDB_Base* db, const char* filename, int32_t linenumber) {
+    s_staticDBLoader.Add(db, filename, linenumber);
 };
 
 void StaticDBLoadAll(void (*loadFn)(WowClientDB_Base*, const char*, int32_t)) {
@@ -22,7 +37,17 @@ void StaticDBLoadAll(void (*loadFn)(WowClientDB_Base*, const char*, int32_t)) {
 void ClientDBInitialize() {
     // TODO
 
-    StaticDBLoadAll(LoadDB);
+    WowClientDB_Cache::SetDirectory("Cache\\DBFilesClient");
+
+    // Static tables don't depend on each other, so load them concurrently and
+    // join before anything can look at them
+    StaticDBLoadAll(QueueDB);
+
+    auto failedDB = s_staticDBLoader.Run(DB_LOADER_THREADS);
+
+    if (failedDB) {
+        SErrDisplayAppFatal("%s", failedDB->m_error);
+    }
 
     // TODO
 }
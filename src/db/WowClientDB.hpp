@@ -2,6 +2,7 @@
 #define DB_WOW_CLIENT_DB_HPP
 
 #include "db/IDatabase.hpp"
+#include "db/WowClientDB_Cache.hpp"
 #include "db/WowClientDB_Common.hpp"
 #include <cstring>
 #include <storm/Error.hpp>
@@ -10,6 +11,23 @@
 template <class T>
 class WowClientDB : public WowClientDB_Common<T>, IDatabase<T> {
     public:
+        // Types
+        struct Layout {
+            int32_t canMemcpy;
+            int32_t canCopy;
+            uint32_t fieldCount;
+            uint32_t stringCount;
+            uint32_t fieldOffsets[sizeof(T) / sizeof(uint32_t) + 1];
+            uint32_t fieldColumns[sizeof(T) / sizeof(uint32_t) + 1];
+            uint32_t stringOffsets[sizeof(T) / sizeof(const char*) + 1];
+            uint32_t stringColumns[sizeof(T) / sizeof(const char*) + 1];
+        };
+
+        // Static functions
+        static void CopyRow(const Layout& layout, const uint8_t* row, const char* strings, T* record);
+        static const Layout& GetLayout();
+        static Layout ProbeLayout();
+
         // Virtual member functions
         virtual void Load(const char* filename, int32_t linenumber);
         virtual void LoadRecords(SFile* f, const char* filename, int32_t linenumber);
@@ -19,8 +37,141 @@ class WowClientDB : public WowClientDB_Common<T>, IDatabase<T> {
         // Member functions
         T* GetRecordByIndex(int32_t index) const;
         int32_t GetNumRecords();
+        int32_t LoadCache(SFile* f, const WowClientDB_Cache::Header& expected);
+        void SaveCache(WowClientDB_Cache::Header* header);
 };
 
+template <class T>
+void WowClientDB<T>::CopyRow(const Layout& layout, const uint8_t* row, const char* strings, T* record) {
+    auto fields = reinterpret_cast<uint8_t*>(record);
+
+    for (uint32_t i = 0; i < layout.fieldCount; i++) {
+        memcpy(&fields[layout.fieldOffsets[i]], &row[layout.fieldColumns[i]], sizeof(uint32_t));
+    }
+
+    for (uint32_t i = 0; i < layout.stringCount; i++) {
+        uint32_t offset;
+        memcpy(&offset, &row[layout.stringColumns[i]], sizeof(offset));
+
+        auto string = &strings[offset];
+        memcpy(&fields[layout.stringOffsets[i]], &string, sizeof(string));
+    }
+}
+
+template <class T>
+const typename WowClientDB<T>::Layout& WowClientDB<T>::GetLayout() {
+    static const Layout s_layout = WowClientDB<T>::ProbeLayout();
+
+    return s_layout;
+}
+
+// The generated records only know how to read themselves column by column
+// from a file. Reading probe rows through that tells which column each field
+// and string comes from, so rows can be decoded without a read per column.
+// Records that don't map onto whole columns keep reading themselves.
+template <class T>
+typename WowClientDB<T>::Layout WowClientDB<T>::ProbeLayout() {
+    Layout layout = {};
+
+    auto rowSize = T::GetRowSize();
+    auto columns = rowSize / sizeof(uint32_t);
+    auto row = static_cast<uint32_t*>(SMemAlloc(rowSize, __FILE__, __LINE__, 0x0));
+    auto strings = static_cast<char*>(SMemAlloc(columns + 1, __FILE__, __LINE__, 0x0));
+    memset(strings, 0, columns + 1);
+
+    SFile* file;
+    SFile::OpenMemory(row, rowSize, &file);
+
+    T record;
+    T copy;
+    auto fields = reinterpret_cast<uint8_t*>(&record);
+
+    // A zeroed row points every string field at the start of the block
+    const char* probe = strings;
+
+    memset(row, 0, rowSize);
+    memset(&record, 0, sizeof(record));
+    record.Read(file, strings);
+
+    for (uint32_t offset = 0; offset + sizeof(probe) <= sizeof(record); offset += alignof(const char*)) {
+        if (!memcmp(&fields[offset], &probe, sizeof(probe))) {
+            layout.stringOffsets[layout.stringCount++] = offset;
+        }
+    }
+
+    // Numbering the columns from 1 shows where each one lands
+    for (uint32_t i = 0; i < columns; i++) {
+        row[i] = i + 1;
+    }
+
+    SFile::SetFilePointer(file, 0);
+    memset(&record, 0, sizeof(record));
+    record.Read(file, strings);
+
+    layout.canCopy = 1;
+
+    for (uint32_t i = 0; i < layout.stringCount; i++) {
+        const char* string;
+        memcpy(&string, &fields[layout.stringOffsets[i]], sizeof(string));
+
+        auto column = string - strings;
+
+        if (column < 1 || column > static_cast<intptr_t>(columns)) {
+            layout.canCopy = 0;
+            break;
+        }
+
+        layout.stringColumns[i] = (column - 1) * sizeof(uint32_t);
+    }
+
+    for (uint32_t offset = 0; offset + sizeof(uint32_t) <= sizeof(record); offset += sizeof(uint32_t)) {
+        auto isString = false;
+
+        for (uint32_t i = 0; i < layout.stringCount; i++) {
+            isString = isString || (offset >= layout.stringOffsets[i] && offset < layout.stringOffsets[i] + sizeof(const char*));
+        }
+
+        uint32_t value;
+        memcpy(&value, &fields[offset], sizeof(value));
+
+        if (!isString && value >= 1 && value <= columns) {
+            layout.fieldOffsets[layout.fieldCount] = offset;
+            layout.fieldColumns[layout.fieldCount++] = (value - 1) * sizeof(uint32_t);
+        }
+    }
+
+    memset(&copy, 0, sizeof(copy));
+    WowClientDB<T>::CopyRow(layout, reinterpret_cast<uint8_t*>(row), strings, &copy);
+
+    layout.canCopy = layout.canCopy && !memcmp(&record, &copy, sizeof(record));
+
+    // Scattered words check the copy doesn't agree only by chance. Rows that
+    // come back unchanged can be copied whole.
+    for (uint32_t i = 0; i < columns; i++) {
+        row[i] = 0x9E3779B9 * (i + 1);
+    }
+
+    for (uint32_t i = 0; layout.canCopy && i < layout.stringCount; i++) {
+        row[layout.stringColumns[i] / sizeof(uint32_t)] = 0;
+    }
+
+    SFile::SetFilePointer(file, 0);
+    memset(&record, 0, sizeof(record));
+    record.Read(file, strings);
+
+    memset(&copy, 0, sizeof(copy));
+    WowClientDB<T>::CopyRow(layout, reinterpret_cast<uint8_t*>(row), strings, &copy);
+
+    layout.canCopy = layout.canCopy && !memcmp(&record, &copy, sizeof(record));
+    layout.canMemcpy = !layout.stringCount && sizeof(T) == rowSize && !memcmp(&record, row, rowSize);
+
+    SFile::Close(file);
+    SMemFree(strings, __FILE__, __LINE__, 0);
+    SMemFree(row, __FILE__, __LINE__, 0);
+
+    return layout;
+}
+
 template <class T>
 int32_t WowClientDB<T>::GetNumRecords() {
     return this->m_numRecords;
@@ -58,40 +209,44 @@ T* WowClientDB<T>::GetRecord(int32_t id) {
         return nullptr;
     }
 
-    return this->m_recordsById[id - this->m_minID];
+    if (this->m_recordsById) {
+        return this->m_recordsById[id - this->m_minID];
+    }
+
+    auto index = this->FindHashIndex(id);
+
+    return index >= 0 ? &this->m_records[index] : nullptr;
 }
 
 template <class T>
 void WowClientDB<T>::Load(const char* filename, int32_t linenumber) {
     if (this->m_loaded) {
-        // TODO
-        // SErrDisplayAppFatalCustom(0x85100079, "%s already loaded! Aborting to prevent memory leak!", T::GetFilename());
+        this->SetError("%s already loaded! Aborting to prevent memory leak!", T::GetFilename());
         return;
     }
 
     SFile* f;
     if (!SFile::OpenEx(nullptr, T::GetFilename(), 0x20000, &f)) {
-        // TODO
-        // SErrDisplayAppFatalCustom(0x85100079, "Unable to open %s", T::GetFilename());
+        this->SetError("Unable to open %s", T::GetFilename());
         return;
     }
 
     uint32_t signature;
     if (!SFile::Read(f, &signature, sizeof(signature), nullptr, nullptr, nullptr)) {
-        // TODO
-        // SErrDisplayAppFatalCustom(0x85100079, "Unable to read signature from %s", T::GetFilename());
+        this->SetError("Unable to read signature from %s", T::GetFilename());
+        SFile::Close(f);
         return;
     }
 
     if (signature != 'CBDW') {
-        // TODO
-        // SErrDisplayAppFatalCustom(0x85100079, "Invalid signature 0x%x from %s", signature, T::GetFilename());
+        this->SetError("Invalid signature 0x%x from %s", signature, T::GetFilename());
+        SFile::Close(f);
         return;
     }
 
     if (!SFile::Read(f, &this->m_numRecords, sizeof(this->m_numRecords), nullptr, nullptr, nullptr)) {
-        // TODO
-        // SErrDisplayAppFatalCustom(0x85100079, "Unable to read record count from %s", T::GetFilename());
+        this->SetError("Unable to read record count from %s", T::GetFilename());
+        SFile::Close(f);
         return;
     }
 
@@ -102,34 +257,56 @@ void WowClientDB<T>::Load(const char* filename, int32_t linenumber) {
 
     uint32_t columnCount;
     if (!SFile::Read(f, &columnCount, sizeof(columnCount), nullptr, nullptr, nullptr)) {
-        // TODO
-        // SErrDisplayAppFatalCustom(0x85100079, "Unable to read column count from %s", T::GetFilename());
+        this->SetError("Unable to read column count from %s", T::GetFilename());
+        SFile::Close(f);
         return;
     }
 
     if (columnCount != T::GetNumColumns()) {
-        // TODO
-        // SErrDisplayAppFatalCustom(0x85100079, "%s has wrong number of columns (found %i, expected %i)", T::GetFilename(), columnCount, T::GetNumColumns());
+        this->SetError("%s has wrong number of columns (found %i, expected %i)", T::GetFilename(), columnCount, T::GetNumColumns());
+        SFile::Close(f);
         return;
     }
 
     uint32_t rowSize;
     if (!SFile::Read(f, &rowSize, sizeof(rowSize), nullptr, nullptr, nullptr)) {
-        // TODO
-        // SErrDisplayAppFatalCustom(0x85100079, "Unable to read row size from %s", T::GetFilename());
+        this->SetError("Unable to read row size from %s", T::GetFilename());
+        SFile::Close(f);
         return;
     }
 
     if (rowSize != T::GetRowSize()) {
-        // TODO
-        // SErrDisplayAppFatalCustom(0x85100079, "%s has wrong row size (found %i, expected %i)", T::GetFilename(), rowSize, T::GetRowSize());
+        this->SetError("%s has wrong row size (found %i, expected %i)", T::GetFilename(), rowSize, T::GetRowSize());
+        SFile::Close(f);
         return;
     }
 
     uint32_t stringSize;
     if (!SFile::Read(f, &stringSize, sizeof(stringSize), nullptr, nullptr, nullptr)) {
-        // TODO
-        // SErrDisplayAppFatalCustom(0x85100079, "Unable to read string size from %s", T::GetFilename());
+        this->SetError("Unable to read string size from %s", T::GetFilename());
+        SFile::Close(f);
+        return;
+    }
+
+    auto& recordLayout = WowClientDB<T>::GetLayout();
+
+    uint32_t layout[] = {
+        T::GetNumColumns(),
+        T::GetRowSize(),
+        static_cast<uint32_t>(sizeof(T)),
+        static_cast<uint32_t>(recordLayout.canMemcpy),
+        recordLayout.stringCount,
+        T::NeedIDAssigned()
+    };
+
+    auto layoutHash = WowClientDB_Cache::Checksum(layout, sizeof(layout), 0x811C9DC5);
+
+    WowClientDB_Cache::Header cacheHeader;
+    auto cacheable = WowClientDB_Cache::Prepare(f, layoutHash, sizeof(T), &cacheHeader);
+
+    if (cacheable && this->LoadCache(f, cacheHeader)) {
+        SFile::Close(f);
+        this->m_loaded = 1;
         return;
     }
 
@@ -141,28 +318,187 @@ void WowClientDB<T>::Load(const char* filename, int32_t linenumber) {
 
     this->LoadRecords(f, filename, linenumber);
 
+    if (this->m_error[0]) {
+        SFile::Close(f);
+        return;
+    }
+
     if (!SFile::Read(f, const_cast<char*>(this->m_strings), stringSize, nullptr, nullptr, nullptr)) {
-        SErrDisplayAppFatal("%s: Cannot read string table", T::GetFilename());
+        this->SetError("%s: Cannot read string table", T::GetFilename());
+        SFile::Close(f);
+        return;
+    }
+
+    if (cacheable) {
+        cacheable = WowClientDB_Cache::Hash(f, 0, &cacheHeader.sourceHash);
     }
 
     SFile::Close(f);
 
+    if (cacheable) {
+        cacheHeader.stringSize = stringSize;
+        this->SaveCache(&cacheHeader);
+    }
+
     this->m_loaded = 1;
 }
 
+template <class T>
+int32_t WowClientDB<T>::LoadCache(SFile* f, const WowClientDB_Cache::Header& expected) {
+    // On a miss the table is read on from just past its header
+    auto header = WowClientDB_Cache::Map(T::GetFilename(), expected, f, sizeof(uint32_t) * 5);
+
+    if (!header) {
+        return 0;
+    }
+
+    // The image stays mapped for the life of the table
+    auto image = reinterpret_cast<uint8_t*>(header);
+
+    this->m_numRecords = header->numRecords;
+    this->m_minID = header->minID;
+    this->m_maxID = header->maxID;
+    this->m_records = reinterpret_cast<T*>(&image[header->recordsOffset]);
+    this->m_strings = reinterpret_cast<const char*>(&image[header->stringsOffset]);
+
+    auto& layout = WowClientDB<T>::GetLayout();
+
+    for (uint32_t i = 0; i < this->m_numRecords; i++) {
+        auto fields = reinterpret_cast<uint8_t*>(&this->m_records[i]);
+
+        for (uint32_t j = 0; j < layout.stringCount; j++) {
+            const char* string;
+            memcpy(&string, &fields[layout.stringOffsets[j]], sizeof(string));
+
+            auto offset = reinterpret_cast<uintptr_t>(string) - header->stringBase;
+            string = offset < header->stringSize ? &this->m_strings[offset] : "";
+
+            memcpy(&fields[layout.stringOffsets[j]], &string, sizeof(string));
+        }
+    }
+
+    if (header->indexType == DB_CACHE_INDEX_DENSE) {
+        // Slots hold row index + 1 and are rewritten in place as pointers,
+        // which are never wider than a slot
+        auto slots = reinterpret_cast<uint64_t*>(&image[header->indexOffset]);
+        auto recordsById = reinterpret_cast<T**>(slots);
+        auto count = this->m_maxID - this->m_minID + 1;
+
+        for (int32_t i = 0; i < count; i++) {
+            auto slot = slots[i];
+            recordsById[i] = slot && slot <= static_cast<uint64_t>(this->m_numRecords) ? &this->m_records[slot - 1] : nullptr;
+        }
+
+        this->m_recordsById = recordsById;
+    } else if (header->indexType == DB_CACHE_INDEX_HASH) {
+        this->m_idHash = reinterpret_cast<WowClientDB_Base::IdSlot*>(&image[header->indexOffset]);
+        this->m_idHashSize = header->idHashSize;
+        this->m_idHashShift = header->idHashShift;
+    }
+
+    return 1;
+}
+
+template <class T>
+void WowClientDB<T>::SaveCache(WowClientDB_Cache::Header* header) {
+    header->numRecords = this->m_numRecords;
+    header->minID = this->m_minID;
+    header->maxID = this->m_maxID;
+    header->stringBase = reinterpret_cast<uintptr_t>(this->m_strings);
+
+    if (this->m_recordsById) {
+        auto count = this->m_maxID - this->m_minID + 1;
+        auto indexBytes = sizeof(uint64_t) * count;
+        auto slots = static_cast<uint64_t*>(SMemAlloc(indexBytes, __FILE__, __LINE__, 0x0));
+
+        for (int32_t i = 0; i < count; i++) {
+            auto record = this->m_recordsById[i];
+            slots[i] = record ? record - this->m_records + 1 : 0;
+        }
+
+        header->indexType = DB_CACHE_INDEX_DENSE;
+        WowClientDB_Cache::Write(T::GetFilename(), header, this->m_records, this->m_strings, slots, indexBytes);
+
+        SMemFree(slots, __FILE__, __LINE__, 0);
+    } else if (this->m_idHash) {
+        header->indexType = DB_CACHE_INDEX_HASH;
+        header->idHashSize = this->m_idHashSize;
+        header->idHashShift = this->m_idHashShift;
+
+        WowClientDB_Cache::Write(T::GetFilename(), header, this->m_records, this->m_strings, this->m_idHash, sizeof(WowClientDB_Base::IdSlot) * this->m_idHashSize);
+    } else {
+        header->indexType = DB_CACHE_INDEX_NONE;
+        WowClientDB_Cache::Write(T::GetFilename(), header, this->m_records, this->m_strings, nullptr, 0);
+    }
+}
+
 template <class T>
 void WowClientDB<T>::LoadRecords(SFile* f, const char* filename, int32_t linenumber) {
     auto records = SMemAlloc(sizeof(T) * this->m_numRecords, filename, linenumber, 0x0);
     this->m_records = static_cast<T*>(records);
 
+    // Pull the whole record block in with a single read and decode rows from
+    // memory. Records whose layout matches the file row are copied as is, the
+    // rest column by column as ProbeLayout mapped them.
+    auto& layout = WowClientDB<T>::GetLayout();
+    auto rowSize = T::GetRowSize();
+    auto rowBytes = static_cast<size_t>(rowSize) * this->m_numRecords;
+
+    if (layout.canMemcpy) {
+        if (!SFile::Read(f, this->m_records, rowBytes, nullptr, nullptr, nullptr)) {
+            this->SetError("%s: Cannot read records", T::GetFilename());
+            return;
+        }
+    } else {
+        auto rows = static_cast<uint8_t*>(SMemAlloc(rowBytes, __FILE__, __LINE__, 0x0));
+
+        if (!SFile::Read(f, rows, rowBytes, nullptr, nullptr, nullptr)) {
+            SMemFree(rows, __FILE__, __LINE__, 0);
+            this->SetError("%s: Cannot read records", T::GetFilename());
+            return;
+        }
+
+        if (layout.canCopy) {
+            for (uint32_t i = 0; i < this->m_numRecords; i++) {
+                WowClientDB<T>::CopyRow(layout, &rows[i * rowSize], this->m_strings, &this->m_records[i]);
+            }
+        } else {
+            SFile* block;
+            SFile::OpenMemory(rows, rowBytes, &block);
+
+            for (uint32_t i = 0; i < this->m_numRecords; i++) {
+                this->m_records[i].Read(block, this->m_strings);
+            }
+
+            SFile::Close(block);
+        }
+
+        SMemFree(rows, __FILE__, __LINE__, 0);
+    }
+
     for (uint32_t i = 0; i < this->m_numRecords; i++) {
         auto record = &this->m_records[i];
-        record->Read(f, this->m_strings);
 
         this->m_maxID = record->GetID() > this->m_maxID ? record->GetID() : this->m_maxID;
         this->m_minID = record->GetID() < this->m_minID ? record->GetID() : this->m_minID;
     }
 
+    if (this->m_numRecords == 0) {
+        return;
+    }
+
+    // Tables with sparse or widely spread IDs get a hash index instead of a
+    // pointer per ID in range
+    if (!this->UseDenseIndex()) {
+        this->InitHashIndex();
+
+        for (uint32_t i = 0; i < this->m_numRecords; i++) {
+            this->AddHashIndex(this->m_records[i].GetID(), i);
+        }
+
+        return;
+    }
+
     auto recordsById = SMemAlloc(sizeof(void*) * (this->m_maxID - this->m_minID + 1), __FILE__, __LINE__, 0x0);
     memset(recordsById, 0, sizeof(void*) * (this->m_maxID - this->m_minID + 1));
     this->m_recordsById = static_cast<T**>(recordsById);
@@ -0,0 +1,77 @@
+#include "db/WowClientDB_Base.hpp"
+#include <cstdarg>
+#include <cstdio>
+#include <storm/Memory.hpp>
+
+static uint32_t HashId(int32_t id, uint32_t shift) {
+    return (static_cast<uint32_t>(id) * 2654435761u) >> shift;
+}
+
+void WowClientDB_Base::AddHashIndex(int32_t id, int32_t index) {
+    auto mask = this->m_idHashSize - 1;
+
+    for (auto slot = HashId(id, this->m_idHashShift); ; slot = (slot + 1) & mask) {
+        auto entry = &this->m_idHash[slot];
+
+        // Later rows win, as they do in the dense index
+        if (entry->index < 0 || entry->id == id) {
+            entry->id = id;
+            entry->index = index;
+            return;
+        }
+    }
+}
+
+int32_t WowClientDB_Base::FindHashIndex(int32_t id) const {
+    auto mask = this->m_idHashSize - 1;
+
+    for (auto slot = HashId(id, this->m_idHashShift); ; slot = (slot + 1) & mask) {
+        auto entry = &this->m_idHash[slot];
+
+        if (entry->index < 0) {
+            return -1;
+        }
+
+        if (entry->id == id) {
+            return entry->index;
+        }
+    }
+}
+
+void WowClientDB_Base::InitHashIndex() {
+    // Keep the table at most half full so probe runs stay short
+    uint32_t bits = 1;
+
+    while ((1u << bits) < static_cast<uint32_t>(this->m_numRecords) * 2) {
+        bits++;
+    }
+
+    this->m_idHashSize = 1u << bits;
+    this->m_idHashShift = 32 - bits;
+
+    this->m_idHash = static_cast<IdSlot*>(SMemAlloc(sizeof(IdSlot) * this->m_idHashSize, __FILE__, __LINE__, 0x0));
+
+    for (uint32_t i = 0; i < this->m_idHashSize; i++) {
+        this->m_idHash[i].id = 0;
+        this->m_idHash[i].index = -1;
+    }
+}
+
+// Load failures are recorded rather than raised so loaders running on worker
+// threads can report them in a fixed order. Only the first error is kept.
+void WowClientDB_Base::SetError(const char* format, ...) {
+    if (this->m_error[0]) {
+        return;
+    }
+
+    va_list args;
+    va_start(args, format);
+    vsnprintf(this->m_error, sizeof(this->m_error), format, args);
+    va_end(args);
+}
+
+int32_t WowClientDB_Base::UseDenseIndex() const {
+    auto range = static_cast<int64_t>(this->m_maxID) - this->m_minID + 1;
+
+    return range <= static_cast<int64_t>(this->m_numRecords) * DB_DENSE_INDEX_MAX_SPREAD;
+}
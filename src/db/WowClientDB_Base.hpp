@@ -4,19 +4,42 @@
 #include "util/SFile.hpp"
 #include <cstdint>
 
+#define DB_ERROR_LENGTH 256
+
+// ID ranges with at most one record per this many IDs are indexed by hash
+// rather than by a dense pointer array
+#define DB_DENSE_INDEX_MAX_SPREAD 4
+
 class WowClientDB_Base {
     public:
+        // Types
+        struct IdSlot {
+            int32_t id;
+            int32_t index;
+        };
+
         // Member variables
         int32_t m_loaded = 0;
         int32_t m_numRecords = 0;
         int32_t m_maxID = -1;
         int32_t m_minID = 0xFFFFFFF;
         const char* m_strings = nullptr;
+        char m_error[DB_ERROR_LENGTH] = {};
+        IdSlot* m_idHash = nullptr;
+        uint32_t m_idHashSize = 0;
+        uint32_t m_idHashShift = 32;
 
         // Virtual member functions
         virtual void Load(const char* filename, int32_t linenumber) = 0;
         virtual void LoadRecords(SFile* f, const char* filename, int32_t linenumber) = 0;
         virtual int32_t GetRecordByIndex(int32_t index, void* ptr) const = 0;
+
+        // Member functions
+        void AddHashIndex(int32_t id, int32_t index);
+        int32_t FindHashIndex(int32_t id) const;
+        void InitHashIndex();
+        void SetError(const char* format, ...);
+        int32_t UseDenseIndex() const;
 };
 
 #endif
@@ -0,0 +1,319 @@
+#include "db/WowClientDB_Cache.hpp"
+#include "db/WowClientDB_Base.hpp"
+#include "util/Filesystem.hpp"
+#include "util/Locale.hpp"
+#include "util/SFile.hpp"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <storm/Memory.hpp>
+
+#if defined(WHOA_SYSTEM_MAC) || defined(WHOA_SYSTEM_LINUX)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+char WowClientDB_Cache::s_directory[STORM_MAX_PATH];
+
+static uint64_t CacheAlign(uint64_t offset) {
+    return (offset + 7) & ~static_cast<uint64_t>(7);
+}
+
+static void CacheRelease(void* base, size_t size) {
+#if defined(WHOA_SYSTEM_MAC) || defined(WHOA_SYSTEM_LINUX)
+    munmap(base, size);
+#else
+    SMemFree(base, __FILE__, __LINE__, 0);
+#endif
+}
+
+static int32_t CacheValidate(const WowClientDB_Cache::Header* header, uint64_t size, const WowClientDB_Cache::Header& expected) {
+    if (
+        header->magic != expected.magic
+        || header->version != expected.version
+        || header->layoutHash != expected.layoutHash
+        || header->recordSize != expected.recordSize
+        || header->pointerSize != expected.pointerSize
+        || header->locale != expected.locale
+        || header->sourceSize != expected.sourceSize
+        || header->fileSize != size
+    ) {
+        return 0;
+    }
+
+    // Bounds are checked before the checksum so a damaged header can't send
+    // the table outside the image
+    uint64_t indexBytes = 0;
+
+    if (header->indexType == DB_CACHE_INDEX_DENSE) {
+        indexBytes = (static_cast<int64_t>(header->maxID) - header->minID + 1) * sizeof(uint64_t);
+    } else if (header->indexType == DB_CACHE_INDEX_HASH) {
+        if (header->idHashSize == 0 || (header->idHashSize & (header->idHashSize - 1)) || (1ull << (32 - header->idHashShift)) != header->idHashSize) {
+            return 0;
+        }
+
+        indexBytes = static_cast<uint64_t>(header->idHashSize) * sizeof(WowClientDB_Base::IdSlot);
+    } else if (header->indexType != DB_CACHE_INDEX_NONE) {
+        return 0;
+    }
+
+    if (
+        header->numRecords < 0
+        || header->maxID < header->minID
+        || header->recordsOffset != CacheAlign(sizeof(WowClientDB_Cache::Header))
+        || header->stringsOffset != CacheAlign(header->recordsOffset + static_cast<uint64_t>(header->numRecords) * header->recordSize)
+        || header->indexOffset != CacheAlign(header->stringsOffset + header->stringSize)
+        || header->indexOffset + indexBytes != size
+    ) {
+        return 0;
+    }
+
+    auto copy = *header;
+    copy.checksum = 0;
+
+    auto checksum = WowClientDB_Cache::Checksum(&copy, sizeof(copy), 0x811C9DC5);
+    checksum = WowClientDB_Cache::Checksum(header + 1, size - sizeof(*header), checksum);
+
+    return checksum == header->checksum;
+}
+
+uint32_t WowClientDB_Cache::Checksum(const void* data, size_t bytes, uint32_t hash) {
+    auto ptr = static_cast<const uint8_t*>(data);
+    auto end = ptr + bytes;
+
+    // FNV-1a over 32-bit words, then any trailing bytes
+    for (; ptr + sizeof(uint32_t) <= end; ptr += sizeof(uint32_t)) {
+        uint32_t word;
+        memcpy(&word, ptr, sizeof(word));
+        hash = (hash ^ word) * 0x01000193;
+    }
+
+    for (; ptr < end; ptr++) {
+        hash = (hash ^ *ptr) * 0x01000193;
+    }
+
+    return hash;
+}
+
+void WowClientDB_Cache::GetPath(const char* dbFilename, char* path, size_t size) {
+    auto name = dbFilename;
+
+    for (auto ptr = dbFilename; *ptr; ptr++) {
+        if (*ptr == '\\' || *ptr == '/') {
+            name = ptr + 1;
+        }
+    }
+
+    SStrPrintf(path, size, "%s/%s.cache", WowClientDB_Cache::s_directory, name);
+}
+
+int32_t WowClientDB_Cache::Hash(SFile* f, uint64_t resume, uint32_t* hash) {
+    if (!SFile::SetFilePointer(f, 0)) {
+        return 0;
+    }
+
+    auto chunk = static_cast<uint8_t*>(SMemAlloc(DB_CACHE_READ_CHUNK, __FILE__, __LINE__, 0x0));
+    uint64_t remaining = SFile::GetFileSize(f, nullptr);
+    uint32_t value = 0x811C9DC5;
+    int32_t result = 1;
+
+    while (remaining) {
+        auto bytes = static_cast<size_t>(remaining < DB_CACHE_READ_CHUNK ? remaining : DB_CACHE_READ_CHUNK);
+
+        if (!SFile::Read(f, chunk, bytes, nullptr, nullptr, nullptr)) {
+            result = 0;
+            break;
+        }
+
+        value = WowClientDB_Cache::Checksum(chunk, bytes, value);
+        remaining -= bytes;
+    }
+
+    SMemFree(chunk, __FILE__, __LINE__, 0);
+
+    *hash = value;
+
+    return SFile::SetFilePointer(f, resume) && result;
+}
+
+WowClientDB_Cache::Header* WowClientDB_Cache::Map(const char* dbFilename, const Header& expected, SFile* f, uint64_t resume) {
+    char path[STORM_MAX_PATH];
+    WowClientDB_Cache::GetPath(dbFilename, path, sizeof(path));
+
+#if defined(WHOA_SYSTEM_MAC) || defined(WHOA_SYSTEM_LINUX)
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    struct stat info;
+
+    if (fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(Header))) {
+        close(fd);
+        return nullptr;
+    }
+
+    size_t size = info.st_size;
+
+    // Private so pointer fixups stay in this process
+    auto base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (base == MAP_FAILED) {
+        return nullptr;
+    }
+#else
+    std::ifstream stream(path, std::ios::in | std::ios::binary | std::ios::ate);
+
+    if (!stream.is_open()) {
+        return nullptr;
+    }
+
+    size_t size = stream.tellg();
+
+    if (size < sizeof(Header)) {
+        return nullptr;
+    }
+
+    auto base = SMemAlloc(size, __FILE__, __LINE__, 0x0);
+
+    stream.seekg(0, std::ios::beg);
+
+    if (!stream.read(static_cast<char*>(base), size)) {
+        SMemFree(base, __FILE__, __LINE__, 0);
+        return nullptr;
+    }
+#endif
+
+    auto header = static_cast<Header*>(base);
+
+    if (!CacheValidate(header, size, expected)) {
+        CacheRelease(base, size);
+        return nullptr;
+    }
+
+    if (header->sourceTime == expected.sourceTime) {
+        return header;
+    }
+
+    // A newer time stamp on a table of the same size is the one case that
+    // needs its bytes read. When they still match, the image is stamped with
+    // the new time so later loads skip the hash.
+    uint32_t sourceHash;
+
+    if (!WowClientDB_Cache::Hash(f, resume, &sourceHash) || sourceHash != header->sourceHash) {
+        CacheRelease(base, size);
+        return nullptr;
+    }
+
+    header->sourceTime = expected.sourceTime;
+    header->checksum = 0;
+
+    auto checksum = WowClientDB_Cache::Checksum(header, sizeof(*header), 0x811C9DC5);
+    header->checksum = WowClientDB_Cache::Checksum(header + 1, size - sizeof(*header), checksum);
+
+    std::fstream stamp(path, std::ios::in | std::ios::out | std::ios::binary);
+
+    if (stamp.is_open()) {
+        stamp.write(reinterpret_cast<char*>(header), sizeof(*header));
+    }
+
+    return header;
+}
+
+int32_t WowClientDB_Cache::Prepare(SFile* f, uint32_t layoutHash, uint32_t recordSize, Header* header) {
+    if (!WowClientDB_Cache::s_directory[0]) {
+        return 0;
+    }
+
+    uint64_t time;
+
+    if (!SFile::GetFileTime(f, &time)) {
+        return 0;
+    }
+
+    memset(header, 0, sizeof(*header));
+
+    header->magic = DB_CACHE_MAGIC;
+    header->version = DB_CACHE_VERSION;
+    header->layoutHash = layoutHash;
+    header->recordSize = recordSize;
+    header->pointerSize = sizeof(void*);
+    header->locale = CURRENT_LANGUAGE;
+    header->sourceSize = SFile::GetFileSize(f, nullptr);
+    header->sourceTime = time;
+
+    return 1;
+}
+
+void WowClientDB_Cache::SetDirectory(const char* directory) {
+    SStrCopy(WowClientDB_Cache::s_directory, directory, sizeof(WowClientDB_Cache::s_directory));
+
+    for (auto ptr = WowClientDB_Cache::s_directory; *ptr; ptr++) {
+        if (*ptr == '\\') {
+            *ptr = '/';
+        }
+    }
+
+    if (WowClientDB_Cache::s_directory[0]) {
+        OsCreateDirectory(WowClientDB_Cache::s_directory, 1);
+    }
+}
+
+int32_t WowClientDB_Cache::Write(const char* dbFilename, Header* header, const void* records, const void* strings, const void* index, size_t indexBytes) {
+    auto recordBytes = static_cast<uint64_t>(header->numRecords) * header->recordSize;
+
+    header->recordsOffset = CacheAlign(sizeof(Header));
+    header->stringsOffset = CacheAlign(header->recordsOffset + recordBytes);
+    header->indexOffset = CacheAlign(header->stringsOffset + header->stringSize);
+    header->fileSize = header->indexOffset + indexBytes;
+    header->checksum = 0;
+
+    auto size = static_cast<size_t>(header->fileSize);
+    auto image = static_cast<uint8_t*>(SMemAlloc(size, __FILE__, __LINE__, 0x0));
+    memset(image, 0, size);
+
+    memcpy(&image[header->recordsOffset], records, recordBytes);
+    memcpy(&image[header->stringsOffset], strings, header->stringSize);
+
+    if (indexBytes) {
+        memcpy(&image[header->indexOffset], index, indexBytes);
+    }
+
+    auto checksum = WowClientDB_Cache::Checksum(header, sizeof(*header), 0x811C9DC5);
+    header->checksum = WowClientDB_Cache::Checksum(&image[sizeof(Header)], size - sizeof(Header), checksum);
+
+    memcpy(image, header, sizeof(*header));
+
+    char path[STORM_MAX_PATH];
+    WowClientDB_Cache::GetPath(dbFilename, path, sizeof(path));
+
+    char tempPath[STORM_MAX_PATH];
+    SStrPrintf(tempPath, sizeof(tempPath), "%s.tmp", path);
+
+    std::ofstream stream(tempPath, std::ios::out | std::ios::binary | std::ios::trunc);
+    auto written = stream.is_open() && stream.write(reinterpret_cast<char*>(image), size);
+    stream.close();
+
+    SMemFree(image, __FILE__, __LINE__, 0);
+
+    if (!written) {
+        remove(tempPath);
+        return 0;
+    }
+
+    // Readers only ever see a complete image
+    if (rename(tempPath, path) != 0) {
+        remove(path);
+
+        if (rename(tempPath, path) != 0) {
+            remove(tempPath);
+            return 0;
+        }
+    }
+
+    return 1;
+}
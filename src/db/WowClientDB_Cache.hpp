@@ -0,0 +1,70 @@
+#ifndef DB_WOW_CLIENT_DB_CACHE_HPP
+#define DB_WOW_CLIENT_DB_CACHE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <storm/String.hpp>
+
+#define DB_CACHE_MAGIC 'DBCC'
+#define DB_CACHE_VERSION 3
+#define DB_CACHE_READ_CHUNK 0x10000
+
+#define DB_CACHE_INDEX_NONE 0
+#define DB_CACHE_INDEX_DENSE 1
+#define DB_CACHE_INDEX_HASH 2
+
+class SFile;
+
+// Decoded tables are saved as a single image: header, record array, string
+// block and ID index, each 8 byte aligned. The image is mapped back as is, so
+// a hit only has to rebase string pointers and the dense index.
+//
+// Images are keyed on the source table's size and time stamp and on a hash
+// of the record layout (column count, row size, record size, flags and what
+// WowClientDB<T>::ProbeLayout finds). The source bytes are only hashed when
+// an image is written, and on a load whose time stamp no longer matches. A
+// change to how a record decodes that keeps that layout isn't visible to the
+// hash, so it needs DB_CACHE_VERSION bumped.
+class WowClientDB_Cache {
+    public:
+        // Types
+        struct Header {
+            uint32_t magic;
+            uint32_t version;
+            uint32_t checksum;
+            uint32_t layoutHash;
+            uint32_t recordSize;
+            uint32_t pointerSize;
+            uint32_t locale;
+            uint32_t sourceHash;
+            uint64_t sourceSize;
+            uint64_t sourceTime;
+            int32_t numRecords;
+            int32_t minID;
+            int32_t maxID;
+            uint32_t stringSize;
+            uint32_t indexType;
+            uint32_t idHashSize;
+            uint32_t idHashShift;
+            uint32_t padding;
+            uint64_t stringBase;
+            uint64_t recordsOffset;
+            uint64_t stringsOffset;
+            uint64_t indexOffset;
+            uint64_t fileSize;
+        };
+
+        // Static variables
+        static char s_directory[STORM_MAX_PATH];
+
+        // Static functions
+        static uint32_t Checksum(const void* data, size_t bytes, uint32_t hash);
+        static void GetPath(const char* dbFilename, char* path, size_t size);
+        static int32_t Hash(SFile* f, uint64_t resume, uint32_t* hash);
+        static Header* Map(const char* dbFilename, const Header& expected, SFile* f, uint64_t resume);
+        static int32_t Prepare(SFile* f, uint32_t layoutHash, uint32_t recordSize, Header* header);
+        static void SetDirectory(const char* directory);
+        static int32_t Write(const char* dbFilename, Header* header, const void* records, const void* strings, const void* index, size_t indexBytes);
+};
+
+#endif
@@ -0,0 +1,77 @@
+#include "db/WowClientDB_Loader.hpp"
+#include "db/WowClientDB_Base.hpp"
+#include <algorithm>
+
+uint32_t WowClientDB_Loader::Thread(void* param) {
+    auto loader = static_cast<WowClientDB_Loader*>(param);
+
+    loader->Work();
+
+    loader->m_lock.Enter();
+    auto last = --loader->m_activeThreads == 0;
+    loader->m_lock.Leave();
+
+    // Run may return and release the loader as soon as this is set
+    if (last) {
+        loader->m_doneEvent.Set();
+    }
+
+    return 0;
+}
+
+void WowClientDB_Loader::Add(WowClientDB_Base* db, const char* filename, int32_t linenumber) {
+    auto job = this->m_jobs.New();
+
+    job->db = db;
+    job->filename = filename;
+    job->linenumber = linenumber;
+}
+
+WowClientDB_Base* WowClientDB_Loader::Run(uint32_t threadCount) {
+    auto jobCount = this->m_jobs.Count();
+
+    // The calling thread takes jobs too
+    threadCount = std::min(std::min(threadCount, static_cast<uint32_t>(DB_LOADER_MAX_THREADS)), jobCount);
+    auto helperCount = threadCount ? threadCount - 1 : 0;
+
+    this->m_nextJob = 0;
+    this->m_activeThreads = helperCount;
+    this->m_doneEvent.Reset();
+
+    for (uint32_t i = 0; i < helperCount; i++) {
+        SThread::Create(&WowClientDB_Loader::Thread, this, this->m_threads[i], const_cast<char*>("DB Loader"), 0);
+    }
+
+    this->Work();
+
+    if (helperCount) {
+        this->m_doneEvent.Wait(0xFFFFFFFF);
+    }
+
+    for (uint32_t i = 0; i < jobCount; i++) {
+        auto db = this->m_jobs[i].db;
+
+        if (db->m_error[0]) {
+            return db;
+        }
+    }
+
+    return nullptr;
+}
+
+void WowClientDB_Loader::Work() {
+    while (true) {
+        this->m_lock.Enter();
+
+        if (this->m_nextJob >= this->m_jobs.Count()) {
+            this->m_lock.Leave();
+            return;
+        }
+
+        auto job = this->m_jobs[this->m_nextJob++];
+
+        this->m_lock.Leave();
+
+        job.db->Load(job.filename, job.linenumber);
+    }
+}
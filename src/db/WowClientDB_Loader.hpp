@@ -0,0 +1,41 @@
+#ifndef DB_WOW_CLIENT_DB_LOADER_HPP
+#define DB_WOW_CLIENT_DB_LOADER_HPP
+
+#include <cstdint>
+#include <storm/Array.hpp>
+#include <storm/Thread.hpp>
+
+#define DB_LOADER_MAX_THREADS 8
+
+class WowClientDB_Base;
+
+// Loads independent tables on a small pool of threads. Run returns once every
+// table has finished, and reports failures in the order tables were added so
+// the outcome doesn't depend on scheduling.
+class WowClientDB_Loader {
+    public:
+        // Types
+        struct Job {
+            WowClientDB_Base* db;
+            const char* filename;
+            int32_t linenumber;
+        };
+
+        // Static functions
+        static uint32_t Thread(void* param);
+
+        // Member variables
+        TSGrowableArray<Job> m_jobs;
+        uint32_t m_nextJob = 0;
+        uint32_t m_activeThreads = 0;
+        SCritSect m_lock;
+        SEvent m_doneEvent = SEvent(1, 0);
+        SThread m_threads[DB_LOADER_MAX_THREADS];
+
+        // Member functions
+        void Add(WowClientDB_Base* db, const char* filename, int32_t linenumber);
+        WowClientDB_Base* Run(uint32_t threadCount);
+        void Work();
+};
+
+#endif
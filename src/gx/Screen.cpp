@@ -4,7 +4,9 @@
 #include "gx/Draw.hpp"
 #include "gx/Font.hpp"
 #include "gx/Gx.hpp"
+#include "gx/Texture.hpp"
 #include "gx/Transform.hpp"
+#include "gx/texture/CTextureAtlas.hpp"
 #include "util/Filesystem.hpp"
 #include <storm/String.hpp>
 #include <tempest/Matrix.hpp>
@@ -111,6 +113,11 @@ int32_t OnPaint(const void* a1, void* a2) {
 
     GxuFontUpdate();
 
+    TextureCacheUpdate();
+
+    // Batches for this frame are out, so atlas pages can move their blocks
+    CTextureAtlas::Update();
+
     if (!Screen::s_presentDisable) {
         if (Screen::s_captureScreen) {
             // TODO
@@ -1,7 +1,11 @@
 #include "gx/Texture.hpp"
+#include "async/AsyncFileRead.hpp"
 #include "gx/Device.hpp"
 #include "gx/Gx.hpp"
 #include "gx/texture/CBLPFile.hpp"
+#include "gx/texture/CTextureAtlas.hpp"
+#include "gx/texture/CTgaFile.hpp"
+#include "gx/texture/MipMap.hpp"
 #include "util/Filesystem.hpp"
 #include "util/SFile.hpp"
 #include <algorithm>
@@ -16,6 +20,13 @@ namespace Texture {
     MipBits* s_mipBits;
     int32_t s_mipBitsValid;
     TSHashTable<CTexture, HASHKEY_TEXTUREFILE> s_textureCache;
+    TSHashTable<CTexture, HASHKEY_TEXTUREFILE> s_solidCache;
+    STORM_EXPLICIT_LIST(CTexture, lruLink) s_cacheList;
+    uint32_t s_cacheFrame;
+    uint32_t s_cacheSize = 32 << 20;
+    uint32_t s_residentBytes;
+    uint32_t s_evictions;
+    uint32_t s_reloads;
 
     EGxTexFormat s_pixelFormatToGxTexFormat[10] = {
         GxTex_Dxt1,         // PIXEL_DXT1
@@ -34,7 +45,9 @@ namespace Texture {
 static CImVector CRAPPY_GREEN = { 0x00, 0xFF, 0x00, 0xFF };
 
 void AsyncTextureWait(CTexture* texture) {
-    // TODO
+    if (texture->asyncObject) {
+        AsyncFileReadWait(texture->asyncObject);
+    }
 }
 
 uint32_t CalcLevelCount(uint32_t width, uint32_t height) {
@@ -157,6 +170,43 @@ void FillInSolidTexture(const CImVector& color, CTexture* texture) {
     SStrCopy(texture->filename, "SolidTexture", STORM_MAX_PATH);
 }
 
+// Puts the color on an atlas page as a single texel, so flat colored quads
+// draw from the same page as the textures around them
+static int32_t FillInSolidAtlasTexture(const CImVector& color, CTexture* texture) {
+    texture->flags |= 0x4;
+
+    if (color.a >= 0xFE) {
+        texture->flags |= 0x1;
+    }
+
+    texture->dataFormat = GxTex_Argb8888;
+    texture->gxTexFormat = GxTex_Argb8888;
+    texture->gxTexTarget = GxTex_2d;
+    texture->gxWidth = 1;
+    texture->gxHeight = 1;
+    texture->gxTexFlags = CGxTexFlags(GxTex_Linear, 0, 0, 0, 0, 0, 1);
+
+    auto atlas = CTextureAtlas::Get(texture);
+
+    if (atlas) {
+        auto images = MippedImgAllocA(PIXEL_ARGB8888, 1, 1, __FILE__, __LINE__);
+        *reinterpret_cast<uint32_t*>(reinterpret_cast<MipBits**>(images)[0]) = color.value;
+
+        atlas->Insert(texture, images);
+
+        SMemFree(images, __FILE__, __LINE__, 0);
+    }
+
+    if (!texture->atlas) {
+        texture->flags &= ~0x4;
+        return 0;
+    }
+
+    SStrCopy(texture->filename, "SolidTexture", STORM_MAX_PATH);
+
+    return 1;
+}
+
 uint32_t GetBitDepth(uint32_t fourCC) {
     switch (fourCC) {
         case 0:
@@ -489,13 +539,28 @@ MipBits* MippedImgAllocA(uint32_t fourCC, uint32_t width, uint32_t height, const
     MipBits** ptr = reinterpret_cast<MipBits**>(images);
 
     for (int32_t level = 0; level < levelCount; level++) {
-        ptr[level] = images + offset;
+        ptr[level] = reinterpret_cast<MipBits*>(reinterpret_cast<char*>(images) + offset);
         offset += CalcLevelSize(level, width, height, fourCC);
     }
 
     return images;
 }
 
+void MippedImgSet(uint32_t fourCC, uint32_t width, uint32_t height, MipBits* images) {
+    uint32_t levelCount = CalcLevelCount(width, height);
+
+    // Level data follows the pointer table directly, so a buffer of
+    // MippedImgCalcSize bytes holds the whole chain
+    uintptr_t offset = sizeof(void*) * levelCount;
+
+    MipBits** ptr = reinterpret_cast<MipBits**>(images);
+
+    for (int32_t level = 0; level < levelCount; level++) {
+        ptr[level] = reinterpret_cast<MipBits*>(reinterpret_cast<char*>(images) + offset);
+        offset += CalcLevelSize(level, width, height, fourCC);
+    }
+}
+
 uint32_t MippedImgCalcSize(uint32_t fourCC, uint32_t width, uint32_t height) {
     uint32_t levelCount = CalcLevelCount(width, height);
     uint32_t levelDataSize = CalcLevelOffset(levelCount, width, height, fourCC);
@@ -571,29 +636,64 @@ void UpdateBlpTextureAsync(EGxTexCommand cmd, uint32_t w, uint32_t h, uint32_t d
     }
 }
 
-int32_t PumpBlpTextureAsync(CTexture* texture, void* buf) {
+// Texture state decoded from a BLP, applied to the texture on the main thread
+// once the decode is done
+struct BlpTextureLoad {
+    CTexture* texture;
+    void* buf;
+    MipBits* images;
+    const char* error;
+    uint16_t flags;
+    uint8_t bestMip;
+    uint8_t alphaBits;
+    EGxTexTarget gxTexTarget;
+    uint16_t gxWidth;
+    uint16_t gxHeight;
+    EGxTexFormat gxTexFormat;
+    EGxTexFormat dataFormat;
+    CGxTexFlags gxTexFlags;
+    uint8_t mipBias;
+};
+
+static void BlpTextureLoadInit(BlpTextureLoad& load, CTexture* texture, void* buf, MipBits* images) {
+    load.texture = texture;
+    load.buf = buf;
+    load.images = images;
+    load.error = nullptr;
+    load.flags = texture->flags;
+    load.bestMip = texture->bestMip;
+    load.alphaBits = texture->alphaBits;
+    load.gxTexTarget = texture->gxTexTarget;
+    load.gxWidth = texture->gxWidth;
+    load.gxHeight = texture->gxHeight;
+    load.gxTexFormat = texture->gxTexFormat;
+    load.dataFormat = texture->dataFormat;
+    load.gxTexFlags = texture->gxTexFlags;
+    load.mipBias = texture->mipBias;
+}
+
+// Parses the header and fills the mip chain. Only touches the load and the
+// texture's filename, so it's safe to run off the main thread. With a null
+// chain, one is allocated for the load.
+static int32_t DecodeBlpTexture(BlpTextureLoad& load) {
     CBLPFile image;
 
-    if (!image.Source(buf)) {
-        texture->loadStatus.Add(
-            STATUS_FATAL,
-            "BLP Texture failure: \"%s\" invalid file version\n",
-            texture->filename
-        );
+    if (!image.Source(load.buf)) {
+        load.error = "BLP Texture failure: \"%s\" invalid file version\n";
 
         image.Close();
 
         return 0;
     }
 
-    if (texture->flags & 0x4 && !(image.m_header.hasMips & 0x10)) {
-        texture->flags &= 0xFFFB;
+    if (load.flags & 0x4 && !(image.m_header.hasMips & 0x10)) {
+        load.flags &= 0xFFFB;
     }
 
-    texture->alphaBits = image.m_header.alphaSize;
+    load.alphaBits = image.m_header.alphaSize;
 
     if (image.m_header.alphaSize == 0) {
-        texture->flags |= 0x1;
+        load.flags |= 0x1;
     }
 
     uint32_t width = image.m_header.width;
@@ -602,7 +702,14 @@ int32_t PumpBlpTextureAsync(CTexture* texture, void* buf) {
 
     RequestImageDimensions(&width, &height, &bestMip);
 
-    texture->bestMip = bestMip;
+    // Textures streamed back in after an eviction skip their top levels
+    for (uint32_t i = 0; i < load.mipBias && bestMip + 1 < image.m_numLevels && width >= 16 && height >= 16; i++) {
+        width >>= 1;
+        height >>= 1;
+        bestMip++;
+    }
+
+    load.bestMip = bestMip;
 
     PIXEL_FORMAT pixFormat;
     EGxTexFormat gxTexFormat;
@@ -611,18 +718,10 @@ int32_t PumpBlpTextureAsync(CTexture* texture, void* buf) {
 
     GetTextureFormats(&pixFormat, &gxTexFormat, preferredFormat, alphaSize);
 
-    int32_t mipLevel = texture->bestMip;
+    int32_t mipLevel = load.bestMip;
 
-    Texture::s_mipBitsValid = 1;
-
-    if (!image.LockChain2(texture->filename, pixFormat, Texture::s_mipBits, mipLevel, 1)) {
-        Texture::s_mipBitsValid = 0;
-
-        texture->loadStatus.Add(
-            STATUS_FATAL,
-            "BLP Texture failure: \"%s\" decompression failed.\n",
-            texture->filename
-        );
+    if (!image.LockChain2(load.texture->filename, pixFormat, load.images, mipLevel, 1)) {
+        load.error = "BLP Texture failure: \"%s\" decompression failed.\n";
 
         image.Close();
 
@@ -640,93 +739,171 @@ int32_t PumpBlpTextureAsync(CTexture* texture, void* buf) {
         gxTexTarget = GxTex_CubeMap;
     }
 
-    texture->gxHeight = gxHeight;
-    texture->gxWidth = gxWidth;
-    texture->gxTexTarget = gxTexTarget;
+    load.gxHeight = gxHeight;
+    load.gxWidth = gxWidth;
+    load.gxTexTarget = gxTexTarget;
 
-    EGxTexFormat dataFormat = Texture::s_pixelFormatToGxTexFormat[pixFormat];
-    texture->dataFormat = dataFormat;
-    texture->gxTexFormat = gxTexFormat;
+    load.dataFormat = Texture::s_pixelFormatToGxTexFormat[pixFormat];
+    load.gxTexFormat = gxTexFormat;
 
     if (gxWidth < 256 && image.m_numLevels == 1) {
-        if (!texture->gxTexFlags.m_generateMipMaps) {
-            texture->gxTexFlags.m_filter = 0;
+        if (!load.gxTexFlags.m_generateMipMaps) {
+            load.gxTexFlags.m_filter = 0;
         }
     }
 
-    if (texture->flags & 0x4) {
-        // TODO
+    image.Close();
 
-        // CTextureAtlas* atlas = CTextureAtlas::Get(v2);
+    return 1;
+}
 
-        // texture->atlas = atlas;
+static void ApplyBlpTexture(const BlpTextureLoad& load) {
+    auto texture = load.texture;
+
+    texture->flags = load.flags;
+    texture->bestMip = load.bestMip;
+    texture->alphaBits = load.alphaBits;
+    texture->gxTexTarget = load.gxTexTarget;
+    texture->gxWidth = load.gxWidth;
+    texture->gxHeight = load.gxHeight;
+    texture->gxTexFormat = load.gxTexFormat;
+    texture->dataFormat = load.dataFormat;
+    texture->gxTexFlags = load.gxTexFlags;
+}
 
-        // if (atlas) {
-        //    sub_4B50D0(atlas, v2);
-        // } else {
-        //    texture->flags &= 0xFFFBu;
-        // }
+// Keeps s_residentBytes in step with the CGxTex of textures in the LRU list.
+// Atlas pages and textures outside the cache aren't budgeted.
+static void TextureCacheAccount(CTexture* texture) {
+    if (!texture->lruLink.IsLinked()) {
+        return;
     }
 
-    if (!texture->atlas) {
-        if (texture->gxTex) {
-            TextureFreeGxTex(texture->gxTex);
-            texture->gxTex = nullptr;
+    Texture::s_residentBytes -= texture->residentBytes;
+    texture->residentBytes = texture->gxTex ? TextureCalcGxTexSize(texture->gxTex) : 0;
+    Texture::s_residentBytes += texture->residentBytes;
+}
+
+// Creates the texture's CGxTex and uploads the decoded chain. Main thread only.
+static int32_t UploadTexture(CTexture* texture, MipBits* images) {
+    if (texture->flags & 0x4) {
+        auto atlas = CTextureAtlas::Get(texture);
+
+        if (!atlas || !atlas->Insert(texture, images)) {
+            texture->flags &= 0xFFFB;
         }
+    }
+
+    if (texture->atlas) {
+        return 1;
+    }
+
+    if (texture->gxTex) {
+        TextureFreeGxTex(texture->gxTex);
+        texture->gxTex = nullptr;
+    }
+
+    CGxTex* gxTex = TextureAllocGxTex(
+        texture->gxTexTarget,
+        texture->gxWidth,
+        texture->gxHeight,
+        0,
+        texture->gxTexFormat,
+        texture->gxTexFlags,
+        texture,
+        &UpdateBlpTextureAsync,
+        texture->dataFormat
+    );
+
+    texture->gxTex = gxTex;
+
+    TextureCacheAccount(texture);
 
-        CGxTex* gxTex = TextureAllocGxTex(
-            texture->gxTexTarget,
+    if (!gxTex) {
+        texture->loadStatus.Add(
+            STATUS_FATAL,
+            "BLP Texture failure: \"%s\" allocating %dx%d texture failed.\n",
+            texture->filename,
             texture->gxWidth,
-            texture->gxHeight,
-            0,
-            texture->gxTexFormat,
-            texture->gxTexFlags,
-            texture,
-            &UpdateBlpTextureAsync,
-            texture->dataFormat
+            texture->gxHeight
         );
 
-        texture->gxTex = gxTex;
+        return 0;
+    }
 
-        if (!gxTex) {
-            Texture::s_mipBitsValid = 0;
+    // UpdateBlpTextureAsync latches from the shared chain, so point it at this
+    // texture's mips for the length of the update
+    auto mipBits = Texture::s_mipBits;
 
-            texture->loadStatus.Add(
-                STATUS_FATAL,
-                "BLP Texture failure: \"%s\" allocating %dx%d texture failed.\n",
-                texture->filename,
-                gxWidth,
-                gxHeight
-            );
+    Texture::s_mipBits = images;
+    Texture::s_mipBitsValid = 1;
 
-            image.Close();
+    GxTexUpdate(gxTex, 0, 0, texture->gxWidth, texture->gxHeight, 1);
 
-            return 0;
-        }
+    Texture::s_mipBits = mipBits;
+    Texture::s_mipBitsValid = 0;
+
+    return 1;
+}
 
-        GxTexUpdate(gxTex, 0, 0, gxWidth, gxHeight, 1);
+int32_t PumpBlpTextureAsync(CTexture* texture, void* buf) {
+    BlpTextureLoad load;
+    BlpTextureLoadInit(load, texture, buf, Texture::s_mipBits);
+
+    if (!DecodeBlpTexture(load)) {
+        texture->loadStatus.Add(STATUS_FATAL, load.error, texture->filename);
+
+        return 0;
     }
 
-    Texture::s_mipBitsValid = 0;
+    ApplyBlpTexture(load);
 
-    image.Close();
+    return UploadTexture(texture, load.images);
+}
 
-    return 1;
+static void DecodeBlpTextureCallback(void* param) {
+    auto load = static_cast<BlpTextureLoad*>(param);
+
+    DecodeBlpTexture(*load);
 }
 
-int32_t FindSubstitution(const char* a1, char* a2) {
-    // TODO
+static void LoadBlpTextureCallback(void* param) {
+    auto load = static_cast<BlpTextureLoad*>(param);
+    auto texture = load->texture;
 
-    return 0;
+    int32_t loaded = 0;
+
+    // A failed or short read never reached DecodeBlpTextureCallback
+    if (texture->asyncObject->isFailed) {
+        texture->loadStatus.Add(STATUS_FATAL, "BLP Texture failure: \"%s\" read failed.\n", texture->filename);
+    } else if (load->error) {
+        texture->loadStatus.Add(STATUS_FATAL, load->error, texture->filename);
+    } else {
+        ApplyBlpTexture(*load);
+        loaded = UploadTexture(texture, load->images);
+    }
+
+    if (!loaded) {
+        FillInSolidTexture(CRAPPY_GREEN, texture);
+    }
+
+    AsyncFileReadDestroyObject(texture->asyncObject);
+    texture->asyncObject = nullptr;
+
+    if (load->images) {
+        SMemFree(load->images, __FILE__, __LINE__, 0);
+    }
+
+    SMemFree(load->buf, __FILE__, __LINE__, 0);
+    SMemFree(load, __FILE__, __LINE__, 0);
 }
 
-CTexture* CreateBlpAsync(char* fileExt, char* fileName, int32_t createFlags, CGxTexFlags texFlags) {
+int32_t FindSubstitution(const char* a1, char* a2) {
     // TODO
 
-    return nullptr;
+    return 0;
 }
 
-CTexture* CreateBlpSync(int32_t createFlags, char* fileName, char* fileExt, CGxTexFlags texFlags) {
+static SFile* OpenTextureFile(int32_t createFlags, char* fileName) {
     SFile* file = nullptr;
 
     // TODO
@@ -741,10 +918,10 @@ CTexture* CreateBlpSync(int32_t createFlags, char* fileName, char* fileExt, CGxT
         return nullptr;
     }
 
-    if (!file) {
-        return nullptr;
-    }
+    return file;
+}
 
+static CTexture* NewTexture(int32_t createFlags, char* fileName, char* fileExt, CGxTexFlags texFlags) {
     auto m = SMemAlloc(sizeof(CTexture), "HTEXTURE", -2, 0x0);
     auto texture = new (m) CTexture();
 
@@ -754,10 +931,9 @@ CTexture* CreateBlpSync(int32_t createFlags, char* fileName, char* fileExt, CGxT
         texture->flags |= 0x2;
     }
 
-    // TODO
-    // if (createFlags & 0x4 && dword_B49C84) {
-    //     texture->flags |= 0x4;
-    // }
+    if (createFlags & 0x4 && CTextureAtlas::s_enabled) {
+        texture->flags |= 0x4;
+    }
 
     if (fileExt) {
         *fileExt = 0;
@@ -765,25 +941,213 @@ CTexture* CreateBlpSync(int32_t createFlags, char* fileName, char* fileExt, CGxT
 
     SStrCopy(texture->filename, fileName, 0x7FFFFFFF);
 
+    return texture;
+}
+
+static void LoadBlpTextureAsync(CTexture* texture, SFile* file) {
+    uint32_t fileSize = SFile::GetFileSize(file, 0);
+
+    auto m = SMemAlloc(sizeof(BlpTextureLoad), __FILE__, __LINE__, 0x0);
+    auto load = new (m) BlpTextureLoad();
+
+    // The chain is allocated by the decode, sized for the mips it keeps
+    BlpTextureLoadInit(*load, texture, SMemAlloc(fileSize, __FILE__, __LINE__, 0), nullptr);
+
+    auto object = AsyncFileReadAllocObject();
+
+    object->file = file;
+    object->buffer = load->buf;
+    object->size = fileSize;
+    object->userArg = load;
+    object->userReadCallback = &DecodeBlpTextureCallback;
+    object->userPostloadCallback = &LoadBlpTextureCallback;
+
+    // Priorities above 127 are texture reads
+    object->priority = 128;
+
+    texture->asyncObject = object;
+
+    AsyncFileReadObject(object, 0);
+}
+
+static void LoadBlpTextureSync(CTexture* texture, SFile* file) {
     size_t fileSize = SFile::GetFileSize(file, 0);
 
     void* buf = SMemAlloc(fileSize, __FILE__, __LINE__, 0);
 
-    if (!SFile::Read(file, buf, fileSize, nullptr, nullptr, nullptr)) {
-        // nullsub_3();
-    }
+    size_t bytesRead = 0;
 
-    if (!PumpBlpTextureAsync(texture, buf)) {
+    if (!SFile::Read(file, buf, fileSize, &bytesRead, nullptr, nullptr) || bytesRead != fileSize) {
+        texture->loadStatus.Add(STATUS_FATAL, "BLP Texture failure: \"%s\" read failed.\n", texture->filename);
+
+        FillInSolidTexture(CRAPPY_GREEN, texture);
+    } else if (!PumpBlpTextureAsync(texture, buf)) {
         FillInSolidTexture(CRAPPY_GREEN, texture);
     }
 
     SFile::Close(file);
 
     SMemFree(buf, __FILE__, __LINE__, 0);
+}
+
+CTexture* CreateBlpAsync(char* fileExt, char* fileName, int32_t createFlags, CGxTexFlags texFlags) {
+    SFile* file = OpenTextureFile(createFlags, fileName);
+
+    if (!file) {
+        return nullptr;
+    }
+
+    auto texture = NewTexture(createFlags, fileName, fileExt, texFlags);
+
+    LoadBlpTextureAsync(texture, file);
 
     return texture;
 }
 
+CTexture* CreateBlpSync(int32_t createFlags, char* fileName, char* fileExt, CGxTexFlags texFlags) {
+    SFile* file = OpenTextureFile(createFlags, fileName);
+
+    if (!file) {
+        return nullptr;
+    }
+
+    auto texture = NewTexture(createFlags, fileName, fileExt, texFlags);
+
+    LoadBlpTextureSync(texture, file);
+
+    return texture;
+}
+
+// Decodes a TGA into an ARGB8888 chain, filling in the mips the format
+// can't carry, and uploads it the same way as a BLP
+static int32_t LoadTgaTexture(CTexture* texture, SFile* file) {
+    size_t fileSize = SFile::GetFileSize(file, 0);
+
+    void* buf = SMemAlloc(fileSize, __FILE__, __LINE__, 0);
+
+    if (!SFile::Read(file, buf, fileSize, nullptr, nullptr, nullptr)) {
+        // nullsub_3();
+    }
+
+    SFile::Close(file);
+
+    CTgaFile image;
+
+    if (!image.Source(buf, fileSize)) {
+        texture->loadStatus.Add(STATUS_FATAL, "TGA Texture failure: \"%s\" unsupported image type\n", texture->filename);
+
+        SMemFree(buf, __FILE__, __LINE__, 0);
+
+        return 0;
+    }
+
+    uint32_t width = image.m_header.width;
+    uint32_t height = image.m_header.height;
+
+    // GxTexCreate only takes power of two sizes of at least 8
+    if (width < 8 || height < 8 || width & (width - 1) || height & (height - 1)) {
+        texture->loadStatus.Add(STATUS_FATAL, "TGA Texture failure: \"%s\" is %dx%d, dimensions must be powers of two of at least 8.\n", texture->filename, width, height);
+
+        SMemFree(buf, __FILE__, __LINE__, 0);
+
+        return 0;
+    }
+
+    auto images = MippedImgAllocA(PIXEL_ARGB8888, width, height, __FILE__, __LINE__);
+
+    if (!image.Lock(reinterpret_cast<uint32_t*>(reinterpret_cast<MipBits**>(images)[0]))) {
+        texture->loadStatus.Add(STATUS_FATAL, "TGA Texture failure: \"%s\" decompression failed.\n", texture->filename);
+
+        SMemFree(images, __FILE__, __LINE__, 0);
+        SMemFree(buf, __FILE__, __LINE__, 0);
+
+        return 0;
+    }
+
+    SMemFree(buf, __FILE__, __LINE__, 0);
+
+    MipMapGenerateChain(MMA_BOX, 0, width, height, images);
+
+    uint32_t gxWidth = width;
+    uint32_t gxHeight = height;
+    uint32_t bestMip = 0;
+
+    RequestImageDimensions(&gxWidth, &gxHeight, &bestMip);
+
+    for (uint32_t i = 0; i < texture->mipBias && gxWidth >= 16 && gxHeight >= 16; i++) {
+        gxWidth >>= 1;
+        gxHeight >>= 1;
+        bestMip++;
+    }
+
+    // Start the chain at the best level that fits
+    if (bestMip) {
+        auto levels = MippedImgAllocA(PIXEL_ARGB8888, gxWidth, gxHeight, __FILE__, __LINE__);
+
+        for (uint32_t level = 0; level < CalcLevelCount(gxWidth, gxHeight); level++) {
+            auto size = std::max(gxWidth >> level, 1u) * std::max(gxHeight >> level, 1u) * 4;
+            memcpy(reinterpret_cast<MipBits**>(levels)[level], reinterpret_cast<MipBits**>(images)[level + bestMip], size);
+        }
+
+        SMemFree(images, __FILE__, __LINE__, 0);
+        images = levels;
+    }
+
+    PIXEL_FORMAT pixFormat;
+    EGxTexFormat gxTexFormat;
+
+    GetTextureFormats(&pixFormat, &gxTexFormat, PIXEL_ARGB8888, image.m_alphaBits);
+
+    texture->bestMip = bestMip;
+    texture->alphaBits = image.m_alphaBits;
+    texture->gxTexTarget = GxTex_2d;
+    texture->gxWidth = gxWidth;
+    texture->gxHeight = gxHeight;
+    texture->gxTexFormat = gxTexFormat;
+    texture->dataFormat = Texture::s_pixelFormatToGxTexFormat[pixFormat];
+
+    if (image.m_alphaBits == 0) {
+        texture->flags |= 0x1;
+    }
+
+    auto loaded = UploadTexture(texture, images);
+
+    SMemFree(images, __FILE__, __LINE__, 0);
+
+    return loaded;
+}
+
+// Brings an evicted texture back from its file, short the mip levels its
+// evictions cost it
+static void StreamTexture(CTexture* texture) {
+    texture->evicted = 0;
+
+    Texture::s_reloads++;
+
+    char fileName[STORM_MAX_PATH];
+    SStrPrintf(fileName, sizeof(fileName), "%s.blp", texture->filename);
+
+    SFile* file = OpenTextureFile(texture->flags & 0x2, fileName);
+
+    if (file) {
+        if (Texture::s_createBlpAsync) {
+            LoadBlpTextureAsync(texture, file);
+        } else {
+            LoadBlpTextureSync(texture, file);
+        }
+
+        return;
+    }
+
+    SStrPrintf(fileName, sizeof(fileName), "%s.tga", texture->filename);
+
+    file = OpenTextureFile(texture->flags & 0x2, fileName);
+
+    if (!file || !LoadTgaTexture(texture, file)) {
+        FillInSolidTexture(CRAPPY_GREEN, texture);
+    }
+}
+
 HTEXTURE CreateBlpTexture(char* fileExt, char* fileName, int32_t createFlags, CGxTexFlags texFlags) {
     if (fileExt) {
         SStrCopy(fileExt, ".blp", 0x7FFFFFFF);
@@ -812,10 +1176,26 @@ HTEXTURE CreateBlpTexture(char* fileExt, char* fileName, int32_t createFlags, CG
     return handle;
 }
 
-HTEXTURE CreateTgaTexture(const char* fileName, const char* fileExt, int32_t a3, CGxTexFlags texFlags, CStatus* status) {
-    // TODO
+HTEXTURE CreateTgaTexture(char* fileName, char* fileExt, int32_t createFlags, CGxTexFlags texFlags, CStatus* status) {
+    if (fileExt) {
+        SStrCopy(fileExt, ".tga", 0x7FFFFFFF);
+    }
 
-    return nullptr;
+    SFile* file = OpenTextureFile(createFlags, fileName);
+
+    if (!file) {
+        return nullptr;
+    }
+
+    auto texture = NewTexture(createFlags, fileName, fileExt, texFlags);
+
+    if (!LoadTgaTexture(texture, file)) {
+        status->Add(texture->loadStatus);
+
+        FillInSolidTexture(CRAPPY_GREEN, texture);
+    }
+
+    return HandleCreate(texture);
 }
 
 HTEXTURE TextureCacheGetTexture(char* fileName, char* fileExt, CGxTexFlags texFlags) {
@@ -832,6 +1212,35 @@ HTEXTURE TextureCacheGetTexture(char* fileName, char* fileExt, CGxTexFlags texFl
         *fileExt = '.';
     }
 
+    if (!texture) {
+        return nullptr;
+    }
+
+    // Cold textures come back at the reduced size their evictions left them
+    if (texture->evicted) {
+        StreamTexture(texture);
+    }
+
+    return HandleCreate(texture);
+
+    return nullptr;
+}
+
+// Solid textures are cached apart from files, under a name spelled from their
+// color. The cache holds no reference of its own, so they go away with their
+// last handle.
+static void SolidTextureName(const CImVector& color, int32_t onAtlas, char* name) {
+    SStrPrintf(name, STORM_MAX_PATH, onAtlas ? "SolidPalette%08X" : "SolidTexture%08X", color.value);
+}
+
+static HTEXTURE SolidTextureCacheGet(const CImVector& color, int32_t onAtlas) {
+    char name[STORM_MAX_PATH];
+    SolidTextureName(color, onAtlas, name);
+
+    HASHKEY_TEXTUREFILE key = { name, CGxTexFlags(GxTex_Linear, 0, 0, 0, 0, 0, 1) };
+
+    auto texture = Texture::s_solidCache.Ptr(SStrHashHT(name), key);
+
     if (texture) {
         return HandleCreate(texture);
     }
@@ -840,9 +1249,7 @@ HTEXTURE TextureCacheGetTexture(char* fileName, char* fileExt, CGxTexFlags texFl
 }
 
 HTEXTURE TextureCacheGetTexture(const CImVector& color) {
-    // TODO
-
-    return nullptr;
+    return SolidTextureCacheGet(color, 0);
 }
 
 void TextureCacheNewTexture(CTexture* texture, CGxTexFlags texFlags) {
@@ -850,10 +1257,118 @@ void TextureCacheNewTexture(CTexture* texture, CGxTexFlags texFlags) {
     HASHKEY_TEXTUREFILE key = { texture->filename, texFlags };
 
     Texture::s_textureCache.Insert(texture, hashval, key);
+
+    // The cache holds its own reference, so textures outlive their last
+    // handle until the budget pushes them out
+    HandleCreate(texture);
+
+    texture->lastFrame = Texture::s_cacheFrame;
+    Texture::s_cacheList.LinkToTail(texture);
+
+    TextureCacheAccount(texture);
 }
 
 void TextureCacheNewTexture(CTexture* texture, const CImVector& color) {
-    // TODO
+    SolidTextureName(color, texture->atlas != nullptr, texture->filename);
+
+    auto hashval = SStrHashHT(texture->filename);
+    HASHKEY_TEXTUREFILE key = { texture->filename, texture->gxTexFlags };
+
+    Texture::s_solidCache.Insert(texture, hashval, key);
+}
+
+// Drops every texture only the cache still holds, whatever the budget
+void TextureCacheFlush() {
+    auto texture = Texture::s_cacheList.Head();
+
+    while (texture) {
+        auto next = Texture::s_cacheList.Next(texture);
+
+        if (!texture->asyncObject && texture->m_refcount <= 1) {
+            HandleClose(texture);
+        }
+
+        texture = next;
+    }
+}
+
+void TextureCacheGetStats(TextureCacheStats& stats) {
+    stats.textures = 0;
+
+    for (auto texture = Texture::s_cacheList.Head(); texture; texture = Texture::s_cacheList.Next(texture)) {
+        stats.textures++;
+    }
+
+    stats.residentBytes = Texture::s_residentBytes;
+    stats.cacheSize = Texture::s_cacheSize;
+    stats.evictions = Texture::s_evictions;
+    stats.reloads = Texture::s_reloads;
+}
+
+void TextureCacheSetSize(uint32_t size) {
+    Texture::s_cacheSize = size;
+}
+
+void TextureCacheUpdate() {
+    // Walk from the least recently used end, stopping at the first texture
+    // drawn this frame. A zero budget is no limit.
+    auto texture = Texture::s_cacheList.Head();
+
+    while (texture && Texture::s_cacheSize && texture->lastFrame != Texture::s_cacheFrame && Texture::s_residentBytes > Texture::s_cacheSize) {
+        auto next = Texture::s_cacheList.Next(texture);
+
+        // Only textures the cache alone still holds are evicted; anything
+        // with a live handle keeps its memory
+        if (texture->asyncObject || texture->m_refcount > 1) {
+            texture = next;
+            continue;
+        }
+
+        Texture::s_evictions++;
+
+        if (texture->gxTex) {
+            // Give back its memory but keep the entry, so the next lookup
+            // streams it in again a mip level smaller
+            TextureFreeGxTex(texture->gxTex);
+            texture->gxTex = nullptr;
+            texture->evicted = 1;
+
+            if (texture->mipBias < 2) {
+                texture->mipBias++;
+            }
+
+            TextureCacheAccount(texture);
+        } else {
+            // Entries already cold, and atlased textures, which cost nothing
+            // against the budget, go altogether
+            HandleClose(texture);
+        }
+
+        texture = next;
+    }
+
+    Texture::s_cacheFrame++;
+}
+
+uint32_t TextureCalcGxTexSize(CGxTex* texId) {
+    uint32_t width, height, baseMip, mipCount;
+    g_theGxDevicePtr->ITexWHDStartEnd(texId, width, height, baseMip, mipCount);
+
+    auto compressed = texId->m_format == GxTex_Dxt1 || texId->m_format == GxTex_Dxt3 || texId->m_format == GxTex_Dxt5;
+
+    uint32_t size = 0;
+
+    for (uint32_t level = 0; level < mipCount; level++) {
+        auto rows = std::max(texId->m_height >> level, 1u);
+
+        if (compressed) {
+            rows = (rows + 3) / 4;
+        }
+
+        size += GxCalcTexelStrideInBytes(texId->m_format, std::max(texId->m_width >> level, 1u)) * rows;
+    }
+
+    return texId->m_target == GxTex_CubeMap ? size * 6 : size;
 }
 
 HTEXTURE TextureCreate(const char* fileName, CGxTexFlags texFlags, CStatus* status, int32_t createFlags) {
@@ -966,7 +1481,13 @@ HTEXTURE TextureCreate(EGxTexTarget target, uint32_t width, uint32_t height, uin
 }
 
 HTEXTURE TextureCreateSolid(const CImVector& color) {
-    HTEXTURE textureHandle = TextureCacheGetTexture(color);
+    return TextureCreateSolid(color, 0);
+}
+
+HTEXTURE TextureCreateSolid(const CImVector& color, int32_t createFlags) {
+    int32_t onAtlas = createFlags & 0x4 && CTextureAtlas::s_enabled;
+
+    HTEXTURE textureHandle = SolidTextureCacheGet(color, onAtlas);
 
     if (textureHandle) {
         return textureHandle;
@@ -975,7 +1496,25 @@ HTEXTURE TextureCreateSolid(const CImVector& color) {
     auto m = SMemAlloc(sizeof(CTexture), __FILE__, __LINE__, 0x0);
     auto texture = new (m) CTexture();
 
-    FillInSolidTexture(color, texture);
+    if (onAtlas && !FillInSolidAtlasTexture(color, texture)) {
+        // With no room on a page, fall back to the standalone texture, which
+        // is cached under its own name
+        textureHandle = SolidTextureCacheGet(color, 0);
+
+        if (textureHandle) {
+            texture->~CTexture();
+            SMemFree(texture, __FILE__, __LINE__, 0x0);
+
+            return textureHandle;
+        }
+
+        onAtlas = 0;
+    }
+
+    if (!onAtlas) {
+        FillInSolidTexture(color, texture);
+    }
+
     textureHandle = HandleCreate(texture);
     TextureCacheNewTexture(texture, color);
 
@@ -988,7 +1527,7 @@ int32_t TextureGetDimensions(CTexture* texture, uint32_t* width, uint32_t* heigh
             return 0;
         }
 
-        // TODO
+        AsyncTextureWait(texture);
     }
 
     if (width) {
@@ -1009,6 +1548,13 @@ int32_t TextureGetDimensions(HTEXTURE textureHandle, uint32_t* width, uint32_t*
 CGxTex* TextureGetGxTex(CTexture* texture, int32_t a2, CStatus* status) {
     STORM_ASSERT(texture);
 
+    if (texture->lruLink.IsLinked() && texture->lastFrame != Texture::s_cacheFrame) {
+        texture->lastFrame = Texture::s_cacheFrame;
+
+        texture->lruLink.Unlink();
+        Texture::s_cacheList.LinkToTail(texture);
+    }
+
     if (texture->flags & 0x4) {
         if (texture->asyncObject) {
             if (a2 != 1 && (a2 != 2 || texture->asyncObject->char24)) {
@@ -1023,14 +1569,10 @@ CGxTex* TextureGetGxTex(CTexture* texture, int32_t a2, CStatus* status) {
             }
         }
 
+        // Atlased textures draw from their page, with texture coordinates
+        // remapped by TextureGetAtlasOffsetAndScale
         if (texture->atlas) {
-            // TODO
-            // atlas->Reload();
-
-            // TODO
-            // - pull texture out of atlas
-
-            return nullptr;
+            return texture->atlas->m_gxTex;
         }
     }
 
@@ -1039,6 +1581,11 @@ CGxTex* TextureGetGxTex(CTexture* texture, int32_t a2, CStatus* status) {
     }
 
     if (!texture->gxTex) {
+        // Nothing in flight to wait on, e.g. a load that already failed
+        if (!texture->asyncObject) {
+            return nullptr;
+        }
+
         if (a2 != 1 && (a2 != 2 || texture->asyncObject->char24)) {
             return nullptr;
         }
@@ -1057,6 +1604,12 @@ CGxTex* TextureGetGxTex(HTEXTURE handle, int32_t a2, CStatus* status) {
     return TextureGetGxTex(reinterpret_cast<CTexture*>(handle), a2, status);
 }
 
+void TextureGetAtlasOffsetAndScale(CTexture* texture, C2Vector& offset, C2Vector& scale) {
+    STORM_ASSERT(texture->atlas);
+
+    texture->atlas->GetOffsetAndScale(texture->atlasBlockIndex, offset, scale);
+}
+
 CTexture* TextureGetTexturePtr(HTEXTURE handle) {
     return reinterpret_cast<CTexture*>(handle);
 }
@@ -1073,6 +1626,10 @@ void TextureInitialize() {
     // - rest of function
 }
 
+int32_t TextureOnAtlas(CTexture* texture) {
+    return texture->atlas != nullptr;
+}
+
 int32_t TextureIsSame(HTEXTURE textureHandle, const char* fileName) {
     char buf[STORM_MAX_PATH];
     uint32_t len = SStrCopy(buf, fileName, sizeof(buf));
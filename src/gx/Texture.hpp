@@ -4,6 +4,7 @@
 #include "gx/Types.hpp"
 #include "gx/texture/CGxTex.hpp"
 #include "gx/texture/CTexture.hpp"
+#include <tempest/Vector.hpp>
 
 typedef HOBJECT HTEXTURE;
 
@@ -11,6 +12,28 @@ typedef void (TEXTURE_CALLBACK)(EGxTexCommand, uint32_t, uint32_t, uint32_t, uin
 
 class CImVector;
 
+struct TextureCacheStats {
+    uint32_t textures;
+    uint32_t residentBytes;
+    uint32_t cacheSize;
+    uint32_t evictions;
+    uint32_t reloads;
+};
+
+namespace Texture {
+    extern int32_t s_createBlpAsync;
+    extern MipBits* s_mipBits;
+    extern int32_t s_mipBitsValid;
+    extern TSHashTable<CTexture, HASHKEY_TEXTUREFILE> s_textureCache;
+    extern TSHashTable<CTexture, HASHKEY_TEXTUREFILE> s_solidCache;
+    extern STORM_EXPLICIT_LIST(CTexture, lruLink) s_cacheList;
+    extern uint32_t s_cacheFrame;
+    extern uint32_t s_cacheSize;
+    extern uint32_t s_residentBytes;
+    extern uint32_t s_evictions;
+    extern uint32_t s_reloads;
+}
+
 void AsyncTextureWait(CTexture*);
 
 uint32_t CalcLevelCount(uint32_t, uint32_t);
@@ -45,8 +68,14 @@ MipBits* MippedImgAllocA(uint32_t, uint32_t, uint32_t, const char*, int32_t);
 
 uint32_t MippedImgCalcSize(uint32_t, uint32_t, uint32_t);
 
+void MippedImgSet(uint32_t, uint32_t, uint32_t, MipBits*);
+
 CGxTex* TextureAllocGxTex(EGxTexTarget, uint32_t, uint32_t, uint32_t, EGxTexFormat, CGxTexFlags, void*, void (*userFunc)(EGxTexCommand, uint32_t, uint32_t, uint32_t, uint32_t, void*, uint32_t&, const void*&), EGxTexFormat);
 
+void TextureCacheFlush();
+
+void TextureCacheGetStats(TextureCacheStats& stats);
+
 HTEXTURE TextureCacheGetTexture(char*, char*, CGxTexFlags);
 
 HTEXTURE TextureCacheGetTexture(const CImVector&);
@@ -55,6 +84,12 @@ void TextureCacheNewTexture(CTexture*, CGxTexFlags);
 
 void TextureCacheNewTexture(CTexture*, const CImVector&);
 
+void TextureCacheSetSize(uint32_t size);
+
+void TextureCacheUpdate();
+
+uint32_t TextureCalcGxTexSize(CGxTex* texId);
+
 HTEXTURE TextureCreate(const char*, CGxTexFlags, CStatus*, int32_t);
 
 HTEXTURE TextureCreate(uint32_t, uint32_t, EGxTexFormat, EGxTexFormat, CGxTexFlags, void*, void (*)(EGxTexCommand, uint32_t, uint32_t, uint32_t, uint32_t, void*, uint32_t&, const void*&), const char*, int32_t);
@@ -63,6 +98,8 @@ HTEXTURE TextureCreate(EGxTexTarget, uint32_t, uint32_t, uint32_t, EGxTexFormat,
 
 HTEXTURE TextureCreateSolid(const CImVector&);
 
+HTEXTURE TextureCreateSolid(const CImVector& color, int32_t createFlags);
+
 int32_t TextureGetDimensions(HTEXTURE, uint32_t*, uint32_t*, int32_t);
 
 void TextureIncreasePriority(CTexture*);
@@ -71,8 +108,12 @@ void TextureInitialize(void);
 
 int32_t TextureIsSame(HTEXTURE textureHandle, const char* fileName);
 
+int32_t TextureOnAtlas(CTexture* texture);
+
 void TextureFreeGxTex(CGxTex* texId);
 
+void TextureGetAtlasOffsetAndScale(CTexture* texture, C2Vector& offset, C2Vector& scale);
+
 CGxTex* TextureGetGxTex(CTexture*, int32_t, CStatus*);
 
 CGxTex* TextureGetGxTex(HTEXTURE, int32_t, CStatus*);
@@ -323,6 +323,14 @@ enum COLOR_FILE_FORMAT {
     COLOR_3 = 3
 };
 
+enum MipMapAlgorithm {
+    MMA_BOX = 0x0,
+    MMA_CUBIC = 0x1,
+    MMA_FULLDFT = 0x2,
+    MMA_KAISER = 0x3,
+    MMA_LINEARLIGHTKAISER = 0x4,
+};
+
 enum PIXEL_FORMAT {
     PIXEL_DXT1 = 0x0,
     PIXEL_DXT3 = 0x1,
@@ -1,11 +1,16 @@
 #include "gx/Texture.hpp"
 #include "gx/texture/CBLPFile.hpp"
+#include "gx/texture/Dxt.hpp"
+#include "gx/texture/MipMap.hpp"
+#include "gx/texture/Palette.hpp"
+#include "gx/texture/PixelPack.hpp"
 #include "util/SFile.hpp"
+#include <algorithm>
 #include <cstring>
 #include <storm/Error.hpp>
 #include <storm/Memory.hpp>
 
-TSGrowableArray<unsigned char> CBLPFile::s_blpFileLoadBuffer;
+thread_local TSGrowableArray<unsigned char> CBLPFile::s_blpFileLoadBuffer;
 
 void CBLPFile::Close() {
     this->m_inMemoryImage = nullptr;
@@ -17,6 +22,53 @@ void CBLPFile::Close() {
     this->m_images = nullptr;
 }
 
+int32_t CBLPFile::GenerateMips(const char* fileName, PIXEL_FORMAT format, MipBits* images) {
+    uint32_t width = this->m_header.width;
+    uint32_t height = this->m_header.height;
+    uint32_t levelCount = CalcLevelCount(width, height);
+
+    // Compressed formats and cube maps keep their single level
+    if (levelCount == 1 || width == 6 * height) {
+        return 1;
+    }
+
+    if (format != PIXEL_ARGB8888 && format != PIXEL_ARGB1555 && format != PIXEL_ARGB4444 && format != PIXEL_RGB565) {
+        return 1;
+    }
+
+    auto algorithm = this->m_mipMapAlgorithm;
+    auto gammaCorrect = algorithm == MMA_LINEARLIGHTKAISER;
+
+    if (format == PIXEL_ARGB8888) {
+        MipMapGenerateChain(algorithm, gammaCorrect, width, height, images);
+    } else {
+        // 16-bit chains are filtered at full precision, then packed
+        auto chain = MippedImgAllocA(PIXEL_ARGB8888, width, height, __FILE__, __LINE__);
+        auto src = reinterpret_cast<MipBits**>(chain);
+        auto dst = reinterpret_cast<MipBits**>(images);
+
+        uint32_t stride = 0;
+
+        if (!this->Lock2(fileName, PIXEL_ARGB8888, 0, reinterpret_cast<unsigned char*>(src[0]), stride)) {
+            SMemFree(chain, __FILE__, __LINE__, 0);
+            return 0;
+        }
+
+        MipMapGenerateChain(algorithm, gammaCorrect, width, height, chain);
+
+        for (uint32_t level = 1; level < levelCount; level++) {
+            auto count = std::max(width >> level, 1u) * std::max(height >> level, 1u);
+            PixelPack(reinterpret_cast<uint32_t*>(src[level]), count, format, dst[level]);
+        }
+
+        SMemFree(chain, __FILE__, __LINE__, 0);
+    }
+
+    this->m_numLevels = levelCount;
+
+    return 1;
+}
+
 int32_t CBLPFile::Lock2(const char* fileName, PIXEL_FORMAT format, uint32_t mipLevel, unsigned char* data, uint32_t& stride) {
     STORM_ASSERT(this->m_inMemoryImage);
 
@@ -29,8 +81,21 @@ int32_t CBLPFile::Lock2(const char* fileName, PIXEL_FORMAT format, uint32_t mipL
 
     switch (this->m_header.colorEncoding) {
         case COLOR_PAL:
-            // TODO
-            return 0;
+            switch (format) {
+                case PIXEL_ARGB8888:
+                case PIXEL_ARGB1555:
+                case PIXEL_ARGB4444:
+                case PIXEL_RGB565: {
+                    uint32_t width = std::max(this->m_header.width >> mipLevel, 1u);
+                    uint32_t height = std::max(this->m_header.height >> mipLevel, 1u);
+                    auto palette = reinterpret_cast<const uint32_t*>(this->m_header.extended.palette);
+
+                    return PalDecompress(palette, this->m_header.alphaSize, width, height, mipData, format, data);
+                }
+
+                default:
+                    return 0;
+            }
 
         case COLOR_DXT:
             switch (format) {
@@ -43,9 +108,12 @@ int32_t CBLPFile::Lock2(const char* fileName, PIXEL_FORMAT format, uint32_t mipL
                 case PIXEL_ARGB8888:
                 case PIXEL_ARGB1555:
                 case PIXEL_ARGB4444:
-                case PIXEL_RGB565:
-                    // TODO
-                    return 0;
+                case PIXEL_RGB565: {
+                    uint32_t width = std::max(this->m_header.width >> mipLevel, 1u);
+                    uint32_t height = std::max(this->m_header.height >> mipLevel, 1u);
+
+                    return DxtDecompress(static_cast<PIXEL_FORMAT>(this->m_header.preferredFormat), width, height, mipData, format, data);
+                }
 
                 case PIXEL_ARGB2565:
                     return 0;
@@ -96,8 +164,7 @@ int32_t CBLPFile::LockChain2(const char* fileName, PIXEL_FORMAT format, MipBits*
             v14 = 1;
         }
 
-        // TODO
-        // MippedImgSet(format, v14, v13, mipLevel);
+        MippedImgSet(format, v14, v13, images);
     } else {
         uint32_t v9 = this->m_header.height >> mipLevel;
 
@@ -126,6 +193,10 @@ int32_t CBLPFile::LockChain2(const char* fileName, PIXEL_FORMAT format, MipBits*
         }
     }
 
+    if (!(this->m_header.hasMips & 0xF) && !this->GenerateMips(fileName, format, images)) {
+        return 0;
+    }
+
     this->m_inMemoryImage = nullptr;
 
     return 1;
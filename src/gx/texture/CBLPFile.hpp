@@ -6,14 +6,6 @@
 #include <cstdint>
 #include <storm/Array.hpp>
 
-enum MipMapAlgorithm {
-    MMA_BOX = 0x0,
-    MMA_CUBIC = 0x1,
-    MMA_FULLDFT = 0x2,
-    MMA_KAISER = 0x3,
-    MMA_LINEARLIGHTKAISER = 0x4,
-};
-
 struct BlpPalPixel {
     char b;
     char g;
@@ -46,7 +38,8 @@ class CBLPFile {
 
     public:
         // Static variables
-        static TSGrowableArray<unsigned char> s_blpFileLoadBuffer;
+        // Per thread, so files opened on different threads don't share a buffer
+        static thread_local TSGrowableArray<unsigned char> s_blpFileLoadBuffer;
 
         // Member variables
         MipBits* m_images = nullptr;
@@ -61,6 +54,7 @@ class CBLPFile {
 
         // Member functions
         void Close(void);
+        int32_t GenerateMips(const char*, PIXEL_FORMAT, MipBits*);
         int32_t Lock2(const char*, PIXEL_FORMAT, uint32_t, unsigned char*, uint32_t&);
         int32_t LockChain2(const char*, PIXEL_FORMAT, MipBits*&, uint32_t, int32_t);
         int32_t Open(const char*, int32_t);
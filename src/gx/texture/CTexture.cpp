@@ -1,5 +1,6 @@
 #include "gx/texture/CTexture.hpp"
 #include "gx/Texture.hpp"
+#include "gx/texture/CTextureAtlas.hpp"
 
 EGxTexFilter CTexture::s_filterMode = GxTex_LinearMipNearest;
 int32_t CTexture::s_maxAnisotropy = 1;
@@ -17,12 +18,19 @@ CTexture::CTexture() {
 }
 
 CTexture::~CTexture() {
+    // A pending load writes to the texture when it lands, so let it finish
+    if (this->asyncObject) {
+        AsyncTextureWait(this);
+    }
+
     if (this->gxTex) {
         TextureFreeGxTex(this->gxTex);
     }
 
+    Texture::s_residentBytes -= this->residentBytes;
+
     if (this->atlas) {
-        // TODO this->atlas->Free(this);
+        this->atlas->Free(this);
     }
 
     // TODO
@@ -8,6 +8,9 @@
 #include <cstdint>
 #include <common/Handle.hpp>
 #include <storm/Hash.hpp>
+#include <storm/List.hpp>
+
+class CTextureAtlas;
 
 class HASHKEY_TEXTUREFILE {
     public:
@@ -39,10 +42,15 @@ class CTexture : public CHandleObject, public TSHashObject<CTexture, HASHKEY_TEX
         EGxTexFormat gxTexFormat = GxTex_Unknown;
         EGxTexFormat dataFormat = GxTex_Unknown;
         CGxTexFlags gxTexFlags = CGxTexFlags(GxTex_Linear, 0, 0, 0, 0, 0, 1);
-        void* atlas = nullptr; // TODO CTextureAtlas
+        CTextureAtlas* atlas = nullptr;
         int32_t atlasBlockIndex = 0;
         uint32_t unk2[2];
         char filename[260];
+        TSLink<CTexture> lruLink;
+        uint32_t lastFrame = 0;
+        uint32_t residentBytes = 0;
+        uint8_t mipBias = 0;
+        uint8_t evicted = 0;
 
         // Member functions
         CTexture();
@@ -0,0 +1,518 @@
+#include "gx/texture/CTextureAtlas.hpp"
+#include "gx/Device.hpp"
+#include "gx/Texture.hpp"
+#include "gx/texture/CTexture.hpp"
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <storm/Error.hpp>
+#include <storm/Memory.hpp>
+
+int32_t CTextureAtlas::s_enabled = 1;
+uint32_t CTextureAtlas::s_generation;
+uint32_t CTextureAtlas::s_pageSize = 1024;
+STORM_LIST(CTextureAtlas) CTextureAtlas::s_atlasList;
+
+static PIXEL_FORMAT AtlasPixelFormat(EGxTexFormat format) {
+    switch (format) {
+        case GxTex_Argb8888:
+            return PIXEL_ARGB8888;
+
+        case GxTex_Argb4444:
+            return PIXEL_ARGB4444;
+
+        case GxTex_Argb1555:
+            return PIXEL_ARGB1555;
+
+        case GxTex_Rgb565:
+            return PIXEL_RGB565;
+
+        default:
+            return PIXEL_UNSPECIFIED;
+    }
+}
+
+static uint8_t* AtlasLevel(MipBits* images, uint32_t level) {
+    return reinterpret_cast<uint8_t*>(reinterpret_cast<MipBits**>(images)[level]);
+}
+
+static void UpdateAtlasTexture(EGxTexCommand cmd, uint32_t w, uint32_t h, uint32_t d, uint32_t mipLevel, void* userArg, uint32_t& texelStrideInBytes, const void*& texels) {
+    auto atlas = static_cast<CTextureAtlas*>(userArg);
+
+    if (cmd == GxTex_Latch) {
+        texelStrideInBytes = GxCalcTexelStrideInBytes(atlas->m_format, w);
+        texels = AtlasLevel(atlas->m_images, mipLevel);
+    }
+}
+
+CTextureAtlas* CTextureAtlas::Get(CTexture* texture) {
+    if (!CTextureAtlas::IsEligible(texture)) {
+        return nullptr;
+    }
+
+    for (auto atlas = CTextureAtlas::s_atlasList.Head(); atlas; atlas = CTextureAtlas::s_atlasList.Next(atlas)) {
+        if (atlas->m_format != texture->dataFormat || !(atlas->m_flags == texture->gxTexFlags)) {
+            continue;
+        }
+
+        if (atlas->Fits(texture)) {
+            return atlas;
+        }
+
+        // Freed blocks leave holes under the skyline, which come back once the
+        // page is repacked at the end of the frame
+        uint32_t width, height;
+        atlas->GetPaddedSize(texture, width, height);
+
+        if (atlas->m_packedArea > atlas->m_usedArea && atlas->m_usedArea + width * height <= atlas->m_size * atlas->m_size) {
+            atlas->m_compactPending = 1;
+        }
+    }
+
+    auto m = SMemAlloc(sizeof(CTextureAtlas), __FILE__, __LINE__, 0x0);
+    auto atlas = new (m) CTextureAtlas(texture->dataFormat, texture->gxTexFlags, CTextureAtlas::s_pageSize);
+
+    if (!atlas->m_gxTex || !atlas->Fits(texture)) {
+        atlas->~CTextureAtlas();
+        SMemFree(atlas, __FILE__, __LINE__, 0);
+
+        return nullptr;
+    }
+
+    CTextureAtlas::s_atlasList.LinkToTail(atlas);
+
+    return atlas;
+}
+
+int32_t CTextureAtlas::IsEligible(CTexture* texture) {
+    if (!CTextureAtlas::s_enabled || texture->gxTexTarget != GxTex_2d) {
+        return 0;
+    }
+
+    if (texture->gxWidth >= 256 || texture->gxHeight >= 256) {
+        return 0;
+    }
+
+    // Wrapping samples past the block, and compressed blocks can't be given
+    // gutters a pixel at a time
+    if (texture->gxTexFlags.m_wrapU || texture->gxTexFlags.m_wrapV) {
+        return 0;
+    }
+
+    if (texture->gxTexFormat != texture->dataFormat || AtlasPixelFormat(texture->dataFormat) == PIXEL_UNSPECIFIED) {
+        return 0;
+    }
+
+    return 1;
+}
+
+CTextureAtlas::CTextureAtlas(EGxTexFormat format, CGxTexFlags flags, uint32_t size) {
+    this->m_format = format;
+    this->m_flags = flags;
+    this->m_size = size;
+
+    this->m_gxTex = TextureAllocGxTex(GxTex_2d, size, size, 0, format, flags, this, &UpdateAtlasTexture, format);
+
+    if (!this->m_gxTex) {
+        return;
+    }
+
+    uint32_t width, height, baseMip;
+    g_theGxDevicePtr->ITexWHDStartEnd(this->m_gxTex, width, height, baseMip, this->m_levelCount);
+
+    // Mipped pages align blocks and widen their gutters so each block keeps a
+    // one pixel border down to the fourth level
+    if (this->m_levelCount > 1) {
+        this->m_padding = 4;
+        this->m_alignment = 4;
+    }
+
+    auto pixelFormat = AtlasPixelFormat(format);
+    this->m_images = MippedImgAllocA(pixelFormat, size, size, __FILE__, __LINE__);
+    memset(AtlasLevel(this->m_images, 0), 0, MippedImgCalcSize(pixelFormat, size, size) - sizeof(void*) * CalcLevelCount(size, size));
+
+    this->ResetSkyline();
+}
+
+CTextureAtlas::~CTextureAtlas() {
+    if (this->m_gxTex) {
+        TextureFreeGxTex(this->m_gxTex);
+    }
+
+    if (this->m_images) {
+        SMemFree(this->m_images, __FILE__, __LINE__, 0);
+    }
+}
+
+void CTextureAtlas::Update() {
+    for (auto atlas = CTextureAtlas::s_atlasList.Head(); atlas; atlas = CTextureAtlas::s_atlasList.Next(atlas)) {
+        if (!atlas->m_compactPending) {
+            continue;
+        }
+
+        atlas->m_compactPending = 0;
+
+        if (atlas->Compact()) {
+            CTextureAtlas::s_generation++;
+        }
+    }
+}
+
+int32_t CTextureAtlas::Compact() {
+    // Tallest first packs a skyline tightest
+    TSGrowableArray<uint32_t> order;
+
+    for (uint32_t i = 0; i < this->m_blocks.Count(); i++) {
+        if (this->m_blocks[i].texture) {
+            *order.New() = i;
+        }
+    }
+
+    std::sort(order.Ptr(), order.Ptr() + order.Count(), [this](uint32_t a, uint32_t b) {
+        auto& blockA = this->m_blocks[a];
+        auto& blockB = this->m_blocks[b];
+
+        return blockA.height != blockB.height ? blockA.height > blockB.height : blockA.width > blockB.width;
+    });
+
+    TSGrowableArray<SKYLINE> skyline;
+    skyline.SetCount(this->m_skyline.Count());
+    memcpy(skyline.Ptr(), this->m_skyline.Ptr(), sizeof(SKYLINE) * skyline.Count());
+
+    TSGrowableArray<BLOCK> placed;
+    placed.SetCount(this->m_blocks.Count());
+    memcpy(placed.Ptr(), this->m_blocks.Ptr(), sizeof(BLOCK) * placed.Count());
+
+    auto packedArea = this->m_packedArea;
+
+    this->ResetSkyline();
+
+    for (uint32_t i = 0; i < order.Count(); i++) {
+        auto& block = placed[order[i]];
+
+        uint32_t x, y;
+
+        if (!this->FindPosition(block.width, block.height, x, y)) {
+            // Keep the old layout
+            this->m_skyline.SetCount(skyline.Count());
+            memcpy(this->m_skyline.Ptr(), skyline.Ptr(), sizeof(SKYLINE) * skyline.Count());
+            this->m_packedArea = packedArea;
+
+            return 0;
+        }
+
+        this->Place(x, y, block.width, block.height);
+
+        block.x = x;
+        block.y = y;
+    }
+
+    auto pixelFormat = AtlasPixelFormat(this->m_format);
+    auto images = MippedImgAllocA(pixelFormat, this->m_size, this->m_size, __FILE__, __LINE__);
+    memset(AtlasLevel(images, 0), 0, MippedImgCalcSize(pixelFormat, this->m_size, this->m_size) - sizeof(void*) * CalcLevelCount(this->m_size, this->m_size));
+
+    auto bytesPerPixel = GxCalcTexelStrideInBytes(this->m_format, 1);
+
+    for (uint32_t i = 0; i < order.Count(); i++) {
+        auto& from = this->m_blocks[order[i]];
+        auto& to = placed[order[i]];
+
+        for (uint32_t level = 0; level < this->m_levelCount; level++) {
+            // Rounding can differ by a texel between the two spots at the
+            // smaller levels
+            auto width = std::min(((from.x + from.width) >> level) - (from.x >> level), ((to.x + to.width) >> level) - (to.x >> level));
+            auto height = std::min(((from.y + from.height) >> level) - (from.y >> level), ((to.y + to.height) >> level) - (to.y >> level));
+
+            if (!width || !height) {
+                break;
+            }
+
+            auto stride = GxCalcTexelStrideInBytes(this->m_format, std::max(this->m_size >> level, 1u));
+            auto src = AtlasLevel(this->m_images, level) + (from.y >> level) * stride + (from.x >> level) * bytesPerPixel;
+            auto dst = AtlasLevel(images, level) + (to.y >> level) * stride + (to.x >> level) * bytesPerPixel;
+
+            for (uint32_t row = 0; row < height; row++) {
+                memcpy(dst + row * stride, src + row * stride, width * bytesPerPixel);
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i < placed.Count(); i++) {
+        this->m_blocks[i] = placed[i];
+    }
+
+    SMemFree(this->m_images, __FILE__, __LINE__, 0);
+    this->m_images = images;
+
+    this->Reload();
+
+    return 1;
+}
+
+int32_t CTextureAtlas::FindPosition(uint32_t width, uint32_t height, uint32_t& x, uint32_t& y) {
+    uint32_t bestWaste = 0;
+    int32_t found = 0;
+
+    // Rest the block where it strands the least area under it, then as low as
+    // possible, then leftmost
+    for (uint32_t i = 0; i < this->m_skyline.Count(); i++) {
+        uint32_t left = this->m_skyline[i].x;
+
+        if (left + width > this->m_size) {
+            break;
+        }
+
+        uint32_t top = 0;
+
+        for (uint32_t j = i; j < this->m_skyline.Count() && this->m_skyline[j].x < left + width; j++) {
+            top = std::max(top, static_cast<uint32_t>(this->m_skyline[j].y));
+        }
+
+        if (top + height > this->m_size) {
+            continue;
+        }
+
+        uint32_t waste = 0;
+
+        for (uint32_t j = i; j < this->m_skyline.Count() && this->m_skyline[j].x < left + width; j++) {
+            auto& segment = this->m_skyline[j];
+            auto span = std::min(static_cast<uint32_t>(segment.x + segment.width), left + width) - segment.x;
+
+            waste += (top - segment.y) * span;
+        }
+
+        if (!found || waste < bestWaste || (waste == bestWaste && top < y)) {
+            bestWaste = waste;
+            x = left;
+            y = top;
+            found = 1;
+        }
+    }
+
+    return found;
+}
+
+int32_t CTextureAtlas::Fits(CTexture* texture) {
+    uint32_t width, height, x, y;
+    this->GetPaddedSize(texture, width, height);
+
+    return this->FindPosition(width, height, x, y);
+}
+
+void CTextureAtlas::Free(CTexture* texture) {
+    auto& block = this->m_blocks[texture->atlasBlockIndex];
+
+    STORM_ASSERT(block.texture == texture);
+
+    block.texture = nullptr;
+
+    this->m_usedArea -= block.width * block.height;
+    this->m_liveCount--;
+
+    texture->atlas = nullptr;
+    texture->atlasBlockIndex = 0;
+
+    if (this->m_liveCount == 0) {
+        CTextureAtlas::s_atlasList.UnlinkNode(this);
+        this->~CTextureAtlas();
+        SMemFree(this, __FILE__, __LINE__, 0);
+
+        return;
+    }
+
+    // Repack once most of what the skyline covers is dead space
+    if (this->m_usedArea * 2 < this->m_packedArea) {
+        this->m_compactPending = 1;
+    }
+}
+
+void CTextureAtlas::GetOffsetAndScale(int32_t blockIndex, C2Vector& offset, C2Vector& scale) {
+    auto& block = this->m_blocks[blockIndex];
+    auto size = static_cast<float>(this->m_size);
+
+    offset.x = (block.x + this->m_padding) / size;
+    offset.y = (block.y + this->m_padding) / size;
+    scale.x = block.texture->gxWidth / size;
+    scale.y = block.texture->gxHeight / size;
+}
+
+void CTextureAtlas::GetPaddedSize(CTexture* texture, uint32_t& width, uint32_t& height) {
+    auto mask = this->m_alignment - 1;
+
+    width = (texture->gxWidth + 2 * this->m_padding + mask) & ~mask;
+    height = (texture->gxHeight + 2 * this->m_padding + mask) & ~mask;
+}
+
+int32_t CTextureAtlas::Insert(CTexture* texture, MipBits* images) {
+    uint32_t width, height, x, y;
+    this->GetPaddedSize(texture, width, height);
+
+    if (!this->FindPosition(width, height, x, y)) {
+        return 0;
+    }
+
+    this->Place(x, y, width, height);
+
+    uint32_t index = 0;
+
+    while (index < this->m_blocks.Count() && this->m_blocks[index].texture) {
+        index++;
+    }
+
+    if (index == this->m_blocks.Count()) {
+        this->m_blocks.New();
+    }
+
+    auto& block = this->m_blocks[index];
+    block.texture = texture;
+    block.x = x;
+    block.y = y;
+    block.width = width;
+    block.height = height;
+
+    this->m_usedArea += width * height;
+    this->m_liveCount++;
+
+    texture->atlas = this;
+    texture->atlasBlockIndex = index;
+
+    auto bytesPerPixel = GxCalcTexelStrideInBytes(this->m_format, 1);
+    uint32_t textureWidth = texture->gxWidth;
+    uint32_t textureHeight = texture->gxHeight;
+    auto textureLevels = CalcLevelCount(textureWidth, textureHeight);
+
+    for (uint32_t level = 0; level < this->m_levelCount; level++) {
+        // The block's footprint at this level, which bounds everything written
+        auto minX = x >> level;
+        auto minY = y >> level;
+        auto maxX = (x + width) >> level;
+        auto maxY = (y + height) >> level;
+
+        auto stride = GxCalcTexelStrideInBytes(this->m_format, std::max(this->m_size >> level, 1u));
+        auto dst = AtlasLevel(this->m_images, level);
+
+        // Past the end of the texture's own chain the block is a flat fill of
+        // its last 1x1 level, which is what further box filtering would give
+        if (level >= textureLevels) {
+            if (minX == maxX || minY == maxY) {
+                break;
+            }
+
+            auto texel = AtlasLevel(images, textureLevels - 1);
+
+            for (uint32_t row = minY; row < maxY; row++) {
+                for (uint32_t col = minX; col < maxX; col++) {
+                    memcpy(dst + row * stride + col * bytesPerPixel, texel, bytesPerPixel);
+                }
+            }
+
+            continue;
+        }
+
+        auto contentX = (x + this->m_padding) >> level;
+        auto contentY = (y + this->m_padding) >> level;
+        auto contentWidth = std::min(std::max(textureWidth >> level, 1u), maxX - std::min(contentX, maxX));
+        auto contentHeight = std::min(std::max(textureHeight >> level, 1u), maxY - std::min(contentY, maxY));
+
+        if (!contentWidth || !contentHeight) {
+            break;
+        }
+
+        auto srcStride = GxCalcTexelStrideInBytes(this->m_format, std::max(textureWidth >> level, 1u));
+        auto src = AtlasLevel(images, level);
+
+        for (uint32_t row = 0; row < contentHeight; row++) {
+            memcpy(dst + (contentY + row) * stride + contentX * bytesPerPixel, src + row * srcStride, contentWidth * bytesPerPixel);
+        }
+
+        // Gutters repeat the edge texels, shrinking with the level
+        auto gutter = this->m_padding >> level;
+
+        if (!gutter) {
+            continue;
+        }
+
+        auto left = std::max(contentX - gutter, minX);
+        auto right = std::min(contentX + contentWidth + gutter, maxX);
+        auto top = std::max(contentY - gutter, minY);
+        auto bottom = std::min(contentY + contentHeight + gutter, maxY);
+
+        for (uint32_t row = contentY; row < contentY + contentHeight; row++) {
+            auto line = dst + row * stride;
+
+            for (uint32_t col = left; col < contentX; col++) {
+                memcpy(line + col * bytesPerPixel, line + contentX * bytesPerPixel, bytesPerPixel);
+            }
+
+            for (uint32_t col = contentX + contentWidth; col < right; col++) {
+                memcpy(line + col * bytesPerPixel, line + (contentX + contentWidth - 1) * bytesPerPixel, bytesPerPixel);
+            }
+        }
+
+        for (uint32_t row = top; row < contentY; row++) {
+            memcpy(dst + row * stride + left * bytesPerPixel, dst + contentY * stride + left * bytesPerPixel, (right - left) * bytesPerPixel);
+        }
+
+        for (uint32_t row = contentY + contentHeight; row < bottom; row++) {
+            memcpy(dst + row * stride + left * bytesPerPixel, dst + (contentY + contentHeight - 1) * stride + left * bytesPerPixel, (right - left) * bytesPerPixel);
+        }
+    }
+
+    GxTexUpdate(this->m_gxTex, x, y, x + width, y + height, 1);
+
+    return 1;
+}
+
+void CTextureAtlas::Place(uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
+    TSGrowableArray<SKYLINE> skyline;
+    int32_t placed = 0;
+
+    for (uint32_t i = 0; i < this->m_skyline.Count(); i++) {
+        auto segment = this->m_skyline[i];
+        auto end = segment.x + segment.width;
+
+        if (end <= x || segment.x >= x + width) {
+            *skyline.New() = segment;
+            continue;
+        }
+
+        if (segment.x < x) {
+            *skyline.New() = { segment.x, segment.y, static_cast<uint16_t>(x - segment.x) };
+        }
+
+        if (!placed) {
+            *skyline.New() = { static_cast<uint16_t>(x), static_cast<uint16_t>(y + height), static_cast<uint16_t>(width) };
+            placed = 1;
+        }
+
+        if (end > x + width) {
+            *skyline.New() = { static_cast<uint16_t>(x + width), segment.y, static_cast<uint16_t>(end - x - width) };
+        }
+    }
+
+    // Merge neighbours left at the same height
+    this->m_skyline.SetCount(0);
+
+    for (uint32_t i = 0; i < skyline.Count(); i++) {
+        auto last = this->m_skyline.Count() ? &this->m_skyline[this->m_skyline.Count() - 1] : nullptr;
+
+        if (last && last->y == skyline[i].y) {
+            last->width += skyline[i].width;
+        } else {
+            *this->m_skyline.New() = skyline[i];
+        }
+    }
+
+    this->m_packedArea += width * height;
+}
+
+void CTextureAtlas::Reload() {
+    GxTexUpdate(this->m_gxTex, 0, 0, this->m_size, this->m_size, 1);
+}
+
+void CTextureAtlas::ResetSkyline() {
+    this->m_skyline.SetCount(1);
+    this->m_skyline[0] = { 0, 0, static_cast<uint16_t>(this->m_size) };
+
+    this->m_packedArea = 0;
+}
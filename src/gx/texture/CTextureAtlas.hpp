@@ -0,0 +1,78 @@
+#ifndef GX_TEXTURE_C_TEXTURE_ATLAS_HPP
+#define GX_TEXTURE_C_TEXTURE_ATLAS_HPP
+
+#include "gx/Types.hpp"
+#include "gx/texture/CGxTex.hpp"
+#include <cstdint>
+#include <storm/Array.hpp>
+#include <storm/List.hpp>
+#include <tempest/Vector.hpp>
+
+class CTexture;
+
+// A shared page holding many small textures. Blocks are placed along a
+// skyline, padded with gutters that repeat each edge at every mip level the
+// page carries. The page keeps a copy of its texels so it can be repacked
+// and reloaded. Repacking moves blocks under texture coordinates that batches
+// have already baked, so it only happens in Update, between frames; batches
+// compare s_generation to know when to remap.
+class CTextureAtlas : public TSLinkedNode<CTextureAtlas> {
+    public:
+        // Types
+        struct BLOCK {
+            CTexture* texture;
+            uint16_t x;
+            uint16_t y;
+            uint16_t width;
+            uint16_t height;
+        };
+
+        struct SKYLINE {
+            uint16_t x;
+            uint16_t y;
+            uint16_t width;
+        };
+
+        // Static variables
+        static int32_t s_enabled;
+        static uint32_t s_generation;
+        static uint32_t s_pageSize;
+        static STORM_LIST(CTextureAtlas) s_atlasList;
+
+        // Static functions
+        static CTextureAtlas* Get(CTexture* texture);
+        static int32_t IsEligible(CTexture* texture);
+        static void Update();
+
+        // Member variables
+        EGxTexFormat m_format;
+        CGxTexFlags m_flags;
+        uint32_t m_size;
+        uint32_t m_levelCount = 1;
+        uint32_t m_padding = 1;
+        uint32_t m_alignment = 1;
+        CGxTex* m_gxTex = nullptr;
+        MipBits* m_images = nullptr;
+        TSGrowableArray<BLOCK> m_blocks;
+        TSGrowableArray<SKYLINE> m_skyline;
+        uint32_t m_liveCount = 0;
+        uint32_t m_usedArea = 0;
+        uint32_t m_packedArea = 0;
+        int32_t m_compactPending = 0;
+
+        // Member functions
+        CTextureAtlas(EGxTexFormat format, CGxTexFlags flags, uint32_t size);
+        ~CTextureAtlas();
+        int32_t Compact();
+        int32_t FindPosition(uint32_t width, uint32_t height, uint32_t& x, uint32_t& y);
+        int32_t Fits(CTexture* texture);
+        void Free(CTexture* texture);
+        void GetOffsetAndScale(int32_t blockIndex, C2Vector& offset, C2Vector& scale);
+        void GetPaddedSize(CTexture* texture, uint32_t& width, uint32_t& height);
+        int32_t Insert(CTexture* texture, MipBits* images);
+        void Place(uint32_t x, uint32_t y, uint32_t width, uint32_t height);
+        void Reload();
+        void ResetSkyline();
+};
+
+#endif
@@ -0,0 +1,275 @@
+#include "gx/texture/CTgaFile.hpp"
+#include <algorithm>
+#include <cstring>
+
+thread_local TSGrowableArray<unsigned char> CTgaFile::s_tgaUnpackBuffer;
+
+static uint16_t TgaRead16(const unsigned char* src) {
+    return src[0] | (src[1] << 8);
+}
+
+static uint32_t TgaExpand5(uint32_t value) {
+    return (value << 3) | (value >> 2);
+}
+
+// Converts one true color pixel, stored blue first, to ARGB8888. Without
+// alpha bits in the descriptor the pixel is opaque.
+static uint32_t TgaColor(const unsigned char* src, uint32_t depth, uint32_t alphaBits) {
+    switch (depth) {
+        case 15:
+        case 16: {
+            uint32_t value = TgaRead16(src);
+            uint32_t alpha = alphaBits && !(value & 0x8000) ? 0x00000000 : 0xFF000000;
+
+            return alpha | (TgaExpand5((value >> 10) & 0x1F) << 16) | (TgaExpand5((value >> 5) & 0x1F) << 8) | TgaExpand5(value & 0x1F);
+        }
+
+        case 24:
+            return 0xFF000000 | (src[2] << 16) | (src[1] << 8) | src[0];
+
+        case 32:
+            return (alphaBits ? static_cast<uint32_t>(src[3]) << 24 : 0xFF000000) | (src[2] << 16) | (src[1] << 8) | src[0];
+
+        default:
+            return 0;
+    }
+}
+
+static uint32_t TgaGrey(const unsigned char* src, uint32_t depth, uint32_t alphaBits) {
+    uint32_t alpha = depth == 16 && alphaBits ? static_cast<uint32_t>(src[1]) << 24 : 0xFF000000;
+
+    return alpha | (src[0] * 0x010101);
+}
+
+// Expands RLE packets into count pixels of bytesPerPixel bytes. Repeat
+// packets fill by doubling the span already written, so every packet is a
+// handful of memcpy or memset calls rather than a loop over its pixels.
+static int32_t TgaUnpackRle(const unsigned char* src, const unsigned char* srcEnd, uint32_t bytesPerPixel, uint32_t count, unsigned char* dst) {
+    auto dstEnd = dst + static_cast<size_t>(count) * bytesPerPixel;
+
+    while (dst < dstEnd) {
+        if (src >= srcEnd) {
+            return 0;
+        }
+
+        uint32_t packet = *src++;
+        size_t bytes = ((packet & 0x7F) + 1) * bytesPerPixel;
+
+        // Packets may not cross the end of the image
+        bytes = std::min(bytes, static_cast<size_t>(dstEnd - dst));
+
+        if (packet & 0x80) {
+            if (static_cast<size_t>(srcEnd - src) < bytesPerPixel) {
+                return 0;
+            }
+
+            if (bytesPerPixel == 1) {
+                memset(dst, *src, bytes);
+            } else {
+                memcpy(dst, src, bytesPerPixel);
+
+                for (size_t filled = bytesPerPixel; filled < bytes; filled *= 2) {
+                    memcpy(dst + filled, dst, std::min(filled, bytes - filled));
+                }
+            }
+
+            src += bytesPerPixel;
+        } else {
+            if (static_cast<size_t>(srcEnd - src) < bytes) {
+                return 0;
+            }
+
+            memcpy(dst, src, bytes);
+
+            src += bytes;
+        }
+
+        dst += bytes;
+    }
+
+    return 1;
+}
+
+uint32_t CTgaFile::BytesPerPixel() {
+    return (this->m_header.pixelDepth + 7) / 8;
+}
+
+int32_t CTgaFile::IsRle() {
+    return this->m_header.imageType >= TGA_RLE_COLORMAPPED;
+}
+
+int32_t CTgaFile::Lock(uint32_t* dst) {
+    uint32_t width = this->m_header.width;
+    uint32_t height = this->m_header.height;
+    uint32_t bytesPerPixel = this->BytesPerPixel();
+    uint32_t depth = this->m_header.pixelDepth;
+    auto pixels = this->m_image;
+
+    size_t rowBytes = static_cast<size_t>(width) * bytesPerPixel;
+    size_t imageBytes = rowBytes * height;
+
+    // The unpack buffer is sized by a 32 bit count
+    if (imageBytes / height != rowBytes || imageBytes > UINT32_MAX) {
+        return 0;
+    }
+
+    if (this->IsRle()) {
+        CTgaFile::s_tgaUnpackBuffer.SetCount(static_cast<uint32_t>(imageBytes));
+
+        if (!TgaUnpackRle(this->m_image, this->m_imageEnd, bytesPerPixel, width * height, CTgaFile::s_tgaUnpackBuffer.Ptr())) {
+            return 0;
+        }
+
+        pixels = CTgaFile::s_tgaUnpackBuffer.Ptr();
+    }
+
+    auto grey = (this->m_header.imageType & 0x7) == TGA_GREY;
+
+    for (uint32_t y = 0; y < height; y++) {
+        auto src = pixels + y * rowBytes;
+        auto row = dst + static_cast<size_t>(this->m_header.descriptor & 0x20 ? y : height - 1 - y) * width;
+
+        if (bytesPerPixel == 1) {
+            for (uint32_t x = 0; x < width; x++) {
+                row[x] = this->m_palette[src[x]];
+            }
+        } else if (grey) {
+            for (uint32_t x = 0; x < width; x++) {
+                row[x] = TgaGrey(src + x * 2, depth, this->m_alphaBits);
+            }
+        } else if (depth == 32) {
+            // Blue first with alpha last is ARGB8888 already
+            memcpy(row, src, width * 4);
+
+            if (!this->m_alphaBits) {
+                for (uint32_t x = 0; x < width; x++) {
+                    row[x] |= 0xFF000000;
+                }
+            }
+        } else if (depth == 24) {
+            for (uint32_t x = 0; x < width; x++) {
+                row[x] = 0xFF000000 | (src[x * 3 + 2] << 16) | (src[x * 3 + 1] << 8) | src[x * 3];
+            }
+        } else {
+            for (uint32_t x = 0; x < width; x++) {
+                row[x] = TgaColor(src + x * 2, depth, this->m_alphaBits);
+            }
+        }
+
+        if (this->m_header.descriptor & 0x10) {
+            std::reverse(row, row + width);
+        }
+    }
+
+    return 1;
+}
+
+int32_t CTgaFile::Source(const void* buf, uint32_t size) {
+    auto data = static_cast<const unsigned char*>(buf);
+
+    if (size < 18) {
+        return 0;
+    }
+
+    auto& header = this->m_header;
+
+    header.idLength = data[0];
+    header.colorMapType = data[1];
+    header.imageType = data[2];
+    header.colorMapStart = TgaRead16(data + 3);
+    header.colorMapLength = TgaRead16(data + 5);
+    header.colorMapDepth = data[7];
+    header.xOrigin = TgaRead16(data + 8);
+    header.yOrigin = TgaRead16(data + 10);
+    header.width = TgaRead16(data + 12);
+    header.height = TgaRead16(data + 14);
+    header.pixelDepth = data[16];
+    header.descriptor = data[17];
+
+    if (!header.width || !header.height) {
+        return 0;
+    }
+
+    uint32_t type = header.imageType & 0x7;
+    uint32_t depth = header.pixelDepth;
+
+    switch (header.imageType) {
+        case TGA_COLORMAPPED:
+        case TGA_RLE_COLORMAPPED:
+            if (header.colorMapType != 1 || depth != 8 || !header.colorMapLength) {
+                return 0;
+            }
+
+            if (header.colorMapDepth != 15 && header.colorMapDepth != 16 && header.colorMapDepth != 24 && header.colorMapDepth != 32) {
+                return 0;
+            }
+
+            break;
+
+        case TGA_TRUECOLOR:
+        case TGA_RLE_TRUECOLOR:
+            if (depth != 15 && depth != 16 && depth != 24 && depth != 32) {
+                return 0;
+            }
+
+            break;
+
+        case TGA_GREY:
+        case TGA_RLE_GREY:
+            if (depth != 8 && depth != 16) {
+                return 0;
+            }
+
+            break;
+
+        default:
+            return 0;
+    }
+
+    // A color map may be present even when the image doesn't use it
+    size_t colorMapSize = header.colorMapType ? header.colorMapLength * ((header.colorMapDepth + 7) / 8) : 0;
+    size_t offset = 18 + header.idLength;
+
+    if (offset + colorMapSize > size) {
+        return 0;
+    }
+
+    this->m_colorMap = data + offset;
+    this->m_image = data + offset + colorMapSize;
+    this->m_imageEnd = data + size;
+
+    if (!this->IsRle() && static_cast<size_t>(this->m_imageEnd - this->m_image) < static_cast<size_t>(header.width) * header.height * this->BytesPerPixel()) {
+        return 0;
+    }
+
+    // Only 16 and 32 bit pixels carry alpha, and 16 bit color has one bit
+    uint32_t colorDepth = type == TGA_COLORMAPPED ? header.colorMapDepth : depth;
+    uint32_t alphaBits = header.descriptor & 0xF;
+
+    if (colorDepth != 16 && colorDepth != 32) {
+        alphaBits = 0;
+    } else if (colorDepth == 16 && type != TGA_GREY) {
+        alphaBits = std::min(alphaBits, 1u);
+    }
+
+    this->m_alphaBits = alphaBits;
+
+    // One byte pixels convert through a table
+    if (type == TGA_COLORMAPPED) {
+        auto entrySize = (header.colorMapDepth + 7) / 8;
+
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t entry = i - header.colorMapStart;
+
+            this->m_palette[i] = i >= header.colorMapStart && entry < header.colorMapLength
+                ? TgaColor(this->m_colorMap + entry * entrySize, header.colorMapDepth, this->m_alphaBits)
+                : 0;
+        }
+    } else if (type == TGA_GREY && depth == 8) {
+        for (uint32_t i = 0; i < 256; i++) {
+            this->m_palette[i] = 0xFF000000 | (i * 0x010101);
+        }
+    }
+
+    return 1;
+}
@@ -0,0 +1,54 @@
+#ifndef GX_TEXTURE_C_TGA_FILE_HPP
+#define GX_TEXTURE_C_TGA_FILE_HPP
+
+#include <cstdint>
+#include <storm/Array.hpp>
+
+enum TGA_IMAGE_TYPE {
+    TGA_COLORMAPPED     = 1,
+    TGA_TRUECOLOR       = 2,
+    TGA_GREY            = 3,
+    TGA_RLE_COLORMAPPED = 9,
+    TGA_RLE_TRUECOLOR   = 10,
+    TGA_RLE_GREY        = 11,
+};
+
+// Reads uncompressed and run length encoded true color, grey and color
+// mapped TGA images into top down ARGB8888 rows
+class CTgaFile {
+    struct TGAHeader {
+        uint8_t idLength;
+        uint8_t colorMapType;
+        uint8_t imageType;
+        uint16_t colorMapStart;
+        uint16_t colorMapLength;
+        uint8_t colorMapDepth;
+        uint16_t xOrigin;
+        uint16_t yOrigin;
+        uint16_t width;
+        uint16_t height;
+        uint8_t pixelDepth;
+        uint8_t descriptor;
+    };
+
+    public:
+        // Static variables
+        // Per thread, so files decoded on different threads don't share a buffer
+        static thread_local TSGrowableArray<unsigned char> s_tgaUnpackBuffer;
+
+        // Member variables
+        TGAHeader m_header;
+        const unsigned char* m_colorMap = nullptr;
+        const unsigned char* m_image = nullptr;
+        const unsigned char* m_imageEnd = nullptr;
+        uint32_t m_palette[256];
+        uint32_t m_alphaBits = 0;
+
+        // Member functions
+        uint32_t BytesPerPixel();
+        int32_t IsRle();
+        int32_t Lock(uint32_t* dst);
+        int32_t Source(const void* buf, uint32_t size);
+};
+
+#endif
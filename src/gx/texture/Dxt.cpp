@@ -0,0 +1,405 @@
+#include "gx/texture/Dxt.hpp"
+#include "gx/texture/PixelPack.hpp"
+#include <algorithm>
+#include <cstring>
+
+// Blocks are decoded four at a time into a 16x4 ARGB8888 tile, which is then
+// converted to the destination format
+#define DXT_TILE_BLOCKS 4
+#define DXT_TILE_WIDTH 16
+
+typedef void (*DXT_TILE_FUNCTION)(PIXEL_FORMAT, const uint8_t*, uint32_t*);
+
+static uint32_t DxtBlockSize(PIXEL_FORMAT format) {
+    return format == PIXEL_DXT1 ? 8 : 16;
+}
+
+static uint32_t DxtExpand5(uint32_t value) {
+    return (value << 3) | (value >> 2);
+}
+
+static uint32_t DxtExpand6(uint32_t value) {
+    return (value << 2) | (value >> 4);
+}
+
+// Builds the four colors of a color block. Blocks paired with explicit alpha
+// always use four colors; DXT1 blocks with c0 <= c1 use three plus
+// transparent black.
+static void DxtColorPalette(const uint8_t* color, int32_t alphaBlock, uint32_t* palette) {
+    uint16_t c0;
+    uint16_t c1;
+    memcpy(&c0, &color[0], sizeof(c0));
+    memcpy(&c1, &color[2], sizeof(c1));
+
+    uint32_t r0 = DxtExpand5(c0 >> 11);
+    uint32_t g0 = DxtExpand6((c0 >> 5) & 0x3F);
+    uint32_t b0 = DxtExpand5(c0 & 0x1F);
+    uint32_t r1 = DxtExpand5(c1 >> 11);
+    uint32_t g1 = DxtExpand6((c1 >> 5) & 0x3F);
+    uint32_t b1 = DxtExpand5(c1 & 0x1F);
+
+    palette[0] = 0xFF000000 | (r0 << 16) | (g0 << 8) | b0;
+    palette[1] = 0xFF000000 | (r1 << 16) | (g1 << 8) | b1;
+
+    if (alphaBlock || c0 > c1) {
+        palette[2] = 0xFF000000 | (((2 * r0 + r1) / 3) << 16) | (((2 * g0 + g1) / 3) << 8) | ((2 * b0 + b1) / 3);
+        palette[3] = 0xFF000000 | (((r0 + 2 * r1) / 3) << 16) | (((g0 + 2 * g1) / 3) << 8) | ((b0 + 2 * b1) / 3);
+    } else {
+        palette[2] = 0xFF000000 | (((r0 + r1) / 2) << 16) | (((g0 + g1) / 2) << 8) | ((b0 + b1) / 2);
+        palette[3] = 0x00000000;
+    }
+}
+
+// Builds the eight DXT5 alpha values, already shifted into the alpha byte
+static void DxtAlphaPalette(const uint8_t* alpha, uint32_t* palette) {
+    uint32_t a0 = alpha[0];
+    uint32_t a1 = alpha[1];
+
+    palette[0] = a0;
+    palette[1] = a1;
+
+    if (a0 > a1) {
+        for (uint32_t i = 1; i < 7; i++) {
+            palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+        }
+    } else {
+        for (uint32_t i = 1; i < 5; i++) {
+            palette[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+        }
+
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+
+    for (uint32_t i = 0; i < 8; i++) {
+        palette[i] <<= 24;
+    }
+}
+
+static void DxtDecodeBlock(PIXEL_FORMAT srcFormat, const uint8_t* block, uint32_t* tile, uint32_t tileStride) {
+    auto color = srcFormat == PIXEL_DXT1 ? block : block + 8;
+
+    uint32_t palette[4];
+    DxtColorPalette(color, srcFormat != PIXEL_DXT1, palette);
+
+    uint32_t indices;
+    memcpy(&indices, &color[4], sizeof(indices));
+
+    for (uint32_t i = 0; i < 16; i++) {
+        tile[(i / 4) * tileStride + i % 4] = palette[(indices >> (2 * i)) & 0x3];
+    }
+
+    if (srcFormat == PIXEL_DXT3) {
+        uint64_t bits;
+        memcpy(&bits, block, sizeof(bits));
+
+        for (uint32_t i = 0; i < 16; i++) {
+            uint32_t alpha = (bits >> (4 * i)) & 0xF;
+            auto pixel = &tile[(i / 4) * tileStride + i % 4];
+            *pixel = (*pixel & 0x00FFFFFF) | ((alpha | (alpha << 4)) << 24);
+        }
+    } else if (srcFormat == PIXEL_DXT5) {
+        uint32_t alphas[8];
+        DxtAlphaPalette(block, alphas);
+
+        uint64_t bits = 0;
+        memcpy(&bits, &block[2], 6);
+
+        for (uint32_t i = 0; i < 16; i++) {
+            auto pixel = &tile[(i / 4) * tileStride + i % 4];
+            *pixel = (*pixel & 0x00FFFFFF) | alphas[(bits >> (3 * i)) & 0x7];
+        }
+    }
+}
+
+static void DxtDecodeTileScalar(PIXEL_FORMAT srcFormat, const uint8_t* blocks, uint32_t* tile) {
+    auto blockSize = DxtBlockSize(srcFormat);
+
+    for (uint32_t b = 0; b < DXT_TILE_BLOCKS; b++) {
+        DxtDecodeBlock(srcFormat, &blocks[b * blockSize], &tile[b * 4], DXT_TILE_WIDTH);
+    }
+}
+
+static void DxtStoreRect(const uint32_t* tile, uint32_t x, uint32_t y, uint32_t columns, uint32_t rows, uint32_t width, PIXEL_FORMAT dstFormat, uint8_t* dst, PIXEL_PACK_FUNCTION pack) {
+    auto pixelSize = dstFormat == PIXEL_ARGB8888 ? 4 : 2;
+
+    for (uint32_t r = 0; r < rows; r++) {
+        auto offset = static_cast<size_t>(y + r) * width + x;
+        pack(&tile[r * DXT_TILE_WIDTH], columns, dstFormat, &dst[offset * pixelSize]);
+    }
+}
+
+#if defined(PIXEL_SIMD_SSE2)
+
+static __m128i DxtSelectSse2(__m128i mask, __m128i a, __m128i b) {
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+static __m128i DxtExpand5Sse2(__m128i value) {
+    return _mm_or_si128(_mm_slli_epi32(value, 3), _mm_srli_epi32(value, 2));
+}
+
+static __m128i DxtExpand6Sse2(__m128i value) {
+    return _mm_or_si128(_mm_slli_epi32(value, 2), _mm_srli_epi32(value, 4));
+}
+
+// x / 3 for x < 65536, the 16 bit lanes _mm_mulhi_epu16 works on, via the high
+// half of x * 0xAAAB. Each 32 bit lane holds a value below 65536, so its upper
+// 16 bits stay zero.
+static __m128i DxtDivide3Sse2(__m128i value) {
+    return _mm_srli_epi32(_mm_mulhi_epu16(value, _mm_set1_epi32(0xAAAB)), 1);
+}
+
+static void DxtDecodeTileSse2(PIXEL_FORMAT srcFormat, const uint8_t* blocks, uint32_t* tile) {
+    auto blockSize = DxtBlockSize(srcFormat);
+    auto colorOffset = srcFormat == PIXEL_DXT1 ? 0 : 8;
+
+    uint32_t endpoints[DXT_TILE_BLOCKS];
+    uint32_t indices[DXT_TILE_BLOCKS];
+
+    for (uint32_t b = 0; b < DXT_TILE_BLOCKS; b++) {
+        memcpy(&endpoints[b], &blocks[b * blockSize + colorOffset], sizeof(uint32_t));
+        memcpy(&indices[b], &blocks[b * blockSize + colorOffset + 4], sizeof(uint32_t));
+    }
+
+    // Palettes for all four blocks at once, one block per lane
+    auto packed = _mm_loadu_si128(reinterpret_cast<const __m128i*>(endpoints));
+    auto c0 = _mm_and_si128(packed, _mm_set1_epi32(0xFFFF));
+    auto c1 = _mm_srli_epi32(packed, 16);
+
+    auto mask5 = _mm_set1_epi32(0x1F);
+    auto mask6 = _mm_set1_epi32(0x3F);
+
+    auto r0 = DxtExpand5Sse2(_mm_srli_epi32(c0, 11));
+    auto g0 = DxtExpand6Sse2(_mm_and_si128(_mm_srli_epi32(c0, 5), mask6));
+    auto b0 = DxtExpand5Sse2(_mm_and_si128(c0, mask5));
+    auto r1 = DxtExpand5Sse2(_mm_srli_epi32(c1, 11));
+    auto g1 = DxtExpand6Sse2(_mm_and_si128(_mm_srli_epi32(c1, 5), mask6));
+    auto b1 = DxtExpand5Sse2(_mm_and_si128(c1, mask5));
+
+    auto fourColor = srcFormat == PIXEL_DXT1 ? _mm_cmpgt_epi32(c0, c1) : _mm_set1_epi32(-1);
+
+    auto r2 = DxtSelectSse2(fourColor, DxtDivide3Sse2(_mm_add_epi32(_mm_add_epi32(r0, r0), r1)), _mm_srli_epi32(_mm_add_epi32(r0, r1), 1));
+    auto g2 = DxtSelectSse2(fourColor, DxtDivide3Sse2(_mm_add_epi32(_mm_add_epi32(g0, g0), g1)), _mm_srli_epi32(_mm_add_epi32(g0, g1), 1));
+    auto b2 = DxtSelectSse2(fourColor, DxtDivide3Sse2(_mm_add_epi32(_mm_add_epi32(b0, b0), b1)), _mm_srli_epi32(_mm_add_epi32(b0, b1), 1));
+    auto r3 = _mm_and_si128(fourColor, DxtDivide3Sse2(_mm_add_epi32(r0, _mm_add_epi32(r1, r1))));
+    auto g3 = _mm_and_si128(fourColor, DxtDivide3Sse2(_mm_add_epi32(g0, _mm_add_epi32(g1, g1))));
+    auto b3 = _mm_and_si128(fourColor, DxtDivide3Sse2(_mm_add_epi32(b0, _mm_add_epi32(b1, b1))));
+
+    auto opaque = _mm_set1_epi32(0xFF000000);
+
+    auto p0 = _mm_or_si128(opaque, _mm_or_si128(_mm_slli_epi32(r0, 16), _mm_or_si128(_mm_slli_epi32(g0, 8), b0)));
+    auto p1 = _mm_or_si128(opaque, _mm_or_si128(_mm_slli_epi32(r1, 16), _mm_or_si128(_mm_slli_epi32(g1, 8), b1)));
+    auto p2 = _mm_or_si128(opaque, _mm_or_si128(_mm_slli_epi32(r2, 16), _mm_or_si128(_mm_slli_epi32(g2, 8), b2)));
+    auto p3 = _mm_or_si128(_mm_and_si128(fourColor, opaque), _mm_or_si128(_mm_slli_epi32(r3, 16), _mm_or_si128(_mm_slli_epi32(g3, 8), b3)));
+
+    // Transpose so each vector holds one block's palette
+    auto t0 = _mm_unpacklo_epi32(p0, p1);
+    auto t1 = _mm_unpacklo_epi32(p2, p3);
+    auto t2 = _mm_unpackhi_epi32(p0, p1);
+    auto t3 = _mm_unpackhi_epi32(p2, p3);
+
+    __m128i palettes[DXT_TILE_BLOCKS] = {
+        _mm_unpacklo_epi64(t0, t1),
+        _mm_unpackhi_epi64(t0, t1),
+        _mm_unpacklo_epi64(t2, t3),
+        _mm_unpackhi_epi64(t2, t3)
+    };
+
+    // Multiplying a row of packed indices by per-lane powers of two lines
+    // each pixel's index up at the same bit position
+    auto colorShift = _mm_set_epi32(1, 4, 16, 64);
+    auto alpha3Shift = _mm_set_epi32(1, 16, 256, 4096);
+    auto alpha5Shift = _mm_set_epi32(1, 8, 64, 512);
+    auto mask16 = _mm_set1_epi32(0xFFFF);
+    auto rgb = _mm_set1_epi32(0x00FFFFFF);
+
+    __m128i values[8];
+    for (uint32_t i = 0; i < 8; i++) {
+        values[i] = _mm_set1_epi32(i);
+    }
+
+    for (uint32_t b = 0; b < DXT_TILE_BLOCKS; b++) {
+        auto block = &blocks[b * blockSize];
+
+        __m128i colors[4] = {
+            _mm_shuffle_epi32(palettes[b], 0x00),
+            _mm_shuffle_epi32(palettes[b], 0x55),
+            _mm_shuffle_epi32(palettes[b], 0xAA),
+            _mm_shuffle_epi32(palettes[b], 0xFF)
+        };
+
+        uint64_t alphaBits = 0;
+        __m128i alphas[8];
+
+        if (srcFormat == PIXEL_DXT3) {
+            memcpy(&alphaBits, block, sizeof(alphaBits));
+        } else if (srcFormat == PIXEL_DXT5) {
+            memcpy(&alphaBits, &block[2], 6);
+
+            uint32_t palette[8];
+            DxtAlphaPalette(block, palette);
+
+            for (uint32_t i = 0; i < 8; i++) {
+                alphas[i] = _mm_set1_epi32(palette[i]);
+            }
+        }
+
+        for (uint32_t r = 0; r < 4; r++) {
+            auto row = _mm_set1_epi32((indices[b] >> (8 * r)) & 0xFF);
+            auto index = _mm_and_si128(_mm_srli_epi32(_mm_mullo_epi16(row, colorShift), 6), values[3]);
+
+            auto pixel = _mm_and_si128(_mm_cmpeq_epi32(index, values[0]), colors[0]);
+            pixel = _mm_or_si128(pixel, _mm_and_si128(_mm_cmpeq_epi32(index, values[1]), colors[1]));
+            pixel = _mm_or_si128(pixel, _mm_and_si128(_mm_cmpeq_epi32(index, values[2]), colors[2]));
+            pixel = _mm_or_si128(pixel, _mm_and_si128(_mm_cmpeq_epi32(index, values[3]), colors[3]));
+
+            if (srcFormat == PIXEL_DXT3) {
+                auto bits = _mm_set1_epi32((alphaBits >> (16 * r)) & 0xFFFF);
+                auto alpha = _mm_srli_epi32(_mm_and_si128(_mm_mullo_epi16(bits, alpha3Shift), mask16), 12);
+                alpha = _mm_or_si128(alpha, _mm_slli_epi32(alpha, 4));
+
+                pixel = _mm_or_si128(_mm_and_si128(pixel, rgb), _mm_slli_epi32(alpha, 24));
+            } else if (srcFormat == PIXEL_DXT5) {
+                auto bits = _mm_set1_epi32((alphaBits >> (12 * r)) & 0xFFF);
+                auto alphaIndex = _mm_and_si128(_mm_srli_epi32(_mm_and_si128(_mm_mullo_epi16(bits, alpha5Shift), mask16), 9), values[7]);
+
+                auto alpha = _mm_and_si128(_mm_cmpeq_epi32(alphaIndex, values[0]), alphas[0]);
+                for (uint32_t i = 1; i < 8; i++) {
+                    alpha = _mm_or_si128(alpha, _mm_and_si128(_mm_cmpeq_epi32(alphaIndex, values[i]), alphas[i]));
+                }
+
+                pixel = _mm_or_si128(_mm_and_si128(pixel, rgb), alpha);
+            }
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(&tile[r * DXT_TILE_WIDTH + b * 4]), pixel);
+        }
+    }
+}
+
+#elif defined(PIXEL_SIMD_NEON)
+
+static void DxtDecodeTileNeon(PIXEL_FORMAT srcFormat, const uint8_t* blocks, uint32_t* tile) {
+    auto blockSize = DxtBlockSize(srcFormat);
+    auto colorOffset = srcFormat == PIXEL_DXT1 ? 0 : 8;
+
+    // Negative counts shift right, one lane per pixel in a row
+    static const int32_t colorShifts[4] = { 0, -2, -4, -6 };
+    static const int32_t alpha3Shifts[4] = { 0, -4, -8, -12 };
+    static const int32_t alpha5Shifts[4] = { 0, -3, -6, -9 };
+
+    auto colorShift = vld1q_s32(colorShifts);
+    auto alpha3Shift = vld1q_s32(alpha3Shifts);
+    auto alpha5Shift = vld1q_s32(alpha5Shifts);
+    auto rgb = vdupq_n_u32(0x00FFFFFF);
+
+    for (uint32_t b = 0; b < DXT_TILE_BLOCKS; b++) {
+        auto block = &blocks[b * blockSize];
+        auto color = &block[colorOffset];
+
+        uint32_t palette[4];
+        DxtColorPalette(color, srcFormat != PIXEL_DXT1, palette);
+
+        uint32_t indices;
+        memcpy(&indices, &color[4], sizeof(indices));
+
+        uint64_t alphaBits = 0;
+        uint32_t alphas[8];
+
+        if (srcFormat == PIXEL_DXT3) {
+            memcpy(&alphaBits, block, sizeof(alphaBits));
+        } else if (srcFormat == PIXEL_DXT5) {
+            memcpy(&alphaBits, &block[2], 6);
+            DxtAlphaPalette(block, alphas);
+        }
+
+        for (uint32_t r = 0; r < 4; r++) {
+            auto index = vandq_u32(vshlq_u32(vdupq_n_u32((indices >> (8 * r)) & 0xFF), colorShift), vdupq_n_u32(0x3));
+
+            auto pixel = vandq_u32(vceqq_u32(index, vdupq_n_u32(0)), vdupq_n_u32(palette[0]));
+            for (uint32_t i = 1; i < 4; i++) {
+                pixel = vorrq_u32(pixel, vandq_u32(vceqq_u32(index, vdupq_n_u32(i)), vdupq_n_u32(palette[i])));
+            }
+
+            if (srcFormat == PIXEL_DXT3) {
+                auto alpha = vandq_u32(vshlq_u32(vdupq_n_u32((alphaBits >> (16 * r)) & 0xFFFF), alpha3Shift), vdupq_n_u32(0xF));
+                alpha = vorrq_u32(alpha, vshlq_n_u32(alpha, 4));
+
+                pixel = vorrq_u32(vandq_u32(pixel, rgb), vshlq_n_u32(alpha, 24));
+            } else if (srcFormat == PIXEL_DXT5) {
+                auto alphaIndex = vandq_u32(vshlq_u32(vdupq_n_u32((alphaBits >> (12 * r)) & 0xFFF), alpha5Shift), vdupq_n_u32(0x7));
+
+                auto alpha = vandq_u32(vceqq_u32(alphaIndex, vdupq_n_u32(0)), vdupq_n_u32(alphas[0]));
+                for (uint32_t i = 1; i < 8; i++) {
+                    alpha = vorrq_u32(alpha, vandq_u32(vceqq_u32(alphaIndex, vdupq_n_u32(i)), vdupq_n_u32(alphas[i])));
+                }
+
+                pixel = vorrq_u32(vandq_u32(pixel, rgb), alpha);
+            }
+
+            vst1q_u32(&tile[r * DXT_TILE_WIDTH + b * 4], pixel);
+        }
+    }
+}
+
+#endif
+
+static int32_t DxtDecompressImage(PIXEL_FORMAT srcFormat, uint32_t width, uint32_t height, const void* src, PIXEL_FORMAT dstFormat, void* dst, DXT_TILE_FUNCTION decodeTile, PIXEL_PACK_FUNCTION pack) {
+    if (srcFormat != PIXEL_DXT1 && srcFormat != PIXEL_DXT3 && srcFormat != PIXEL_DXT5) {
+        return 0;
+    }
+
+    if (dstFormat != PIXEL_ARGB8888 && dstFormat != PIXEL_ARGB4444 && dstFormat != PIXEL_ARGB1555 && dstFormat != PIXEL_RGB565) {
+        return 0;
+    }
+
+    auto blockSize = DxtBlockSize(srcFormat);
+    auto blocksWide = (width + 3) / 4;
+    auto blocksHigh = (height + 3) / 4;
+    auto in = static_cast<const uint8_t*>(src);
+    auto out = static_cast<uint8_t*>(dst);
+
+    uint32_t tile[DXT_TILE_WIDTH * 4];
+    uint8_t padded[DXT_TILE_BLOCKS * 16];
+
+    for (uint32_t by = 0; by < blocksHigh; by++) {
+        auto row = &in[static_cast<size_t>(by) * blocksWide * blockSize];
+        auto y = by * 4;
+        auto rows = std::min(4u, height - y);
+
+        for (uint32_t bx = 0; bx < blocksWide; bx += DXT_TILE_BLOCKS) {
+            auto blocks = &row[bx * blockSize];
+            auto count = std::min(static_cast<uint32_t>(DXT_TILE_BLOCKS), blocksWide - bx);
+
+            // Short runs at the right edge are padded out to a full tile
+            if (count < DXT_TILE_BLOCKS) {
+                memset(padded, 0, sizeof(padded));
+                memcpy(padded, blocks, count * blockSize);
+                blocks = padded;
+            }
+
+            decodeTile(srcFormat, blocks, tile);
+
+            auto x = bx * 4;
+            auto columns = std::min(static_cast<uint32_t>(DXT_TILE_WIDTH), width - x);
+
+            DxtStoreRect(tile, x, y, columns, rows, width, dstFormat, out, pack);
+        }
+    }
+
+    return 1;
+}
+
+int32_t DxtDecompress(PIXEL_FORMAT srcFormat, uint32_t width, uint32_t height, const void* src, PIXEL_FORMAT dstFormat, void* dst) {
+#if defined(PIXEL_SIMD_SSE2)
+    return DxtDecompressImage(srcFormat, width, height, src, dstFormat, dst, &DxtDecodeTileSse2, &PixelPack);
+#elif defined(PIXEL_SIMD_NEON)
+    return DxtDecompressImage(srcFormat, width, height, src, dstFormat, dst, &DxtDecodeTileNeon, &PixelPack);
+#else
+    return DxtDecompressImage(srcFormat, width, height, src, dstFormat, dst, &DxtDecodeTileScalar, &PixelPack);
+#endif
+}
+
+int32_t DxtDecompressScalar(PIXEL_FORMAT srcFormat, uint32_t width, uint32_t height, const void* src, PIXEL_FORMAT dstFormat, void* dst) {
+    return DxtDecompressImage(srcFormat, width, height, src, dstFormat, dst, &DxtDecodeTileScalar, &PixelPackScalar);
+}
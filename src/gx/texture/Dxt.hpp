@@ -0,0 +1,14 @@
+#ifndef GX_TEXTURE_DXT_HPP
+#define GX_TEXTURE_DXT_HPP
+
+#include "gx/Types.hpp"
+#include <cstdint>
+
+// Decompresses a DXT1, DXT3 or DXT5 image into tightly packed ARGB8888,
+// ARGB4444, ARGB1555 or RGB565 rows. Returns 0 for unsupported formats.
+int32_t DxtDecompress(PIXEL_FORMAT srcFormat, uint32_t width, uint32_t height, const void* src, PIXEL_FORMAT dstFormat, void* dst);
+
+// Reference decoder with the same output as DxtDecompress, one block at a time
+int32_t DxtDecompressScalar(PIXEL_FORMAT srcFormat, uint32_t width, uint32_t height, const void* src, PIXEL_FORMAT dstFormat, void* dst);
+
+#endif
@@ -0,0 +1,347 @@
+#include "gx/texture/MipMap.hpp"
+#include "gx/Texture.hpp"
+#include "gx/texture/PixelPack.hpp"
+#include <algorithm>
+#include <cmath>
+#include <storm/Memory.hpp>
+
+#define MIP_MAX_TAPS 16
+#define MIP_TILE_WIDTH 64
+#define MIP_LINEAR_STEPS 4096
+#define MIP_PI 3.14159265358979323846
+
+#if defined(PIXEL_SIMD_SSE2)
+
+typedef __m128 MipVec;
+
+static MipVec MipVecSplat(float value) {
+    return _mm_set1_ps(value);
+}
+
+static MipVec MipVecLoad(const float* src) {
+    return _mm_loadu_ps(src);
+}
+
+static void MipVecStore(float* dst, MipVec value) {
+    _mm_storeu_ps(dst, value);
+}
+
+static MipVec MipVecMulAdd(MipVec sum, MipVec value, MipVec weight) {
+    return _mm_add_ps(sum, _mm_mul_ps(value, weight));
+}
+
+#elif defined(PIXEL_SIMD_NEON)
+
+typedef float32x4_t MipVec;
+
+static MipVec MipVecSplat(float value) {
+    return vdupq_n_f32(value);
+}
+
+static MipVec MipVecLoad(const float* src) {
+    return vld1q_f32(src);
+}
+
+static void MipVecStore(float* dst, MipVec value) {
+    vst1q_f32(dst, value);
+}
+
+static MipVec MipVecMulAdd(MipVec sum, MipVec value, MipVec weight) {
+    return vmlaq_f32(sum, value, weight);
+}
+
+#else
+
+struct MipVec {
+    float v[4];
+};
+
+static MipVec MipVecSplat(float value) {
+    return { { value, value, value, value } };
+}
+
+static MipVec MipVecLoad(const float* src) {
+    return { { src[0], src[1], src[2], src[3] } };
+}
+
+static void MipVecStore(float* dst, MipVec value) {
+    for (uint32_t i = 0; i < 4; i++) {
+        dst[i] = value.v[i];
+    }
+}
+
+static MipVec MipVecMulAdd(MipVec sum, MipVec value, MipVec weight) {
+    for (uint32_t i = 0; i < 4; i++) {
+        sum.v[i] += value.v[i] * weight.v[i];
+    }
+
+    return sum;
+}
+
+#endif
+
+// 2:1 reduction along one axis: destination pixel x reads source pixels
+// step * x + base + [0, taps). An axis of size 1 passes through.
+struct MipKernel {
+    uint32_t taps;
+    uint32_t step;
+    int32_t base;
+    MipVec weights[MIP_MAX_TAPS];
+};
+
+struct MipTables {
+    float toFloat[256];
+    float toLinear[256];
+    uint8_t fromLinear[MIP_LINEAR_STEPS];
+
+    MipTables() {
+        for (uint32_t i = 0; i < 256; i++) {
+            double value = i / 255.0;
+
+            this->toFloat[i] = value;
+            this->toLinear[i] = value <= 0.04045 ? value / 12.92 : pow((value + 0.055) / 1.055, 2.4);
+        }
+
+        for (uint32_t i = 0; i < MIP_LINEAR_STEPS; i++) {
+            double value = i / static_cast<double>(MIP_LINEAR_STEPS - 1);
+            double srgb = value <= 0.0031308 ? value * 12.92 : 1.055 * pow(value, 1.0 / 2.4) - 0.055;
+
+            this->fromLinear[i] = static_cast<uint8_t>(srgb * 255.0 + 0.5);
+        }
+    }
+};
+
+static const MipTables& MipGetTables() {
+    static MipTables tables;
+    return tables;
+}
+
+static double MipSinc(double x) {
+    if (fabs(x) < 1e-9) {
+        return 1.0;
+    }
+
+    x *= MIP_PI;
+    return sin(x) / x;
+}
+
+static double MipBesselI0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+
+    for (uint32_t k = 1; term > sum * 1e-12; k++) {
+        term *= (x * x) / (4.0 * k * k);
+        sum += term;
+    }
+
+    return sum;
+}
+
+// Kernel radius in destination pixels
+static double MipKernelRadius(MipMapAlgorithm algorithm) {
+    switch (algorithm) {
+        case MMA_CUBIC:
+            return 2.0;
+
+        case MMA_FULLDFT:
+            return 4.0;
+
+        case MMA_KAISER:
+        case MMA_LINEARLIGHTKAISER:
+            return 3.0;
+
+        default:
+            return 0.5;
+    }
+}
+
+static double MipKernelValue(MipMapAlgorithm algorithm, double x) {
+    x = fabs(x);
+
+    switch (algorithm) {
+        case MMA_CUBIC:
+            // Catmull-Rom
+            if (x < 1.0) {
+                return 1.5 * x * x * x - 2.5 * x * x + 1.0;
+            }
+
+            return x < 2.0 ? -0.5 * x * x * x + 2.5 * x * x - 4.0 * x + 2.0 : 0.0;
+
+        case MMA_FULLDFT:
+            // Ideal low pass, cut off with a Lanczos window
+            return x < 4.0 ? MipSinc(x) * MipSinc(x / 4.0) : 0.0;
+
+        case MMA_KAISER:
+        case MMA_LINEARLIGHTKAISER: {
+            if (x >= 3.0) {
+                return 0.0;
+            }
+
+            double ratio = x / 3.0;
+            return MipSinc(x) * MipBesselI0(4.0 * sqrt(1.0 - ratio * ratio)) / MipBesselI0(4.0);
+        }
+
+        default:
+            return x < 0.5 ? 1.0 : 0.0;
+    }
+}
+
+static void MipKernelInit(MipMapAlgorithm algorithm, uint32_t size, MipKernel& kernel) {
+    if (size == 1) {
+        kernel.taps = 1;
+        kernel.step = 1;
+        kernel.base = 0;
+        kernel.weights[0] = MipVecSplat(1.0f);
+
+        return;
+    }
+
+    kernel.taps = static_cast<uint32_t>(MipKernelRadius(algorithm) * 4.0);
+    kernel.step = 2;
+    kernel.base = 1 - static_cast<int32_t>(kernel.taps / 2);
+
+    // Source pixel centers sit 0.5 past their index; the destination center
+    // sits between source pixels 2x and 2x + 1
+    double weights[MIP_MAX_TAPS];
+    double sum = 0.0;
+
+    for (uint32_t k = 0; k < kernel.taps; k++) {
+        weights[k] = MipKernelValue(algorithm, (kernel.base + static_cast<int32_t>(k) - 0.5) / 2.0);
+        sum += weights[k];
+    }
+
+    for (uint32_t k = 0; k < kernel.taps; k++) {
+        kernel.weights[k] = MipVecSplat(static_cast<float>(weights[k] / sum));
+    }
+}
+
+static void MipDecodeRow(const C4Pixel* row, uint32_t width, int32_t first, uint32_t count, const float* colorTable, const float* alphaTable, float* dst) {
+    for (uint32_t i = 0; i < count; i++) {
+        auto x = std::min(std::max(first + static_cast<int32_t>(i), 0), static_cast<int32_t>(width) - 1);
+        auto& pixel = row[x];
+
+        dst[i * 4 + 0] = colorTable[static_cast<uint8_t>(pixel.b)];
+        dst[i * 4 + 1] = colorTable[static_cast<uint8_t>(pixel.g)];
+        dst[i * 4 + 2] = colorTable[static_cast<uint8_t>(pixel.r)];
+        dst[i * 4 + 3] = alphaTable[static_cast<uint8_t>(pixel.a)];
+    }
+}
+
+static void MipFilterRow(const MipKernel& kernel, const float* src, uint32_t count, float* dst) {
+    for (uint32_t x = 0; x < count; x++) {
+        auto in = &src[x * kernel.step * 4];
+        auto sum = MipVecSplat(0.0f);
+
+        for (uint32_t k = 0; k < kernel.taps; k++) {
+            sum = MipVecMulAdd(sum, MipVecLoad(&in[k * 4]), kernel.weights[k]);
+        }
+
+        MipVecStore(&dst[x * 4], sum);
+    }
+}
+
+static char MipEncode(float value) {
+    return static_cast<char>(static_cast<uint8_t>(std::min(std::max(value * 255.0f + 0.5f, 0.0f), 255.0f)));
+}
+
+static char MipEncodeLinear(const uint8_t* fromLinear, float value) {
+    auto index = std::min(std::max(value * (MIP_LINEAR_STEPS - 1) + 0.5f, 0.0f), static_cast<float>(MIP_LINEAR_STEPS - 1));
+    return static_cast<char>(fromLinear[static_cast<uint32_t>(index)]);
+}
+
+void MipMapReduce(MipMapAlgorithm algorithm, int32_t gammaCorrect, uint32_t width, uint32_t height, const C4Pixel* src, C4Pixel* dst) {
+    auto& tables = MipGetTables();
+    auto linear = gammaCorrect || algorithm == MMA_LINEARLIGHTKAISER;
+    auto colorTable = linear ? tables.toLinear : tables.toFloat;
+
+    auto dstWidth = std::max(width >> 1, 1u);
+    auto dstHeight = std::max(height >> 1, 1u);
+
+    MipKernel horizontal;
+    MipKernel vertical;
+    MipKernelInit(algorithm, width, horizontal);
+    MipKernelInit(algorithm, height, vertical);
+
+    // Work on columns of MIP_TILE_WIDTH destination pixels. Each source row
+    // of a column is decoded and filtered horizontally once, into a ring of
+    // vertical.taps rows, then the ring is filtered vertically.
+    auto decodeCount = horizontal.step * (MIP_TILE_WIDTH - 1) + horizontal.taps;
+    auto ringStride = MIP_TILE_WIDTH * 4;
+    auto buffer = static_cast<float*>(SMemAlloc((decodeCount * 4 + vertical.taps * ringStride + 4) * sizeof(float), __FILE__, __LINE__, 0x0));
+    auto decoded = buffer;
+    auto ring = &buffer[decodeCount * 4];
+    auto sum = &ring[vertical.taps * ringStride];
+
+    int32_t ringRows[MIP_MAX_TAPS];
+    float* taps[MIP_MAX_TAPS];
+
+    for (uint32_t x0 = 0; x0 < dstWidth; x0 += MIP_TILE_WIDTH) {
+        auto count = std::min(static_cast<uint32_t>(MIP_TILE_WIDTH), dstWidth - x0);
+        auto first = static_cast<int32_t>(horizontal.step * x0) + horizontal.base;
+        auto decodeWidth = horizontal.step * (count - 1) + horizontal.taps;
+
+        std::fill(ringRows, ringRows + MIP_MAX_TAPS, -1);
+
+        for (uint32_t y = 0; y < dstHeight; y++) {
+            // Clamped rows near the edges repeat, but the rows one destination
+            // row needs always fit the ring without collisions
+            for (uint32_t k = 0; k < vertical.taps; k++) {
+                auto row = static_cast<int32_t>(vertical.step * y) + vertical.base + static_cast<int32_t>(k);
+                row = std::min(std::max(row, 0), static_cast<int32_t>(height) - 1);
+
+                auto slot = row % vertical.taps;
+                taps[k] = &ring[slot * ringStride];
+
+                if (ringRows[slot] != row) {
+                    MipDecodeRow(&src[static_cast<size_t>(row) * width], width, first, decodeWidth, colorTable, tables.toFloat, decoded);
+                    MipFilterRow(horizontal, decoded, count, taps[k]);
+                    ringRows[slot] = row;
+                }
+            }
+
+            auto out = &dst[static_cast<size_t>(y) * dstWidth + x0];
+
+            for (uint32_t x = 0; x < count; x++) {
+                auto value = MipVecSplat(0.0f);
+
+                for (uint32_t k = 0; k < vertical.taps; k++) {
+                    value = MipVecMulAdd(value, MipVecLoad(&taps[k][x * 4]), vertical.weights[k]);
+                }
+
+                MipVecStore(sum, value);
+
+                if (linear) {
+                    out[x].b = MipEncodeLinear(tables.fromLinear, sum[0]);
+                    out[x].g = MipEncodeLinear(tables.fromLinear, sum[1]);
+                    out[x].r = MipEncodeLinear(tables.fromLinear, sum[2]);
+                } else {
+                    out[x].b = MipEncode(sum[0]);
+                    out[x].g = MipEncode(sum[1]);
+                    out[x].r = MipEncode(sum[2]);
+                }
+
+                out[x].a = MipEncode(sum[3]);
+            }
+        }
+    }
+
+    SMemFree(buffer, __FILE__, __LINE__, 0);
+}
+
+int32_t MipMapGenerateChain(MipMapAlgorithm algorithm, int32_t gammaCorrect, uint32_t width, uint32_t height, MipBits* images) {
+    if (width == 6 * height) {
+        return 0;
+    }
+
+    auto levels = reinterpret_cast<C4Pixel**>(images);
+    auto levelCount = CalcLevelCount(width, height);
+
+    for (uint32_t level = 1; level < levelCount; level++) {
+        auto levelWidth = std::max(width >> (level - 1), 1u);
+        auto levelHeight = std::max(height >> (level - 1), 1u);
+
+        MipMapReduce(algorithm, gammaCorrect, levelWidth, levelHeight, levels[level - 1], levels[level]);
+    }
+
+    return 1;
+}
@@ -0,0 +1,16 @@
+#ifndef GX_TEXTURE_MIP_MAP_HPP
+#define GX_TEXTURE_MIP_MAP_HPP
+
+#include "gx/Types.hpp"
+#include <cstdint>
+
+// Filters an ARGB8888 image down one level, halving each dimension above 1.
+// Gamma correct filtering averages color in linear light; alpha is always
+// filtered as is. MMA_LINEARLIGHTKAISER is always gamma correct.
+void MipMapReduce(MipMapAlgorithm algorithm, int32_t gammaCorrect, uint32_t width, uint32_t height, const C4Pixel* src, C4Pixel* dst);
+
+// Fills every level after the first of an ARGB8888 chain laid out by
+// MippedImgAllocA or MippedImgSet. Returns 0 for cube maps.
+int32_t MipMapGenerateChain(MipMapAlgorithm algorithm, int32_t gammaCorrect, uint32_t width, uint32_t height, MipBits* images);
+
+#endif
@@ -0,0 +1,153 @@
+#include "gx/texture/Palette.hpp"
+#include "gx/texture/PixelPack.hpp"
+#include <algorithm>
+
+// Pixels are expanded to ARGB8888 in spans, then converted to the
+// destination format. Spans start on a multiple of 8 pixels, so their alpha
+// always starts on a byte boundary.
+#define PAL_SPAN 256
+
+typedef void (*PAL_SPAN_FUNCTION)(const uint32_t*, uint32_t, const uint8_t*, const uint8_t*, uint32_t, uint32_t*);
+
+static uint32_t PalAlpha(uint32_t alphaSize, const uint8_t* alpha, uint32_t i) {
+    switch (alphaSize) {
+        case 1:
+            return (alpha[i >> 3] >> (i & 0x7)) & 0x1 ? 0xFF : 0x00;
+
+        case 4: {
+            uint32_t value = (alpha[i >> 1] >> ((i & 0x1) * 4)) & 0xF;
+            return value | (value << 4);
+        }
+
+        case 8:
+            return alpha[i];
+
+        default:
+            return 0xFF;
+    }
+}
+
+static void PalExpandScalar(const uint32_t* palette, uint32_t alphaSize, const uint8_t* indices, const uint8_t* alpha, uint32_t count, uint32_t* out) {
+    for (uint32_t i = 0; i < count; i++) {
+        out[i] = (palette[indices[i]] & 0x00FFFFFF) | (PalAlpha(alphaSize, alpha, i) << 24);
+    }
+}
+
+#if defined(PIXEL_SIMD_SSE2)
+
+// Widens 16 alpha bytes into four vectors of ARGB8888 alpha
+static void PalWidenAlphaSse2(__m128i bytes, __m128i* alphas) {
+    auto zero = _mm_setzero_si128();
+    auto lo = _mm_unpacklo_epi8(zero, bytes);
+    auto hi = _mm_unpackhi_epi8(zero, bytes);
+
+    alphas[0] = _mm_unpacklo_epi16(zero, lo);
+    alphas[1] = _mm_unpackhi_epi16(zero, lo);
+    alphas[2] = _mm_unpacklo_epi16(zero, hi);
+    alphas[3] = _mm_unpackhi_epi16(zero, hi);
+}
+
+static void PalExpandSse2(const uint32_t* palette, uint32_t alphaSize, const uint8_t* indices, const uint8_t* alpha, uint32_t count, uint32_t* out) {
+    auto rgb = _mm_set1_epi32(0x00FFFFFF);
+    auto opaque = _mm_set1_epi32(0xFF000000);
+    auto nibble = _mm_set1_epi8(0x0F);
+
+    uint32_t i = 0;
+
+    // 16 pixels per pass: a whole number of alpha bytes at every depth
+    for (; i + 16 <= count; i += 16) {
+        __m128i alphas[4];
+
+        switch (alphaSize) {
+            case 1: {
+                auto bits = _mm_set1_epi32(alpha[i >> 3] | (alpha[(i >> 3) + 1] << 8));
+                auto mask = _mm_set_epi32(8, 4, 2, 1);
+
+                for (uint32_t k = 0; k < 4; k++) {
+                    alphas[k] = _mm_and_si128(_mm_cmpeq_epi32(_mm_and_si128(bits, mask), mask), opaque);
+                    mask = _mm_slli_epi32(mask, 4);
+                }
+
+                break;
+            }
+
+            case 4: {
+                // Interleave low and high nibbles back into pixel order, then
+                // scale each to 8 bits with n * 17
+                auto bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(&alpha[i >> 1]));
+                auto lo = _mm_and_si128(bytes, nibble);
+                auto hi = _mm_and_si128(_mm_srli_epi16(bytes, 4), nibble);
+                auto values = _mm_unpacklo_epi8(lo, hi);
+
+                PalWidenAlphaSse2(_mm_or_si128(values, _mm_slli_epi16(values, 4)), alphas);
+
+                break;
+            }
+
+            case 8:
+                PalWidenAlphaSse2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&alpha[i])), alphas);
+
+                break;
+
+            default:
+                alphas[0] = alphas[1] = alphas[2] = alphas[3] = opaque;
+
+                break;
+        }
+
+        // Palette reads stay scalar, four indices at a time
+        for (uint32_t k = 0; k < 4; k++) {
+            auto index = &indices[i + k * 4];
+            auto colors = _mm_set_epi32(palette[index[3]], palette[index[2]], palette[index[1]], palette[index[0]]);
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(&out[i + k * 4]), _mm_or_si128(_mm_and_si128(colors, rgb), alphas[k]));
+        }
+    }
+
+    PalExpandScalar(palette, alphaSize, &indices[i], &alpha[i * alphaSize / 8], count - i, &out[i]);
+}
+
+#endif
+
+static int32_t PalDecompressImage(const uint32_t* palette, uint32_t alphaSize, uint32_t width, uint32_t height, const void* src, PIXEL_FORMAT dstFormat, void* dst, PAL_SPAN_FUNCTION expand, PIXEL_PACK_FUNCTION pack) {
+    if (alphaSize != 0 && alphaSize != 1 && alphaSize != 4 && alphaSize != 8) {
+        return 0;
+    }
+
+    if (dstFormat != PIXEL_ARGB8888 && dstFormat != PIXEL_ARGB4444 && dstFormat != PIXEL_ARGB1555 && dstFormat != PIXEL_RGB565) {
+        return 0;
+    }
+
+    auto count = width * height;
+    auto indices = static_cast<const uint8_t*>(src);
+    auto alpha = &indices[count];
+
+    uint32_t span[PAL_SPAN];
+
+    for (uint32_t first = 0; first < count; first += PAL_SPAN) {
+        auto spanCount = std::min(static_cast<uint32_t>(PAL_SPAN), count - first);
+        auto spanAlpha = &alpha[first * alphaSize / 8];
+
+        // ARGB8888 is expanded in place
+        if (dstFormat == PIXEL_ARGB8888) {
+            expand(palette, alphaSize, &indices[first], spanAlpha, spanCount, &static_cast<uint32_t*>(dst)[first]);
+        } else {
+            expand(palette, alphaSize, &indices[first], spanAlpha, spanCount, span);
+            pack(span, spanCount, dstFormat, &static_cast<uint16_t*>(dst)[first]);
+        }
+    }
+
+    return 1;
+}
+
+int32_t PalDecompress(const uint32_t* palette, uint32_t alphaSize, uint32_t width, uint32_t height, const void* src, PIXEL_FORMAT dstFormat, void* dst) {
+#if defined(PIXEL_SIMD_SSE2)
+    return PalDecompressImage(palette, alphaSize, width, height, src, dstFormat, dst, &PalExpandSse2, &PixelPack);
+#else
+    return PalDecompressImage(palette, alphaSize, width, height, src, dstFormat, dst, &PalExpandScalar, &PixelPack);
+#endif
+}
+
+int32_t PalDecompressScalar(const uint32_t* palette, uint32_t alphaSize, uint32_t width, uint32_t height, const void* src, PIXEL_FORMAT dstFormat, void* dst) {
+    return PalDecompressImage(palette, alphaSize, width, height, src, dstFormat, dst, &PalExpandScalar, &PixelPackScalar);
+}
@@ -0,0 +1,16 @@
+#ifndef GX_TEXTURE_PALETTE_HPP
+#define GX_TEXTURE_PALETTE_HPP
+
+#include "gx/Types.hpp"
+#include <cstdint>
+
+// Expands a palettized image into tightly packed ARGB8888, ARGB4444,
+// ARGB1555 or RGB565 rows. The source holds one palette index per pixel
+// followed by 0, 1, 4 or 8 bits of alpha per pixel, packed low bits first.
+// Returns 0 for unsupported formats and alpha depths.
+int32_t PalDecompress(const uint32_t* palette, uint32_t alphaSize, uint32_t width, uint32_t height, const void* src, PIXEL_FORMAT dstFormat, void* dst);
+
+// Reference decoder with the same output as PalDecompress, one pixel at a time
+int32_t PalDecompressScalar(const uint32_t* palette, uint32_t alphaSize, uint32_t width, uint32_t height, const void* src, PIXEL_FORMAT dstFormat, void* dst);
+
+#endif
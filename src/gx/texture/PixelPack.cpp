@@ -0,0 +1,142 @@
+#include "gx/texture/PixelPack.hpp"
+#include <cstring>
+
+static uint16_t PixelPackOne(uint32_t pixel, PIXEL_FORMAT format) {
+    switch (format) {
+        case PIXEL_ARGB4444:
+            return ((pixel >> 16) & 0xF000) | ((pixel >> 12) & 0x0F00) | ((pixel >> 8) & 0x00F0) | ((pixel >> 4) & 0x000F);
+
+        case PIXEL_ARGB1555:
+            return ((pixel >> 16) & 0x8000) | ((pixel >> 9) & 0x7C00) | ((pixel >> 6) & 0x03E0) | ((pixel >> 3) & 0x001F);
+
+        default:
+            return ((pixel >> 8) & 0xF800) | ((pixel >> 5) & 0x07E0) | ((pixel >> 3) & 0x001F);
+    }
+}
+
+#if defined(PIXEL_SIMD_SSE2)
+
+static __m128i PixelPackSse2(__m128i pixel, PIXEL_FORMAT format) {
+    switch (format) {
+        case PIXEL_ARGB4444:
+            return _mm_or_si128(
+                _mm_or_si128(
+                    _mm_and_si128(_mm_srli_epi32(pixel, 16), _mm_set1_epi32(0xF000)),
+                    _mm_and_si128(_mm_srli_epi32(pixel, 12), _mm_set1_epi32(0x0F00))
+                ),
+                _mm_or_si128(
+                    _mm_and_si128(_mm_srli_epi32(pixel, 8), _mm_set1_epi32(0x00F0)),
+                    _mm_and_si128(_mm_srli_epi32(pixel, 4), _mm_set1_epi32(0x000F))
+                )
+            );
+
+        case PIXEL_ARGB1555:
+            return _mm_or_si128(
+                _mm_or_si128(
+                    _mm_and_si128(_mm_srli_epi32(pixel, 16), _mm_set1_epi32(0x8000)),
+                    _mm_and_si128(_mm_srli_epi32(pixel, 9), _mm_set1_epi32(0x7C00))
+                ),
+                _mm_or_si128(
+                    _mm_and_si128(_mm_srli_epi32(pixel, 6), _mm_set1_epi32(0x03E0)),
+                    _mm_and_si128(_mm_srli_epi32(pixel, 3), _mm_set1_epi32(0x001F))
+                )
+            );
+
+        default:
+            return _mm_or_si128(
+                _mm_or_si128(
+                    _mm_and_si128(_mm_srli_epi32(pixel, 8), _mm_set1_epi32(0xF800)),
+                    _mm_and_si128(_mm_srli_epi32(pixel, 5), _mm_set1_epi32(0x07E0))
+                ),
+                _mm_and_si128(_mm_srli_epi32(pixel, 3), _mm_set1_epi32(0x001F))
+            );
+    }
+}
+
+#elif defined(PIXEL_SIMD_NEON)
+
+static uint32x4_t PixelPackNeon(uint32x4_t pixel, PIXEL_FORMAT format) {
+    switch (format) {
+        case PIXEL_ARGB4444:
+            return vorrq_u32(
+                vorrq_u32(
+                    vandq_u32(vshrq_n_u32(pixel, 16), vdupq_n_u32(0xF000)),
+                    vandq_u32(vshrq_n_u32(pixel, 12), vdupq_n_u32(0x0F00))
+                ),
+                vorrq_u32(
+                    vandq_u32(vshrq_n_u32(pixel, 8), vdupq_n_u32(0x00F0)),
+                    vandq_u32(vshrq_n_u32(pixel, 4), vdupq_n_u32(0x000F))
+                )
+            );
+
+        case PIXEL_ARGB1555:
+            return vorrq_u32(
+                vorrq_u32(
+                    vandq_u32(vshrq_n_u32(pixel, 16), vdupq_n_u32(0x8000)),
+                    vandq_u32(vshrq_n_u32(pixel, 9), vdupq_n_u32(0x7C00))
+                ),
+                vorrq_u32(
+                    vandq_u32(vshrq_n_u32(pixel, 6), vdupq_n_u32(0x03E0)),
+                    vandq_u32(vshrq_n_u32(pixel, 3), vdupq_n_u32(0x001F))
+                )
+            );
+
+        default:
+            return vorrq_u32(
+                vorrq_u32(
+                    vandq_u32(vshrq_n_u32(pixel, 8), vdupq_n_u32(0xF800)),
+                    vandq_u32(vshrq_n_u32(pixel, 5), vdupq_n_u32(0x07E0))
+                ),
+                vandq_u32(vshrq_n_u32(pixel, 3), vdupq_n_u32(0x001F))
+            );
+    }
+}
+
+#endif
+
+void PixelPack(const uint32_t* src, uint32_t count, PIXEL_FORMAT format, void* dst) {
+    if (format == PIXEL_ARGB8888) {
+        memcpy(dst, src, count * sizeof(uint32_t));
+        return;
+    }
+
+    auto out = static_cast<uint16_t*>(dst);
+    uint32_t i = 0;
+
+#if defined(PIXEL_SIMD_SSE2)
+    // packs_epi32 saturates signed values, so pack around a bias
+    auto bias32 = _mm_set1_epi32(0x8000);
+    auto bias16 = _mm_set1_epi16(static_cast<int16_t>(0x8000));
+
+    for (; i + 8 <= count; i += 8) {
+        auto lo = _mm_sub_epi32(PixelPackSse2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&src[i])), format), bias32);
+        auto hi = _mm_sub_epi32(PixelPackSse2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&src[i + 4])), format), bias32);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&out[i]), _mm_add_epi16(_mm_packs_epi32(lo, hi), bias16));
+    }
+#elif defined(PIXEL_SIMD_NEON)
+    for (; i + 8 <= count; i += 8) {
+        auto lo = vmovn_u32(PixelPackNeon(vld1q_u32(&src[i]), format));
+        auto hi = vmovn_u32(PixelPackNeon(vld1q_u32(&src[i + 4]), format));
+
+        vst1q_u16(&out[i], vcombine_u16(lo, hi));
+    }
+#endif
+
+    for (; i < count; i++) {
+        out[i] = PixelPackOne(src[i], format);
+    }
+}
+
+void PixelPackScalar(const uint32_t* src, uint32_t count, PIXEL_FORMAT format, void* dst) {
+    if (format == PIXEL_ARGB8888) {
+        memcpy(dst, src, count * sizeof(uint32_t));
+        return;
+    }
+
+    auto out = static_cast<uint16_t*>(dst);
+
+    for (uint32_t i = 0; i < count; i++) {
+        out[i] = PixelPackOne(src[i], format);
+    }
+}
@@ -0,0 +1,23 @@
+#ifndef GX_TEXTURE_PIXEL_PACK_HPP
+#define GX_TEXTURE_PIXEL_PACK_HPP
+
+#include "gx/Types.hpp"
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PIXEL_SIMD_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define PIXEL_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+typedef void (*PIXEL_PACK_FUNCTION)(const uint32_t*, uint32_t, PIXEL_FORMAT, void*);
+
+// Converts ARGB8888 pixels to ARGB8888, ARGB4444, ARGB1555 or RGB565 by
+// truncating each channel
+void PixelPack(const uint32_t* src, uint32_t count, PIXEL_FORMAT format, void* dst);
+
+void PixelPackScalar(const uint32_t* src, uint32_t count, PIXEL_FORMAT format, void* dst);
+
+#endif
@@ -1,19 +1,51 @@
 #include "model/CM2Cache.hpp"
 #include "gx/Gx.hpp"
+#include "model/CM2Model.hpp"
 #include "model/CM2Shared.hpp"
+#include "model/M2Internal.hpp"
 #include "model/Model2.hpp"
 #include "util/Filesystem.hpp"
 #include "util/SFile.hpp"
+#include <algorithm>
 #include <cstring>
 #include <new>
+#include <common/ObjectAlloc.hpp>
+#include <common/Time.hpp>
 #include <storm/Memory.hpp>
 #include <storm/String.hpp>
 #include <tempest/Box.hpp>
 
 CM2Cache CM2Cache::s_cache;
 
+uint32_t CM2Cache::ThreadProc(void* arg) {
+    auto cache = static_cast<CM2Cache*>(arg);
+
+    // Workers outlive frames: each start token runs the callback once and
+    // answers with one done token
+    while (true) {
+        cache->m_threadStart.Wait(0xFFFFFFFF);
+
+        if (cache->m_threadQuit) {
+            cache->m_threadDone.Signal(1);
+
+            return 0;
+        }
+
+        cache->m_threadCallback(cache->m_threadArg);
+        cache->m_threadDone.Signal(1);
+    }
+}
+
 void CM2Cache::BeginThread(void (*callback)(void*), void* arg) {
-    // TODO
+    if (!this->m_threadCount) {
+        return;
+    }
+
+    this->m_threadCallback = callback;
+    this->m_threadArg = arg;
+    this->m_threadBusy = 1;
+
+    this->m_threadStart.Signal(this->m_threadCount);
 }
 
 CM2Shared* CM2Cache::CreateShared(const char* path, uint32_t flags) {
@@ -31,11 +63,22 @@ CM2Shared* CM2Cache::CreateShared(const char* path, uint32_t flags) {
         *ext = '.';
     }
 
-    // TODO
+    // Models already live, or still loading, share one copy: callers get a
+    // reference and queue on the pending load through CallbackWhenLoaded
+    auto hashval = SStrHashHT(convertedPath);
+    HASHKEY_M2FILE key = { convertedPath };
+
+    if (auto shared = this->m_sharedHash.Ptr(hashval, key)) {
+        shared->AddRef();
+
+        return shared;
+    }
 
     SFile* fileptr;
 
     if (SFile::OpenEx(nullptr, convertedPath, (flags >> 2) & 1, &fileptr)) {
+        this->m_sharedLoads++;
+
         auto m = SMemAlloc(sizeof(CM2Shared), __FILE__, __LINE__, 0x0);
         auto shared = new (m) CM2Shared(this);
 
@@ -47,20 +90,79 @@ CM2Shared* CM2Cache::CreateShared(const char* path, uint32_t flags) {
                 // TODO
             }
 
+            key.m_filename = shared->m_filePath;
+            this->m_sharedHash.Insert(shared, hashval, key);
+
             // TODO
 
             return shared;
         }
 
         SFile::Close(fileptr);
-        delete shared;
+
+        shared->~CM2Shared();
+        SMemFree(m, __FILE__, __LINE__, 0);
     }
 
     return nullptr;
 }
 
-void CM2Cache::GarbageCollect(int32_t a2) {
-    // TODO
+void CM2Cache::GarbageCollect(int32_t flush) {
+    auto start = OsGetAsyncTimeMsPrecise();
+    uint32_t bytes = 0;
+
+    // Every pass frees at least one object, then stops at either budget
+    auto overBudget = [&](uint32_t size) {
+        return !flush && bytes && (bytes + size > this->m_gcByteBudget || OsGetAsyncTimeMsPrecise() - start >= this->m_gcTimeBudget);
+    };
+
+    // Models go first, since freeing one may release the last reference to
+    // its shared data
+    while (this->m_gcModelList) {
+        if (overBudget(sizeof(CM2Model))) {
+            return;
+        }
+
+        auto model = this->m_gcModelList;
+
+        this->m_gcModelList = model->m_gcNext;
+
+        if (!this->m_gcModelList) {
+            this->m_gcModelTail = &this->m_gcModelList;
+        }
+
+        auto memHandle = model->m_memHandle;
+
+        model->~CM2Model();
+        ObjectFree(*g_modelPool, memHandle);
+
+        bytes += sizeof(CM2Model);
+    }
+
+    auto now = OsGetAsyncTimeMs();
+
+    // Released shared data stays cached until it has gone unused for the idle
+    // timeout. The list is in release order, so the first one still within
+    // the timeout ends the pass.
+    while (this->m_gcSharedList) {
+        auto shared = this->m_gcSharedList;
+
+        if (!flush && now - shared->m_releaseTime < this->m_gcTimeout) {
+            return;
+        }
+
+        if (overBudget(shared->m_dataSize)) {
+            return;
+        }
+
+        this->UnlinkShared(shared);
+
+        bytes += shared->m_dataSize;
+
+        // Unlinks from the shared hash on the way out
+        shared->~CM2Shared();
+        SMemFree(shared, __FILE__, __LINE__, 0);
+    }
 }
 
 int32_t CM2Cache::Initialize(uint32_t flags) {
@@ -72,6 +174,10 @@ int32_t CM2Cache::Initialize(uint32_t flags) {
 
     // TODO
 
+    if (flags & 0x4) {
+        this->m_flags |= 0x4;
+    }
+
     if (flags & 0x8) {
         if (GxCaps().m_shaderTargets[GxSh_Vertex] > GxShVS_none && GxCaps().m_shaderTargets[GxSh_Pixel] > GxShPS_none) {
             this->m_flags |= 0x8;
@@ -85,10 +191,95 @@ int32_t CM2Cache::Initialize(uint32_t flags) {
     return 1;
 }
 
+void CM2Cache::ReleaseModel(CM2Model* model) {
+    model->m_gcNext = nullptr;
+
+    *this->m_gcModelTail = model;
+    this->m_gcModelTail = &model->m_gcNext;
+}
+
+void CM2Cache::ReleaseShared(CM2Shared* shared) {
+    shared->m_releaseTime = OsGetAsyncTimeMs();
+
+    shared->m_gcPrev = this->m_gcSharedTail;
+    shared->m_gcNext = nullptr;
+    *this->m_gcSharedTail = shared;
+    this->m_gcSharedTail = &shared->m_gcNext;
+}
+
+void CM2Cache::SetThreadCount(uint32_t count) {
+    count = std::min(count, static_cast<uint32_t>(M2_MAX_THREADS));
+
+    if (count == this->m_threadCount) {
+        return;
+    }
+
+    if (this->m_threadCount) {
+        this->m_threadQuit = 1;
+        this->m_threadStart.Signal(this->m_threadCount);
+
+        for (uint32_t i = 0; i < this->m_threadCount; i++) {
+            this->m_threadDone.Wait(0xFFFFFFFF);
+        }
+
+        // Every worker has answered the quit token, so each is on its way out
+        for (uint32_t i = 0; i < this->m_threadCount; i++) {
+            this->m_threads[i].Wait(0xFFFFFFFF);
+            this->m_threads[i].Close();
+        }
+
+        this->m_threadQuit = 0;
+        this->m_threadCount = 0;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        char name[32];
+        SStrPrintf(name, sizeof(name), "M2Animate %d", i);
+
+        if (!SThread::Create(CM2Cache::ThreadProc, this, this->m_threads[i], name, 0)) {
+            break;
+        }
+
+        this->m_threadCount++;
+    }
+}
+
+// Joins the animation workers. Client teardown calls this through M2Destroy,
+// so the workers are gone before the static cache and storm are torn down.
+void CM2Cache::Shutdown() {
+    this->WaitThread();
+    this->SetThreadCount(0);
+}
+
+void CM2Cache::UnlinkShared(CM2Shared* shared) {
+    if (!shared->m_gcPrev) {
+        return;
+    }
+
+    *shared->m_gcPrev = shared->m_gcNext;
+
+    if (shared->m_gcNext) {
+        shared->m_gcNext->m_gcPrev = shared->m_gcPrev;
+    } else {
+        this->m_gcSharedTail = shared->m_gcPrev;
+    }
+
+    shared->m_gcPrev = nullptr;
+    shared->m_gcNext = nullptr;
+}
+
 void CM2Cache::UpdateShared() {
     // TODO
 }
 
 void CM2Cache::WaitThread() {
-    // TODO
+    if (!this->m_threadBusy) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < this->m_threadCount; i++) {
+        this->m_threadDone.Wait(0xFFFFFFFF);
+    }
+
+    this->m_threadBusy = 0;
 }
@@ -1,24 +1,66 @@
 #ifndef MODEL_C_M2_CACHE_HPP
 #define MODEL_C_M2_CACHE_HPP
 
+#include "model/CM2Shared.hpp"
+#include "model/M2Types.hpp"
 #include <cstdint>
+#include <storm/Atomic.hpp>
+#include <storm/Hash.hpp>
+#include <storm/Thread.hpp>
 
-class CM2Shared;
+class CM2Model;
 
 class CM2Cache {
     public:
         // Static variables
         static CM2Cache s_cache;
 
+        // Static functions
+        static uint32_t ThreadProc(void* arg);
+
         // Member variables
         uint32_t m_initialized = 0;
         uint32_t m_flags = 0;
+        TSHashTable<CM2Shared, HASHKEY_M2FILE> m_sharedHash;
+        uint32_t m_sharedLoads = 0;
+        CM2Shared* m_gcSharedList = nullptr;
+        CM2Shared** m_gcSharedTail = &this->m_gcSharedList;
+        CM2Model* m_gcModelList = nullptr;
+        CM2Model** m_gcModelTail = &this->m_gcModelList;
+        uint32_t m_gcTimeout = 30000;
+        uint32_t m_gcTimeBudget = 1;
+        uint32_t m_gcByteBudget = 0x100000;
+        SThread m_threads[M2_MAX_THREADS];
+        uint32_t m_threadCount = 0;
+        SSemaphore m_threadStart;
+        SSemaphore m_threadDone;
+        void (*m_threadCallback)(void*) = nullptr;
+        void* m_threadArg = nullptr;
+        int32_t m_threadBusy = 0;
+        int32_t m_threadQuit = 0;
+        uint32_t m_bakeInterval = 0;
+        uint32_t m_bakeSizeLimit = 16 * 1024 * 1024;
+        uint32_t m_bakeSize = 0;
+        float m_bakeTolerance = 0.01f;
+        uint32_t m_animateCull = 0;
+        float m_animateReducedDistance = 0.0f;
+        uint32_t m_animateReducedInterval = 100;
+        float m_animateSkipDistance = 0.0f;
 
         // Member functions
+        CM2Cache()
+            : m_threadStart(0, M2_MAX_THREADS)
+            , m_threadDone(0, M2_MAX_THREADS)
+            {};
         void BeginThread(void (*callback)(void*), void* arg);
         CM2Shared* CreateShared(const char*, uint32_t);
-        void GarbageCollect(int32_t a2);
+        void GarbageCollect(int32_t flush);
         int32_t Initialize(uint32_t flags);
+        void ReleaseModel(CM2Model* model);
+        void ReleaseShared(CM2Shared* shared);
+        void SetThreadCount(uint32_t count);
+        void Shutdown();
+        void UnlinkShared(CM2Shared* shared);
         void UpdateShared();
         void WaitThread();
 };
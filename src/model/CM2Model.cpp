@@ -1,11 +1,15 @@
 #include "model/CM2Model.hpp"
 #include "async/AsyncFileRead.hpp"
 #include "math/Types.hpp"
+#include "model/CM2Cache.hpp"
 #include "model/CM2Scene.hpp"
 #include "model/CM2Shared.hpp"
 #include "model/M2Animate.hpp"
+#include "model/M2Bake.hpp"
 #include "model/M2Data.hpp"
 #include "model/M2Model.hpp"
+#include "model/M2Types.hpp"
+#include <algorithm>
 #include <cmath>
 #include <new>
 #include <common/DataMgr.hpp>
@@ -16,6 +20,7 @@ uint32_t CM2Model::s_loadingSequence = 0xFFFFFFFF;
 uint8_t* CM2Model::s_sequenceBase;
 uint32_t CM2Model::s_sequenceBaseSize;
 uint32_t CM2Model::s_skinProfileBoneCountMax[] = { 256, 64, 53, 21 };
+thread_local M2BoneTransforms CM2Model::s_boneTransforms;
 
 CM2Model* CM2Model::AllocModel(uint32_t* heapId) {
     uint32_t memHandle;
@@ -24,8 +29,7 @@ CM2Model* CM2Model::AllocModel(uint32_t* heapId) {
     if (ObjectAlloc(*heapId, &memHandle, &object, 0)) {
         CM2Model* model = new (object) CM2Model();
 
-        // TODO
-        // model->uint2E8 = memHandle;
+        model->m_memHandle = memHandle;
 
         return model;
     }
@@ -33,6 +37,25 @@ CM2Model* CM2Model::AllocModel(uint32_t* heapId) {
     return nullptr;
 }
 
+// Finds the last key in [first, count) at or before time, or first when time
+// comes before all of them
+uint32_t CM2Model::FindKeySearch(const uint32_t* times, uint32_t first, uint32_t count, uint32_t time) {
+    uint32_t low = first;
+    uint32_t high = count;
+
+    while (high - low > 1) {
+        uint32_t middle = (low + high) >> 1;
+
+        if (times[middle] <= time) {
+            low = middle;
+        } else {
+            high = middle;
+        }
+    }
+
+    return low;
+}
+
 bool CM2Model::Sub825E00(M2Data* data, uint32_t a2) {
     if (data->sequenceIdxHashById.Count() == 0) {
         for (int32_t i = 0; i < data->sequences.Count(); i++) {
@@ -76,6 +99,40 @@ uint16_t CM2Model::Sub8260C0(M2Data* data, uint32_t sequenceId, int32_t a3) {
     return -1;
 }
 
+CM2Model::~CM2Model() {
+    while (this->m_modelCallList) {
+        auto modelCall = this->m_modelCallList;
+        this->m_modelCallList = modelCall->modelCallNext;
+
+        SMemFree(modelCall);
+    }
+
+    if (this->m_textures) {
+        for (int32_t i = 0; i < this->m_shared->m_data->textures.Count(); i++) {
+            if (this->m_textures[i]) {
+                HandleClose(this->m_textures[i]);
+            }
+        }
+    }
+
+    // TODO
+    // - release cameras
+
+    if (this->m_boneMatrices) {
+        SMemFree(this->m_boneMatrices, __FILE__, __LINE__, 0);
+    }
+
+    if (this->m_animateLodPoses) {
+        SMemFree(this->m_animateLodPoses, __FILE__, __LINE__, 0);
+    }
+
+    if (this->m_dataBlock) {
+        SMemFree(this->m_dataBlock, __FILE__, __LINE__, 0);
+    }
+
+    this->m_shared->Release();
+}
+
 void CM2Model::Animate() {
     // TODO
 }
@@ -127,6 +184,9 @@ void CM2Model::AnimateMT(const C44Matrix* view, const C3Vector& a3, const C3Vect
         this->m_time = this->m_scene->m_time;
     }
 
+    auto& transforms = CM2Model::s_boneTransforms;
+    transforms.SetCount(this->m_shared->m_data->bones.Count());
+
     for (int32_t i = 0; i < this->m_shared->m_data->bones.Count(); i++) {
         auto& bone = this->m_shared->m_data->bones[i];
         auto& modelBone = this->m_bones[i];
@@ -187,21 +247,29 @@ void CM2Model::AnimateMT(const C44Matrix* view, const C3Vector& a3, const C3Vect
 
         uint32_t boneFlags = bone.flags | modelBone.flags;
 
-        C44Matrix* boneParentMatrix;
+        C4Quaternion rotationStart = { 0.0f, 0.0f, 0.0f, 1.0f };
+        C4Quaternion rotationEnd = { 0.0f, 0.0f, 0.0f, 1.0f };
+        float rotationRatio = 0.0f;
+        C3Vector scale = { 1.0f, 1.0f, 1.0f };
+        C3Vector translation = { 0.0f, 0.0f, 0.0f };
 
-        if (bone.parentIndex == 0xFFFF) {
-            boneParentMatrix = &this->matrixF4;
-        } else {
-            boneParentMatrix = &this->m_boneMatrices[bone.parentIndex];
+        // Baked sequences hold every track's value at fixed intervals, so the
+        // bone is a blend between two samples instead of a key search per track
+        auto baked = boneFlags & (0x80 | 0x200) && this->uint90 == 0
+            ? this->m_shared->GetBakedSequence(modelBone.sequence.uint4)
+            : nullptr;
 
-            if (boneFlags & (0x1 | 0x2 | 0x4)) {
-                // TODO
-            }
-        }
+        if (baked) {
+            baked->Sample(i, modelBone.sequence.uint0, rotationStart, rotationEnd, rotationRatio, translation, scale);
 
-        if (boneFlags & (0x80 | 0x200)) {
-            C44Matrix boneLocalMatrix;
+            if (bone.scaleTrack.sequenceTimes.Count()) {
+                modelBone.scaleTrack.currentValue = scale;
+            }
 
+            if (bone.translationTrack.sequenceTimes.Count()) {
+                modelBone.translationTrack.currentValue = translation;
+            }
+        } else if (boneFlags & (0x80 | 0x200)) {
             if (bone.rotationTrack.sequenceTimes.Count()) {
                 auto& rotationTrack = bone.rotationTrack;
 
@@ -210,10 +278,11 @@ void CM2Model::AnimateMT(const C44Matrix* view, const C3Vector& a3, const C3Vect
                     || (rotationTrack.sequenceTimes.Count() == 1 && rotationTrack.sequenceTimes[0].times.Count() > this->uint90)
                 ) {
                     C4Quaternion defaultValue = { 0.0f, 0.0f, 0.0f, 1.0f };
-                    M2AnimateTrack<M2CompQuat, C4Quaternion>(this, &modelBone, rotationTrack, modelBone.rotationTrack, defaultValue);
+                    M2AnimateBoneTrackKeys(this, &modelBone, rotationTrack, modelBone.rotationTrack, defaultValue, rotationStart, rotationEnd, rotationRatio);
+                } else {
+                    rotationStart = modelBone.rotationTrack.currentValue;
+                    rotationEnd = modelBone.rotationTrack.currentValue;
                 }
-
-                boneLocalMatrix = C44Matrix(modelBone.rotationTrack.currentValue);
             } else {
                 // TODO
             }
@@ -226,17 +295,15 @@ void CM2Model::AnimateMT(const C44Matrix* view, const C3Vector& a3, const C3Vect
                     || (scaleTrack.sequenceTimes.Count() == 1 && scaleTrack.sequenceTimes[0].times.Count() > this->uint90)
                 ) {
                     C3Vector defaultValue = { 1.0f, 1.0f, 1.0f };
-                    M2AnimateTrack<C3Vector, C3Vector>(this, &modelBone, scaleTrack, modelBone.scaleTrack, defaultValue);
+                    M2AnimateBoneTrack<C3Vector>(this, &modelBone, scaleTrack, modelBone.scaleTrack, defaultValue);
                 }
 
-                boneLocalMatrix.Scale(modelBone.scaleTrack.currentValue);
+                scale = modelBone.scaleTrack.currentValue;
             }
 
             // TODO
             // conditional involving bone flags and a matrix member of M2ModelBone
 
-            C3Vector translation;
-
             if (bone.translationTrack.sequenceTimes.Count()) {
                 auto& translationTrack = bone.translationTrack;
 
@@ -245,27 +312,44 @@ void CM2Model::AnimateMT(const C44Matrix* view, const C3Vector& a3, const C3Vect
                     || (translationTrack.sequenceTimes.Count() == 1 && translationTrack.sequenceTimes[0].times.Count() > this->uint90)
                 ) {
                     C3Vector defaultValue = { 0.0f, 0.0f, 0.0f };
-                    M2AnimateTrack<C3Vector, C3Vector>(this, &modelBone, translationTrack, modelBone.translationTrack, defaultValue);
+                    M2AnimateBoneTrack<C3Vector>(this, &modelBone, translationTrack, modelBone.translationTrack, defaultValue);
                 }
 
-                translation = modelBone.translationTrack.currentValue + bone.pivot;
-            } else {
-                translation = bone.pivot;
+                translation = modelBone.translationTrack.currentValue;
             }
+        }
+
+        transforms.Set(i, rotationStart, rotationEnd, rotationRatio, translation, scale, bone.pivot);
+    }
+
+    // Rotation blends and local matrices for the whole skeleton at once, then
+    // down the hierarchy, parents first
+    transforms.Build();
+
+    for (int32_t i = 0; i < this->m_shared->m_data->bones.Count(); i++) {
+        auto& bone = this->m_shared->m_data->bones[i];
+        auto& modelBone = this->m_bones[i];
+
+        uint32_t boneFlags = bone.flags | modelBone.flags;
+
+        C44Matrix* boneParentMatrix;
 
-            boneLocalMatrix.d0 += translation.x;
-            boneLocalMatrix.d1 += translation.y;
-            boneLocalMatrix.d2 += translation.z;
+        if (bone.parentIndex == 0xFFFF) {
+            boneParentMatrix = &this->matrixF4;
+        } else {
+            boneParentMatrix = &this->m_boneMatrices[bone.parentIndex];
 
-            C3Vector negPivot = {
-                -bone.pivot.x,
-                -bone.pivot.y,
-                -bone.pivot.z
-            };
+            if (boneFlags & (0x1 | 0x2 | 0x4)) {
+                // TODO
+            }
+        }
 
-            boneLocalMatrix.Translate(negPivot);
+        if (boneFlags & (0x80 | 0x200)) {
+            if (bone.rotationTrack.sequenceTimes.Count()) {
+                modelBone.rotationTrack.currentValue = transforms.Rotation(i);
+            }
 
-            this->m_boneMatrices[i] = boneLocalMatrix * *boneParentMatrix;
+            this->m_boneMatrices[i] = transforms.m_matrices[i] * *boneParentMatrix;
         } else {
             this->m_boneMatrices[i] = *boneParentMatrix;
         }
@@ -479,6 +563,84 @@ void CM2Model::AnimateMT(const C44Matrix* view, const C3Vector& a3, const C3Vect
     // TODO
 }
 
+void CM2Model::AnimateMTReduced(const C44Matrix* view, const C3Vector& a3, const C3Vector& a4, float a5, float a6, uint32_t interval) {
+    if (!this->m_loaded) {
+        return;
+    }
+
+    uint32_t boneCount = this->m_shared->m_data->bones.Count();
+
+    if (!boneCount) {
+        this->AnimateMT(view, a3, a4, a5, a6);
+        return;
+    }
+
+    // Model space poses from the last two updates, the first half blending
+    // toward the second
+    int32_t reset = 0;
+
+    if (!this->m_animateLodPoses) {
+        this->m_animateLodPoses = static_cast<M2ModelBonePose*>(SMemAlloc(sizeof(M2ModelBonePose) * boneCount * 2, __FILE__, __LINE__, 0));
+
+        for (uint32_t i = 0; i < boneCount * 2; i++) {
+            new (&this->m_animateLodPoses[i]) M2ModelBonePose();
+        }
+
+        reset = 1;
+    }
+
+    auto prevPoses = this->m_animateLodPoses;
+    auto nextPoses = this->m_animateLodPoses + boneCount;
+
+    uint32_t elapsed = this->m_scene->m_time - this->m_animateLodTime;
+
+    // Models animated in full or skipped last frame, and anything else more
+    // than one update behind, catch up to the current pose instead of blending
+    // from a stale one
+    if (this->m_animateLodLast != M2ANIMATE_REDUCED || elapsed >= interval * 2) {
+        reset = 1;
+    }
+
+    if (reset || elapsed >= interval) {
+        this->AnimateMT(view, a3, a4, a5, a6);
+
+        auto viewInv = this->matrixF4.Inverse(this->matrixF4.Determinant());
+
+        for (uint32_t i = 0; i < boneCount; i++) {
+            prevPoses[i] = nextPoses[i];
+            M2DecomposePose(this->m_boneMatrices[i] * viewInv, nextPoses[i]);
+        }
+
+        this->m_animateLodTime = this->m_scene->m_time;
+
+        // Nothing to blend from, and the bone matrices already hold the pose
+        if (reset) {
+            for (uint32_t i = 0; i < boneCount; i++) {
+                prevPoses[i] = nextPoses[i];
+            }
+
+            return;
+        }
+
+        elapsed = 0;
+    } else {
+        this->matrixF4 = this->matrixB4 * *view;
+
+        this->float88 = !this->m_attachParent || this->m_attachParent->m_flags & 0x1
+            ? this->matrixF4.d2 * this->matrixF4.d2 + this->matrixF4.d1 * this->matrixF4.d1 + this->matrixF4.d0 * this->matrixF4.d0
+            : this->m_attachParent->float88;
+    }
+
+    float ratio = static_cast<float>(elapsed) / static_cast<float>(interval);
+
+    for (uint32_t i = 0; i < boneCount; i++) {
+        C44Matrix pose;
+        M2InterpolatePose(prevPoses[i], nextPoses[i], ratio, pose);
+
+        this->m_boneMatrices[i] = pose * this->matrixF4;
+    }
+}
+
 void CM2Model::AnimateMTSimple(const C44Matrix* view, const C3Vector& a3, const C3Vector& a4, float a5, float a6) {
     // TODO
 }
@@ -592,130 +754,104 @@ void CM2Model::CancelDeferredSequences(uint32_t boneIndex, bool a3) {
 }
 
 void CM2Model::DetachFromScene() {
-    // TODO
+    if (!this->m_scene) {
+        return;
+    }
+
+    this->SetAnimating(0);
+
+    if (this->m_drawPrev) {
+        *this->m_drawPrev = this->m_drawNext;
+
+        if (this->m_drawNext) {
+            this->m_drawNext->m_drawPrev = this->m_drawPrev;
+        }
+
+        this->m_drawPrev = nullptr;
+        this->m_drawNext = nullptr;
+    }
+
+    if (this->m_scenePrev) {
+        *this->m_scenePrev = this->m_sceneNext;
+
+        if (this->m_sceneNext) {
+            this->m_sceneNext->m_scenePrev = this->m_scenePrev;
+        }
+
+        this->m_scenePrev = nullptr;
+        this->m_sceneNext = nullptr;
+    }
+
+    if (this->m_loaded) {
+        for (int32_t i = 0; i < this->m_shared->m_data->lights.Count(); i++) {
+            this->m_lights[i].light.Unlink();
+        }
+    }
+
+    this->m_scene = nullptr;
 }
 
-void CM2Model::FindKey(M2ModelBoneSeq* sequence, const M2TrackBase& track, uint32_t& currentKey, uint32_t& nextKey, float& ratio) {
+void CM2Model::FindKey(M2ModelBoneSeq* sequence, const M2TrackBase& track, M2ModelTrackBase& modelTrack, uint32_t& nextKey, float& ratio) {
     if (!track.sequenceTimes.Count()) {
         nextKey = 0;
-        currentKey = 0;
+        modelTrack.currentKey = 0;
         ratio = 0.0f;
 
         return;
     }
 
-    uint32_t v6 = sequence->uint0;
-    uint32_t v7 = sequence->uint4;
+    uint32_t time = sequence->uint0;
+    uint32_t seqIndex = sequence->uint4;
 
     if (track.loopIndex == 0xFFFF) {
-        if (v7 >= track.sequenceTimes.Count()) {
-            v7 = 0;
+        if (seqIndex >= track.sequenceTimes.Count()) {
+            seqIndex = 0;
         }
     } else {
-        v6 = this->m_loops[track.loopIndex];
-        v7 = 0;
+        time = this->m_loops[track.loopIndex];
+        seqIndex = 0;
     }
 
-    uint32_t v12 = track.sequenceTimes[v7].times.Count();
+    auto& seqTimes = track.sequenceTimes[seqIndex];
+    uint32_t keyCount = seqTimes.times.Count();
 
-    if (v12 <= 1) {
+    if (keyCount <= 1) {
         nextKey = 0;
-        currentKey = 0;
+        modelTrack.currentKey = 0;
         ratio = 0.0f;
 
         return;
     }
 
-    if (currentKey >= v12) {
-        currentKey = 0;
-    }
-
-    uint32_t v15 = currentKey;
-    auto& v24 = track.sequenceTimes[v7];
-    auto v14 = v24.times.Data();
-    auto v16 = v6 - v14[currentKey];
-    uint32_t* v17;
-    uint32_t* v18;
-    uint32_t* v19;
-    uint32_t v20;
-    uint32_t v21;
-
-    if (v16 >= 500) {
-        if (v16 < 0xFFFFFE0C) {
-            v15 = 0;
-
-            if (v6 >= 500) {
-                v20 = v12;
-
-                while (1) {
-                    v21 = (v20 + v15) >> 1;
-
-                    if (v6 >= v14[v21]) {
-                        v15 = v21 + 1;
-
-                        if (v21 + 1 >= v12 || v6 < v14[v21 + 1]) {
-                            v15 = v21;
-                            goto LABEL_36;
-                        }
-                    } else {
-                        v20 = v21 - 1;
-                    }
-
-                    if (v15 >= v20) {
-                        goto LABEL_36;
-                    }
-                }
-            }
-
-            v19 = v14 + 1;
-
-            do {
-                if (*v19 > v6) {
-                    break;
-                }
-
-                ++v15;
-                ++v19;
-            } while (v15 < v12 - 1);
-        } else if (v15) {
-            v18 = &v14[v15];
+    auto times = seqTimes.times.Data();
+    uint32_t key = modelTrack.currentKey;
 
-            do {
-                if (*v18 <= v6) {
-                    break;
-                }
+    // Playback only moves forward, so the key found last time is still current
+    // or a few keys behind. A sequence change, a loop or a seek sends the time
+    // elsewhere and falls back to a search.
+    if (modelTrack.currentSequence != seqIndex || key >= keyCount || time < times[key]) {
+        key = CM2Model::FindKeySearch(times, 0, keyCount, time);
+    } else {
+        uint32_t lastStep = std::min(key + M2_KEY_CURSOR_STEPS, keyCount - 1);
 
-                --v15;
-                --v18;
-            } while (v15);
+        while (key < lastStep && times[key + 1] <= time) {
+            key++;
         }
-    } else if (v15 < v12 - 1) {
-        v17 = &v14[v15 + 1];
-
-        do {
-            if (*v17 > v6) {
-                break;
-            }
 
-            ++v15;
-            ++v17;
-        } while (v15 < v12 - 1);
+        if (key + 1 < keyCount && times[key + 1] <= time) {
+            key = CM2Model::FindKeySearch(times, key, keyCount, time);
+        }
     }
 
-LABEL_36:
+    modelTrack.currentKey = key;
+    modelTrack.currentSequence = seqIndex;
 
-    if (v15 + 1 >= v24.times.Count()) {
-        nextKey = v15;
-        currentKey = v15;
+    if (key + 1 >= keyCount || time < times[key]) {
+        nextKey = key;
         ratio = 0.0f;
     } else {
-        currentKey = v15;
-        nextKey = v15 + 1;
-
-        uint32_t* v22 = &v24.times[v15];
-        float v23 = static_cast<float>(v6 - v22[0]);
-        float v25 = static_cast<float>(v22[1] - v22[0]);
-        ratio = v23 / v25;
+        nextKey = key + 1;
+        ratio = static_cast<float>(time - times[key]) / static_cast<float>(times[key + 1] - times[key]);
     }
 }
 
@@ -785,6 +921,7 @@ int32_t CM2Model::InitializeLoaded() {
     // allocate space for particles and ribbons
 
     char* data = static_cast<char*>(SMemAlloc(dataSize, __FILE__, __LINE__, 0));
+    this->m_dataBlock = data;
 
     if (this->m_shared->m_data->bones.Count()) {
         this->m_bones = reinterpret_cast<M2ModelBone*>(&data[0]);
@@ -1109,7 +1246,18 @@ void CM2Model::ProcessCallbacksRecursive() {
 }
 
 void CM2Model::Release() {
-    // TODO
+    STORM_ASSERT(this->m_refCount);
+
+    if (--this->m_refCount) {
+        return;
+    }
+
+    // Nothing reaches the model once it's out of the scene and callback
+    // lists, so the cache frees it on its next collection
+    this->DetachFromScene();
+    this->UnlinkFromCallbackList();
+
+    this->m_shared->m_cache->ReleaseModel(this);
 }
 
 void CM2Model::SetAnimating(int32_t animating) {
@@ -4,6 +4,8 @@
 #include "gx/Camera.hpp"
 #include "gx/Texture.hpp"
 #include "model/CM2Lighting.hpp"
+#include "model/M2BoneTransforms.hpp"
+#include "model/M2Types.hpp"
 #include <cstdint>
 #include <tempest/Matrix.hpp>
 #include <tempest/Vector.hpp>
@@ -14,11 +16,13 @@ class CM2Shared;
 struct M2Batch;
 struct M2Data;
 struct M2ModelBone;
+struct M2ModelBonePose;
 struct M2ModelBoneSeq;
 struct M2ModelCamera;
 struct M2ModelColor;
 struct M2ModelLight;
 struct M2ModelTextureWeight;
+struct M2ModelTrackBase;
 struct M2SequenceFallback;
 struct M2TrackBase;
 
@@ -36,13 +40,18 @@ class CM2Model {
         static uint8_t* s_sequenceBase;
         static uint32_t s_sequenceBaseSize;
         static uint32_t s_skinProfileBoneCountMax[];
+        // Per thread, so models animated on different threads don't share
+        // scratch space
+        static thread_local M2BoneTransforms s_boneTransforms;
 
         // Static functions
         static CM2Model* AllocModel(uint32_t* heapId);
+        static uint32_t FindKeySearch(const uint32_t* times, uint32_t first, uint32_t count, uint32_t time);
         static bool Sub825E00(M2Data* data, uint32_t a2);
         static uint16_t Sub8260C0(M2Data* data, uint32_t sequenceId, int32_t a3);
 
         // Member variables
+        uint32_t m_memHandle = 0;
         uint32_t m_refCount = 1;
         uint32_t m_flags = 0;
         CM2Model** m_scenePrev = nullptr;
@@ -108,6 +117,12 @@ class CM2Model {
         void* m_lightingArg = nullptr;
         M2ModelCamera* m_cameras = nullptr;
         void* ptr2D0 = nullptr;
+        void* m_dataBlock = nullptr;
+        CM2Model* m_gcNext = nullptr;
+        uint32_t m_animateLod = M2ANIMATE_FULL;
+        uint32_t m_animateLodLast = M2ANIMATE_FULL;
+        uint32_t m_animateLodTime = 0;
+        M2ModelBonePose* m_animateLodPoses = nullptr;
 
         // Member functions
         CM2Model()
@@ -135,15 +150,17 @@ class CM2Model {
             , m_flag200000(0)
             , m_flag400000(0)
             {};
+        ~CM2Model();
         void Animate();
         void AnimateCamerasST();
         void AnimateMT(const C44Matrix* view, const C3Vector& a3, const C3Vector& a4, float a5, float a6);
+        void AnimateMTReduced(const C44Matrix* view, const C3Vector& a3, const C3Vector& a4, float a5, float a6, uint32_t interval);
         void AnimateMTSimple(const C44Matrix* view, const C3Vector& a3, const C3Vector& a4, float a5, float a6);
         void AnimateST();
         void AttachToScene(CM2Scene* scene);
         void CancelDeferredSequences(uint32_t boneIndex, bool a3);
         void DetachFromScene();
-        void FindKey(M2ModelBoneSeq* sequence, const M2TrackBase& track, uint32_t& currentKey, uint32_t& nextKey, float& ratio);
+        void FindKey(M2ModelBoneSeq* sequence, const M2TrackBase& track, M2ModelTrackBase& modelTrack, uint32_t& nextKey, float& ratio);
         CAaBox& GetBoundingBox(CAaBox& bounds);
         HCAMERA GetCameraByIndex(uint32_t index);
         C3Vector GetPosition();
@@ -10,12 +10,52 @@
 #include "model/M2Sort.hpp"
 #include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <tempest/Math.hpp>
 
 uint32_t CM2Scene::s_optFlags = 0xFFFFFFFF;
 
 void CM2Scene::AnimateThread(void* arg) {
-    // TODO
+    auto scene = static_cast<CM2Scene*>(arg);
+
+    scene->AnimateModels(SInterlockedIncrement(&scene->m_animateThreads) - 1);
+}
+
+void CM2Scene::AnimateModel(CM2Model* model) {
+    if (model->m_flag1000) {
+        C3Vector v222 = { 0.0f, 0.0f, 0.0f };
+        C3Vector v218 = { 1.0f, 1.0f, 1.0f };
+
+        model->AnimateMTSimple(&this->m_view, v218, v222, 1.0f, 1.0f);
+    } else if (model->m_animateLod == M2ANIMATE_REDUCED) {
+        C3Vector v220 = { 0.0f, 0.0f, 0.0f };
+        C3Vector v221 = { 1.0f, 1.0f, 1.0f };
+
+        model->AnimateMTReduced(&this->m_view, v221, v220, 1.0f, 1.0f, this->m_cache->m_animateReducedInterval);
+    } else {
+        C3Vector v220 = { 0.0f, 0.0f, 0.0f };
+        C3Vector v221 = { 1.0f, 1.0f, 1.0f };
+
+        model->AnimateMT(&this->m_view, v221, v220, 1.0f, 1.0f);
+    }
+}
+
+void CM2Scene::AnimateModels(uint32_t slot) {
+    for (uint32_t i = 0; i < this->m_animateSliceCount; i++) {
+        auto& slice = this->m_animateSlices[(slot + i) % this->m_animateSliceCount];
+
+        while (true) {
+            uint32_t chunk = SInterlockedIncrement(&slice.next) - 1;
+
+            if (chunk >= slice.end) {
+                break;
+            }
+
+            for (uint32_t j = this->m_animateChunks[chunk]; j < this->m_animateChunks[chunk + 1]; j++) {
+                this->AnimateModel(this->m_animateModels[j]);
+            }
+        }
+    }
 }
 
 void CM2Scene::ComputeElementShaders(M2Element* element) {
@@ -391,50 +431,25 @@ void CM2Scene::Animate(const C3Vector& cameraPos) {
     this->m_view.Translate(invCameraPos);
     this->m_viewInv = this->m_view.Inverse(this->m_view.Determinant());
 
-    if (this->m_cache->m_flags & 0x4) {
-        // In multithreaded mode, iteration over the animate list is interleaved:
-        // - the current thread animates entries 0, 2, 4, ...
-        // - the newly created thread animates entries 1, 3, 5, ...
-
-        this->m_cache->BeginThread(CM2Scene::AnimateThread, this);
+    this->SelectAnimateLods();
 
-        CM2Model* nextModel;
-        for (auto model = this->m_animateList; model; model = nextModel->m_animateNext) {
-            if (!model->m_attachParent) {
-                if (model->m_flag1000) {
-                    C3Vector v222 = { 0.0f, 0.0f, 0.0f };
-                    C3Vector v218 = { 1.0f, 1.0f, 1.0f };
+    if (this->m_cache->m_flags & 0x4) {
+        // In multithreaded mode, every worker and the current thread first
+        // work through their own share of the chunks, then steal what's left
+        // of the others'. Models only write their own state, so the results
+        // don't depend on which thread animated which model.
 
-                    model->AnimateMTSimple(&this->m_view, v218, v222, 1.0f, 1.0f);
-                } else {
-                    C3Vector v220 = { 0.0f, 0.0f, 0.0f };
-                    C3Vector v221 = { 1.0f, 1.0f, 1.0f };
+        this->SplitAnimateList(this->m_cache->m_threadCount + 1);
 
-                    model->AnimateMT(&this->m_view, v221, v220, 1.0f, 1.0f);
-                }
-            }
+        this->m_cache->BeginThread(CM2Scene::AnimateThread, this);
 
-            nextModel = model->m_animateNext;
-            if (!nextModel) {
-                break;
-            }
-        }
+        this->AnimateModels(0);
 
         this->m_cache->WaitThread();
     } else {
         for (auto model = this->m_animateList; model; model = model->m_animateNext) {
-            if (!model->m_attachParent) {
-                if (model->m_flag1000 != 0) {
-                    C3Vector v222 = { 0.0f, 0.0f, 0.0f };
-                    C3Vector v218 = { 1.0f, 1.0f, 1.0f };
-
-                    model->AnimateMTSimple(&this->m_view, v218, v222, 1.0f, 1.0f);
-                } else {
-                    C3Vector v220 = { 0.0f, 0.0f, 0.0f };
-                    C3Vector v221 = { 1.0f, 1.0f, 1.0f };
-
-                    model->AnimateMT(&this->m_view, v221, v220, 1.0f, 1.0f);
-                }
+            if (!model->m_attachParent && model->m_animateLod != M2ANIMATE_SKIPPED) {
+                this->AnimateModel(model);
             }
         }
     }
@@ -709,6 +724,166 @@ int32_t CM2Scene::Draw(M2PASS pass) {
     return 1;
 }
 
+void CM2Scene::SplitAnimateList(uint32_t sliceCount) {
+    // Bone evaluation dominates the cost of animating a model
+    auto cost = [](CM2Model* model) {
+        return 1 + (model->m_loaded ? model->m_shared->m_data->bones.Count() : 0);
+    };
+
+    this->m_animateModels.SetCount(0);
+    this->m_animateChunks.SetCount(0);
+
+    uint32_t totalCost = 0;
+
+    for (auto model = this->m_animateList; model; model = model->m_animateNext) {
+        if (!model->m_attachParent && model->m_animateLod != M2ANIMATE_SKIPPED) {
+            *this->m_animateModels.New() = model;
+            totalCost += cost(model);
+        }
+    }
+
+    // A few chunks per slice leaves something to steal when slices finish
+    // unevenly
+    uint32_t chunkCost = std::max(totalCost / (sliceCount * 4), 1u);
+    uint32_t runCost = 0;
+
+    for (uint32_t i = 0; i < this->m_animateModels.Count(); i++) {
+        if (!runCost) {
+            *this->m_animateChunks.New() = i;
+        }
+
+        runCost += cost(this->m_animateModels[i]);
+
+        if (runCost >= chunkCost) {
+            runCost = 0;
+        }
+    }
+
+    uint32_t chunkCount = this->m_animateChunks.Count();
+    *this->m_animateChunks.New() = this->m_animateModels.Count();
+
+    this->m_animateSliceCount = sliceCount;
+
+    for (uint32_t i = 0; i < sliceCount; i++) {
+        this->m_animateSlices[i].next = i * chunkCount / sliceCount;
+        this->m_animateSlices[i].end = (i + 1) * chunkCount / sliceCount;
+    }
+
+    // The current thread takes the first slice
+    this->m_animateThreads = 1;
+}
+
+uint32_t CM2Scene::SelectAnimateLod(CM2Model* model) {
+    auto cache = this->m_cache;
+
+    if (!model->m_loaded || (!cache->m_animateCull && cache->m_animateReducedDistance <= 0.0f && cache->m_animateSkipDistance <= 0.0f)) {
+        return M2ANIMATE_FULL;
+    }
+
+    // A sphere around the bounding box, scaled by the largest axis of the
+    // world transform
+    auto& extent = model->m_shared->m_data->bounds.extent;
+    auto& world = model->matrixB4;
+
+    C3Vector center = {
+        (extent.b.x + extent.t.x) * 0.5f,
+        (extent.b.y + extent.t.y) * 0.5f,
+        (extent.b.z + extent.t.z) * 0.5f
+    };
+
+    C3Vector halfSize = {
+        (extent.t.x - extent.b.x) * 0.5f,
+        (extent.t.y - extent.b.y) * 0.5f,
+        (extent.t.z - extent.b.z) * 0.5f
+    };
+
+    float scale = std::max({
+        world.a0 * world.a0 + world.a1 * world.a1 + world.a2 * world.a2,
+        world.b0 * world.b0 + world.b1 * world.b1 + world.b2 * world.b2,
+        world.c0 * world.c0 + world.c1 * world.c1 + world.c2 * world.c2
+    });
+
+    float radius = sqrtf(halfSize.SquaredMag() * scale);
+    C3Vector viewCenter = (center * world) * this->m_view;
+
+    if (cache->m_animateCull) {
+        for (auto& plane : this->m_animatePlanes) {
+            if (plane.x * viewCenter.x + plane.y * viewCenter.y + plane.z * viewCenter.z + plane.w < -radius) {
+                return M2ANIMATE_SKIPPED;
+            }
+        }
+    }
+
+    float distance = std::max(sqrtf(viewCenter.SquaredMag()) - radius, 0.0f);
+
+    if (cache->m_animateSkipDistance > 0.0f && distance > cache->m_animateSkipDistance) {
+        return M2ANIMATE_SKIPPED;
+    }
+
+    if (cache->m_animateReducedDistance > 0.0f && distance > cache->m_animateReducedDistance) {
+        return M2ANIMATE_REDUCED;
+    }
+
+    return M2ANIMATE_FULL;
+}
+
+void CM2Scene::SelectAnimateLods() {
+    for (uint32_t i = 0; i < M2ANIMATE_COUNT; i++) {
+        this->m_animateCounts[i] = 0;
+    }
+
+    if (this->m_cache->m_animateCull) {
+        C44Matrix projection;
+        GxXformProjection(projection);
+
+        // Clip space x and y stay within w for anything in view, so the side
+        // planes are the w column plus or minus the x and y columns. Models
+        // behind the camera fall outside them too.
+        C4Vector x = { projection.a0, projection.b0, projection.c0, projection.d0 };
+        C4Vector y = { projection.a1, projection.b1, projection.c1, projection.d1 };
+        C4Vector w = { projection.a3, projection.b3, projection.c3, projection.d3 };
+
+        this->m_animatePlanes[0] = { w.x + x.x, w.y + x.y, w.z + x.z, w.w + x.w };
+        this->m_animatePlanes[1] = { w.x - x.x, w.y - x.y, w.z - x.z, w.w - x.w };
+        this->m_animatePlanes[2] = { w.x + y.x, w.y + y.y, w.z + y.z, w.w + y.w };
+        this->m_animatePlanes[3] = { w.x - y.x, w.y - y.y, w.z - y.z, w.w - y.w };
+
+        for (auto& plane : this->m_animatePlanes) {
+            float length = sqrtf(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+
+            if (length > 0.0f) {
+                plane = { plane.x / length, plane.y / length, plane.z / length, plane.w / length };
+            }
+        }
+    }
+
+    for (auto model = this->m_animateList; model; model = model->m_animateNext) {
+        model->m_animateLodLast = model->m_animateLod;
+    }
+
+    for (auto model = this->m_animateList; model; model = model->m_animateNext) {
+        if (!model->m_attachParent) {
+            model->m_animateLod = this->SelectAnimateLod(model);
+            this->m_animateCounts[model->m_animateLod]++;
+        }
+    }
+
+    // Attachments move with the model they hang off, so they share its level
+    // of detail: a skipped parent doesn't animate its children either
+    for (auto model = this->m_animateList; model; model = model->m_animateNext) {
+        if (model->m_attachParent) {
+            auto root = model->m_attachParent;
+
+            while (root->m_attachParent) {
+                root = root->m_attachParent;
+            }
+
+            model->m_animateLod = root->m_animateLod;
+            this->m_animateCounts[model->m_animateLod]++;
+        }
+    }
+}
+
 void CM2Scene::SelectLights(CM2Lighting* lighting) {
     for (auto light = this->m_lightList; light; light = light->m_lightNext) {
         lighting->AddLight(light);
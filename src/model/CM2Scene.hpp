@@ -6,6 +6,7 @@
 #include <cstdint>
 #include <storm/Array.hpp>
 #include <tempest/Matrix.hpp>
+#include <tempest/Vector.hpp>
 
 class CM2Cache;
 class CM2Light;
@@ -42,6 +43,13 @@ class CM2Scene {
         C44Matrix m_view;
         C44Matrix m_viewInv;
         uint32_t uint104 = 0;
+        TSGrowableArray<CM2Model*> m_animateModels;
+        TSGrowableArray<uint32_t> m_animateChunks;
+        M2AnimateSlice m_animateSlices[M2_MAX_THREADS + 1];
+        uint32_t m_animateSliceCount = 0;
+        ATOMIC32 m_animateThreads = 0;
+        C4Vector m_animatePlanes[4];
+        uint32_t m_animateCounts[M2ANIMATE_COUNT] = {};
 
         // Member functions
         CM2Scene(CM2Cache* cache)
@@ -49,9 +57,14 @@ class CM2Scene {
             {};
         void AdvanceTime(uint32_t a2);
         void Animate(const C3Vector& cameraPos);
+        void AnimateModel(CM2Model* model);
+        void AnimateModels(uint32_t slot);
         CM2Model* CreateModel(const char* file, uint32_t a3);
         int32_t Draw(M2PASS pass);
+        uint32_t SelectAnimateLod(CM2Model* model);
+        void SelectAnimateLods();
         void SelectLights(CM2Lighting* lighting);
+        void SplitAnimateList(uint32_t sliceCount);
 };
 
 #endif
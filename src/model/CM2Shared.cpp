@@ -5,18 +5,26 @@
 #include "gx/Texture.hpp"
 #include "model/CM2Cache.hpp"
 #include "model/CM2Model.hpp"
+#include "model/M2Bake.hpp"
 #include "model/M2Data.hpp"
 #include "model/M2Init.hpp"
 #include "model/M2Types.hpp"
 #include "util/CStatus.hpp"
 #include "util/SFile.hpp"
 #include <cstring>
+#include <storm/Memory.hpp>
+
+bool HASHKEY_M2FILE::operator==(const HASHKEY_M2FILE& key) {
+    return !SStrCmpI(this->m_filename, key.m_filename, STORM_MAX_PATH);
+}
 
 void CM2Shared::LoadFailedCallback(void* arg) {
     CM2Shared* shared = static_cast<CM2Shared*>(arg);
 
     AsyncFileReadDestroyObject(shared->asyncObject);
     shared->asyncObject = nullptr;
+
+    shared->LoadFailed();
 }
 
 void CM2Shared::LoadSucceededCallback(void* arg) {
@@ -29,14 +37,14 @@ void CM2Shared::LoadSucceededCallback(void* arg) {
     uint32_t size = shared->m_dataSize;
     M2Data& data = *shared->m_data;
 
-    if (!M2Init(base, size, data)) {
-        return;
-    }
+    if (!M2Init(base, size, data) || !shared->Initialize()) {
+        shared->LoadFailed();
 
-    if (!shared->Initialize()) {
         return;
     }
 
+    shared->Bake();
+
     // TODO
     // - allocate space for low priority sequence pointers
 
@@ -46,14 +54,93 @@ void CM2Shared::LoadSucceededCallback(void* arg) {
 void CM2Shared::SkinProfileLoadedCallback(void* arg) {
     CM2Shared* shared = static_cast<CM2Shared*>(arg);
 
-    shared->FinishLoadingSkinProfile(shared->asyncObject->size);
+    auto loaded = shared->FinishLoadingSkinProfile(shared->asyncObject->size);
 
     AsyncFileReadDestroyObject(shared->asyncObject);
     shared->asyncObject = nullptr;
+
+    if (!loaded) {
+        shared->LoadFailed();
+    }
 }
 
-void CM2Shared::AddRef() {
+CM2Shared::~CM2Shared() {
+    // Cancels a read still in flight, so it can't land in freed memory
+    if (this->asyncObject) {
+        AsyncFileReadDestroyObject(this->asyncObject);
+        this->asyncObject = nullptr;
+    }
+
+    if (this->textures) {
+        for (int32_t i = 0; i < this->m_data->textures.count; i++) {
+            if (this->textures[i]) {
+                HandleClose(this->textures[i]);
+            }
+        }
+
+        SMemFree(this->textures, __FILE__, __LINE__, 0);
+    }
+
     // TODO
+    // - release index and vertex pools
+
+    if (this->m_skinSections) {
+        SMemFree(this->m_skinSections, __FILE__, __LINE__, 0);
+    }
+
+    if (this->skinProfile) {
+        SMemFree(this->skinProfile, __FILE__, __LINE__, 0);
+    }
+
+    if (this->m_bakedSequences) {
+        for (int32_t i = 0; i < this->m_data->sequences.Count(); i++) {
+            if (this->m_bakedSequences[i]) {
+                SMemFree(this->m_bakedSequences[i], __FILE__, __LINE__, 0);
+            }
+        }
+
+        SMemFree(this->m_bakedSequences, __FILE__, __LINE__, 0);
+
+        this->m_cache->m_bakeSize -= this->m_bakedSize;
+    }
+
+    if (this->m_data) {
+        SMemFree(this->m_data, __FILE__, __LINE__, 0);
+    }
+}
+
+void CM2Shared::AddRef() {
+    // Taken back up before the cache got around to freeing it
+    if (!this->m_refCount++) {
+        this->m_cache->UnlinkShared(this);
+    }
+}
+
+// Resamples every sequence it can into compact samples, while the cache stays
+// under its size limit
+void CM2Shared::Bake() {
+    auto cache = this->m_cache;
+    uint32_t sequenceCount = this->m_data->sequences.Count();
+
+    if (!cache->m_bakeInterval || !sequenceCount) {
+        return;
+    }
+
+    this->m_bakedSequences = static_cast<M2BakedSequence**>(SMemAlloc(sizeof(M2BakedSequence*) * sequenceCount, __FILE__, __LINE__, 0x0));
+
+    for (uint32_t i = 0; i < sequenceCount; i++) {
+        this->m_bakedSequences[i] = nullptr;
+    }
+
+    for (uint32_t i = 0; i < sequenceCount && cache->m_bakeSize < cache->m_bakeSizeLimit; i++) {
+        auto baked = M2BakeSequence(this->m_data, i, cache->m_bakeInterval, cache->m_bakeTolerance, cache->m_bakeSizeLimit - cache->m_bakeSize);
+
+        if (baked) {
+            this->m_bakedSequences[i] = baked;
+            this->m_bakedSize += baked->m_size;
+            cache->m_bakeSize += baked->m_size;
+        }
+    }
 }
 
 int32_t CM2Shared::CallbackWhenLoaded(CM2Model* model) {
@@ -61,6 +148,10 @@ int32_t CM2Shared::CallbackWhenLoaded(CM2Model* model) {
         return 1;
     }
 
+    if (this->m_loadFailed) {
+        return 0;
+    }
+
     if (this->m_m2DataLoaded && this->m_skinProfileLoaded) {
         model->InitializeLoaded();
 
@@ -282,6 +373,14 @@ int32_t CM2Shared::FinishLoadingSkinProfile(uint32_t size) {
     return 1;
 }
 
+M2BakedSequence* CM2Shared::GetBakedSequence(uint32_t sequence) {
+    if (!this->m_bakedSequences || sequence >= this->m_data->sequences.Count()) {
+        return nullptr;
+    }
+
+    return this->m_bakedSequences[sequence];
+}
+
 CShaderEffect* CM2Shared::GetEffect(M2Batch* batch) {
     CShaderEffect* effect;
 
@@ -531,6 +630,7 @@ int32_t CM2Shared::Load(SFile* file, int32_t a3, CAaBox* a4) {
     this->asyncObject->userPostloadCallback = &CM2Shared::LoadSucceededCallback;
     this->asyncObject->userFailedCallback = &CM2Shared::LoadFailedCallback;
     this->asyncObject->isRead = 0;
+    this->asyncObject->isFailed = 0;
     this->asyncObject->isProcessed = 0;
 
     AsyncFileReadObject(this->asyncObject, 0);
@@ -538,6 +638,23 @@ int32_t CM2Shared::Load(SFile* file, int32_t a3, CAaBox* a4) {
     return 1;
 }
 
+// Drops the model from the cache, so the next request reads the file again,
+// and runs the loaded callbacks of every model queued on it. Those models
+// never load, which is how their callbacks tell the load failed.
+void CM2Shared::LoadFailed() {
+    this->m_loadFailed = 1;
+    this->m_cache->m_sharedHash.Unlink(this);
+
+    for (auto model = this->m_callbackList; model; model = this->m_callbackList) {
+        model->UnlinkFromCallbackList();
+
+        if (model->m_loadedCallback) {
+            model->m_loadedCallback(model, model->m_loadedArg);
+            model->m_loadedCallback = nullptr;
+        }
+    }
+}
+
 int32_t CM2Shared::LoadSkinProfile(uint32_t profile) {
     // TODO
     // the file path logic is in its own function
@@ -587,6 +704,7 @@ int32_t CM2Shared::LoadSkinProfile(uint32_t profile) {
     this->asyncObject->userPostloadCallback = &CM2Shared::SkinProfileLoadedCallback;
     this->asyncObject->userFailedCallback = &CM2Shared::LoadFailedCallback;
     this->asyncObject->isRead = 0;
+    this->asyncObject->isFailed = 0;
     this->asyncObject->isProcessed = 0;
     this->asyncObject->priority = 125;
 
@@ -596,7 +714,13 @@ int32_t CM2Shared::LoadSkinProfile(uint32_t profile) {
 }
 
 void CM2Shared::Release() {
-    // TODO
+    STORM_ASSERT(this->m_refCount);
+
+    if (--this->m_refCount) {
+        return;
+    }
+
+    this->m_cache->ReleaseShared(this);
 }
 
 int32_t CM2Shared::SetIndices() {
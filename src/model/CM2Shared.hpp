@@ -3,6 +3,7 @@
 
 #include "gx/Texture.hpp"
 #include <cstdint>
+#include <storm/Hash.hpp>
 #include <storm/String.hpp>
 #include <tempest/Box.hpp>
 
@@ -12,13 +13,23 @@ class CGxPool;
 class CM2Cache;
 class CM2Model;
 class CShaderEffect;
+class M2BakedSequence;
 struct M2Batch;
 struct M2Data;
 struct M2SkinProfile;
 struct M2SkinSection;
 class SFile;
 
-class CM2Shared {
+class HASHKEY_M2FILE {
+    public:
+        // Member variables
+        const char* m_filename;
+
+        // Member functions
+        bool operator==(const HASHKEY_M2FILE&);
+};
+
+class CM2Shared : public TSHashObject<CM2Shared, HASHKEY_M2FILE> {
     public:
         // Static functions
         static void LoadFailedCallback(void* param);
@@ -27,6 +38,10 @@ class CM2Shared {
 
         // Member variables
         CM2Cache* m_cache;
+        uint32_t m_refCount = 1;
+        CM2Shared** m_gcPrev = nullptr;
+        CM2Shared* m_gcNext = nullptr;
+        uint32_t m_releaseTime = 0;
         uint32_t m_m2DataLoaded : 1;
         uint32_t m_skinProfileLoaded : 1;
         uint32_t m_flag4 : 1;
@@ -34,6 +49,7 @@ class CM2Shared {
         uint32_t m_flag10 : 1;
         uint32_t m_flag20 : 1;
         uint32_t m_flag40 : 1;
+        uint32_t m_loadFailed : 1;
         CAsyncObject* asyncObject = nullptr;
         CM2Model* m_callbackList = nullptr;
         CM2Model** m_callbackListTail = &this->m_callbackList;
@@ -52,6 +68,8 @@ class CM2Shared {
         M2SkinSection* m_skinSections = nullptr;
         uint32_t uint190 = 0;
         uint32_t uint194 = 0;
+        M2BakedSequence** m_bakedSequences = nullptr;
+        uint32_t m_bakedSize = 0;
 
         // Member functions
         CM2Shared(CM2Cache* cache)
@@ -63,15 +81,20 @@ class CM2Shared {
             , m_flag10(0)
             , m_flag20(0)
             , m_flag40(0)
+            , m_loadFailed(0)
             {};
+        ~CM2Shared();
         void AddRef();
+        void Bake();
         int32_t CallbackWhenLoaded(CM2Model* model);
         CShaderEffect* CreateSimpleEffect(uint32_t textureCount, uint16_t shader, uint16_t textureCoordComboIndex);
+        M2BakedSequence* GetBakedSequence(uint32_t sequence);
         CShaderEffect* GetEffect(M2Batch* batch);
         int32_t FinishLoadingSkinProfile(uint32_t size);
         int32_t Initialize();
         int32_t InitializeSkinProfile();
         int32_t Load(SFile* file, int32_t a3, CAaBox* a4);
+        void LoadFailed();
         int32_t LoadSkinProfile(uint32_t profile);
         void Release();
         int32_t SetIndices();
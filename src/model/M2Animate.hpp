@@ -4,11 +4,7 @@
 #include "model/CM2Model.hpp"
 #include "model/M2Data.hpp"
 #include "model/M2Model.hpp"
-
-struct M2SequenceFallback {
-    uint16_t uint0;
-    uint16_t uint2;
-};
+#include <cmath>
 
 template<class T1, class T2>
 void M2SetValue(const T1& sourceValue, T2& destValue) {
@@ -16,7 +12,7 @@ void M2SetValue(const T1& sourceValue, T2& destValue) {
 }
 
 template<>
-void M2SetValue(const M2CompQuat& sourceValue, C4Quaternion& destValue) {
+inline void M2SetValue(const M2CompQuat& sourceValue, C4Quaternion& destValue) {
     destValue.x = (sourceValue.auCompQ[0] & 0xFFFF) * 0.000030518044f - 1.0f;
     destValue.y = (sourceValue.auCompQ[0] >> 16)    * 0.000030518044f - 1.0f;
     destValue.z = (sourceValue.auCompQ[1] & 0xFFFF) * 0.000030518044f - 1.0f;
@@ -24,29 +20,34 @@ void M2SetValue(const M2CompQuat& sourceValue, C4Quaternion& destValue) {
 }
 
 template<>
-void M2SetValue(const fixed16& sourceValue, float& destValue) {
+inline void M2SetValue(const M2SplineKey<M2CompQuat>& sourceValue, C4Quaternion& destValue) {
+    M2SetValue(sourceValue.value, destValue);
+}
+
+template<>
+inline void M2SetValue(const fixed16& sourceValue, float& destValue) {
     destValue = static_cast<float>(sourceValue);
 }
 
-void M2InterpolateLinear(const C3Vector& startValue, const C3Vector& endValue, float ratio, C3Vector& value) {
+inline void M2InterpolateLinear(const C3Vector& startValue, const C3Vector& endValue, float ratio, C3Vector& value) {
     value.x = startValue.x + (ratio * (endValue.x - startValue.x));
     value.y = startValue.y + (ratio * (endValue.y - startValue.y));
     value.z = startValue.z + (ratio * (endValue.z - startValue.z));
 }
 
-void M2InterpolateLinear(float startValue, float endValue, float ratio, float& value) {
+inline void M2InterpolateLinear(float startValue, float endValue, float ratio, float& value) {
     value = startValue + (ratio * (endValue - startValue));
 }
 
-void M2InterpolateLinear(fixed16 startValue, fixed16 endValue, float ratio, float& value) {
+inline void M2InterpolateLinear(fixed16 startValue, fixed16 endValue, float ratio, float& value) {
     value = static_cast<float>(startValue) + (ratio * (static_cast<float>(endValue) - static_cast<float>(startValue)));
 }
 
-void M2InterpolateLinear(uint8_t startValue, uint8_t endValue, float ratio, uint8_t& value) {
+inline void M2InterpolateLinear(uint8_t startValue, uint8_t endValue, float ratio, uint8_t& value) {
     value = startValue + (ratio * (endValue - startValue));
 }
 
-void M2InterpolateLinear(const M2CompQuat& startValue, const M2CompQuat& endValue, float ratio, C4Quaternion& value) {
+inline void M2InterpolateLinear(const M2CompQuat& startValue, const M2CompQuat& endValue, float ratio, C4Quaternion& value) {
     C4Quaternion quat1;
     C4Quaternion quat2;
     M2SetValue(startValue, quat1);
@@ -55,24 +56,81 @@ void M2InterpolateLinear(const M2CompQuat& startValue, const M2CompQuat& endValu
     value = C4Quaternion::Nlerp(ratio, quat1, quat2);
 }
 
-void M2InterpolateCubicBezier(const M2SplineKey<C3Vector>& startKey, const M2SplineKey<C3Vector>& endKey, float ratio, C3Vector& value) {
-    // TODO
-}
+// Splits a bone matrix into per axis scale, rotation and translation. Shear
+// from non-uniform scale up the bone chain doesn't survive.
+inline void M2DecomposePose(const C44Matrix& matrix, M2ModelBonePose& pose) {
+    C3Vector axes[3] = {
+        { matrix.a0, matrix.a1, matrix.a2 },
+        { matrix.b0, matrix.b1, matrix.b2 },
+        { matrix.c0, matrix.c1, matrix.c2 }
+    };
 
-void M2InterpolateCubicBezier(const M2SplineKey<float>& startKey, const M2SplineKey<float>& endKey, float ratio, float& value) {
-    // TODO
-}
+    float scale[3];
 
-void M2InterpolateCubicHermite(const M2SplineKey<C3Vector>& startKey, const M2SplineKey<C3Vector>& endKey, float ratio, C3Vector& value) {
-    // TODO
+    for (uint32_t i = 0; i < 3; i++) {
+        scale[i] = axes[i].Mag();
+
+        if (scale[i] > 0.0f) {
+            axes[i] = axes[i] * (1.0f / scale[i]);
+        }
+    }
+
+    // A mirrored basis keeps its flip in the scale, so what's left is a rotation
+    float determinant = axes[0].x * (axes[1].y * axes[2].z - axes[1].z * axes[2].y)
+        - axes[0].y * (axes[1].x * axes[2].z - axes[1].z * axes[2].x)
+        + axes[0].z * (axes[1].x * axes[2].y - axes[1].y * axes[2].x);
+
+    if (determinant < 0.0f) {
+        scale[0] = -scale[0];
+        axes[0] = axes[0] * -1.0f;
+    }
+
+    float trace = axes[0].x + axes[1].y + axes[2].z;
+    auto& q = pose.rotation;
+
+    if (trace > 0.0f) {
+        float s = sqrtf(trace + 1.0f) * 2.0f;
+        q = { (axes[1].z - axes[2].y) / s, (axes[2].x - axes[0].z) / s, (axes[0].y - axes[1].x) / s, 0.25f * s };
+    } else if (axes[0].x > axes[1].y && axes[0].x > axes[2].z) {
+        float s = sqrtf(1.0f + axes[0].x - axes[1].y - axes[2].z) * 2.0f;
+        q = { 0.25f * s, (axes[0].y + axes[1].x) / s, (axes[2].x + axes[0].z) / s, (axes[1].z - axes[2].y) / s };
+    } else if (axes[1].y > axes[2].z) {
+        float s = sqrtf(1.0f + axes[1].y - axes[0].x - axes[2].z) * 2.0f;
+        q = { (axes[0].y + axes[1].x) / s, 0.25f * s, (axes[1].z + axes[2].y) / s, (axes[2].x - axes[0].z) / s };
+    } else {
+        float s = sqrtf(1.0f + axes[2].z - axes[0].x - axes[1].y) * 2.0f;
+        q = { (axes[2].x + axes[0].z) / s, (axes[1].z + axes[2].y) / s, 0.25f * s, (axes[0].y - axes[1].x) / s };
+    }
+
+    pose.translation = { matrix.d0, matrix.d1, matrix.d2 };
+    pose.scale = { scale[0], scale[1], scale[2] };
 }
 
-void M2InterpolateCubicHermite(const M2SplineKey<float>& startKey, const M2SplineKey<float>& endKey, float ratio, float& value) {
-    // TODO
+inline void M2InterpolatePose(const M2ModelBonePose& startPose, const M2ModelBonePose& endPose, float ratio, C44Matrix& matrix) {
+    matrix = C44Matrix(C4Quaternion::Nlerp(ratio, startPose.rotation, endPose.rotation));
+
+    C3Vector scale;
+    C3Vector translation;
+    M2InterpolateLinear(startPose.scale, endPose.scale, ratio, scale);
+    M2InterpolateLinear(startPose.translation, endPose.translation, ratio, translation);
+
+    matrix.a0 *= scale.x;
+    matrix.a1 *= scale.x;
+    matrix.a2 *= scale.x;
+    matrix.b0 *= scale.y;
+    matrix.b1 *= scale.y;
+    matrix.b2 *= scale.y;
+    matrix.c0 *= scale.z;
+    matrix.c1 *= scale.z;
+    matrix.c2 *= scale.z;
+
+    matrix.d0 = translation.x;
+    matrix.d1 = translation.y;
+    matrix.d2 = translation.z;
 }
 
 template<class T1, class T2>
-void M2AnimateSplineTrack(CM2Model* model, M2ModelBone* modelBone, const M2Track<T1>& track, M2ModelTrack<T2>& modelTrack, const T2& defaultValue) {
+void M2AnimateSplineTrack(CM2Model* model, M2ModelBone* modelBone, const M2Track<T1>& track, M2ModelSplineTrack<T2>& modelTrack, const T2& defaultValue) {
     auto seqIndex = modelBone->sequence.uint4 < track.sequenceKeys.Count() ? modelBone->sequence.uint4 : 0;
     auto& seqKeys = track.sequenceKeys[seqIndex];
 
@@ -80,7 +138,7 @@ void M2AnimateSplineTrack(CM2Model* model, M2ModelBone* modelBone, const M2Track
         uint32_t nextKey;
         float ratio;
 
-        model->FindKey(&modelBone->sequence, track, modelTrack.currentKey, nextKey, ratio);
+        model->FindKey(&modelBone->sequence, track, modelTrack, nextKey, ratio);
 
         if (track.trackType == 0) {
             modelTrack.currentValue = seqKeys.keys[modelTrack.currentKey].value;
@@ -90,17 +148,26 @@ void M2AnimateSplineTrack(CM2Model* model, M2ModelBone* modelBone, const M2Track
         auto& startKey = seqKeys.keys[modelTrack.currentKey];
         auto& endKey = seqKeys.keys[nextKey];
 
+        // Spline segments are set up once, when the track first lands in them
+        if (track.trackType != 1 && (modelTrack.segmentKey != modelTrack.currentKey || modelTrack.segmentSequence != seqIndex)) {
+            modelTrack.segmentKey = modelTrack.currentKey;
+            modelTrack.segmentSequence = seqIndex;
+
+            if (track.trackType == 2) {
+                M2InterpolateCubicBezier(startKey, endKey, modelTrack.segment);
+            } else {
+                M2InterpolateCubicHermite(startKey, endKey, modelTrack.segment);
+            }
+        }
+
         switch (track.trackType) {
             case 1:
                 M2InterpolateLinear(startKey.value, endKey.value, ratio, modelTrack.currentValue);
                 break;
 
             case 2:
-                M2InterpolateCubicBezier(startKey, endKey, ratio, modelTrack.currentValue);
-                break;
-
             case 3:
-                M2InterpolateCubicHermite(startKey, endKey, ratio, modelTrack.currentValue);
+                M2InterpolateCubic(modelTrack.segment, ratio, modelTrack.currentValue);
                 break;
         }
     } else {
@@ -115,6 +182,37 @@ void M2AnimateSplineTrack(CM2Model* model, M2ModelBone* modelBone, const M2Track
     // - blend with secondary active sequence
 }
 
+// Finds the keys a track blends between and how far along it is, leaving the
+// blend itself to the caller
+template<class T1, class T2>
+void M2AnimateTrackKeys(CM2Model* model, M2ModelBone* modelBone, const M2Track<T1>& track, M2ModelTrack<T2>& modelTrack, const T2& defaultValue, T2& startValue, T2& endValue, float& ratio) {
+    auto seqIndex = modelBone->sequence.uint4 < track.sequenceKeys.Count() ? modelBone->sequence.uint4 : 0;
+    auto& seqKeys = track.sequenceKeys[seqIndex];
+
+    if (seqKeys.keys.Count()) {
+        uint32_t nextKey;
+
+        model->FindKey(&modelBone->sequence, track, modelTrack, nextKey, ratio);
+
+        M2SetValue<T1, T2>(seqKeys.keys[modelTrack.currentKey], startValue);
+
+        if (track.trackType == 0) {
+            endValue = startValue;
+            ratio = 0.0f;
+            return;
+        }
+
+        M2SetValue<T1, T2>(seqKeys.keys[nextKey], endValue);
+    } else {
+        startValue = defaultValue;
+        endValue = defaultValue;
+        ratio = 0.0f;
+    }
+
+    // TODO
+    // - blend with secondary active sequence
+}
+
 template<class T1, class T2>
 void M2AnimateTrack(CM2Model* model, M2ModelBone* modelBone, const M2Track<T1>& track, M2ModelTrack<T2>& modelTrack, const T2& defaultValue) {
     auto seqIndex = modelBone->sequence.uint4 < track.sequenceKeys.Count() ? modelBone->sequence.uint4 : 0;
@@ -124,7 +222,7 @@ void M2AnimateTrack(CM2Model* model, M2ModelBone* modelBone, const M2Track<T1>&
         uint32_t nextKey;
         float ratio;
 
-        model->FindKey(&modelBone->sequence, track, modelTrack.currentKey, nextKey, ratio);
+        model->FindKey(&modelBone->sequence, track, modelTrack, nextKey, ratio);
 
         if (track.trackType == 0) {
             M2SetValue<T1, T2>(seqKeys.keys[modelTrack.currentKey], modelTrack.currentValue);
@@ -147,4 +245,26 @@ void M2AnimateTrack(CM2Model* model, M2ModelBone* modelBone, const M2Track<T1>&
     // - blend with secondary active sequence
 }
 
+// Bone tracks hold plain values, except Bezier and Hermite tracks, whose keys
+// carry their tangents as M2SplineKey<T>
+template<class T>
+void M2AnimateBoneTrack(CM2Model* model, M2ModelBone* modelBone, const M2Track<T>& track, M2ModelSplineTrack<T>& modelTrack, const T& defaultValue) {
+    if (track.trackType == 2 || track.trackType == 3) {
+        auto& splineTrack = reinterpret_cast<const M2Track<M2SplineKey<T>>&>(track);
+        M2AnimateSplineTrack<M2SplineKey<T>, T>(model, modelBone, splineTrack, modelTrack, defaultValue);
+    } else {
+        M2AnimateTrack<T, T>(model, modelBone, track, modelTrack, defaultValue);
+    }
+}
+
+// Spline rotations blend between their key values, as linear ones do
+inline void M2AnimateBoneTrackKeys(CM2Model* model, M2ModelBone* modelBone, const M2Track<M2CompQuat>& track, M2ModelTrack<C4Quaternion>& modelTrack, const C4Quaternion& defaultValue, C4Quaternion& startValue, C4Quaternion& endValue, float& ratio) {
+    if (track.trackType == 2 || track.trackType == 3) {
+        auto& splineTrack = reinterpret_cast<const M2Track<M2SplineKey<M2CompQuat>>&>(track);
+        M2AnimateTrackKeys<M2SplineKey<M2CompQuat>, C4Quaternion>(model, modelBone, splineTrack, modelTrack, defaultValue, startValue, endValue, ratio);
+    } else {
+        M2AnimateTrackKeys<M2CompQuat, C4Quaternion>(model, modelBone, track, modelTrack, defaultValue, startValue, endValue, ratio);
+    }
+}
+
 #endif
@@ -0,0 +1,336 @@
+#include "model/M2Bake.hpp"
+#include "model/CM2Model.hpp"
+#include "model/M2Animate.hpp"
+#include "model/M2Data.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <new>
+#include <storm/Memory.hpp>
+
+// Bytes per bone per sample: a 16 bit quaternion and two half float vectors
+#define M2_BAKE_BONE_SIZE (sizeof(int16_t) * 4 + sizeof(uint16_t) * 3 * 2)
+
+// Whether AnimateMT evaluates every track of every bone from this sequence's
+// own keys, blending linearly, which is all a bake can reproduce
+static int32_t M2BakeCanBake(M2Data* data, uint32_t sequence) {
+    auto& seq = data->sequences[sequence];
+
+    if (!(seq.flags & 0x20) || !seq.duration) {
+        return 0;
+    }
+
+    auto canBakeTrack = [](const M2TrackBase& track) {
+        if (!track.sequenceTimes.Count()) {
+            return true;
+        }
+
+        if (track.loopIndex != 0xFFFF || track.trackType > 1) {
+            return false;
+        }
+
+        return track.sequenceTimes.Count() > 1 || track.sequenceTimes[0].times.Count() > 0;
+    };
+
+    for (uint32_t i = 0; i < data->bones.Count(); i++) {
+        auto& bone = data->bones[i];
+
+        if (!canBakeTrack(bone.rotationTrack) || !canBakeTrack(bone.scaleTrack) || !canBakeTrack(bone.translationTrack)) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+// The keys a track blends between at time, as FindKey and M2AnimateTrack find
+// them
+template<class T1, class T2>
+static void M2BakeTrackKeys(const M2Track<T1>& track, uint32_t sequence, uint32_t time, const T2& defaultValue, T2& startValue, T2& endValue, float& ratio) {
+    auto& seqKeys = track.sequenceKeys[sequence < track.sequenceKeys.Count() ? sequence : 0];
+    ratio = 0.0f;
+
+    if (!track.sequenceTimes.Count() || !seqKeys.keys.Count()) {
+        startValue = defaultValue;
+        endValue = defaultValue;
+        return;
+    }
+
+    auto& seqTimes = track.sequenceTimes[sequence < track.sequenceTimes.Count() ? sequence : 0];
+    uint32_t keyCount = seqTimes.times.Count();
+    uint32_t key = 0;
+    uint32_t nextKey = 0;
+
+    if (keyCount > 1) {
+        auto times = seqTimes.times.Data();
+        key = CM2Model::FindKeySearch(times, 0, keyCount, time);
+
+        if (key + 1 < keyCount && time >= times[key]) {
+            nextKey = key + 1;
+            ratio = static_cast<float>(time - times[key]) / static_cast<float>(times[key + 1] - times[key]);
+        } else {
+            nextKey = key;
+        }
+    }
+
+    M2SetValue<T1, T2>(seqKeys.keys[key], startValue);
+
+    if (track.trackType == 0) {
+        endValue = startValue;
+        ratio = 0.0f;
+    } else {
+        M2SetValue<T1, T2>(seqKeys.keys[nextKey], endValue);
+    }
+}
+
+static void M2BakeBone(const M2CompBone& bone, uint32_t sequence, uint32_t time, C4Quaternion& rotation, C3Vector& translation, C3Vector& scale) {
+    C4Quaternion identity = { 0.0f, 0.0f, 0.0f, 1.0f };
+    C3Vector zero = { 0.0f, 0.0f, 0.0f };
+    C3Vector one = { 1.0f, 1.0f, 1.0f };
+
+    C4Quaternion rotationStart;
+    C4Quaternion rotationEnd;
+    C3Vector start;
+    C3Vector end;
+    float ratio;
+
+    M2BakeTrackKeys<M2CompQuat, C4Quaternion>(bone.rotationTrack, sequence, time, identity, rotationStart, rotationEnd, ratio);
+    rotation = C4Quaternion::Nlerp(ratio, rotationStart, rotationEnd);
+
+    M2BakeTrackKeys<C3Vector, C3Vector>(bone.translationTrack, sequence, time, zero, start, end, ratio);
+    M2InterpolateLinear(start, end, ratio, translation);
+
+    M2BakeTrackKeys<C3Vector, C3Vector>(bone.scaleTrack, sequence, time, one, start, end, ratio);
+    M2InterpolateLinear(start, end, ratio, scale);
+}
+
+// Largest difference between two rotations, on the same side of the sphere
+static float M2BakeRotationError(const C4Quaternion& a, const C4Quaternion& b) {
+    float sign = a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w < 0.0f ? -1.0f : 1.0f;
+
+    return std::max({
+        fabsf(a.x - sign * b.x),
+        fabsf(a.y - sign * b.y),
+        fabsf(a.z - sign * b.z),
+        fabsf(a.w - sign * b.w)
+    });
+}
+
+// Largest difference between two vectors, relative past unit length
+static float M2BakeVectorError(const C3Vector& a, const C3Vector& b) {
+    return std::max({
+        fabsf(a.x - b.x) / std::max(fabsf(b.x), 1.0f),
+        fabsf(a.y - b.y) / std::max(fabsf(b.y), 1.0f),
+        fabsf(a.z - b.z) / std::max(fabsf(b.z), 1.0f)
+    });
+}
+
+float M2BakeFloat(uint16_t value) {
+    uint32_t sign = (value & 0x8000) << 16;
+    uint32_t exponent = (value >> 10) & 0x1F;
+    uint32_t mantissa = value & 0x3FF;
+    uint32_t bits;
+
+    if (exponent == 0) {
+        // Zero and subnormals, mantissa * 2^-24
+        float subnormal = mantissa * (1.0f / 16777216.0f);
+        return sign ? -subnormal : subnormal;
+    } else if (exponent == 31) {
+        bits = sign | 0x7F800000 | (mantissa << 13);
+    } else {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    }
+
+    float result;
+    memcpy(&result, &bits, sizeof(result));
+
+    return result;
+}
+
+uint16_t M2BakeHalf(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    uint32_t sign = (bits >> 16) & 0x8000;
+    int32_t exponent = static_cast<int32_t>((bits >> 23) & 0xFF) - 127 + 15;
+    uint32_t mantissa = bits & 0x7FFFFF;
+
+    // Infinity and NaN, and everything too large for a half
+    if (exponent >= 31) {
+        return sign | 0x7C00 | ((bits & 0x7FFFFFFF) > 0x7F800000 ? 0x200 : 0);
+    }
+
+    uint32_t shift = 13;
+    uint32_t half;
+
+    if (exponent <= 0) {
+        if (exponent < -10) {
+            return sign;
+        }
+
+        // Subnormal, with the implicit bit shifted in
+        mantissa |= 0x800000;
+        shift = 14 - exponent;
+        half = mantissa >> shift;
+    } else {
+        half = (exponent << 10) | (mantissa >> shift);
+    }
+
+    // Round to nearest even, carrying into the exponent where it overflows
+    uint32_t rest = mantissa & ((1u << shift) - 1);
+    uint32_t halfway = 1u << (shift - 1);
+
+    if (rest > halfway || (rest == halfway && (half & 1))) {
+        half++;
+    }
+
+    return sign | half;
+}
+
+M2BakedSequence* M2BakeSequence(M2Data* data, uint32_t sequence, uint32_t interval, float tolerance, uint32_t sizeLimit) {
+    if (!interval || sequence >= data->sequences.Count() || !M2BakeCanBake(data, sequence)) {
+        return nullptr;
+    }
+
+    uint32_t duration = data->sequences[sequence].duration;
+    uint32_t boneCount = data->bones.Count();
+
+    // One sample past the end, so every time has a sample on either side
+    uint32_t sampleCount = duration / interval + 2;
+    uint32_t headerSize = (sizeof(M2BakedSequence) + 15) & ~15;
+    uint64_t size = headerSize + static_cast<uint64_t>(sampleCount) * boneCount * M2_BAKE_BONE_SIZE;
+
+    if (size > sizeLimit) {
+        return nullptr;
+    }
+
+    auto m = static_cast<uint8_t*>(SMemAlloc(static_cast<uint32_t>(size), __FILE__, __LINE__, 0x0));
+    auto baked = new (m) M2BakedSequence();
+
+    baked->m_duration = duration;
+    baked->m_interval = interval;
+    baked->m_sampleCount = sampleCount;
+    baked->m_boneCount = boneCount;
+    baked->m_size = static_cast<uint32_t>(size);
+    baked->m_rotations = reinterpret_cast<int16_t*>(m + headerSize);
+    baked->m_translations = reinterpret_cast<uint16_t*>(baked->m_rotations + sampleCount * boneCount * 4);
+    baked->m_scales = baked->m_translations + sampleCount * boneCount * 3;
+
+    for (uint32_t i = 0; i < sampleCount; i++) {
+        uint32_t time = std::min(i * interval, duration);
+
+        for (uint32_t j = 0; j < boneCount; j++) {
+            C4Quaternion rotation;
+            C3Vector translation;
+            C3Vector scale;
+            M2BakeBone(data->bones[j], sequence, time, rotation, translation, scale);
+
+            auto sample = i * boneCount + j;
+
+            baked->m_rotations[sample * 4 + 0] = static_cast<int16_t>(lrintf(rotation.x * 32767.0f));
+            baked->m_rotations[sample * 4 + 1] = static_cast<int16_t>(lrintf(rotation.y * 32767.0f));
+            baked->m_rotations[sample * 4 + 2] = static_cast<int16_t>(lrintf(rotation.z * 32767.0f));
+            baked->m_rotations[sample * 4 + 3] = static_cast<int16_t>(lrintf(rotation.w * 32767.0f));
+
+            baked->m_translations[sample * 3 + 0] = M2BakeHalf(translation.x);
+            baked->m_translations[sample * 3 + 1] = M2BakeHalf(translation.y);
+            baked->m_translations[sample * 3 + 2] = M2BakeHalf(translation.z);
+
+            baked->m_scales[sample * 3 + 0] = M2BakeHalf(scale.x);
+            baked->m_scales[sample * 3 + 1] = M2BakeHalf(scale.y);
+            baked->m_scales[sample * 3 + 2] = M2BakeHalf(scale.z);
+        }
+    }
+
+    auto withinTolerance = [&](uint32_t bone, uint32_t time) {
+        C4Quaternion rotation;
+        C3Vector translation;
+        C3Vector scale;
+        M2BakeBone(data->bones[bone], sequence, time, rotation, translation, scale);
+
+        C4Quaternion bakedStart;
+        C4Quaternion bakedEnd;
+        float bakedRatio;
+        C3Vector bakedTranslation;
+        C3Vector bakedScale;
+        baked->Sample(bone, time, bakedStart, bakedEnd, bakedRatio, bakedTranslation, bakedScale);
+
+        auto bakedRotation = C4Quaternion::Nlerp(bakedRatio, bakedStart, bakedEnd);
+
+        return M2BakeRotationError(bakedRotation, rotation) <= tolerance
+            && M2BakeVectorError(bakedTranslation, translation) <= tolerance
+            && M2BakeVectorError(bakedScale, scale) <= tolerance;
+    };
+
+    // Sequences whose keys the samples miss by more than the tolerance, on a
+    // sample, halfway between two or on any key in between, stay with exact
+    // evaluation. Keys are where a bake cuts corners the most.
+    for (uint32_t i = 0; i + 1 < sampleCount; i++) {
+        uint32_t startTime = std::min(i * interval, duration);
+        uint32_t endTime = std::min(startTime + interval, duration);
+
+        for (uint32_t j = 0; j < boneCount; j++) {
+            auto& bone = data->bones[j];
+            auto within = withinTolerance(j, startTime) && withinTolerance(j, (startTime + endTime) / 2);
+
+            for (M2TrackBase* track : { static_cast<M2TrackBase*>(&bone.rotationTrack), static_cast<M2TrackBase*>(&bone.translationTrack), static_cast<M2TrackBase*>(&bone.scaleTrack) }) {
+                if (!within || !track->sequenceTimes.Count()) {
+                    continue;
+                }
+
+                auto& times = track->sequenceTimes[sequence < track->sequenceTimes.Count() ? sequence : 0].times;
+                auto key = times.Count() ? CM2Model::FindKeySearch(times.Data(), 0, times.Count(), startTime) : 0;
+
+                for (; within && key < times.Count() && times[key] < endTime; key++) {
+                    if (times[key] >= startTime) {
+                        within = withinTolerance(j, times[key]);
+                    }
+                }
+            }
+
+            if (!within) {
+                SMemFree(m, __FILE__, __LINE__, 0x0);
+                return nullptr;
+            }
+        }
+    }
+
+    return baked;
+}
+
+void M2BakedSequence::Sample(uint32_t bone, uint32_t time, C4Quaternion& rotationStart, C4Quaternion& rotationEnd, float& ratio, C3Vector& translation, C3Vector& scale) const {
+    time = std::min(time, this->m_duration);
+
+    uint32_t sample = std::min(time / this->m_interval, this->m_sampleCount - 2);
+    uint32_t startTime = sample * this->m_interval;
+    uint32_t endTime = std::min(startTime + this->m_interval, this->m_duration);
+
+    ratio = endTime > startTime ? static_cast<float>(time - startTime) / static_cast<float>(endTime - startTime) : 0.0f;
+
+    auto start = sample * this->m_boneCount + bone;
+    auto end = start + this->m_boneCount;
+
+    auto rotations = this->m_rotations;
+    rotationStart = {
+        rotations[start * 4 + 0] * (1.0f / 32767.0f),
+        rotations[start * 4 + 1] * (1.0f / 32767.0f),
+        rotations[start * 4 + 2] * (1.0f / 32767.0f),
+        rotations[start * 4 + 3] * (1.0f / 32767.0f)
+    };
+    rotationEnd = {
+        rotations[end * 4 + 0] * (1.0f / 32767.0f),
+        rotations[end * 4 + 1] * (1.0f / 32767.0f),
+        rotations[end * 4 + 2] * (1.0f / 32767.0f),
+        rotations[end * 4 + 3] * (1.0f / 32767.0f)
+    };
+
+    auto translations = this->m_translations;
+    C3Vector translationStart = { M2BakeFloat(translations[start * 3 + 0]), M2BakeFloat(translations[start * 3 + 1]), M2BakeFloat(translations[start * 3 + 2]) };
+    C3Vector translationEnd = { M2BakeFloat(translations[end * 3 + 0]), M2BakeFloat(translations[end * 3 + 1]), M2BakeFloat(translations[end * 3 + 2]) };
+    M2InterpolateLinear(translationStart, translationEnd, ratio, translation);
+
+    auto scales = this->m_scales;
+    C3Vector scaleStart = { M2BakeFloat(scales[start * 3 + 0]), M2BakeFloat(scales[start * 3 + 1]), M2BakeFloat(scales[start * 3 + 2]) };
+    C3Vector scaleEnd = { M2BakeFloat(scales[end * 3 + 0]), M2BakeFloat(scales[end * 3 + 1]), M2BakeFloat(scales[end * 3 + 2]) };
+    M2InterpolateLinear(scaleStart, scaleEnd, ratio, scale);
+}
@@ -0,0 +1,35 @@
+#ifndef MODEL_M2_BAKE_HPP
+#define MODEL_M2_BAKE_HPP
+
+#include <cstdint>
+#include <tempest/Quaternion.hpp>
+#include <tempest/Vector.hpp>
+
+struct M2Data;
+
+// Every bone of one sequence resampled at a fixed interval, sample by sample
+// so a frame reads one contiguous run. Rotations are 16 bit normalized
+// quaternions, translations and scales half floats.
+class M2BakedSequence {
+    public:
+        // Member variables
+        uint32_t m_duration;
+        uint32_t m_interval;
+        uint32_t m_sampleCount;
+        uint32_t m_boneCount;
+        uint32_t m_size;
+        int16_t* m_rotations;
+        uint16_t* m_translations;
+        uint16_t* m_scales;
+
+        // Member functions
+        void Sample(uint32_t bone, uint32_t time, C4Quaternion& rotationStart, C4Quaternion& rotationEnd, float& ratio, C3Vector& translation, C3Vector& scale) const;
+};
+
+M2BakedSequence* M2BakeSequence(M2Data* data, uint32_t sequence, uint32_t interval, float tolerance, uint32_t sizeLimit);
+
+float M2BakeFloat(uint16_t value);
+
+uint16_t M2BakeHalf(float value);
+
+#endif
@@ -0,0 +1,329 @@
+#include "model/M2BoneTransforms.hpp"
+
+#if defined(M2_SIMD_AVX)
+
+#define M2_SIMD_WIDTH 8
+
+typedef __m256 M2SimdFloat;
+
+static inline M2SimdFloat M2SimdLoad(const float* src) { return _mm256_loadu_ps(src); }
+static inline void M2SimdStore(float* dst, M2SimdFloat value) { _mm256_storeu_ps(dst, value); }
+static inline M2SimdFloat M2SimdSplat(float value) { return _mm256_set1_ps(value); }
+static inline M2SimdFloat M2SimdAdd(M2SimdFloat a, M2SimdFloat b) { return _mm256_add_ps(a, b); }
+static inline M2SimdFloat M2SimdSub(M2SimdFloat a, M2SimdFloat b) { return _mm256_sub_ps(a, b); }
+static inline M2SimdFloat M2SimdMul(M2SimdFloat a, M2SimdFloat b) { return _mm256_mul_ps(a, b); }
+static inline M2SimdFloat M2SimdDiv(M2SimdFloat a, M2SimdFloat b) { return _mm256_div_ps(a, b); }
+static inline M2SimdFloat M2SimdSqrt(M2SimdFloat a) { return _mm256_sqrt_ps(a); }
+
+// -value where sign is negative, value elsewhere
+static inline M2SimdFloat M2SimdFlipSign(M2SimdFloat value, M2SimdFloat sign) {
+    auto negative = _mm256_cmp_ps(sign, _mm256_setzero_ps(), _CMP_LT_OQ);
+    return _mm256_xor_ps(value, _mm256_and_ps(negative, _mm256_set1_ps(-0.0f)));
+}
+
+// value where it's positive, one elsewhere
+static inline M2SimdFloat M2SimdPositiveOrOne(M2SimdFloat value) {
+    auto positive = _mm256_cmp_ps(value, _mm256_setzero_ps(), _CMP_GT_OQ);
+    return _mm256_blendv_ps(_mm256_set1_ps(1.0f), value, positive);
+}
+
+#elif defined(M2_SIMD_SSE2)
+
+#define M2_SIMD_WIDTH 4
+
+typedef __m128 M2SimdFloat;
+
+static inline M2SimdFloat M2SimdLoad(const float* src) { return _mm_loadu_ps(src); }
+static inline void M2SimdStore(float* dst, M2SimdFloat value) { _mm_storeu_ps(dst, value); }
+static inline M2SimdFloat M2SimdSplat(float value) { return _mm_set1_ps(value); }
+static inline M2SimdFloat M2SimdAdd(M2SimdFloat a, M2SimdFloat b) { return _mm_add_ps(a, b); }
+static inline M2SimdFloat M2SimdSub(M2SimdFloat a, M2SimdFloat b) { return _mm_sub_ps(a, b); }
+static inline M2SimdFloat M2SimdMul(M2SimdFloat a, M2SimdFloat b) { return _mm_mul_ps(a, b); }
+static inline M2SimdFloat M2SimdDiv(M2SimdFloat a, M2SimdFloat b) { return _mm_div_ps(a, b); }
+static inline M2SimdFloat M2SimdSqrt(M2SimdFloat a) { return _mm_sqrt_ps(a); }
+
+static inline M2SimdFloat M2SimdFlipSign(M2SimdFloat value, M2SimdFloat sign) {
+    auto negative = _mm_cmplt_ps(sign, _mm_setzero_ps());
+    return _mm_xor_ps(value, _mm_and_ps(negative, _mm_set1_ps(-0.0f)));
+}
+
+static inline M2SimdFloat M2SimdPositiveOrOne(M2SimdFloat value) {
+    auto positive = _mm_cmpgt_ps(value, _mm_setzero_ps());
+    return _mm_or_ps(_mm_and_ps(positive, value), _mm_andnot_ps(positive, _mm_set1_ps(1.0f)));
+}
+
+#elif defined(M2_SIMD_NEON)
+
+#define M2_SIMD_WIDTH 4
+
+typedef float32x4_t M2SimdFloat;
+
+static inline M2SimdFloat M2SimdLoad(const float* src) { return vld1q_f32(src); }
+static inline void M2SimdStore(float* dst, M2SimdFloat value) { vst1q_f32(dst, value); }
+static inline M2SimdFloat M2SimdSplat(float value) { return vdupq_n_f32(value); }
+static inline M2SimdFloat M2SimdAdd(M2SimdFloat a, M2SimdFloat b) { return vaddq_f32(a, b); }
+static inline M2SimdFloat M2SimdSub(M2SimdFloat a, M2SimdFloat b) { return vsubq_f32(a, b); }
+static inline M2SimdFloat M2SimdMul(M2SimdFloat a, M2SimdFloat b) { return vmulq_f32(a, b); }
+static inline M2SimdFloat M2SimdDiv(M2SimdFloat a, M2SimdFloat b) { return vdivq_f32(a, b); }
+static inline M2SimdFloat M2SimdSqrt(M2SimdFloat a) { return vsqrtq_f32(a); }
+
+static inline M2SimdFloat M2SimdFlipSign(M2SimdFloat value, M2SimdFloat sign) {
+    auto negative = vcltq_f32(sign, vdupq_n_f32(0.0f));
+    return vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(value), vandq_u32(negative, vdupq_n_u32(0x80000000))));
+}
+
+static inline M2SimdFloat M2SimdPositiveOrOne(M2SimdFloat value) {
+    return vbslq_f32(vcgtq_f32(value, vdupq_n_f32(0.0f)), value, vdupq_n_f32(1.0f));
+}
+
+#endif
+
+// Component arrays are padded to a multiple of the widest batch
+#define M2_BONE_STRIDE_ALIGN 8
+
+// Floats per bone: two rotations, the ratio, translation, scale and pivot
+#define M2_BONE_COMPONENTS 18
+
+static void M2BuildBoneMatrix(M2BoneTransforms& transforms, uint32_t index) {
+    C4Quaternion rotationStart = {
+        transforms.m_rotationStart[0][index],
+        transforms.m_rotationStart[1][index],
+        transforms.m_rotationStart[2][index],
+        transforms.m_rotationStart[3][index]
+    };
+
+    C4Quaternion rotationEnd = {
+        transforms.m_rotationEnd[0][index],
+        transforms.m_rotationEnd[1][index],
+        transforms.m_rotationEnd[2][index],
+        transforms.m_rotationEnd[3][index]
+    };
+
+    auto rotation = C4Quaternion::Nlerp(transforms.m_ratio[index], rotationStart, rotationEnd);
+
+    transforms.m_rotationStart[0][index] = rotation.x;
+    transforms.m_rotationStart[1][index] = rotation.y;
+    transforms.m_rotationStart[2][index] = rotation.z;
+    transforms.m_rotationStart[3][index] = rotation.w;
+
+    C44Matrix matrix(rotation);
+
+    C3Vector scale = {
+        transforms.m_scale[0][index],
+        transforms.m_scale[1][index],
+        transforms.m_scale[2][index]
+    };
+
+    matrix.Scale(scale);
+
+    matrix.d0 += transforms.m_translation[0][index] + transforms.m_pivot[0][index];
+    matrix.d1 += transforms.m_translation[1][index] + transforms.m_pivot[1][index];
+    matrix.d2 += transforms.m_translation[2][index] + transforms.m_pivot[2][index];
+
+    C3Vector negPivot = {
+        -transforms.m_pivot[0][index],
+        -transforms.m_pivot[1][index],
+        -transforms.m_pivot[2][index]
+    };
+
+    matrix.Translate(negPivot);
+
+    transforms.m_matrices[index] = matrix;
+}
+
+void M2BoneTransforms::Build() {
+#if defined(M2_SIMD_WIDTH)
+    auto zero = M2SimdSplat(0.0f);
+    auto one = M2SimdSplat(1.0f);
+
+    float columns[12][M2_SIMD_WIDTH];
+
+    for (uint32_t i = 0; i < this->m_count; i += M2_SIMD_WIDTH) {
+        auto ax = M2SimdLoad(&this->m_rotationStart[0][i]);
+        auto ay = M2SimdLoad(&this->m_rotationStart[1][i]);
+        auto az = M2SimdLoad(&this->m_rotationStart[2][i]);
+        auto aw = M2SimdLoad(&this->m_rotationStart[3][i]);
+        auto bx = M2SimdLoad(&this->m_rotationEnd[0][i]);
+        auto by = M2SimdLoad(&this->m_rotationEnd[1][i]);
+        auto bz = M2SimdLoad(&this->m_rotationEnd[2][i]);
+        auto bw = M2SimdLoad(&this->m_rotationEnd[3][i]);
+        auto ratio = M2SimdLoad(&this->m_ratio[i]);
+
+        // Blend along the shorter arc, then normalize
+        auto dot = M2SimdAdd(M2SimdAdd(M2SimdAdd(M2SimdMul(ax, bx), M2SimdMul(ay, by)), M2SimdMul(az, bz)), M2SimdMul(aw, bw));
+
+        bx = M2SimdFlipSign(bx, dot);
+        by = M2SimdFlipSign(by, dot);
+        bz = M2SimdFlipSign(bz, dot);
+        bw = M2SimdFlipSign(bw, dot);
+
+        auto x = M2SimdAdd(ax, M2SimdMul(ratio, M2SimdSub(bx, ax)));
+        auto y = M2SimdAdd(ay, M2SimdMul(ratio, M2SimdSub(by, ay)));
+        auto z = M2SimdAdd(az, M2SimdMul(ratio, M2SimdSub(bz, az)));
+        auto w = M2SimdAdd(aw, M2SimdMul(ratio, M2SimdSub(bw, aw)));
+
+        auto length = M2SimdPositiveOrOne(M2SimdSqrt(M2SimdAdd(M2SimdAdd(M2SimdAdd(M2SimdMul(x, x), M2SimdMul(y, y)), M2SimdMul(z, z)), M2SimdMul(w, w))));
+
+        x = M2SimdDiv(x, length);
+        y = M2SimdDiv(y, length);
+        z = M2SimdDiv(z, length);
+        w = M2SimdDiv(w, length);
+
+        M2SimdStore(&this->m_rotationStart[0][i], x);
+        M2SimdStore(&this->m_rotationStart[1][i], y);
+        M2SimdStore(&this->m_rotationStart[2][i], z);
+        M2SimdStore(&this->m_rotationStart[3][i], w);
+
+        // Rotation rows
+        auto x2 = M2SimdAdd(x, x);
+        auto y2 = M2SimdAdd(y, y);
+        auto z2 = M2SimdAdd(z, z);
+        auto xx = M2SimdMul(x, x2);
+        auto xy = M2SimdMul(x, y2);
+        auto xz = M2SimdMul(x, z2);
+        auto yy = M2SimdMul(y, y2);
+        auto yz = M2SimdMul(y, z2);
+        auto zz = M2SimdMul(z, z2);
+        auto wx = M2SimdMul(w, x2);
+        auto wy = M2SimdMul(w, y2);
+        auto wz = M2SimdMul(w, z2);
+
+        auto scaleX = M2SimdLoad(&this->m_scale[0][i]);
+        auto scaleY = M2SimdLoad(&this->m_scale[1][i]);
+        auto scaleZ = M2SimdLoad(&this->m_scale[2][i]);
+
+        auto a0 = M2SimdMul(M2SimdSub(one, M2SimdAdd(yy, zz)), scaleX);
+        auto a1 = M2SimdMul(M2SimdAdd(xy, wz), scaleX);
+        auto a2 = M2SimdMul(M2SimdSub(xz, wy), scaleX);
+        auto b0 = M2SimdMul(M2SimdSub(xy, wz), scaleY);
+        auto b1 = M2SimdMul(M2SimdSub(one, M2SimdAdd(xx, zz)), scaleY);
+        auto b2 = M2SimdMul(M2SimdAdd(yz, wx), scaleY);
+        auto c0 = M2SimdMul(M2SimdAdd(xz, wy), scaleZ);
+        auto c1 = M2SimdMul(M2SimdSub(yz, wx), scaleZ);
+        auto c2 = M2SimdMul(M2SimdSub(one, M2SimdAdd(xx, yy)), scaleZ);
+
+        // Translation about the pivot
+        auto pivotX = M2SimdLoad(&this->m_pivot[0][i]);
+        auto pivotY = M2SimdLoad(&this->m_pivot[1][i]);
+        auto pivotZ = M2SimdLoad(&this->m_pivot[2][i]);
+        auto negPivotX = M2SimdSub(zero, pivotX);
+        auto negPivotY = M2SimdSub(zero, pivotY);
+        auto negPivotZ = M2SimdSub(zero, pivotZ);
+
+        auto d0 = M2SimdAdd(M2SimdLoad(&this->m_translation[0][i]), pivotX);
+        auto d1 = M2SimdAdd(M2SimdLoad(&this->m_translation[1][i]), pivotY);
+        auto d2 = M2SimdAdd(M2SimdLoad(&this->m_translation[2][i]), pivotZ);
+
+        d0 = M2SimdAdd(d0, M2SimdAdd(M2SimdAdd(M2SimdMul(a0, negPivotX), M2SimdMul(b0, negPivotY)), M2SimdMul(c0, negPivotZ)));
+        d1 = M2SimdAdd(d1, M2SimdAdd(M2SimdAdd(M2SimdMul(a1, negPivotX), M2SimdMul(b1, negPivotY)), M2SimdMul(c1, negPivotZ)));
+        d2 = M2SimdAdd(d2, M2SimdAdd(M2SimdAdd(M2SimdMul(a2, negPivotX), M2SimdMul(b2, negPivotY)), M2SimdMul(c2, negPivotZ)));
+
+        M2SimdStore(columns[0], a0);
+        M2SimdStore(columns[1], a1);
+        M2SimdStore(columns[2], a2);
+        M2SimdStore(columns[3], b0);
+        M2SimdStore(columns[4], b1);
+        M2SimdStore(columns[5], b2);
+        M2SimdStore(columns[6], c0);
+        M2SimdStore(columns[7], c1);
+        M2SimdStore(columns[8], c2);
+        M2SimdStore(columns[9], d0);
+        M2SimdStore(columns[10], d1);
+        M2SimdStore(columns[11], d2);
+
+        for (uint32_t lane = 0; lane < M2_SIMD_WIDTH; lane++) {
+            this->m_matrices[i + lane] = C44Matrix(
+                columns[0][lane], columns[1][lane], columns[2][lane], 0.0f,
+                columns[3][lane], columns[4][lane], columns[5][lane], 0.0f,
+                columns[6][lane], columns[7][lane], columns[8][lane], 0.0f,
+                columns[9][lane], columns[10][lane], columns[11][lane], 1.0f
+            );
+        }
+    }
+#else
+    this->BuildScalar();
+#endif
+}
+
+void M2BoneTransforms::BuildScalar() {
+    for (uint32_t i = 0; i < this->m_count; i++) {
+        M2BuildBoneMatrix(*this, i);
+    }
+}
+
+C4Quaternion M2BoneTransforms::Rotation(uint32_t index) {
+    return {
+        this->m_rotationStart[0][index],
+        this->m_rotationStart[1][index],
+        this->m_rotationStart[2][index],
+        this->m_rotationStart[3][index]
+    };
+}
+
+void M2BoneTransforms::Set(uint32_t index, const C4Quaternion& rotationStart, const C4Quaternion& rotationEnd, float ratio, const C3Vector& translation, const C3Vector& scale, const C3Vector& pivot) {
+    this->m_rotationStart[0][index] = rotationStart.x;
+    this->m_rotationStart[1][index] = rotationStart.y;
+    this->m_rotationStart[2][index] = rotationStart.z;
+    this->m_rotationStart[3][index] = rotationStart.w;
+    this->m_rotationEnd[0][index] = rotationEnd.x;
+    this->m_rotationEnd[1][index] = rotationEnd.y;
+    this->m_rotationEnd[2][index] = rotationEnd.z;
+    this->m_rotationEnd[3][index] = rotationEnd.w;
+    this->m_ratio[index] = ratio;
+    this->m_translation[0][index] = translation.x;
+    this->m_translation[1][index] = translation.y;
+    this->m_translation[2][index] = translation.z;
+    this->m_scale[0][index] = scale.x;
+    this->m_scale[1][index] = scale.y;
+    this->m_scale[2][index] = scale.z;
+    this->m_pivot[0][index] = pivot.x;
+    this->m_pivot[1][index] = pivot.y;
+    this->m_pivot[2][index] = pivot.z;
+}
+
+void M2BoneTransforms::SetCount(uint32_t count) {
+    this->m_count = count;
+    this->m_stride = (count + M2_BONE_STRIDE_ALIGN - 1) & ~(M2_BONE_STRIDE_ALIGN - 1);
+
+    this->m_data.SetCount(this->m_stride * M2_BONE_COMPONENTS);
+    this->m_matrices.SetCount(this->m_stride);
+
+    auto data = this->m_data.Ptr();
+
+    for (uint32_t i = 0; i < 4; i++) {
+        this->m_rotationStart[i] = data;
+        data += this->m_stride;
+    }
+
+    for (uint32_t i = 0; i < 4; i++) {
+        this->m_rotationEnd[i] = data;
+        data += this->m_stride;
+    }
+
+    this->m_ratio = data;
+    data += this->m_stride;
+
+    for (uint32_t i = 0; i < 3; i++) {
+        this->m_translation[i] = data;
+        data += this->m_stride;
+    }
+
+    for (uint32_t i = 0; i < 3; i++) {
+        this->m_scale[i] = data;
+        data += this->m_stride;
+    }
+
+    for (uint32_t i = 0; i < 3; i++) {
+        this->m_pivot[i] = data;
+        data += this->m_stride;
+    }
+
+    // Batches run past the last bone, so padding holds identity transforms
+    C4Quaternion identity = { 0.0f, 0.0f, 0.0f, 1.0f };
+    C3Vector zero = { 0.0f, 0.0f, 0.0f };
+    C3Vector one = { 1.0f, 1.0f, 1.0f };
+
+    for (uint32_t i = count; i < this->m_stride; i++) {
+        this->Set(i, identity, identity, 0.0f, zero, one, zero);
+    }
+}
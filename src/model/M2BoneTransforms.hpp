@@ -0,0 +1,37 @@
+#ifndef MODEL_M2_BONE_TRANSFORMS_HPP
+#define MODEL_M2_BONE_TRANSFORMS_HPP
+
+#include "model/M2Simd.hpp"
+#include <cstdint>
+#include <storm/Array.hpp>
+#include <tempest/Matrix.hpp>
+#include <tempest/Quaternion.hpp>
+#include <tempest/Vector.hpp>
+
+// Interpolated transforms for every bone of a model, one array per component,
+// so the rotation blends and local matrices of a whole skeleton are built in
+// batches. A bone's rotation is the pair of keys it blends between and the
+// blend ratio until Build normalizes the blend in place.
+class M2BoneTransforms {
+    public:
+        // Member variables
+        TSGrowableArray<float> m_data;
+        TSGrowableArray<C44Matrix> m_matrices;
+        uint32_t m_count = 0;
+        uint32_t m_stride = 0;
+        float* m_rotationStart[4];
+        float* m_rotationEnd[4];
+        float* m_ratio;
+        float* m_translation[3];
+        float* m_scale[3];
+        float* m_pivot[3];
+
+        // Member functions
+        void Build();
+        void BuildScalar();
+        C4Quaternion Rotation(uint32_t index);
+        void Set(uint32_t index, const C4Quaternion& rotationStart, const C4Quaternion& rotationEnd, float ratio, const C3Vector& translation, const C3Vector& scale, const C3Vector& pivot);
+        void SetCount(uint32_t count);
+};
+
+#endif
@@ -215,15 +215,15 @@ int32_t M2Init(uint8_t* base, uint32_t size, const M2Data& data, M2Color& color)
 }
 
 int32_t M2Init(uint8_t* base, uint32_t size, const M2Data& data, M2CompBone& bone) {
-    if (!M2Init<C3Vector>(base, size, data, bone.translationTrack)) {
+    if (!M2Init<C3Vector>(base, size, data, bone.translationTrack) || !M2InitSplineKeys(base, size, data, bone.translationTrack)) {
         return 0;
     }
 
-    if (!M2Init<M2CompQuat>(base, size, data, bone.rotationTrack)) {
+    if (!M2Init<M2CompQuat>(base, size, data, bone.rotationTrack) || !M2InitSplineKeys(base, size, data, bone.rotationTrack)) {
         return 0;
     }
 
-    if (!M2Init<C3Vector>(base, size, data, bone.scaleTrack)) {
+    if (!M2Init<C3Vector>(base, size, data, bone.scaleTrack) || !M2InitSplineKeys(base, size, data, bone.scaleTrack)) {
         return 0;
     }
 
@@ -216,4 +216,44 @@ int32_t M2Init(uint8_t* base, uint32_t size, const M2Data& data, M2Track<T>& tra
     return 1;
 }
 
+// Bezier and Hermite bone tracks store every key with its tangents, as
+// M2SplineKey<T>, so their keys run three times as far as M2Init checked
+template<class T>
+int32_t M2InitSplineKeys(uint8_t* base, uint32_t size, const M2Data& data, M2Track<T>& track) {
+    if (track.trackType != 2 && track.trackType != 3) {
+        return 1;
+    }
+
+    for (uint32_t i = 0; i < track.sequenceKeys.Count(); i++) {
+        auto keysBase = base;
+        auto keysSize = size;
+
+        // Only keys this pass pointed into its file
+        if (CM2Model::s_loadingSequence != 0xFFFFFFFF) {
+            if (i != CM2Model::s_loadingSequence) {
+                continue;
+            }
+
+            keysBase = CM2Model::s_sequenceBase;
+            keysSize = CM2Model::s_sequenceBaseSize;
+        } else if (track.loopIndex == 0xFFFF && !(data.sequences[i].flags & 0x20)) {
+            continue;
+        }
+
+        auto& keys = track.sequenceKeys[i].keys;
+
+        if (!keys.Count()) {
+            continue;
+        }
+
+        auto offset = reinterpret_cast<uint8_t*>(keys.Data()) - keysBase;
+
+        if (offset < 0 || static_cast<size_t>(offset) + keys.Count() * sizeof(M2SplineKey<T>) > keysSize) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
 #endif
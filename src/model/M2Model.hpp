@@ -3,6 +3,7 @@
 
 #include "gx/Camera.hpp"
 #include "model/CM2Light.hpp"
+#include "model/M2Spline.hpp"
 #include <cstdint>
 #include <tempest/Quaternion.hpp>
 #include <tempest/Vector.hpp>
@@ -10,13 +11,28 @@
 template<class T>
 class M2Track;
 
-template<class T>
-struct M2ModelTrack {
+// Key cursor of a track: the key FindKey found last, and the sequence it was
+// found in. Both fit in what would otherwise be padding before sourceTrack.
+struct M2ModelTrackBase {
     uint32_t currentKey = 0;
+    uint16_t currentSequence = 0xFFFF;
+};
+
+template<class T>
+struct M2ModelTrack : M2ModelTrackBase {
     M2Track<T>* sourceTrack = nullptr;
     T currentValue;
 };
 
+// Spline tracks also keep the segment they evaluated last, so frames that stay
+// within it only evaluate its polynomial
+template<class T>
+struct M2ModelSplineTrack : M2ModelTrack<T> {
+    uint32_t segmentKey = 0xFFFFFFFF;
+    uint16_t segmentSequence = 0xFFFF;
+    M2SplineSegment<T> segment;
+};
+
 struct M2ModelAttachment {
 };
 
@@ -36,9 +52,9 @@ struct M2ModelBoneSeq {
 };
 
 struct M2ModelBone {
-    M2ModelTrack<C3Vector> translationTrack;
+    M2ModelSplineTrack<C3Vector> translationTrack;
     M2ModelTrack<C4Quaternion> rotationTrack;
-    M2ModelTrack<C3Vector> scaleTrack;
+    M2ModelSplineTrack<C3Vector> scaleTrack;
     M2ModelBoneSeq sequence;
     M2ModelBoneSeq secondarySequence;
     uint32_t flags = 0;
@@ -50,10 +66,18 @@ struct M2ModelBone {
     float floatA8 = 0.0f;
 };
 
+// A model space bone pose taken apart, so reduced animation can blend the
+// rotation as a rotation
+struct M2ModelBonePose {
+    C4Quaternion rotation;
+    C3Vector translation;
+    C3Vector scale;
+};
+
 struct M2ModelCamera {
-    M2ModelTrack<C3Vector> positionTrack;
-    M2ModelTrack<C3Vector> targetTrack;
-    M2ModelTrack<float> rollTrack;
+    M2ModelSplineTrack<C3Vector> positionTrack;
+    M2ModelSplineTrack<C3Vector> targetTrack;
+    M2ModelSplineTrack<float> rollTrack;
     HCAMERA m_camera = nullptr;
 };
 
@@ -79,4 +103,9 @@ struct M2ModelTextureWeight {
     M2ModelTrack<float> weightTrack;
 };
 
+struct M2SequenceFallback {
+    uint16_t uint0;
+    uint16_t uint2;
+};
+
 #endif
@@ -0,0 +1,17 @@
+#ifndef MODEL_M2_SIMD_HPP
+#define MODEL_M2_SIMD_HPP
+
+// Widest vector instruction set the build targets. AVX builds can use the SSE
+// intrinsics as well.
+#if defined(__AVX__)
+#define M2_SIMD_AVX
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define M2_SIMD_SSE2
+#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define M2_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+#endif
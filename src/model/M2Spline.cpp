@@ -0,0 +1,99 @@
+#include "model/M2Spline.hpp"
+#include "model/M2Simd.hpp"
+
+// Bezier segments run through the key values with the tangents as the inner
+// control points
+static void M2BezierCoefficients(float p0, float p1, float p2, float p3, float* coefficients) {
+    coefficients[0] = p0;
+    coefficients[1] = 3.0f * (p1 - p0);
+    coefficients[2] = 3.0f * (p0 - 2.0f * p1 + p2);
+    coefficients[3] = p3 - p0 + 3.0f * (p1 - p2);
+}
+
+// Hermite segments run through the key values with the tangents as the
+// derivatives there
+static void M2HermiteCoefficients(float p0, float m0, float m1, float p1, float* coefficients) {
+    coefficients[0] = p0;
+    coefficients[1] = m0;
+    coefficients[2] = 3.0f * (p1 - p0) - 2.0f * m0 - m1;
+    coefficients[3] = 2.0f * (p0 - p1) + m0 + m1;
+}
+
+void M2InterpolateCubic(const M2SplineSegment<C3Vector>& segment, float ratio, C3Vector& value) {
+#if defined(M2_SIMD_AVX) || defined(M2_SIMD_SSE2)
+    auto t = _mm_set1_ps(ratio);
+
+    auto result = _mm_loadu_ps(segment.coefficients[3]);
+    result = _mm_add_ps(_mm_mul_ps(result, t), _mm_loadu_ps(segment.coefficients[2]));
+    result = _mm_add_ps(_mm_mul_ps(result, t), _mm_loadu_ps(segment.coefficients[1]));
+    result = _mm_add_ps(_mm_mul_ps(result, t), _mm_loadu_ps(segment.coefficients[0]));
+
+    float lanes[4];
+    _mm_storeu_ps(lanes, result);
+
+    value = { lanes[0], lanes[1], lanes[2] };
+#elif defined(M2_SIMD_NEON)
+    auto t = vdupq_n_f32(ratio);
+
+    auto result = vld1q_f32(segment.coefficients[3]);
+    result = vaddq_f32(vmulq_f32(result, t), vld1q_f32(segment.coefficients[2]));
+    result = vaddq_f32(vmulq_f32(result, t), vld1q_f32(segment.coefficients[1]));
+    result = vaddq_f32(vmulq_f32(result, t), vld1q_f32(segment.coefficients[0]));
+
+    value = { vgetq_lane_f32(result, 0), vgetq_lane_f32(result, 1), vgetq_lane_f32(result, 2) };
+#else
+    M2InterpolateCubicScalar(segment, ratio, value);
+#endif
+}
+
+void M2InterpolateCubic(const M2SplineSegment<float>& segment, float ratio, float& value) {
+    auto& c = segment.coefficients;
+
+    value = ((c[3] * ratio + c[2]) * ratio + c[1]) * ratio + c[0];
+}
+
+void M2InterpolateCubicBezier(const M2SplineKey<C3Vector>& startKey, const M2SplineKey<C3Vector>& endKey, M2SplineSegment<C3Vector>& segment) {
+    float coefficients[3][4];
+
+    M2BezierCoefficients(startKey.value.x, startKey.outTan.x, endKey.inTan.x, endKey.value.x, coefficients[0]);
+    M2BezierCoefficients(startKey.value.y, startKey.outTan.y, endKey.inTan.y, endKey.value.y, coefficients[1]);
+    M2BezierCoefficients(startKey.value.z, startKey.outTan.z, endKey.inTan.z, endKey.value.z, coefficients[2]);
+
+    for (uint32_t i = 0; i < 4; i++) {
+        segment.coefficients[i][0] = coefficients[0][i];
+        segment.coefficients[i][1] = coefficients[1][i];
+        segment.coefficients[i][2] = coefficients[2][i];
+        segment.coefficients[i][3] = 0.0f;
+    }
+}
+
+void M2InterpolateCubicBezier(const M2SplineKey<float>& startKey, const M2SplineKey<float>& endKey, M2SplineSegment<float>& segment) {
+    M2BezierCoefficients(startKey.value, startKey.outTan, endKey.inTan, endKey.value, segment.coefficients);
+}
+
+void M2InterpolateCubicHermite(const M2SplineKey<C3Vector>& startKey, const M2SplineKey<C3Vector>& endKey, M2SplineSegment<C3Vector>& segment) {
+    float coefficients[3][4];
+
+    M2HermiteCoefficients(startKey.value.x, startKey.outTan.x, endKey.inTan.x, endKey.value.x, coefficients[0]);
+    M2HermiteCoefficients(startKey.value.y, startKey.outTan.y, endKey.inTan.y, endKey.value.y, coefficients[1]);
+    M2HermiteCoefficients(startKey.value.z, startKey.outTan.z, endKey.inTan.z, endKey.value.z, coefficients[2]);
+
+    for (uint32_t i = 0; i < 4; i++) {
+        segment.coefficients[i][0] = coefficients[0][i];
+        segment.coefficients[i][1] = coefficients[1][i];
+        segment.coefficients[i][2] = coefficients[2][i];
+        segment.coefficients[i][3] = 0.0f;
+    }
+}
+
+void M2InterpolateCubicHermite(const M2SplineKey<float>& startKey, const M2SplineKey<float>& endKey, M2SplineSegment<float>& segment) {
+    M2HermiteCoefficients(startKey.value, startKey.outTan, endKey.inTan, endKey.value, segment.coefficients);
+}
+
+void M2InterpolateCubicScalar(const M2SplineSegment<C3Vector>& segment, float ratio, C3Vector& value) {
+    auto& c = segment.coefficients;
+
+    value.x = ((c[3][0] * ratio + c[2][0]) * ratio + c[1][0]) * ratio + c[0][0];
+    value.y = ((c[3][1] * ratio + c[2][1]) * ratio + c[1][1]) * ratio + c[0][1];
+    value.z = ((c[3][2] * ratio + c[2][2]) * ratio + c[1][2]) * ratio + c[0][2];
+}
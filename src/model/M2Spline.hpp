@@ -0,0 +1,35 @@
+#ifndef MODEL_M2_SPLINE_HPP
+#define MODEL_M2_SPLINE_HPP
+
+#include "model/M2Data.hpp"
+#include <cstdint>
+#include <tempest/Vector.hpp>
+
+// One segment of a spline track as the cubic a + b t + c t^2 + d t^3 in the
+// blend ratio t, so evaluating it is a single polynomial
+template<class T>
+struct M2SplineSegment {
+    T coefficients[4];
+};
+
+template<>
+struct M2SplineSegment<C3Vector> {
+    // x, y, z and a padding lane per coefficient, for 4 wide loads
+    float coefficients[4][4];
+};
+
+void M2InterpolateCubic(const M2SplineSegment<C3Vector>& segment, float ratio, C3Vector& value);
+
+void M2InterpolateCubic(const M2SplineSegment<float>& segment, float ratio, float& value);
+
+void M2InterpolateCubicBezier(const M2SplineKey<C3Vector>& startKey, const M2SplineKey<C3Vector>& endKey, M2SplineSegment<C3Vector>& segment);
+
+void M2InterpolateCubicBezier(const M2SplineKey<float>& startKey, const M2SplineKey<float>& endKey, M2SplineSegment<float>& segment);
+
+void M2InterpolateCubicHermite(const M2SplineKey<C3Vector>& startKey, const M2SplineKey<C3Vector>& endKey, M2SplineSegment<C3Vector>& segment);
+
+void M2InterpolateCubicHermite(const M2SplineKey<float>& startKey, const M2SplineKey<float>& endKey, M2SplineSegment<float>& segment);
+
+void M2InterpolateCubicScalar(const M2SplineSegment<C3Vector>& segment, float ratio, C3Vector& value);
+
+#endif
@@ -2,10 +2,21 @@
 #define MODEL_M2_TYPES_HPP
 
 #include "M2Data.hpp"
+#include <storm/Atomic.hpp>
+
+#define M2_KEY_CURSOR_STEPS 4
+#define M2_MAX_THREADS 16
 
 class CM2Model;
 class CShaderEffect;
 
+enum M2ANIMATE {
+    M2ANIMATE_FULL = 0,
+    M2ANIMATE_REDUCED = 1,
+    M2ANIMATE_SKIPPED = 2,
+    M2ANIMATE_COUNT = 3
+};
+
 enum M2BLEND {
     M2BLEND_OPAQUE = 0x0,
     M2BLEND_ALPHA_KEY = 0x1,
@@ -43,6 +54,11 @@ enum M2PASS {
     M2PASS_COUNT = 3
 };
 
+struct M2AnimateSlice {
+    ATOMIC32 next;
+    uint32_t end;
+};
+
 struct M2Element {
     int32_t type;
     CM2Model* model;
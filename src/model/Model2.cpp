@@ -3,6 +3,8 @@
 #include "model/M2Internal.hpp"
 #include "console/CVar.hpp"
 #include "util/Filesystem.hpp"
+#include "util/System.hpp"
+#include <algorithm>
 #include <cstring>
 #include <new>
 #include <common/ObjectAlloc.hpp>
@@ -17,6 +19,32 @@ static CVar* s_M2BatchParticlesVar;
 static CVar* s_M2ForceAdditiveParticleSortVar;
 static CVar* s_M2FasterVar;
 static CVar* s_M2FasterDebugVar;
+static CVar* s_M2CacheTimeoutVar;
+static CVar* s_M2AnimateThreadsVar;
+static CVar* s_M2BakeAnimationsVar;
+static CVar* s_M2BakeMemoryVar;
+static CVar* s_M2BakeToleranceVar;
+static CVar* s_M2AnimateCullVar;
+static CVar* s_M2AnimateReducedDistanceVar;
+static CVar* s_M2AnimateReducedIntervalVar;
+static CVar* s_M2AnimateSkipDistanceVar;
+
+uint32_t M2ConvertBakeInterval(int32_t rate) {
+    if (rate <= 0) {
+        return 0;
+    }
+
+    return std::max(1000 / rate, 1);
+}
+
+uint32_t M2ConvertThreadCount(int32_t threads) {
+    if (threads > 0) {
+        return threads;
+    }
+
+    // One worker for every core past the one running the scene
+    return std::max(OsGetProcessorCount(), 1u) - 1;
+}
 
 uint32_t M2ConvertFasterFlags(int32_t faster, int32_t debugFaster) {
     uint32_t flags = 0x0;
@@ -115,11 +143,74 @@ int32_t M2ConvertModelFileName(const char* source, char* dest, uint32_t a3, uint
     return 1;
 }
 
+bool M2CacheTimeoutChanged(CVar* cvar, char const* oldValue, char const* newValue, void* userArg) {
+    CM2Cache::s_cache.m_gcTimeout = SStrToInt(newValue) * 1000;
+
+    return true;
+}
+
+bool M2AnimateThreadsChanged(CVar* cvar, char const* oldValue, char const* newValue, void* userArg) {
+    if (CM2Cache::s_cache.m_flags & 0x4) {
+        CM2Cache::s_cache.SetThreadCount(M2ConvertThreadCount(SStrToInt(newValue)));
+    }
+
+    return true;
+}
+
+bool M2BakeAnimationsChanged(CVar* cvar, char const* oldValue, char const* newValue, void* userArg) {
+    CM2Cache::s_cache.m_bakeInterval = M2ConvertBakeInterval(SStrToInt(newValue));
+
+    return true;
+}
+
+bool M2BakeMemoryChanged(CVar* cvar, char const* oldValue, char const* newValue, void* userArg) {
+    CM2Cache::s_cache.m_bakeSizeLimit = std::max(SStrToInt(newValue), 0) * 1024;
+
+    return true;
+}
+
+bool M2BakeToleranceChanged(CVar* cvar, char const* oldValue, char const* newValue, void* userArg) {
+    CM2Cache::s_cache.m_bakeTolerance = SStrToFloat(newValue);
+
+    return true;
+}
+
+bool M2AnimateCullChanged(CVar* cvar, char const* oldValue, char const* newValue, void* userArg) {
+    CM2Cache::s_cache.m_animateCull = SStrToInt(newValue) != 0;
+
+    return true;
+}
+
+bool M2AnimateReducedDistanceChanged(CVar* cvar, char const* oldValue, char const* newValue, void* userArg) {
+    CM2Cache::s_cache.m_animateReducedDistance = std::max(SStrToFloat(newValue), 0.0f);
+
+    return true;
+}
+
+bool M2AnimateReducedIntervalChanged(CVar* cvar, char const* oldValue, char const* newValue, void* userArg) {
+    CM2Cache::s_cache.m_animateReducedInterval = std::max(SStrToInt(newValue), 1);
+
+    return true;
+}
+
+bool M2AnimateSkipDistanceChanged(CVar* cvar, char const* oldValue, char const* newValue, void* userArg) {
+    CM2Cache::s_cache.m_animateSkipDistance = std::max(SStrToFloat(newValue), 0.0f);
+
+    return true;
+}
+
 CM2Scene* M2CreateScene() {
     auto m = SMemAlloc(sizeof(CM2Scene), __FILE__, __LINE__, 0x0);
     return new (m) CM2Scene(&CM2Cache::s_cache);
 }
 
+void M2Destroy() {
+    // Frees every model and shared model nothing references anymore
+    CM2Cache::s_cache.GarbageCollect(1);
+
+    CM2Cache::s_cache.Shutdown();
+}
+
 uint32_t M2GetCacheFlags() {
     return CM2Cache::s_cache.m_flags;
 }
@@ -127,6 +218,24 @@ uint32_t M2GetCacheFlags() {
 void M2Initialize(uint16_t flags, uint32_t a2) {
     CM2Cache::s_cache.Initialize(flags);
 
+    if (CM2Cache::s_cache.m_flags & 0x4) {
+        auto threads = s_M2AnimateThreadsVar ? s_M2AnimateThreadsVar->GetInt() : 0;
+        CM2Cache::s_cache.SetThreadCount(M2ConvertThreadCount(threads));
+    }
+
+    if (s_M2BakeAnimationsVar) {
+        CM2Cache::s_cache.m_bakeInterval = M2ConvertBakeInterval(s_M2BakeAnimationsVar->GetInt());
+        CM2Cache::s_cache.m_bakeSizeLimit = std::max(s_M2BakeMemoryVar->GetInt(), 0) * 1024;
+        CM2Cache::s_cache.m_bakeTolerance = SStrToFloat(s_M2BakeToleranceVar->GetString());
+    }
+
+    if (s_M2AnimateCullVar) {
+        CM2Cache::s_cache.m_animateCull = s_M2AnimateCullVar->GetInt() != 0;
+        CM2Cache::s_cache.m_animateReducedDistance = std::max(SStrToFloat(s_M2AnimateReducedDistanceVar->GetString()), 0.0f);
+        CM2Cache::s_cache.m_animateReducedInterval = std::max(s_M2AnimateReducedIntervalVar->GetInt(), 1);
+        CM2Cache::s_cache.m_animateSkipDistance = std::max(SStrToFloat(s_M2AnimateSkipDistanceVar->GetString()), 0.0f);
+    }
+
     if (!a2) {
         a2 = 2048;
     }
@@ -239,6 +348,114 @@ uint32_t M2RegisterCVars() {
         false
     );
 
+    s_M2CacheTimeoutVar = CVar::Register(
+        "M2CacheTimeout",
+        "seconds an unused model stays cached",
+        0,
+        "30",
+        M2CacheTimeoutChanged,
+        1,
+        false,
+        nullptr,
+        false
+    );
+
+    s_M2AnimateThreadsVar = CVar::Register(
+        "M2AnimateThreads",
+        "worker threads for model animations (0 for one per extra core)",
+        0,
+        "0",
+        M2AnimateThreadsChanged,
+        1,
+        false,
+        nullptr,
+        false
+    );
+
+    s_M2BakeAnimationsVar = CVar::Register(
+        "M2BakeAnimations",
+        "samples per second to bake model animations at as they load (0 to evaluate keys)",
+        0,
+        "0",
+        M2BakeAnimationsChanged,
+        1,
+        false,
+        nullptr,
+        false
+    );
+
+    s_M2BakeMemoryVar = CVar::Register(
+        "M2BakeMemory",
+        "kilobytes all baked model animations may use",
+        0,
+        "16384",
+        M2BakeMemoryChanged,
+        1,
+        false,
+        nullptr,
+        false
+    );
+
+    s_M2BakeToleranceVar = CVar::Register(
+        "M2BakeTolerance",
+        "largest error a baked model animation may have before its keys are used instead",
+        0,
+        "0.01",
+        M2BakeToleranceChanged,
+        1,
+        false,
+        nullptr,
+        false
+    );
+
+    s_M2AnimateCullVar = CVar::Register(
+        "M2AnimateCull",
+        "skip animating models outside the view until they come back into it",
+        0,
+        "0",
+        M2AnimateCullChanged,
+        1,
+        false,
+        nullptr,
+        false
+    );
+
+    s_M2AnimateReducedDistanceVar = CVar::Register(
+        "M2AnimateReducedDistance",
+        "distance past which models animate at a reduced rate (0 to animate them every frame)",
+        0,
+        "0",
+        M2AnimateReducedDistanceChanged,
+        1,
+        false,
+        nullptr,
+        false
+    );
+
+    s_M2AnimateReducedIntervalVar = CVar::Register(
+        "M2AnimateReducedInterval",
+        "milliseconds between animation updates of models past M2AnimateReducedDistance",
+        0,
+        "100",
+        M2AnimateReducedIntervalChanged,
+        1,
+        false,
+        nullptr,
+        false
+    );
+
+    s_M2AnimateSkipDistanceVar = CVar::Register(
+        "M2AnimateSkipDistance",
+        "distance past which models don't animate (0 to animate them at any distance)",
+        0,
+        "0",
+        M2AnimateSkipDistanceChanged,
+        1,
+        false,
+        nullptr,
+        false
+    );
+
     uint32_t flags = 0;
 
     if (s_M2UseZFillVar->GetInt()) {
@@ -11,6 +11,8 @@ int32_t M2ConvertModelFileName(const char* source, char* dest, uint32_t a3, uint
 
 CM2Scene* M2CreateScene();
 
+void M2Destroy();
+
 uint32_t M2GetCacheFlags();
 
 void M2Initialize(uint16_t flags, uint32_t a2);
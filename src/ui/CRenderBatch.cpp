@@ -5,6 +5,7 @@
 #include "gx/Font.hpp"
 #include "gx/Shader.hpp"
 #include "gx/font/CGxStringBatch.hpp"
+#include "gx/texture/CTextureAtlas.hpp"
 #include <cstdlib>
 #include <storm/Error.hpp>
 
@@ -85,13 +86,12 @@ void CRenderBatch::Queue(CTexture* texture, EGxBlend alphaMode, int32_t posCount
     mesh->indices = const_cast<uint16_t*>(indices);
     mesh->idxCount = idxCount;
 
-    // TODO
-    // - implement atlas stuff
-    mesh->onAtlas = 0;
-    // mesh->onAtlas = TextureOnAtlas(texture);
-    // if (onAtlas) {
-    //     TextureGetAtlasOffsetAndScale(mesh->texture, mesh->offset, mesh->scale);
-    // }
+    mesh->onAtlas = TextureOnAtlas(texture);
+
+    if (mesh->onAtlas) {
+        TextureGetAtlasOffsetAndScale(texture, mesh->atlasOffset, mesh->atlasScale);
+        mesh->atlasGeneration = CTextureAtlas::s_generation;
+    }
 
     this->m_count++;
 }
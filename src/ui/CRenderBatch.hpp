@@ -35,7 +35,8 @@ class CSimpleBatchedMesh {
         uint16_t* indices;
         int32_t idxCount;
         int32_t onAtlas;
-        float atlasScale;
+        uint32_t atlasGeneration;
+        C2Vector atlasScale;
         C2Vector atlasOffset;
 
         // Member functions
@@ -9,6 +9,7 @@
 #include "gx/Texture.hpp"
 #include "gx/Transform.hpp"
 #include "gx/Types.hpp"
+#include "gx/texture/CTextureAtlas.hpp"
 #include "ui/CRenderBatch.hpp"
 
 CGxShader* CSimpleRender::s_vertexShader[2];
@@ -79,6 +80,12 @@ void CSimpleRender::DrawBatch(CRenderBatch* batch) {
             posCount = mesh->posCount;
             idxCount = mesh->idxCount;
 
+            // Pages repacked since the batch was built moved the block
+            if (mesh->onAtlas && mesh->atlasGeneration != CTextureAtlas::s_generation) {
+                TextureGetAtlasOffsetAndScale(mesh->texture, mesh->atlasOffset, mesh->atlasScale);
+                mesh->atlasGeneration = CTextureAtlas::s_generation;
+            }
+
             CGxBuf* vertexStream = g_theGxDevicePtr->BufStream(GxPoolTarget_Vertex, 24, posCount);
             char* vertexData = g_theGxDevicePtr->BufLock(vertexStream);
             CGxVertexPCT* vertexBuf = reinterpret_cast<CGxVertexPCT*>(vertexData);
@@ -113,7 +120,9 @@ void CSimpleRender::DrawBatch(CRenderBatch* batch) {
                     }
 
                     if (mesh->onAtlas) {
-                        // TODO
+                        C2Vector* tc = &mesh->texCoord[i];
+                        vertexBuf->tc[0].x = mesh->atlasOffset.x + tc->x * mesh->atlasScale.x;
+                        vertexBuf->tc[0].y = mesh->atlasOffset.y + tc->y * mesh->atlasScale.y;
                     } else {
                         C2Vector* tc = &mesh->texCoord[i];
                         vertexBuf->tc[0].x = tc->x;
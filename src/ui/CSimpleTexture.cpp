@@ -523,7 +523,8 @@ int32_t CSimpleTexture::SetTexture(const char* fileName, bool wrapU, bool wrapV,
 }
 
 int32_t CSimpleTexture::SetTexture(const CImVector& color) {
-    HTEXTURE texture = TextureCreateSolid(color);
+    // On an atlas page, like the images around it
+    HTEXTURE texture = TextureCreateSolid(color, 0x4);
 
     if (this->m_texture) {
         HandleClose(this->m_texture);
@@ -2,8 +2,41 @@
 #include <cstring>
 #include <storm/String.hpp>
 
+#if defined(WHOA_SYSTEM_WIN)
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#endif
+
+static void OsMakeDirectory(const char* path) {
+#if defined(WHOA_SYSTEM_WIN)
+    CreateDirectoryA(path, nullptr);
+#else
+    mkdir(path, 0777);
+#endif
+}
+
 void OsCreateDirectory(const char* pathName, int32_t recursive) {
-    // TODO
+    char path[STORM_MAX_PATH];
+    SStrCopy(path, pathName, sizeof(path));
+
+    for (auto ptr = path; *ptr; ptr++) {
+        if (*ptr == '\\' || *ptr == '/') {
+#if !defined(WHOA_SYSTEM_WIN)
+            *ptr = '/';
+#endif
+
+            // Existing parents are fine, so failures are ignored
+            if (recursive && ptr != path) {
+                auto separator = *ptr;
+                *ptr = '\0';
+                OsMakeDirectory(path);
+                *ptr = separator;
+            }
+        }
+    }
+
+    OsMakeDirectory(path);
 }
 
 void OsBuildFontFilePath(const char* fileName, char* buffer, size_t size) {
@@ -0,0 +1,302 @@
+#include "util/SArchive.hpp"
+#include <cstring>
+#include <storm/Memory.hpp>
+#include <storm/String.hpp>
+
+uint32_t SArchive::s_cryptTable[0x500];
+
+void SArchive::Decrypt(void* data, uint32_t bytes, uint32_t key) {
+    SArchive::InitializeCryptTable();
+
+    auto dwords = static_cast<uint32_t*>(data);
+    uint32_t seed = 0xEEEEEEEE;
+
+    for (uint32_t i = 0; i < bytes / 4; i++) {
+        seed += SArchive::s_cryptTable[0x400 + (key & 0xFF)];
+        uint32_t value = dwords[i] ^ (key + seed);
+        key = ((~key << 0x15) + 0x11111111) | (key >> 0x0B);
+        seed = value + seed + (seed << 5) + 3;
+        dwords[i] = value;
+    }
+}
+
+void SArchive::Encrypt(void* data, uint32_t bytes, uint32_t key) {
+    SArchive::InitializeCryptTable();
+
+    auto dwords = static_cast<uint32_t*>(data);
+    uint32_t seed = 0xEEEEEEEE;
+
+    for (uint32_t i = 0; i < bytes / 4; i++) {
+        seed += SArchive::s_cryptTable[0x400 + (key & 0xFF)];
+        uint32_t value = dwords[i];
+        dwords[i] = value ^ (key + seed);
+        key = ((~key << 0x15) + 0x11111111) | (key >> 0x0B);
+        seed = value + seed + (seed << 5) + 3;
+    }
+}
+
+uint32_t SArchive::HashString(const char* str, uint32_t hashType) {
+    SArchive::InitializeCryptTable();
+
+    uint32_t seed1 = 0x7FED7FED;
+    uint32_t seed2 = 0xEEEEEEEE;
+
+    for (auto ptr = reinterpret_cast<const uint8_t*>(str); *ptr; ptr++) {
+        uint32_t ch = *ptr;
+
+        if (ch >= 'a' && ch <= 'z') {
+            ch -= 'a' - 'A';
+        } else if (ch == '/') {
+            ch = '\\';
+        }
+
+        seed1 = SArchive::s_cryptTable[hashType + ch] ^ (seed1 + seed2);
+        seed2 = ch + seed1 + seed2 + (seed2 << 5) + 3;
+    }
+
+    return seed1;
+}
+
+void SArchive::InitializeCryptTable() {
+    // Archives are read from loader threads, so the table is built under the
+    // guard of a function-local static rather than a plain flag
+    static int32_t s_initialized = []() {
+        uint32_t seed = 0x00100001;
+
+        for (uint32_t i = 0; i < 0x100; i++) {
+            for (uint32_t j = 0, index = i; j < 5; j++, index += 0x100) {
+                seed = (seed * 125 + 3) % 0x2AAAAB;
+                uint32_t hi = (seed & 0xFFFF) << 16;
+
+                seed = (seed * 125 + 3) % 0x2AAAAB;
+                uint32_t lo = seed & 0xFFFF;
+
+                SArchive::s_cryptTable[index] = hi | lo;
+            }
+        }
+
+        return 1;
+    }();
+
+    (void)s_initialized;
+}
+
+SArchive::~SArchive() {
+    if (this->m_hashTable) {
+        SMemFree(this->m_hashTable, __FILE__, __LINE__, 0);
+    }
+
+    if (this->m_blockTable) {
+        SMemFree(this->m_blockTable, __FILE__, __LINE__, 0);
+    }
+
+    if (this->m_hiBlockTable) {
+        SMemFree(this->m_hiBlockTable, __FILE__, __LINE__, 0);
+    }
+
+    if (this->m_filename) {
+        SMemFree(this->m_filename, __FILE__, __LINE__, 0);
+    }
+}
+
+const SArchive::BlockEntry* SArchive::FindFile(const char* filename, uint16_t locale, uint64_t* offset) {
+    if (!this->m_hashTableEntries) {
+        return nullptr;
+    }
+
+    auto mask = this->m_hashTableEntries - 1;
+    auto index = SArchive::HashString(filename, MPQ_HASH_TABLE_INDEX) & mask;
+    auto nameA = SArchive::HashString(filename, MPQ_HASH_NAME_A);
+    auto nameB = SArchive::HashString(filename, MPQ_HASH_NAME_B);
+
+    const HashEntry* match = nullptr;
+
+    for (uint32_t i = 0; i < this->m_hashTableEntries; i++) {
+        auto entry = &this->m_hashTable[(index + i) & mask];
+
+        if (entry->blockIndex == MPQ_HASH_ENTRY_EMPTY) {
+            break;
+        }
+
+        if (entry->nameA != nameA || entry->nameB != nameB || entry->blockIndex >= this->m_blockTableEntries) {
+            continue;
+        }
+
+        // The requested locale wins, with the locale neutral entry as the
+        // fallback
+        if (entry->locale == locale) {
+            match = entry;
+            break;
+        }
+
+        if (entry->locale == 0) {
+            match = entry;
+        }
+    }
+
+    if (!match) {
+        return nullptr;
+    }
+
+    auto block = &this->m_blockTable[match->blockIndex];
+
+    if (!(block->flags & MPQ_FILE_EXISTS)) {
+        return nullptr;
+    }
+
+    uint64_t blockOffset = block->offset;
+
+    if (this->m_hiBlockTable) {
+        blockOffset |= static_cast<uint64_t>(this->m_hiBlockTable[match->blockIndex]) << 32;
+    }
+
+    *offset = this->m_archiveOffset + blockOffset;
+
+    return block;
+}
+
+int32_t SArchive::Open(const char* filename) {
+    char path[STORM_MAX_PATH];
+    SStrCopy(path, filename, sizeof(path));
+
+    for (auto ptr = path; *ptr; ptr++) {
+        if (*ptr == '\\') {
+            *ptr = '/';
+        }
+    }
+
+    this->m_stream.open(path, std::ios::in | std::ios::binary);
+
+    if (!this->m_stream.is_open()) {
+        return 0;
+    }
+
+    this->m_stream.seekg(0, std::ios::end);
+    uint64_t fileSize = this->m_stream.tellg();
+
+    // The header may follow a user data block and is always 512 byte aligned
+    Header header;
+    uint64_t headerOffset = 0;
+    int32_t found = 0;
+
+    while (headerOffset + 0x20 <= fileSize) {
+        uint32_t signature;
+
+        if (!this->ReadRaw(headerOffset, &signature, sizeof(signature))) {
+            return 0;
+        }
+
+        if (signature == MPQ_USERDATA_SIGNATURE) {
+            uint32_t userData[4];
+
+            if (!this->ReadRaw(headerOffset, userData, sizeof(userData))) {
+                return 0;
+            }
+
+            // userData[2] is the offset of the real header
+            if (userData[2] && (userData[2] & 0x1FF) == 0) {
+                headerOffset += userData[2];
+                continue;
+            }
+        } else if (signature == MPQ_HEADER_SIGNATURE) {
+            memset(&header, 0, sizeof(header));
+
+            if (!this->ReadRaw(headerOffset, &header, 0x20)) {
+                return 0;
+            }
+
+            if (header.formatVersion >= 1 && header.headerSize >= 0x2C) {
+                if (!this->ReadRaw(headerOffset + 0x20, &header.hiBlockTableOffset, 0x0C)) {
+                    return 0;
+                }
+            }
+
+            found = 1;
+            break;
+        }
+
+        headerOffset += 0x200;
+    }
+
+    if (!found || header.formatVersion > 1) {
+        return 0;
+    }
+
+    // Hash table sizes are powers of two
+    if (header.hashTableEntries & (header.hashTableEntries - 1)) {
+        return 0;
+    }
+
+    // Table sizes come from the file, so they're sized in 64 bits and have to
+    // fit in what follows the header
+    uint64_t archiveBytes = fileSize - headerOffset;
+
+    uint64_t hashTableOffset = header.hashTableOffset | (static_cast<uint64_t>(header.hashTableOffsetHi) << 32);
+    uint64_t hashTableBytes = static_cast<uint64_t>(header.hashTableEntries) * sizeof(HashEntry);
+
+    uint64_t blockTableOffset = header.blockTableOffset | (static_cast<uint64_t>(header.blockTableOffsetHi) << 32);
+    uint64_t blockTableBytes = static_cast<uint64_t>(header.blockTableEntries) * sizeof(BlockEntry);
+
+    uint64_t hiBlockTableBytes = static_cast<uint64_t>(header.blockTableEntries) * sizeof(uint16_t);
+
+    if (
+        hashTableOffset > archiveBytes || hashTableBytes > archiveBytes - hashTableOffset
+        || blockTableOffset > archiveBytes || blockTableBytes > archiveBytes - blockTableOffset
+        || hashTableBytes > 0xFFFFFFFF || blockTableBytes > 0xFFFFFFFF
+    ) {
+        return 0;
+    }
+
+    if (header.formatVersion >= 1 && header.hiBlockTableOffset && (header.hiBlockTableOffset > archiveBytes || hiBlockTableBytes > archiveBytes - header.hiBlockTableOffset)) {
+        return 0;
+    }
+
+    this->m_archiveOffset = headerOffset;
+    this->m_sectorSize = 0x200 << header.sectorSizeShift;
+    this->m_hashTableEntries = header.hashTableEntries;
+    this->m_blockTableEntries = header.blockTableEntries;
+
+    this->m_hashTable = static_cast<HashEntry*>(SMemAlloc(hashTableBytes, __FILE__, __LINE__, 0x0));
+
+    if (!this->ReadRaw(headerOffset + hashTableOffset, this->m_hashTable, static_cast<uint32_t>(hashTableBytes))) {
+        return 0;
+    }
+
+    SArchive::Decrypt(this->m_hashTable, static_cast<uint32_t>(hashTableBytes), SArchive::HashString("(hash table)", MPQ_HASH_FILE_KEY));
+
+    this->m_blockTable = static_cast<BlockEntry*>(SMemAlloc(blockTableBytes, __FILE__, __LINE__, 0x0));
+
+    if (!this->ReadRaw(headerOffset + blockTableOffset, this->m_blockTable, static_cast<uint32_t>(blockTableBytes))) {
+        return 0;
+    }
+
+    SArchive::Decrypt(this->m_blockTable, static_cast<uint32_t>(blockTableBytes), SArchive::HashString("(block table)", MPQ_HASH_FILE_KEY));
+
+    if (header.formatVersion >= 1 && header.hiBlockTableOffset) {
+        this->m_hiBlockTable = static_cast<uint16_t*>(SMemAlloc(hiBlockTableBytes, __FILE__, __LINE__, 0x0));
+
+        if (!this->ReadRaw(headerOffset + header.hiBlockTableOffset, this->m_hiBlockTable, static_cast<uint32_t>(hiBlockTableBytes))) {
+            return 0;
+        }
+    }
+
+    auto filenameLen = SStrLen(filename) + 1;
+    this->m_filename = static_cast<char*>(SMemAlloc(filenameLen, __FILE__, __LINE__, 0x0));
+    SStrCopy(this->m_filename, filename, filenameLen);
+
+    return 1;
+}
+
+int32_t SArchive::ReadRaw(uint64_t offset, void* buffer, uint32_t bytes) {
+    this->m_streamLock.Enter();
+
+    this->m_stream.clear();
+    this->m_stream.seekg(offset, std::ios::beg);
+    this->m_stream.read(static_cast<char*>(buffer), bytes);
+
+    auto success = this->m_stream.gcount() == static_cast<std::streamsize>(bytes);
+
+    this->m_streamLock.Leave();
+
+    return success ? 1 : 0;
+}
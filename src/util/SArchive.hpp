@@ -0,0 +1,92 @@
+#ifndef UTIL_S_ARCHIVE_HPP
+#define UTIL_S_ARCHIVE_HPP
+
+#include <cstdint>
+#include <fstream>
+#include <storm/List.hpp>
+#include <storm/Thread.hpp>
+
+#define MPQ_HEADER_SIGNATURE    0x1A51504D // 'MPQ\x1A'
+#define MPQ_USERDATA_SIGNATURE  0x1B51504D // 'MPQ\x1B'
+
+#define MPQ_HASH_TABLE_INDEX    0x000
+#define MPQ_HASH_NAME_A         0x100
+#define MPQ_HASH_NAME_B         0x200
+#define MPQ_HASH_FILE_KEY       0x300
+
+#define MPQ_HASH_ENTRY_EMPTY    0xFFFFFFFF
+#define MPQ_HASH_ENTRY_DELETED  0xFFFFFFFE
+
+#define MPQ_FILE_IMPLODE        0x00000100
+#define MPQ_FILE_COMPRESS       0x00000200
+#define MPQ_FILE_ENCRYPTED      0x00010000
+#define MPQ_FILE_FIX_KEY        0x00020000
+#define MPQ_FILE_SINGLE_UNIT    0x01000000
+#define MPQ_FILE_DELETE_MARKER  0x02000000
+#define MPQ_FILE_SECTOR_CRC     0x04000000
+#define MPQ_FILE_EXISTS         0x80000000
+
+class SArchive : public TSLinkedNode<SArchive> {
+    public:
+        // Types
+        struct Header {
+            uint32_t signature;
+            uint32_t headerSize;
+            uint32_t archiveSize;
+            uint16_t formatVersion;
+            uint16_t sectorSizeShift;
+            uint32_t hashTableOffset;
+            uint32_t blockTableOffset;
+            uint32_t hashTableEntries;
+            uint32_t blockTableEntries;
+            // v2
+            uint64_t hiBlockTableOffset;
+            uint16_t hashTableOffsetHi;
+            uint16_t blockTableOffsetHi;
+        };
+
+        struct HashEntry {
+            uint32_t nameA;
+            uint32_t nameB;
+            uint16_t locale;
+            uint16_t platform;
+            uint32_t blockIndex;
+        };
+
+        struct BlockEntry {
+            uint32_t offset;
+            uint32_t compressedSize;
+            uint32_t fileSize;
+            uint32_t flags;
+        };
+
+        // Static variables
+        static uint32_t s_cryptTable[0x500];
+
+        // Static functions
+        static void Decrypt(void* data, uint32_t bytes, uint32_t key);
+        static void Encrypt(void* data, uint32_t bytes, uint32_t key);
+        static uint32_t HashString(const char* str, uint32_t hashType);
+        static void InitializeCryptTable();
+
+        // Member variables
+        char* m_filename = nullptr;
+        std::ifstream m_stream;
+        SCritSect m_streamLock;
+        uint64_t m_archiveOffset = 0;
+        uint32_t m_sectorSize = 0;
+        int32_t m_priority = 0;
+        HashEntry* m_hashTable = nullptr;
+        uint32_t m_hashTableEntries = 0;
+        BlockEntry* m_blockTable = nullptr;
+        uint16_t* m_hiBlockTable = nullptr;
+        uint32_t m_blockTableEntries = 0;
+
+        // Member functions
+        ~SArchive();
+        const BlockEntry* FindFile(const char* filename, uint16_t locale, uint64_t* offset);
+        int32_t Open(const char* filename);
+        int32_t ReadRaw(uint64_t offset, void* buffer, uint32_t bytes);
+};
+
+#endif
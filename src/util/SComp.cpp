@@ -0,0 +1,348 @@
+#include "util/SComp.hpp"
+#include <cstring>
+#include <storm/Memory.hpp>
+
+#if defined(WHOA_SCOMP_ZLIB)
+#include <zlib.h>
+#endif
+
+#if defined(WHOA_SCOMP_BZIP2)
+#include <bzlib.h>
+#endif
+
+#define EXPLODE_MAX_BITS 13
+
+struct ExplodeHuffman {
+    int16_t count[EXPLODE_MAX_BITS + 1];
+    int16_t symbol[256];
+};
+
+struct ExplodeState {
+    const uint8_t* in;
+    const uint8_t* inEnd;
+    uint32_t bitBuf;
+    uint32_t bitCount;
+    uint8_t* out;
+    uint8_t* outEnd;
+    uint8_t* outStart;
+};
+
+// Code lengths for the fixed PKWARE DCL huffman codes, run length encoded:
+// low nibble is the bit length, high nibble plus one is the repeat count
+static const uint8_t s_explodeLitLen[] = {
+    11, 124, 8, 7, 28, 7, 188, 13, 76, 4, 10, 8, 12, 10, 12, 10, 8, 23, 8,
+    9, 7, 6, 7, 8, 7, 6, 55, 8, 23, 24, 12, 11, 7, 9, 11, 12, 6, 7, 22, 5,
+    7, 24, 6, 11, 9, 6, 7, 22, 7, 11, 38, 7, 9, 8, 25, 11, 8, 11, 9, 12,
+    8, 12, 5, 38, 5, 38, 5, 11, 7, 5, 6, 21, 6, 10, 53, 8, 7, 24, 10, 27,
+    44, 253, 253, 253, 252, 252, 252, 13, 12, 45, 12, 45, 12, 61, 12, 45,
+    44, 173
+};
+
+static const uint8_t s_explodeLenLen[] = { 2, 35, 36, 53, 38, 23 };
+
+static const uint8_t s_explodeDistLen[] = { 2, 20, 53, 230, 247, 151, 248 };
+
+static const int16_t s_explodeLenBase[16] = { 3, 2, 4, 5, 6, 7, 8, 9, 10, 12, 16, 24, 40, 72, 136, 264 };
+
+static const uint8_t s_explodeLenExtra[16] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 3, 4, 5, 6, 7, 8 };
+
+static ExplodeHuffman s_explodeLitCode;
+static ExplodeHuffman s_explodeLenCode;
+static ExplodeHuffman s_explodeDistCode;
+
+static void ExplodeConstruct(ExplodeHuffman* h, const uint8_t* rep, uint32_t n) {
+    int16_t length[256];
+    int32_t symbols = 0;
+
+    for (uint32_t i = 0; i < n; i++) {
+        auto len = rep[i] & 0xF;
+        auto left = (rep[i] >> 4) + 1;
+
+        while (left--) {
+            length[symbols++] = len;
+        }
+    }
+
+    memset(h->count, 0, sizeof(h->count));
+
+    for (int32_t symbol = 0; symbol < symbols; symbol++) {
+        h->count[length[symbol]]++;
+    }
+
+    int16_t offs[EXPLODE_MAX_BITS + 1];
+    offs[1] = 0;
+
+    for (int32_t len = 1; len < EXPLODE_MAX_BITS; len++) {
+        offs[len + 1] = offs[len] + h->count[len];
+    }
+
+    for (int32_t symbol = 0; symbol < symbols; symbol++) {
+        if (length[symbol]) {
+            h->symbol[offs[length[symbol]]++] = symbol;
+        }
+    }
+}
+
+static void ExplodeInitialize() {
+    // Sectors are decompressed on loader threads, so the first ones to get
+    // here wait for the tables to be built instead of racing to build them
+    static int32_t s_initialized = []() {
+        ExplodeConstruct(&s_explodeLitCode, s_explodeLitLen, sizeof(s_explodeLitLen));
+        ExplodeConstruct(&s_explodeLenCode, s_explodeLenLen, sizeof(s_explodeLenLen));
+        ExplodeConstruct(&s_explodeDistCode, s_explodeDistLen, sizeof(s_explodeDistLen));
+
+        return 1;
+    }();
+
+    (void)s_initialized;
+}
+
+static int32_t ExplodeBits(ExplodeState* s, uint32_t need, uint32_t* value) {
+    while (s->bitCount < need) {
+        if (s->in == s->inEnd) {
+            return 0;
+        }
+
+        s->bitBuf |= static_cast<uint32_t>(*s->in++) << s->bitCount;
+        s->bitCount += 8;
+    }
+
+    *value = s->bitBuf & ((1u << need) - 1);
+    s->bitBuf >>= need;
+    s->bitCount -= need;
+
+    return 1;
+}
+
+static int32_t ExplodeDecode(ExplodeState* s, const ExplodeHuffman* h, int32_t* symbol) {
+    // Codes are stored with their bits inverted
+    int32_t code = 0;
+    int32_t first = 0;
+    int32_t index = 0;
+
+    for (int32_t len = 1; len <= EXPLODE_MAX_BITS; len++) {
+        uint32_t bit;
+        if (!ExplodeBits(s, 1, &bit)) {
+            return 0;
+        }
+
+        code |= bit ^ 1;
+
+        auto count = h->count[len];
+        if (code - first < count) {
+            *symbol = h->symbol[index + (code - first)];
+            return 1;
+        }
+
+        index += count;
+        first += count;
+        first <<= 1;
+        code <<= 1;
+    }
+
+    return 0;
+}
+
+int32_t SCompExplode(void* dest, uint32_t* destsize, const void* source, uint32_t sourcesize) {
+    ExplodeInitialize();
+
+    ExplodeState s;
+    s.in = static_cast<const uint8_t*>(source);
+    s.inEnd = s.in + sourcesize;
+    s.bitBuf = 0;
+    s.bitCount = 0;
+    s.out = static_cast<uint8_t*>(dest);
+    s.outStart = s.out;
+    s.outEnd = s.out + *destsize;
+
+    uint32_t lit;
+    uint32_t dict;
+
+    if (!ExplodeBits(&s, 8, &lit) || lit > 1) {
+        return 0;
+    }
+
+    if (!ExplodeBits(&s, 8, &dict) || dict < 4 || dict > 6) {
+        return 0;
+    }
+
+    while (true) {
+        uint32_t isMatch;
+        if (!ExplodeBits(&s, 1, &isMatch)) {
+            return 0;
+        }
+
+        if (isMatch) {
+            int32_t symbol;
+            uint32_t extra;
+
+            if (!ExplodeDecode(&s, &s_explodeLenCode, &symbol) || !ExplodeBits(&s, s_explodeLenExtra[symbol], &extra)) {
+                return 0;
+            }
+
+            uint32_t len = s_explodeLenBase[symbol] + extra;
+
+            // End of stream
+            if (len == 519) {
+                break;
+            }
+
+            auto distBits = len == 2 ? 2 : dict;
+
+            if (!ExplodeDecode(&s, &s_explodeDistCode, &symbol) || !ExplodeBits(&s, distBits, &extra)) {
+                return 0;
+            }
+
+            uint32_t dist = (static_cast<uint32_t>(symbol) << distBits) + extra + 1;
+
+            if (dist > static_cast<uint32_t>(s.out - s.outStart) || len > static_cast<uint32_t>(s.outEnd - s.out)) {
+                return 0;
+            }
+
+            // Matches may overlap the bytes being written
+            auto from = s.out - dist;
+            for (uint32_t i = 0; i < len; i++) {
+                *s.out++ = *from++;
+            }
+        } else {
+            uint32_t value;
+
+            if (lit) {
+                int32_t symbol;
+                if (!ExplodeDecode(&s, &s_explodeLitCode, &symbol)) {
+                    return 0;
+                }
+
+                value = symbol;
+            } else if (!ExplodeBits(&s, 8, &value)) {
+                return 0;
+            }
+
+            if (s.out == s.outEnd) {
+                return 0;
+            }
+
+            *s.out++ = value;
+        }
+    }
+
+    *destsize = s.out - s.outStart;
+
+    return 1;
+}
+
+static int32_t SCompDecompressZlib(void* dest, uint32_t* destsize, const void* source, uint32_t sourcesize) {
+#if defined(WHOA_SCOMP_ZLIB)
+    uLongf len = *destsize;
+
+    if (uncompress(static_cast<Bytef*>(dest), &len, static_cast<const Bytef*>(source), sourcesize) != Z_OK) {
+        return 0;
+    }
+
+    *destsize = len;
+
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+static int32_t SCompDecompressBzip2(void* dest, uint32_t* destsize, const void* source, uint32_t sourcesize) {
+#if defined(WHOA_SCOMP_BZIP2)
+    unsigned int len = *destsize;
+
+    if (BZ2_bzBuffToBuffDecompress(static_cast<char*>(dest), &len, const_cast<char*>(static_cast<const char*>(source)), sourcesize, 0, 0) != BZ_OK) {
+        return 0;
+    }
+
+    *destsize = len;
+
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+int32_t SCompDecompress(void* dest, uint32_t* destsize, const void* source, uint32_t sourcesize) {
+    if (sourcesize == 0) {
+        return 0;
+    }
+
+    // Stored uncompressed
+    if (sourcesize == *destsize) {
+        if (dest != source) {
+            memmove(dest, source, sourcesize);
+        }
+
+        return 1;
+    }
+
+    static const struct {
+        uint8_t mask;
+        int32_t (*decompress)(void*, uint32_t*, const void*, uint32_t);
+    } s_methods[] = {
+        { SCOMP_TYPE_BZIP2,  &SCompDecompressBzip2 },
+        { SCOMP_TYPE_PKWARE, &SCompExplode },
+        { SCOMP_TYPE_ZLIB,   &SCompDecompressZlib },
+    };
+
+    auto mask = *static_cast<const uint8_t*>(source);
+    auto data = static_cast<const uint8_t*>(source) + 1;
+    auto dataSize = sourcesize - 1;
+
+    uint8_t supported = 0;
+    uint32_t passes = 0;
+
+    for (auto& method : s_methods) {
+        supported |= method.mask;
+
+        if (mask & method.mask) {
+            passes++;
+        }
+    }
+
+    // Huffman, ADPCM and sparse streams are only used by sound files
+    if ((mask & ~supported) || passes == 0) {
+        return 0;
+    }
+
+    // Chained methods ping-pong between the destination and a scratch buffer,
+    // arranged so that the final pass lands in the destination
+    uint8_t* scratch = nullptr;
+
+    if (passes > 1) {
+        scratch = static_cast<uint8_t*>(SMemAlloc(*destsize, __FILE__, __LINE__, 0x0));
+    }
+
+    int32_t result = 1;
+    uint32_t outSize = *destsize;
+
+    for (auto& method : s_methods) {
+        if (!(mask & method.mask)) {
+            continue;
+        }
+
+        passes--;
+
+        auto out = (passes & 1) ? scratch : static_cast<uint8_t*>(dest);
+        outSize = *destsize;
+
+        if (!method.decompress(out, &outSize, data, dataSize)) {
+            result = 0;
+            break;
+        }
+
+        data = out;
+        dataSize = outSize;
+    }
+
+    if (scratch) {
+        SMemFree(scratch, __FILE__, __LINE__, 0);
+    }
+
+    if (result) {
+        *destsize = outSize;
+    }
+
+    return result;
+}
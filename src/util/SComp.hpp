@@ -0,0 +1,18 @@
+#ifndef UTIL_S_COMP_HPP
+#define UTIL_S_COMP_HPP
+
+#include <cstdint>
+
+#define SCOMP_TYPE_HUFFMAN      0x01
+#define SCOMP_TYPE_ZLIB         0x02
+#define SCOMP_TYPE_PKWARE       0x08
+#define SCOMP_TYPE_BZIP2        0x10
+#define SCOMP_TYPE_SPARSE       0x20
+#define SCOMP_TYPE_ADPCM_MONO   0x40
+#define SCOMP_TYPE_ADPCM_STEREO 0x80
+
+int32_t SCompDecompress(void* dest, uint32_t* destsize, const void* source, uint32_t sourcesize);
+
+int32_t SCompExplode(void* dest, uint32_t* destsize, const void* source, uint32_t sourcesize);
+
+#endif
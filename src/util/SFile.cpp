@@ -1,78 +1,481 @@
 #include "util/SFile.hpp"
+#include "util/SArchive.hpp"
+#include "util/SComp.hpp"
 #include <cstring>
-#include <limits>
+#include <new>
+#include <storm/Hash.hpp>
 #include <storm/Memory.hpp>
 #include <storm/String.hpp>
+#include <storm/Thread.hpp>
+
+#if defined(WHOA_SYSTEM_MAC) || defined(WHOA_SYSTEM_LINUX)
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static STORM_LIST(SArchive) s_archiveList;
+static SCritSect s_archiveLock;
+static uint16_t s_locale;
+static int32_t s_streamingMode;
+
+#if defined(WHOA_SYSTEM_MAC) || defined(WHOA_SYSTEM_LINUX)
+
+class SFileMapping : public TSHashObject<SFileMapping, HASHKEY_PTR> {
+    public:
+        // Member variables
+        void* m_base;
+        size_t m_size;
+};
+
+static TSHashTable<SFileMapping, HASHKEY_PTR> s_mappingTable;
+static SCritSect s_mappingLock;
+
+static int32_t SFileMap(SFile* file, size_t extraBytes, void** buffer) {
+    if (file->m_size == 0) {
+        return 0;
+    }
+
+    // Extra bytes must fit in the zero filled tail of the last page
+    size_t size = file->m_size;
+    size_t pageSize = sysconf(_SC_PAGESIZE);
+    size_t slack = (pageSize - size % pageSize) % pageSize;
+
+    if (extraBytes > slack) {
+        return 0;
+    }
+
+    // Every load gets its own private mapping, so writes to one buffer stay
+    // out of the file and out of every other load of it. Unwritten pages are
+    // still shared through the page cache.
+    auto base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file->m_fd, 0);
+
+    if (base == MAP_FAILED) {
+        return 0;
+    }
+
+    uint32_t hashval = reinterpret_cast<uintptr_t>(base);
+    HASHKEY_PTR key = { base };
+
+    s_mappingLock.Enter();
+
+    auto mapping = s_mappingTable.New(hashval, key, 0, 0);
+    mapping->m_base = base;
+    mapping->m_size = size;
+
+    s_mappingLock.Leave();
+
+    *buffer = base;
+
+    return 1;
+}
+
+static int32_t SFileUnmap(void* ptr) {
+    uint32_t hashval = reinterpret_cast<uintptr_t>(ptr);
+    HASHKEY_PTR key = { ptr };
+
+    s_mappingLock.Enter();
+
+    auto mapping = s_mappingTable.Ptr(hashval, key);
+
+    if (!mapping) {
+        s_mappingLock.Leave();
+        return 0;
+    }
+
+    auto base = mapping->m_base;
+    auto size = mapping->m_size;
+    s_mappingTable.Delete(mapping);
+
+    s_mappingLock.Leave();
+
+    munmap(base, size);
+
+    return 1;
+}
+
+#endif
+
+static uint32_t SFileSectorBytes(SFile* file, uint32_t sector) {
+    auto start = sector * file->m_sectorSize;
+    auto remaining = static_cast<uint32_t>(file->m_size) - start;
+
+    return remaining < file->m_sectorSize ? remaining : file->m_sectorSize;
+}
+
+static int32_t SFileReadSector(SFile* file, uint32_t sector, uint8_t* dest) {
+    auto bytes = SFileSectorBytes(file, sector);
+
+    uint32_t rawOffset;
+    uint32_t rawBytes;
+
+    if (file->m_flags & MPQ_FILE_SINGLE_UNIT) {
+        rawOffset = 0;
+        rawBytes = file->m_compressedSize;
+    } else if (file->m_sectorOffsets) {
+        rawOffset = file->m_sectorOffsets[sector];
+        rawBytes = file->m_sectorOffsets[sector + 1] - rawOffset;
+    } else {
+        rawOffset = sector * file->m_sectorSize;
+        rawBytes = bytes;
+    }
+
+    if (rawBytes > bytes) {
+        return 0;
+    }
+
+    // Stored sectors are read straight into the destination
+    auto compressed = rawBytes < bytes;
+    auto raw = compressed ? file->m_readBuffer : dest;
+
+    if (!file->m_archive->ReadRaw(file->m_dataOffset + rawOffset, raw, rawBytes)) {
+        return 0;
+    }
+
+    if (file->m_flags & MPQ_FILE_ENCRYPTED) {
+        SArchive::Decrypt(raw, rawBytes, file->m_key + sector);
+    }
+
+    if (!compressed) {
+        return 1;
+    }
+
+    auto outBytes = bytes;
+    int32_t result;
+
+    if (file->m_flags & MPQ_FILE_IMPLODE) {
+        result = SCompExplode(dest, &outBytes, raw, rawBytes);
+    } else {
+        result = SCompDecompress(dest, &outBytes, raw, rawBytes);
+    }
+
+    return result && outBytes == bytes;
+}
+
+static const SArchive::BlockEntry* SFileFindInArchive(SArchive* archive, const char* filename, uint64_t* dataOffset, int32_t* deleted) {
+    auto block = archive->FindFile(filename, s_locale, dataOffset);
+
+    if (!block) {
+        return nullptr;
+    }
+
+    // Patch archives mask out files from lower priority archives with delete markers
+    if (block->flags & MPQ_FILE_DELETE_MARKER) {
+        *deleted = 1;
+        return nullptr;
+    }
+
+    return block;
+}
+
+static int32_t SFileOpenFromArchive(SArchive* archive, const char* filename, const SArchive::BlockEntry* block, uint64_t dataOffset, SFile** file) {
+    auto fileptr = new SFile;
+
+    fileptr->m_filename = strdup(filename);
+    fileptr->m_size = block->fileSize;
+    fileptr->m_archive = archive;
+    fileptr->m_dataOffset = dataOffset;
+    fileptr->m_compressedSize = block->compressedSize;
+    fileptr->m_flags = block->flags;
+
+    if (block->flags & MPQ_FILE_ENCRYPTED) {
+        auto name = filename;
+
+        for (auto ptr = filename; *ptr; ptr++) {
+            if (*ptr == '\\' || *ptr == '/') {
+                name = ptr + 1;
+            }
+        }
+
+        fileptr->m_key = SArchive::HashString(name, MPQ_HASH_FILE_KEY);
+
+        if (block->flags & MPQ_FILE_FIX_KEY) {
+            fileptr->m_key = (fileptr->m_key + block->offset) ^ block->fileSize;
+        }
+    }
+
+    auto compressed = block->flags & (MPQ_FILE_IMPLODE | MPQ_FILE_COMPRESS);
+    uint32_t readBufferSize;
+
+    if (block->flags & MPQ_FILE_SINGLE_UNIT) {
+        fileptr->m_sectorSize = block->fileSize;
+        fileptr->m_sectorCount = block->fileSize ? 1 : 0;
+        readBufferSize = block->compressedSize;
+    } else {
+        fileptr->m_sectorSize = archive->m_sectorSize;
+        fileptr->m_sectorCount = (block->fileSize + archive->m_sectorSize - 1) / archive->m_sectorSize;
+        readBufferSize = archive->m_sectorSize;
+    }
+
+    if (compressed && !(block->flags & MPQ_FILE_SINGLE_UNIT) && fileptr->m_sectorCount) {
+        auto entries = fileptr->m_sectorCount + 1;
+        auto tableBytes = entries * sizeof(uint32_t);
+
+        fileptr->m_sectorOffsets = static_cast<uint32_t*>(SMemAlloc(tableBytes, __FILE__, __LINE__, 0x0));
+
+        int32_t valid = archive->ReadRaw(dataOffset, fileptr->m_sectorOffsets, tableBytes);
+
+        if (valid && (block->flags & MPQ_FILE_ENCRYPTED)) {
+            SArchive::Decrypt(fileptr->m_sectorOffsets, tableBytes, fileptr->m_key - 1);
+        }
+
+        for (uint32_t i = 0; valid && i < fileptr->m_sectorCount; i++) {
+            valid = fileptr->m_sectorOffsets[i] <= fileptr->m_sectorOffsets[i + 1];
+        }
+
+        if (!valid || fileptr->m_sectorOffsets[0] < tableBytes || fileptr->m_sectorOffsets[entries - 1] > block->compressedSize) {
+            SFile::Close(fileptr);
+            return 0;
+        }
+    }
+
+    if (compressed && readBufferSize) {
+        fileptr->m_readBuffer = static_cast<uint8_t*>(SMemAlloc(readBufferSize, __FILE__, __LINE__, 0x0));
+    }
+
+    *file = fileptr;
+
+    return 1;
+}
 
 // TODO Proper implementation
 int32_t SFile::Close(SFile* file) {
-    delete file->m_filename;
+    free(const_cast<char*>(file->m_filename));
 
-    file->m_stream->close();
-    delete file->m_stream;
+    if (file->m_stream) {
+        file->m_stream->close();
+        delete file->m_stream;
+    }
+
+#if defined(WHOA_SYSTEM_MAC) || defined(WHOA_SYSTEM_LINUX)
+    if (file->m_fd >= 0) {
+        close(file->m_fd);
+    }
+#endif
+
+    if (file->m_sectorOffsets) {
+        SMemFree(file->m_sectorOffsets, __FILE__, __LINE__, 0);
+    }
+
+    if (file->m_sectorBuffer) {
+        SMemFree(file->m_sectorBuffer, __FILE__, __LINE__, 0);
+    }
+
+    if (file->m_readBuffer) {
+        SMemFree(file->m_readBuffer, __FILE__, __LINE__, 0);
+    }
 
     delete file;
 
     return 1;
 }
 
+int32_t SFile::CloseArchive(SArchive* archive) {
+    s_archiveLock.Enter();
+    s_archiveList.UnlinkNode(archive);
+    s_archiveLock.Leave();
+
+    archive->~SArchive();
+    SMemFree(archive, __FILE__, __LINE__, 0);
+
+    return 1;
+}
+
+void SFile::EnableStreamingMode(int32_t enable) {
+    s_streamingMode = enable;
+}
+
+// Returns 1 when the file is read straight off local disk, or 2 when it's
+// served from an archive that streaming mode may still be filling in. Without
+// streaming mode everything is local.
+int32_t SFile::FileIsLocal(SFile* file, uint32_t flags) {
+    if (!s_streamingMode || !file->m_archive) {
+        return 1;
+    }
+
+    return 2;
+}
+
 // TODO Proper implementation
 size_t SFile::GetFileSize(SFile* file, size_t* filesizeHigh) {
     return file->m_size;
 }
 
-int32_t SFile::IsStreamingMode() {
+// Files inside an archive report the archive's modification time
+int32_t SFile::GetFileTime(SFile* file, uint64_t* time) {
+#if defined(WHOA_SYSTEM_MAC) || defined(WHOA_SYSTEM_LINUX)
+    struct stat info;
+
+    if (file->m_archive) {
+        char path[STORM_MAX_PATH];
+        SStrCopy(path, file->m_archive->m_filename, sizeof(path));
+
+        for (auto ptr = path; *ptr; ptr++) {
+            if (*ptr == '\\') {
+                *ptr = '/';
+            }
+        }
+
+        if (stat(path, &info) != 0) {
+            return 0;
+        }
+    } else if (file->m_fd < 0 || fstat(file->m_fd, &info) != 0) {
+        return 0;
+    }
+
+    *time = info.st_mtime;
+
+    return 1;
+#else
     // TODO
     return 0;
+#endif
+}
+
+uint16_t SFile::GetLocale() {
+    return s_locale;
+}
+
+// Loose files on POSIX systems can be read directly from their descriptor,
+// starting at the returned offset
+int32_t SFile::GetNativeHandle(SFile* file, int32_t* fd, uint64_t* offset) {
+#if defined(WHOA_SYSTEM_MAC) || defined(WHOA_SYSTEM_LINUX)
+    if (!file->m_archive && file->m_fd >= 0) {
+        *fd = file->m_fd;
+        *offset = file->m_position;
+
+        return 1;
+    }
+#endif
+
+    return 0;
+}
+
+int32_t SFile::IsStreamingMode() {
+    return s_streamingMode;
 }
 
 // TODO Proper implementation
 int32_t SFile::Load(SArchive* archive, const char* filename, void** buffer, size_t* bytes, size_t extraBytes, uint32_t flags, SOVERLAPPED* overlapped) {
-    auto pathLen = SStrLen(filename);
-    char path[STORM_MAX_PATH];
-    SStrCopy(path, filename, sizeof(path));
+    SFile* file;
 
-    for (int32_t i = 0; i < pathLen; ++i) {
-        if (path[i] == '\\') {
-            path[i] = '/';
-        }
+    if (!SFile::OpenEx(archive, filename, flags, &file)) {
+        return 0;
     }
 
-    std::ifstream file (path, std::ios::in | std::ios::binary | std::ios::ate);
-    size_t size;
-    char* data;
-
-    if (file.is_open()) {
-        size = static_cast<size_t>(file.tellg());
+    size_t size = SFile::GetFileSize(file, nullptr);
 
-        if (bytes) {
-            *bytes = size;
-        }
+    if (bytes) {
+        *bytes = size;
+    }
 
-        data = new char[size + extraBytes];
+#if defined(WHOA_SYSTEM_MAC) || defined(WHOA_SYSTEM_LINUX)
+    // Loose files are mapped copy on write, a fresh mapping per load that
+    // SFile::Unload unmaps
+    if (!file->m_archive && SFileMap(file, extraBytes, buffer)) {
+        SFile::Close(file);
+        return 1;
+    }
+#endif
 
-        file.seekg(0, std::ios::beg);
-        file.read(data, size);
-        file.close();
+    auto data = static_cast<char*>(SMemAlloc(size + extraBytes, __FILE__, __LINE__, 0x0));
 
-        if (extraBytes) {
-            memset(data + size, 0, extraBytes);
-        }
+    size_t bytesRead = 0;
+    auto result = SFile::Read(file, data, size, &bytesRead, nullptr, nullptr);
 
-        *buffer = data;
+    SFile::Close(file);
 
-        return 1;
-    } else {
+    if (!result || bytesRead != size) {
+        SMemFree(data, __FILE__, __LINE__, 0);
         return 0;
     }
+
+    if (extraBytes) {
+        memset(data + size, 0, extraBytes);
+    }
+
+    *buffer = data;
+
+    return 1;
 }
 
 int32_t SFile::Open(const char* filename, SFile** file) {
     return SFile::OpenEx(nullptr, filename, 0, file);
 }
 
+int32_t SFile::OpenArchive(const char* filename, int32_t priority, uint32_t flags, SArchive** archive) {
+    SArchive::InitializeCryptTable();
+
+    auto m = SMemAlloc(sizeof(SArchive), __FILE__, __LINE__, 0x0);
+    auto archiveptr = new (m) SArchive();
+
+    if (!archiveptr->Open(filename)) {
+        archiveptr->~SArchive();
+        SMemFree(m, __FILE__, __LINE__, 0);
+
+        *archive = nullptr;
+
+        return 0;
+    }
+
+    archiveptr->m_priority = priority;
+
+    // Keep the list sorted from highest to lowest priority so patch archives
+    // are searched before the archives they patch
+    s_archiveLock.Enter();
+
+    auto next = s_archiveList.Head();
+    while (next && next->m_priority >= priority) {
+        next = s_archiveList.Next(next);
+    }
+
+    if (next) {
+        s_archiveList.LinkNode(archiveptr, 2, next);
+    } else {
+        s_archiveList.LinkToTail(archiveptr);
+    }
+
+    s_archiveLock.Leave();
+
+    *archive = archiveptr;
+
+    return 1;
+}
+
 // TODO Proper implementation
 int32_t SFile::OpenEx(SArchive* archive, const char* filename, uint32_t flags, SFile** file) {
+    int32_t deleted = 0;
+    uint64_t dataOffset;
+    const SArchive::BlockEntry* block = nullptr;
+
+    if (archive) {
+        block = SFileFindInArchive(archive, filename, &dataOffset, &deleted);
+
+        return block && SFileOpenFromArchive(archive, filename, block, dataOffset, file);
+    }
+
+    // Only the lookup holds the lock; reading the sector table leaves other
+    // threads free to find their files
+    s_archiveLock.Enter();
+
+    for (auto node = s_archiveList.Head(); node && !deleted; node = s_archiveList.Next(node)) {
+        block = SFileFindInArchive(node, filename, &dataOffset, &deleted);
+
+        if (block) {
+            archive = node;
+            break;
+        }
+    }
+
+    s_archiveLock.Leave();
+
+    if (block) {
+        return SFileOpenFromArchive(archive, filename, block, dataOffset, file);
+    }
+
+    // Fall back to loose files on disk
     auto pathLen = SStrLen(filename);
     char path[STORM_MAX_PATH];
     SStrCopy(path, filename, sizeof(path));
@@ -83,27 +486,57 @@ int32_t SFile::OpenEx(SArchive* archive, const char* filename, uint32_t flags, S
         }
     }
 
+#if defined(WHOA_SYSTEM_MAC) || defined(WHOA_SYSTEM_LINUX)
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+
+    struct stat info;
+
+    if (fd < 0 || fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+        if (fd >= 0) {
+            close(fd);
+        }
+
+        *file = nullptr;
+        return 0;
+    }
+
     SFile* fileptr = new SFile;
 
     fileptr->m_filename = strdup(filename);
-
+    fileptr->m_fd = fd;
+    fileptr->m_size = info.st_size;
+#else
     std::ifstream* stream = new std::ifstream(path, std::ios::in | std::ios::binary | std::ios::ate);
 
     if (!stream->is_open()) {
+        delete stream;
         *file = nullptr;
         return 0;
     }
 
-    stream->seekg(0, std::ios::beg);
+    SFile* fileptr = new SFile;
 
-    stream->ignore(std::numeric_limits<std::streamsize>::max());
-    std::streamsize size = stream->gcount();
-    stream->clear();
+    fileptr->m_filename = strdup(filename);
 
+    std::streamsize size = stream->tellg();
     stream->seekg(0, std::ios::beg);
 
     fileptr->m_stream = stream;
     fileptr->m_size = size;
+#endif
+
+    *file = fileptr;
+
+    return 1;
+}
+
+// Wraps a block already in memory, which must outlive the file, so readers
+// written against SFile can decode it without going back to disk
+int32_t SFile::OpenMemory(const void* data, size_t size, SFile** file) {
+    SFile* fileptr = new SFile;
+
+    fileptr->m_memory = static_cast<const uint8_t*>(data);
+    fileptr->m_size = size;
 
     *file = fileptr;
 
@@ -112,16 +545,132 @@ int32_t SFile::OpenEx(SArchive* archive, const char* filename, uint32_t flags, S
 
 // TODO Proper implementation
 int32_t SFile::Read(SFile* file, void* buffer, size_t bytestoread, size_t* bytesread, SOVERLAPPED* overlapped, TASYNCPARAMBLOCK* asyncparam) {
-    file->m_stream->read((char*)buffer, bytestoread);
+    if (file->m_memory) {
+        auto available = static_cast<uint32_t>(file->m_size) - file->m_position;
+        auto bytes = bytestoread < available ? static_cast<uint32_t>(bytestoread) : available;
+
+        memcpy(buffer, file->m_memory + file->m_position, bytes);
+        file->m_position += bytes;
+
+        if (bytesread) {
+            *bytesread = bytes;
+        }
+
+        return 1;
+    }
+
+    if (!file->m_archive) {
+#if defined(WHOA_SYSTEM_MAC) || defined(WHOA_SYSTEM_LINUX)
+        size_t total = 0;
+
+        while (total < bytestoread) {
+            auto result = pread(file->m_fd, static_cast<char*>(buffer) + total, bytestoread - total, file->m_position + total);
+
+            if (result < 0 && errno == EINTR) {
+                continue;
+            }
+
+            if (result <= 0) {
+                break;
+            }
+
+            total += result;
+        }
+
+        file->m_position += total;
+
+        if (bytesread) {
+            *bytesread = total;
+        }
+#else
+        file->m_stream->read((char*)buffer, bytestoread);
+
+        if (bytesread) {
+            *bytesread = file->m_stream->gcount();
+        }
+#endif
+
+        return 1;
+    }
+
+    auto available = static_cast<uint32_t>(file->m_size) - file->m_position;
+    auto remaining = bytestoread < available ? static_cast<uint32_t>(bytestoread) : available;
+    auto out = static_cast<uint8_t*>(buffer);
+    int32_t result = 1;
+
+    while (remaining) {
+        auto sector = file->m_position / file->m_sectorSize;
+        auto sectorOffset = file->m_position % file->m_sectorSize;
+        auto sectorBytes = SFileSectorBytes(file, sector);
+        auto chunk = sectorBytes - sectorOffset;
+
+        if (chunk > remaining) {
+            chunk = remaining;
+        }
+
+        if (sectorOffset == 0 && chunk == sectorBytes) {
+            // Whole sectors decode directly into the caller's buffer
+            if (!SFileReadSector(file, sector, out)) {
+                result = 0;
+                break;
+            }
+        } else {
+            if (file->m_sectorIndex != sector) {
+                if (!file->m_sectorBuffer) {
+                    file->m_sectorBuffer = static_cast<uint8_t*>(SMemAlloc(file->m_sectorSize, __FILE__, __LINE__, 0x0));
+                }
+
+                if (!SFileReadSector(file, sector, file->m_sectorBuffer)) {
+                    file->m_sectorIndex = 0xFFFFFFFF;
+                    result = 0;
+                    break;
+                }
+
+                file->m_sectorIndex = sector;
+            }
+
+            memcpy(out, file->m_sectorBuffer + sectorOffset, chunk);
+        }
+
+        out += chunk;
+        remaining -= chunk;
+        file->m_position += chunk;
+    }
 
     if (bytesread) {
-        *bytesread = file->m_stream->gcount();
+        *bytesread = out - static_cast<uint8_t*>(buffer);
+    }
+
+    return result;
+}
+
+int32_t SFile::SetFilePointer(SFile* file, uint64_t offset) {
+    if (offset > static_cast<uint64_t>(file->m_size)) {
+        return 0;
+    }
+
+    file->m_position = offset;
+
+    if (file->m_stream) {
+        file->m_stream->clear();
+        file->m_stream->seekg(offset, std::ios::beg);
     }
 
     return 1;
 }
 
+// Archive lookups take the entry for this locale over the neutral one
+void SFile::SetLocale(uint16_t locale) {
+    s_locale = locale;
+}
+
 int32_t SFile::Unload(void* ptr) {
+#if defined(WHOA_SYSTEM_MAC) || defined(WHOA_SYSTEM_LINUX)
+    if (SFileUnmap(ptr)) {
+        return 1;
+    }
+#endif
+
     SMemFree(ptr, __FILE__, __LINE__, 0);
     return 1;
 }
@@ -14,18 +14,42 @@ class SFile {
     public:
         // Static functions
         static int32_t Close(SFile*);
+        static int32_t CloseArchive(SArchive*);
+        static void EnableStreamingMode(int32_t);
+        static int32_t FileIsLocal(SFile*, uint32_t);
         static size_t GetFileSize(SFile*, size_t*);
+        static int32_t GetFileTime(SFile*, uint64_t*);
+        static uint16_t GetLocale();
+        static int32_t GetNativeHandle(SFile*, int32_t*, uint64_t*);
         static int32_t IsStreamingMode(void);
         static int32_t Load(SArchive*, const char*, void**, size_t*, size_t, uint32_t, SOVERLAPPED*);
         static int32_t Open(const char*, SFile**);
+        static int32_t OpenArchive(const char*, int32_t, uint32_t, SArchive**);
         static int32_t OpenEx(SArchive*, const char*, uint32_t, SFile**);
+        static int32_t OpenMemory(const void*, size_t, SFile**);
         static int32_t Read(SFile*, void*, size_t, size_t*, SOVERLAPPED*, TASYNCPARAMBLOCK*);
+        static int32_t SetFilePointer(SFile*, uint64_t);
+        static void SetLocale(uint16_t);
         static int32_t Unload(void*);
 
         // Member variables
-        const char* m_filename;
-        std::ifstream* m_stream; // TODO Proper implementation
-        std::streamsize m_size; // TODO Proper implementation
+        const char* m_filename = nullptr;
+        std::ifstream* m_stream = nullptr; // TODO Proper implementation
+        std::streamsize m_size = 0; // TODO Proper implementation
+        SArchive* m_archive = nullptr;
+        uint64_t m_dataOffset = 0;
+        uint32_t m_compressedSize = 0;
+        uint32_t m_flags = 0;
+        uint32_t m_key = 0;
+        uint32_t m_position = 0;
+        uint32_t m_sectorSize = 0;
+        uint32_t m_sectorCount = 0;
+        uint32_t* m_sectorOffsets = nullptr;
+        uint8_t* m_sectorBuffer = nullptr;
+        uint32_t m_sectorIndex = 0xFFFFFFFF;
+        uint8_t* m_readBuffer = nullptr;
+        int32_t m_fd = -1;
+        const uint8_t* m_memory = nullptr;
 };
 
 #endif
@@ -0,0 +1,20 @@
+#include "util/System.hpp"
+
+#if defined(WHOA_SYSTEM_WIN)
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+uint32_t OsGetProcessorCount() {
+#if defined(WHOA_SYSTEM_WIN)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+
+    return info.dwNumberOfProcessors;
+#else
+    auto count = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return count > 0 ? static_cast<uint32_t>(count) : 1;
+#endif
+}
@@ -0,0 +1,8 @@
+#ifndef UTIL_SYSTEM_HPP
+#define UTIL_SYSTEM_HPP
+
+#include <cstdint>
+
+uint32_t OsGetProcessorCount();
+
+#endif
@@ -0,0 +1,379 @@
+#include "catch.hpp"
+#include "AsyncFixture.hpp"
+#include "../util/MpqFixture.hpp"
+#include "async/AsyncFile.hpp"
+#include "async/AsyncFileRead.hpp"
+#include "async/CAsyncObject.hpp"
+#include "util/SFile.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+#include <common/Time.hpp>
+#include <storm/String.hpp>
+
+struct AsyncReadRequest {
+    std::chrono::steady_clock::time_point queued;
+    double latency;
+    int32_t* completed;
+};
+
+static void AsyncReadPostload(void* param) {
+    auto request = static_cast<AsyncReadRequest*>(param);
+
+    request->latency = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - request->queued).count();
+    (*request->completed)++;
+}
+
+TEST_CASE("AsyncFileReadObject throughput", "[async][!benchmark]") {
+    const uint32_t fileCount = 4000;
+    const uint32_t fileSize = 16 * 1024;
+
+    std::vector<uint8_t> contents(fileSize);
+    char path[STORM_MAX_PATH];
+
+    for (uint32_t i = 0; i < fileCount; i++) {
+        SStrPrintf(path, sizeof(path), "AsyncFileReadTest_%02u_%04u.bin", i % 32, i);
+
+        for (uint32_t j = 0; j < fileSize; j++) {
+            contents[j] = (i + j) & 0xFF;
+        }
+
+        auto file = fopen(path, "wb");
+        fwrite(contents.data(), 1, fileSize, file);
+        fclose(file);
+    }
+
+    AsyncFileReadTestStart();
+
+    std::vector<AsyncReadRequest> requests(fileCount);
+    std::vector<CAsyncObject*> objects(fileCount);
+    std::vector<uint8_t> buffers(static_cast<size_t>(fileCount) * fileSize);
+    int32_t completed = 0;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (uint32_t i = 0; i < fileCount; i++) {
+        SStrPrintf(path, sizeof(path), "AsyncFileReadTest_%02u_%04u.bin", i % 32, i);
+
+        auto object = AsyncFileReadAllocObject();
+        REQUIRE(SFile::Open(path, &object->file));
+
+        object->buffer = &buffers[static_cast<size_t>(i) * fileSize];
+        object->size = fileSize;
+        object->userArg = &requests[i];
+        object->userPostloadCallback = &AsyncReadPostload;
+
+        requests[i].queued = std::chrono::steady_clock::now();
+        requests[i].completed = &completed;
+
+        objects[i] = object;
+        AsyncFileReadObject(object, 0);
+    }
+
+    while (completed < static_cast<int32_t>(fileCount)) {
+        AsyncFileReadPollHandler(nullptr, nullptr);
+    }
+
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<double> latencies;
+    for (auto& request : requests) {
+        latencies.push_back(request.latency);
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+
+    WARN(
+        fileCount << " reads of " << fileSize << " bytes in " << elapsed << " s ("
+        << (fileCount * static_cast<double>(fileSize) / (1024.0 * 1024.0)) / elapsed << " MB/s, "
+        << fileCount / elapsed << " reads/s); latency p50 " << latencies[fileCount / 2]
+        << " ms, p99 " << latencies[fileCount * 99 / 100] << " ms, max " << latencies.back() << " ms"
+    );
+
+    for (uint32_t i = 0; i < fileCount; i++) {
+        auto buffer = &buffers[static_cast<size_t>(i) * fileSize];
+        REQUIRE(buffer[0] == (i & 0xFF));
+        REQUIRE(buffer[fileSize - 1] == ((i + fileSize - 1) & 0xFF));
+
+        AsyncFileReadDestroyObject(objects[i]);
+
+        SStrPrintf(path, sizeof(path), "AsyncFileReadTest_%02u_%04u.bin", i % 32, i);
+        remove(path);
+    }
+}
+
+struct StreamingReadRequest {
+    int32_t* completed;
+    int32_t completedBefore;
+};
+
+static void StreamingReadPostload(void* param) {
+    auto request = static_cast<StreamingReadRequest*>(param);
+
+    request->completedBefore = *request->completed;
+    (*request->completed)++;
+}
+
+TEST_CASE("AsyncFileReadObject streaming queues", "[async]") {
+    const uint32_t textureCount = 128;
+    const uint32_t textureSize = 128 * 1024;
+    const uint32_t geometrySize = 2048;
+
+    std::vector<std::vector<uint8_t>> textureSectors;
+    for (uint32_t i = 0; i < textureSize / 512; i++) {
+        textureSectors.emplace_back(512, static_cast<uint8_t>(i));
+    }
+
+    std::vector<std::vector<uint8_t>> geometrySectors;
+    for (uint32_t i = 0; i < geometrySize / 512; i++) {
+        geometrySectors.emplace_back(512, static_cast<uint8_t>(0xA0 + i));
+    }
+
+    char path[STORM_MAX_PATH];
+
+    MpqFixture fixture;
+    fixture.Add("World\\Geometry.m2", 0, geometrySize, geometrySectors);
+
+    for (uint32_t i = 0; i < textureCount; i++) {
+        SStrPrintf(path, sizeof(path), "World\\Texture%02u.blp", i);
+        fixture.Add(path, 0, textureSize, textureSectors);
+    }
+
+    fixture.Write("AsyncFileReadStreaming.mpq");
+
+    SArchive* archive;
+    REQUIRE(SFile::OpenArchive("AsyncFileReadStreaming.mpq", 0, 0, &archive));
+
+    AsyncFileReadTestStart();
+    SFile::EnableStreamingMode(1);
+
+    CAsyncQueueStats before[NUM_ASYNC_QUEUES];
+    for (int32_t i = 0; i < NUM_ASYNC_QUEUES; i++) {
+        AsyncFileRead::s_asyncQueues[i]->GetStats(&before[i]);
+    }
+
+    int32_t completed = 0;
+    std::vector<StreamingReadRequest> requests(textureCount + 1);
+    std::vector<CAsyncObject*> objects(textureCount + 1);
+    std::vector<uint8_t> buffers(static_cast<size_t>(textureCount) * textureSize + geometrySize);
+
+    for (uint32_t i = 0; i <= textureCount; i++) {
+        auto object = AsyncFileReadAllocObject();
+
+        if (i < textureCount) {
+            SStrPrintf(path, sizeof(path), "World\\Texture%02u.blp", i);
+            object->priority = 200;
+            object->size = textureSize;
+        } else {
+            SStrPrintf(path, sizeof(path), "World\\Geometry.m2");
+            object->priority = 100;
+            object->size = geometrySize;
+        }
+
+        REQUIRE(SFile::OpenEx(nullptr, path, 0, &object->file));
+
+        object->buffer = &buffers[static_cast<size_t>(i) * textureSize];
+        object->userArg = &requests[i];
+        object->userPostloadCallback = &StreamingReadPostload;
+
+        requests[i].completed = &completed;
+        objects[i] = object;
+    }
+
+    // Flood the texture queue, then ask for geometry behind it
+    for (auto object : objects) {
+        AsyncFileReadObject(object, 0);
+    }
+
+    REQUIRE(objects[0]->char24 == 1);
+
+    while (completed < static_cast<int32_t>(textureCount + 1)) {
+        AsyncFileReadPollHandler(nullptr, nullptr);
+        OsSleep(1);
+    }
+
+    // The geometry read has its own worker and doesn't wait for the texture
+    // backlog. Textures read while the geometry worker is being scheduled can
+    // still finish first, so the bound leaves room for slow machines.
+    auto geometry = requests[textureCount];
+    CHECK(geometry.completedBefore < static_cast<int32_t>(textureCount / 4));
+
+    auto geometryBuffer = &buffers[static_cast<size_t>(textureCount) * textureSize];
+    CHECK(geometryBuffer[0] == 0xA0);
+    CHECK(geometryBuffer[geometrySize - 1] == 0xA3);
+
+    CAsyncQueueStats stats[NUM_ASYNC_QUEUES];
+    for (int32_t i = 0; i < NUM_ASYNC_QUEUES; i++) {
+        AsyncFileRead::s_asyncQueues[i]->GetStats(&stats[i]);
+
+        CHECK(stats[i].queued == 0);
+        CHECK(stats[i].inFlight == 0);
+    }
+
+    CHECK(stats[0].completed == before[0].completed);
+    CHECK(stats[1].completed - before[1].completed == 1);
+    CHECK(stats[2].completed - before[2].completed == textureCount);
+
+    for (auto object : objects) {
+        AsyncFileReadDestroyObject(object);
+    }
+
+    SFile::EnableStreamingMode(0);
+    SFile::CloseArchive(archive);
+    remove("AsyncFileReadStreaming.mpq");
+}
+
+static void StreamingReadCount(void* param) {
+    (*static_cast<int32_t*>(param))++;
+}
+
+TEST_CASE("AsyncFileReadObject streaming queues with several workers", "[async]") {
+    const uint32_t threadCount = 4;
+    const uint32_t fileCount = 96;
+    const uint32_t fileSize = 8 * 1024;
+
+    char path[STORM_MAX_PATH];
+
+    MpqFixture fixture;
+
+    for (uint32_t i = 0; i < fileCount; i++) {
+        std::vector<std::vector<uint8_t>> sectors;
+        for (uint32_t j = 0; j < fileSize / 512; j++) {
+            sectors.emplace_back(512, static_cast<uint8_t>(i + j));
+        }
+
+        SStrPrintf(path, sizeof(path), "World\\File%02u.bin", i);
+        fixture.Add(path, 0, fileSize, sectors);
+    }
+
+    fixture.Write("AsyncFileReadWorkers.mpq");
+
+    SArchive* archive;
+    REQUIRE(SFile::OpenArchive("AsyncFileReadWorkers.mpq", 0, 0, &archive));
+
+    AsyncFileReadTestStart();
+    AsyncFileReadTestAddThreads(threadCount);
+    SFile::EnableStreamingMode(1);
+
+    CAsyncQueueStats before[NUM_ASYNC_QUEUES];
+    for (int32_t i = 0; i < NUM_ASYNC_QUEUES; i++) {
+        AsyncFileRead::s_asyncQueues[i]->GetStats(&before[i]);
+    }
+
+    std::vector<int32_t> postCount(fileCount, 0);
+    std::vector<CAsyncObject*> objects(fileCount);
+    std::vector<uint8_t> buffers(static_cast<size_t>(fileCount) * fileSize);
+
+    // Alternate between the texture and geometry queues
+    for (uint32_t i = 0; i < fileCount; i++) {
+        auto object = AsyncFileReadAllocObject();
+
+        SStrPrintf(path, sizeof(path), "World\\File%02u.bin", i);
+        REQUIRE(SFile::OpenEx(nullptr, path, 0, &object->file));
+
+        object->priority = i & 1 ? 200 : 100;
+        object->size = fileSize;
+        object->buffer = &buffers[static_cast<size_t>(i) * fileSize];
+        object->userArg = &postCount[i];
+        object->userPostloadCallback = &StreamingReadCount;
+
+        objects[i] = object;
+    }
+
+    for (auto object : objects) {
+        AsyncFileReadObject(object, 0);
+    }
+
+    auto done = [&]() {
+        return std::all_of(postCount.begin(), postCount.end(), [](int32_t count) { return count > 0; });
+    };
+
+    while (!done()) {
+        AsyncFileReadPollHandler(nullptr, nullptr);
+        OsSleep(1);
+    }
+
+    // Give a read taken by two workers the chance to be posted twice
+    for (uint32_t i = 0; i < 20; i++) {
+        AsyncFileReadPollHandler(nullptr, nullptr);
+        OsSleep(1);
+    }
+
+    for (uint32_t i = 0; i < fileCount; i++) {
+        CHECK(postCount[i] == 1);
+
+        auto buffer = &buffers[static_cast<size_t>(i) * fileSize];
+        CHECK(buffer[0] == static_cast<uint8_t>(i));
+        CHECK(buffer[fileSize - 1] == static_cast<uint8_t>(i + fileSize / 512 - 1));
+    }
+
+    CAsyncQueueStats stats[NUM_ASYNC_QUEUES];
+    for (int32_t i = 0; i < NUM_ASYNC_QUEUES; i++) {
+        AsyncFileRead::s_asyncQueues[i]->GetStats(&stats[i]);
+
+        CHECK(stats[i].queued == 0);
+        CHECK(stats[i].inFlight == 0);
+    }
+
+    CHECK(stats[1].completed - before[1].completed == fileCount / 2);
+    CHECK(stats[2].completed - before[2].completed == fileCount / 2);
+
+    for (auto object : objects) {
+        AsyncFileReadDestroyObject(object);
+    }
+
+    SFile::EnableStreamingMode(0);
+    SFile::CloseArchive(archive);
+    remove("AsyncFileReadWorkers.mpq");
+}
+
+struct ShortReadRequest {
+    int32_t loaded;
+    int32_t failed;
+};
+
+static void ShortReadPostload(void* param) {
+    static_cast<ShortReadRequest*>(param)->loaded++;
+}
+
+static void ShortReadFailed(void* param) {
+    static_cast<ShortReadRequest*>(param)->failed++;
+}
+
+TEST_CASE("AsyncFileReadObject short reads", "[async]") {
+    std::vector<uint8_t> contents(1024, 0x5A);
+
+    auto file = fopen("AsyncFileReadShort.bin", "wb");
+    fwrite(contents.data(), 1, contents.size(), file);
+    fclose(file);
+
+    AsyncFileReadTestStart();
+
+    ShortReadRequest request = {};
+    std::vector<uint8_t> buffer(contents.size() + 512);
+
+    auto object = AsyncFileReadAllocObject();
+    REQUIRE(SFile::Open("AsyncFileReadShort.bin", &object->file));
+
+    // Asks for more than the file holds
+    object->buffer = buffer.data();
+    object->size = buffer.size();
+    object->userArg = &request;
+    object->userPostloadCallback = &ShortReadPostload;
+    object->userFailedCallback = &ShortReadFailed;
+
+    AsyncFileReadObject(object, 0);
+
+    while (!request.loaded && !request.failed) {
+        AsyncFileReadPollHandler(nullptr, nullptr);
+        OsSleep(1);
+    }
+
+    CHECK(request.failed == 1);
+    CHECK(request.loaded == 0);
+    CHECK(object->isFailed);
+
+    AsyncFileReadDestroyObject(object);
+    remove("AsyncFileReadShort.bin");
+}
@@ -0,0 +1,51 @@
+#ifndef TEST_ASYNC_ASYNC_FIXTURE_HPP
+#define TEST_ASYNC_ASYNC_FIXTURE_HPP
+
+#include "async/AsyncFileRead.hpp"
+#include <common/Prop.hpp>
+
+// Brings up all three queues the way streaming mode does, without registering
+// the poll handler, which needs an event context; tests pump
+// AsyncFileReadPollHandler themselves. Reads only reach the net queues while
+// SFile streaming mode is enabled.
+inline void AsyncFileReadTestStart() {
+    static bool s_started;
+
+    if (s_started) {
+        return;
+    }
+
+    AsyncFileRead::s_propContext = PropGetSelectedContext();
+    AsyncFileRead::s_shutdownEvent.Reset();
+
+    for (int32_t i = 0; i < NUM_ASYNC_QUEUES; i++) {
+        auto queue = AsyncFileReadCreateQueue();
+        AsyncFileRead::s_asyncQueues[i] = queue;
+        AsyncFileReadCreateThread(queue, AsyncFileRead::s_asyncQueueNames[i]);
+    }
+
+    AsyncFileRead::s_asyncQueues[2]->int20 = 1;
+
+    s_started = true;
+}
+
+// Tops every queue up to threadCount workers. Workers are never torn down, so
+// tests that run afterwards share them.
+inline void AsyncFileReadTestAddThreads(uint32_t threadCount) {
+    for (int32_t i = 0; i < NUM_ASYNC_QUEUES; i++) {
+        auto queue = AsyncFileRead::s_asyncQueues[i];
+        uint32_t current = 0;
+
+        for (auto thread = AsyncFileRead::s_asyncThreadList.Head(); thread; thread = AsyncFileRead::s_asyncThreadList.Next(thread)) {
+            if (thread->queue == queue) {
+                current++;
+            }
+        }
+
+        for (; current < threadCount; current++) {
+            AsyncFileReadCreateThread(queue, AsyncFileRead::s_asyncQueueNames[i]);
+        }
+    }
+}
+
+#endif
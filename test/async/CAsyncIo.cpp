@@ -0,0 +1,167 @@
+#include "catch.hpp"
+#include "async/CAsyncIo.hpp"
+#include "async/CAsyncObject.hpp"
+#include "util/SFile.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+static void AsyncIoTestRead(int32_t disableRing) {
+    const uint32_t readCount = 32;
+    const uint32_t readSize = 4096;
+
+    auto path = "CAsyncIoTest.bin";
+
+    std::vector<uint8_t> contents(readCount * readSize);
+    for (uint32_t i = 0; i < contents.size(); i++) {
+        contents[i] = static_cast<uint8_t>(i * 7 + i / readSize);
+    }
+
+    auto f = fopen(path, "wb");
+    REQUIRE(f);
+    fwrite(contents.data(), 1, contents.size(), f);
+    fclose(f);
+
+    CAsyncIo::s_disableRing = disableRing;
+
+    CAsyncIo io;
+    REQUIRE(io.Initialize(ASYNC_IO_QUEUE_DEPTH));
+
+    std::vector<CAsyncObject> objects(readCount);
+    std::vector<uint8_t> buffer(contents.size());
+
+    for (uint32_t i = 0; i < readCount; i++) {
+        auto object = &objects[i];
+
+        REQUIRE(SFile::OpenEx(nullptr, path, 0, &object->file));
+        SFile::SetFilePointer(object->file, i * readSize);
+
+        object->buffer = &buffer[i * readSize];
+        object->size = readSize;
+    }
+
+    uint32_t completed = 0;
+    uint32_t maxInFlight = 0;
+
+    for (auto& object : objects) {
+        if (!io.CanSubmit() || !io.Submit(&object)) {
+            REQUIRE(SFile::Read(object.file, object.buffer, object.size, nullptr, nullptr, nullptr));
+            completed++;
+        }
+
+        maxInFlight = std::max(maxInFlight, io.m_inFlight);
+    }
+
+    CAsyncObject* reaped[ASYNC_IO_QUEUE_DEPTH];
+    int32_t results[ASYNC_IO_QUEUE_DEPTH];
+
+    while (completed < readCount) {
+        auto count = io.Reap(reaped, results, ASYNC_IO_QUEUE_DEPTH);
+
+        for (uint32_t i = 0; i < count; i++) {
+            CHECK(results[i]);
+        }
+
+        completed += count;
+
+        if (!count) {
+            io.Wait(100);
+        }
+    }
+
+    CHECK(io.m_inFlight == 0);
+    CHECK(buffer == contents);
+
+#if defined(WHOA_SYSTEM_LINUX)
+    // Every read was queued before any was reaped
+    CHECK(maxInFlight == readCount);
+#endif
+
+    io.Destroy();
+
+    for (auto& object : objects) {
+        SFile::Close(object.file);
+    }
+
+    CAsyncIo::s_disableRing = 0;
+
+    remove(path);
+}
+
+TEST_CASE("CAsyncIo::Submit", "[async]") {
+    SECTION("keeps reads in flight and completes all of them") {
+        AsyncIoTestRead(0);
+    }
+
+    SECTION("keeps reads in flight on reader threads without io_uring") {
+        AsyncIoTestRead(1);
+    }
+}
+
+TEST_CASE("CAsyncIo::Cancel", "[async]") {
+    SECTION("completes every read in flight exactly once") {
+        const uint32_t readCount = 32;
+        const uint32_t readSize = 4096;
+
+        auto path = "CAsyncIoTest.bin";
+
+        std::vector<uint8_t> contents(readCount * readSize, 0xAB);
+
+        auto f = fopen(path, "wb");
+        REQUIRE(f);
+        fwrite(contents.data(), 1, contents.size(), f);
+        fclose(f);
+
+        CAsyncIo::s_disableRing = 1;
+
+        CAsyncIo io;
+        REQUIRE(io.Initialize(ASYNC_IO_QUEUE_DEPTH));
+
+        std::vector<CAsyncObject> objects(readCount);
+        std::vector<uint8_t> buffer(contents.size());
+        std::vector<uint32_t> reapCount(readCount, 0);
+
+        for (uint32_t i = 0; i < readCount; i++) {
+            auto object = &objects[i];
+
+            REQUIRE(SFile::OpenEx(nullptr, path, 0, &object->file));
+            SFile::SetFilePointer(object->file, i * readSize);
+
+            object->buffer = &buffer[i * readSize];
+            object->size = readSize;
+
+            REQUIRE(io.Submit(object));
+        }
+
+        io.Cancel();
+
+        CAsyncObject* reaped[ASYNC_IO_QUEUE_DEPTH];
+        int32_t results[ASYNC_IO_QUEUE_DEPTH];
+
+        while (io.m_inFlight) {
+            auto count = io.Reap(reaped, results, ASYNC_IO_QUEUE_DEPTH);
+
+            for (uint32_t i = 0; i < count; i++) {
+                reapCount[reaped[i] - objects.data()]++;
+            }
+
+            if (!count) {
+                io.Wait(100);
+            }
+        }
+
+        for (auto count : reapCount) {
+            CHECK(count == 1);
+        }
+
+        io.Destroy();
+
+        for (auto& object : objects) {
+            SFile::Close(object.file);
+        }
+
+        CAsyncIo::s_disableRing = 0;
+
+        remove(path);
+    }
+}
@@ -0,0 +1,194 @@
+#include "catch.hpp"
+#include "async/CAsyncObject.hpp"
+#include "async/CAsyncQueue.hpp"
+#include <random>
+#include <thread>
+#include <vector>
+
+struct QueueTestObject {
+    CAsyncObject object;
+    uint32_t thread;
+    uint32_t sequence;
+};
+
+static QueueTestObject* QueueTestGet(CAsyncObject* object) {
+    return reinterpret_cast<QueueTestObject*>(object);
+}
+
+static void QueueTestInit(QueueTestObject* entry, uint8_t priority, uint32_t thread, uint32_t sequence) {
+    entry->object.priority = priority;
+    entry->object.heapIndex = ASYNC_OBJECT_NOT_QUEUED;
+    entry->object.queue = nullptr;
+    entry->thread = thread;
+    entry->sequence = sequence;
+}
+
+TEST_CASE("CAsyncQueue::Link", "[async]") {
+    SECTION("orders by priority, then link order") {
+        CAsyncQueue queue;
+        QueueTestObject entries[6];
+
+        uint8_t priorities[] = { 126, 125, 126, 10, 125, 126 };
+
+        for (uint32_t i = 0; i < 6; i++) {
+            QueueTestInit(&entries[i], priorities[i], 0, i);
+            queue.Link(&entries[i].object, 0);
+        }
+
+        uint32_t expected[] = { 3, 1, 4, 0, 2, 5 };
+
+        for (uint32_t i = 0; i < 6; i++) {
+            REQUIRE(queue.Pop() == &entries[expected[i]].object);
+        }
+
+        REQUIRE(queue.Pop() == nullptr);
+    }
+
+    SECTION("links ahead of equal priorities when front is set") {
+        CAsyncQueue queue;
+        QueueTestObject entries[3];
+
+        QueueTestInit(&entries[0], 126, 0, 0);
+        QueueTestInit(&entries[1], 126, 0, 1);
+        QueueTestInit(&entries[2], 125, 0, 2);
+
+        queue.Link(&entries[0].object, 0);
+        queue.Link(&entries[1].object, 1);
+        queue.Link(&entries[2].object, 1);
+
+        REQUIRE(queue.Pop() == &entries[2].object);
+        REQUIRE(queue.Pop() == &entries[1].object);
+        REQUIRE(queue.Pop() == &entries[0].object);
+    }
+
+    SECTION("relinking an object with a lower priority moves it forward") {
+        CAsyncQueue queue;
+        QueueTestObject entries[64];
+
+        for (uint32_t i = 0; i < 64; i++) {
+            QueueTestInit(&entries[i], 100, 0, i);
+            queue.Link(&entries[i].object, 0);
+        }
+
+        entries[40].object.priority = 50;
+        queue.Link(&entries[40].object, 0);
+
+        REQUIRE(queue.readCount == 64);
+        REQUIRE(queue.Pop() == &entries[40].object);
+        REQUIRE(queue.Pop() == &entries[0].object);
+    }
+
+    SECTION("LinkToHead and Unlink") {
+        CAsyncQueue queue;
+        QueueTestObject entries[16];
+
+        for (uint32_t i = 0; i < 16; i++) {
+            QueueTestInit(&entries[i], i, 0, i);
+            queue.Link(&entries[i].object, 0);
+        }
+
+        queue.LinkToHead(&entries[12].object);
+        REQUIRE(queue.Head() == &entries[12].object);
+
+        queue.Unlink(&entries[12].object);
+        queue.Unlink(&entries[5].object);
+        queue.Unlink(&entries[5].object);
+
+        REQUIRE(entries[5].object.heapIndex == ASYNC_OBJECT_NOT_QUEUED);
+        REQUIRE(queue.readCount == 14);
+
+        for (uint32_t i = 0; i < 16; i++) {
+            if (i == 5 || i == 12) {
+                continue;
+            }
+
+            REQUIRE(queue.Pop() == &entries[i].object);
+        }
+    }
+}
+
+TEST_CASE("CAsyncQueue concurrent link and pop", "[async]") {
+    const uint32_t threadCount = 8;
+    const uint32_t objectCount = 4000;
+
+    CAsyncQueue queue;
+    std::vector<QueueTestObject> entries(threadCount * objectCount);
+
+    // Producers link with random priorities and occasionally bump an object
+    // they already queued, while a consumer drains the queue concurrently
+    std::vector<std::thread> producers;
+
+    for (uint32_t t = 0; t < threadCount; t++) {
+        producers.emplace_back([&queue, &entries, t, objectCount]() {
+            std::mt19937 random(t + 1);
+            uint32_t stamp = 0;
+
+            for (uint32_t i = 0; i < objectCount; i++) {
+                auto entry = &entries[t * objectCount + i];
+                QueueTestInit(entry, 64 + random() % 64, t, stamp++);
+
+                queue.lock.Enter();
+                entry->object.queue = &queue;
+                queue.Link(&entry->object, 0);
+                queue.lock.Leave();
+
+                if (i > 0 && random() % 8 == 0) {
+                    auto earlier = &entries[t * objectCount + random() % i];
+
+                    queue.lock.Enter();
+
+                    if (earlier->object.queue == &queue && earlier->object.priority > 0) {
+                        earlier->object.priority = random() % earlier->object.priority;
+                        earlier->sequence = stamp++;
+                        queue.Link(&earlier->object, 0);
+                    }
+
+                    queue.lock.Leave();
+                }
+            }
+        });
+    }
+
+    uint32_t consumed = 0;
+    std::thread consumer([&queue, &consumed, threadCount, objectCount]() {
+        while (consumed < threadCount * objectCount / 2) {
+            queue.lock.Enter();
+
+            if (auto object = queue.Pop()) {
+                object->queue = nullptr;
+                consumed++;
+            }
+
+            queue.lock.Leave();
+        }
+    });
+
+    for (auto& producer : producers) {
+        producer.join();
+    }
+
+    consumer.join();
+
+    // With producers finished, the rest must drain in priority order and, for
+    // equal priorities, in the order each producer last linked them
+    REQUIRE(queue.readCount == threadCount * objectCount - consumed);
+
+    std::vector<std::vector<int64_t>> lastSequence(256, std::vector<int64_t>(threadCount, -1));
+    int32_t lastPriority = -1;
+
+    while (auto object = queue.Pop()) {
+        auto entry = QueueTestGet(object);
+
+        REQUIRE(object->priority >= lastPriority);
+        lastPriority = object->priority;
+
+        auto& last = lastSequence[object->priority][entry->thread];
+        REQUIRE(static_cast<int64_t>(entry->sequence) > last);
+        last = entry->sequence;
+
+        object->queue = nullptr;
+        consumed++;
+    }
+
+    REQUIRE(consumed == threadCount * objectCount);
+}
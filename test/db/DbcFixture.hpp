@@ -0,0 +1,37 @@
+#ifndef TEST_DB_DBC_FIXTURE_HPP
+#define TEST_DB_DBC_FIXTURE_HPP
+
+#include "../util/MpqFixture.hpp"
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// Adds a WDBC file with the given rows (as raw 32-bit columns) and string
+// block to the fixture
+inline void AddDbc(MpqFixture& fixture, const char* name, uint32_t columnCount, const std::vector<std::vector<uint32_t>>& rows, const std::string& strings) {
+    uint32_t header[5] = {
+        'CBDW',
+        static_cast<uint32_t>(rows.size()),
+        columnCount,
+        columnCount * 4,
+        static_cast<uint32_t>(strings.size())
+    };
+
+    std::vector<uint8_t> data(reinterpret_cast<uint8_t*>(header), reinterpret_cast<uint8_t*>(header) + sizeof(header));
+
+    for (auto& row : rows) {
+        auto bytes = reinterpret_cast<const uint8_t*>(row.data());
+        data.insert(data.end(), bytes, bytes + row.size() * sizeof(uint32_t));
+    }
+
+    data.insert(data.end(), strings.begin(), strings.end());
+
+    std::vector<std::vector<uint8_t>> sectors;
+    for (size_t offset = 0; offset < data.size(); offset += 512) {
+        sectors.emplace_back(data.begin() + offset, data.begin() + std::min(offset + 512, data.size()));
+    }
+
+    fixture.Add(name, 0, data.size(), sectors);
+}
+
+#endif
@@ -0,0 +1,354 @@
+#include "catch.hpp"
+#include "DbcFixture.hpp"
+#include "db/WowClientDB.hpp"
+#include "db/rec/Cfg_ConfigsRec.hpp"
+#include "db/rec/MapRec.hpp"
+#include "util/Locale.hpp"
+#include "util/SFile.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static uint32_t FloatBits(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+// Builds a Map.dbc row: ID, directory, instance type, flags, pvp, name[17],
+// area, description0[17], description1[17], loading screen, minimap scale,
+// corpse map, corpse x/y, time of day, expansion, raid offset, max players
+static std::vector<uint32_t> MakeMapRow(uint32_t id, uint32_t directory, uint32_t name, uint32_t description) {
+    std::vector<uint32_t> row;
+
+    row.push_back(id);
+    row.push_back(directory);
+    row.push_back(id % 5);
+    row.push_back(id * 3);
+    row.push_back(id & 1);
+
+    for (uint32_t i = 0; i < 16; i++) {
+        row.push_back(i == CURRENT_LANGUAGE ? name : 0);
+    }
+    row.push_back(0xFF01CC);
+
+    row.push_back(id + 1000);
+
+    for (uint32_t i = 0; i < 16; i++) {
+        row.push_back(i == CURRENT_LANGUAGE ? description : 0);
+    }
+    row.push_back(0xFF01CC);
+
+    for (uint32_t i = 0; i < 16; i++) {
+        row.push_back(0);
+    }
+    row.push_back(0xFF01CC);
+
+    row.push_back(id + 2000);
+    row.push_back(FloatBits(1.5f));
+    row.push_back(id + 3000);
+    row.push_back(FloatBits(id * 0.25f));
+    row.push_back(FloatBits(id * -0.5f));
+    row.push_back(0);
+    row.push_back(id % 3);
+    row.push_back(7);
+    row.push_back(id % 40);
+
+    return row;
+}
+
+TEST_CASE("WowClientDB::Load", "[db]") {
+    SECTION("decodes rows and resolves strings from a synthetic WDBC") {
+        // Offset 0 is the empty string, as in shipped files
+        std::string strings("\0World\\Maps\\Azeroth\0Eastern Kingdoms\0Kalimdor\0Fly\0", 50);
+
+        std::vector<std::vector<uint32_t>> rows = {
+            MakeMapRow(0, 1, 20, 0),
+            MakeMapRow(1, 1, 37, 46),
+            MakeMapRow(530, 0, 20, 46)
+        };
+
+        REQUIRE(rows[0].size() == MapRec::GetNumColumns());
+
+        MpqFixture fixture;
+        AddDbc(fixture, MapRec::GetFilename(), MapRec::GetNumColumns(), rows, strings);
+        fixture.Write("WowClientDBTest.mpq");
+
+        SArchive* archive;
+        REQUIRE(SFile::OpenArchive("WowClientDBTest.mpq", 0, 0, &archive));
+
+        WowClientDB<MapRec> db;
+        db.Load(__FILE__, __LINE__);
+
+        REQUIRE(db.m_loaded == 1);
+        REQUIRE(db.GetNumRecords() == 3);
+
+        auto record = db.GetRecord(1);
+        REQUIRE(record != nullptr);
+        CHECK(record->m_ID == 1);
+        CHECK(std::string(record->m_directory) == "World\\Maps\\Azeroth");
+        CHECK(record->m_instanceType == 1);
+        CHECK(record->m_flags == 3);
+        CHECK(record->m_pvp == 1);
+        CHECK(std::string(record->m_mapName) == "Kalimdor");
+        CHECK(record->m_areaTableID == 1001);
+        CHECK(std::string(record->m_mapDescription0) == "Fly");
+        CHECK(std::string(record->m_mapDescription1) == "");
+        CHECK(record->m_loadingScreenID == 2001);
+        CHECK(record->m_minimapIconScale == 1.5f);
+        CHECK(record->m_corpseMapID == 3001);
+        CHECK(record->m_corpse[0] == 0.25f);
+        CHECK(record->m_corpse[1] == -0.5f);
+        CHECK(record->m_expansionID == 1);
+        CHECK(record->m_raidOffset == 7);
+        CHECK(record->m_maxPlayers == 1);
+
+        auto last = db.GetRecord(530);
+        REQUIRE(last != nullptr);
+        CHECK(std::string(last->m_directory) == "");
+        CHECK(std::string(last->m_mapName) == "Eastern Kingdoms");
+        CHECK(last->m_maxPlayers == 10);
+
+        CHECK(db.GetRecord(2) == nullptr);
+        CHECK(db.GetRecordByIndex(0)->m_ID == 0);
+
+        SFile::CloseArchive(archive);
+        remove("WowClientDBTest.mpq");
+    }
+
+    SECTION("maps the fields and strings of a record onto its columns") {
+        auto& layout = WowClientDB<MapRec>::GetLayout();
+
+        CHECK_FALSE(layout.canMemcpy);
+        CHECK(layout.canCopy);
+        CHECK(layout.fieldCount == 14);
+        REQUIRE(layout.stringCount == 4);
+        CHECK(layout.stringOffsets[0] == offsetof(MapRec, m_directory));
+        CHECK(layout.stringOffsets[1] == offsetof(MapRec, m_mapName));
+        CHECK(layout.stringOffsets[2] == offsetof(MapRec, m_mapDescription0));
+        CHECK(layout.stringOffsets[3] == offsetof(MapRec, m_mapDescription1));
+        CHECK(layout.stringColumns[1] == (5 + CURRENT_LANGUAGE) * sizeof(uint32_t));
+    }
+
+    SECTION("copies rows that match the record layout") {
+        std::vector<std::vector<uint32_t>> rows;
+        for (uint32_t i = 1; i <= 4; i++) {
+            rows.push_back({ i, i * 10, i & 1, static_cast<uint32_t>(-static_cast<int32_t>(i)) });
+        }
+
+        MpqFixture fixture;
+        AddDbc(fixture, Cfg_ConfigsRec::GetFilename(), Cfg_ConfigsRec::GetNumColumns(), rows, std::string(1, '\0'));
+        fixture.Write("WowClientDBTest.mpq");
+
+        SArchive* archive;
+        REQUIRE(SFile::OpenArchive("WowClientDBTest.mpq", 0, 0, &archive));
+
+        CHECK(WowClientDB<Cfg_ConfigsRec>::GetLayout().canMemcpy);
+        CHECK(WowClientDB<Cfg_ConfigsRec>::GetLayout().stringCount == 0);
+
+        WowClientDB<Cfg_ConfigsRec> db;
+        db.Load(__FILE__, __LINE__);
+
+        REQUIRE(db.GetNumRecords() == 4);
+
+        for (int32_t i = 1; i <= 4; i++) {
+            auto record = db.GetRecord(i);
+            REQUIRE(record != nullptr);
+            CHECK(record->m_realmType == i * 10);
+            CHECK(record->m_playerKillingAllowed == (i & 1));
+            CHECK(record->m_roleplaying == -i);
+        }
+
+        SFile::CloseArchive(archive);
+        remove("WowClientDBTest.mpq");
+    }
+}
+
+static std::vector<std::vector<uint32_t>> MakeConfigRows(const std::vector<int32_t>& ids) {
+    std::vector<std::vector<uint32_t>> rows;
+
+    for (auto id : ids) {
+        rows.push_back({ static_cast<uint32_t>(id), static_cast<uint32_t>(id) * 10, 0, 0 });
+    }
+
+    return rows;
+}
+
+TEST_CASE("WowClientDB::GetRecord", "[db]") {
+    SECTION("indexes compact ID ranges densely") {
+        MpqFixture fixture;
+        AddDbc(fixture, Cfg_ConfigsRec::GetFilename(), Cfg_ConfigsRec::GetNumColumns(), MakeConfigRows({ 5, 6, 8, 11 }), std::string(1, '\0'));
+        fixture.Write("WowClientDBTest.mpq");
+
+        SArchive* archive;
+        REQUIRE(SFile::OpenArchive("WowClientDBTest.mpq", 0, 0, &archive));
+
+        WowClientDB<Cfg_ConfigsRec> db;
+        db.Load(__FILE__, __LINE__);
+
+        CHECK(db.m_idHash == nullptr);
+
+        CHECK(db.GetRecord(8)->m_realmType == 80);
+        CHECK(db.GetRecord(7) == nullptr);
+        CHECK(db.GetRecord(4) == nullptr);
+        CHECK(db.GetRecord(12) == nullptr);
+
+        SFile::CloseArchive(archive);
+        remove("WowClientDBTest.mpq");
+    }
+
+    SECTION("hashes sparse ID ranges") {
+        std::vector<int32_t> ids = { -50, 3, 1000, 70000, 2000000000, 1000 };
+
+        MpqFixture fixture;
+        AddDbc(fixture, Cfg_ConfigsRec::GetFilename(), Cfg_ConfigsRec::GetNumColumns(), MakeConfigRows(ids), std::string(1, '\0'));
+        fixture.Write("WowClientDBTest.mpq");
+
+        SArchive* archive;
+        REQUIRE(SFile::OpenArchive("WowClientDBTest.mpq", 0, 0, &archive));
+
+        WowClientDB<Cfg_ConfigsRec> db;
+        db.Load(__FILE__, __LINE__);
+
+        REQUIRE(db.m_idHash != nullptr);
+
+        CHECK(db.GetRecord(-50)->m_realmType == -500);
+        CHECK(db.GetRecord(3)->m_realmType == 30);
+        CHECK(db.GetRecord(70000)->m_realmType == 700000);
+        CHECK(db.GetRecord(2000000000) == db.GetRecordByIndex(4));
+
+        // Duplicate IDs resolve to the last row, as in the dense index
+        CHECK(db.GetRecord(1000) == db.GetRecordByIndex(5));
+
+        CHECK(db.GetRecord(0) == nullptr);
+        CHECK(db.GetRecord(999) == nullptr);
+        CHECK(db.GetRecord(-51) == nullptr);
+        CHECK(db.GetRecord(2000000001) == nullptr);
+
+        SFile::CloseArchive(archive);
+        remove("WowClientDBTest.mpq");
+    }
+}
+
+TEST_CASE("WowClientDB::Load throughput", "[db][!benchmark]") {
+    const uint32_t recordCount = 50000;
+    const uint32_t iterations = 5;
+
+    std::string strings("\0World\\Maps\\Azeroth\0Eastern Kingdoms\0Kalimdor\0Fly\0", 50);
+
+    std::vector<std::vector<uint32_t>> rows;
+    for (uint32_t i = 0; i < recordCount; i++) {
+        rows.push_back(MakeMapRow(i, 1, 20, 46));
+    }
+
+    MpqFixture fixture;
+    AddDbc(fixture, MapRec::GetFilename(), MapRec::GetNumColumns(), rows, strings);
+    fixture.Write("WowClientDBTest.mpq");
+
+    SArchive* archive;
+    REQUIRE(SFile::OpenArchive("WowClientDBTest.mpq", 0, 0, &archive));
+
+    // Reference: one SFile::Read per column, the way rows used to be read
+    auto start = std::chrono::steady_clock::now();
+
+    for (uint32_t n = 0; n < iterations; n++) {
+        SFile* file;
+        REQUIRE(SFile::OpenEx(nullptr, MapRec::GetFilename(), 0x20000, &file));
+
+        uint32_t header[5];
+        SFile::Read(file, header, sizeof(header), nullptr, nullptr, nullptr);
+
+        uint32_t column;
+        for (uint32_t i = 0; i < recordCount * MapRec::GetNumColumns(); i++) {
+            SFile::Read(file, &column, sizeof(column), nullptr, nullptr, nullptr);
+        }
+
+        SFile::Close(file);
+    }
+
+    auto perField = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+
+    start = std::chrono::steady_clock::now();
+
+    for (uint32_t n = 0; n < iterations; n++) {
+        WowClientDB<MapRec> db;
+        db.Load(__FILE__, __LINE__);
+
+        // WowClientDB has no unload yet, so each pass leaks its tables
+        REQUIRE(db.GetNumRecords() == static_cast<int32_t>(recordCount));
+    }
+
+    auto bulk = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+
+    WARN(
+        recordCount << " Map.dbc rows: per-field reads " << perField << " ms, bulk load "
+        << bulk << " ms (" << perField / bulk << "x)"
+    );
+
+    SFile::CloseArchive(archive);
+    remove("WowClientDBTest.mpq");
+}
+
+TEST_CASE("WowClientDB::GetRecord lookup", "[db][!benchmark]") {
+    const uint32_t recordCount = 20000;
+    const uint32_t lookups = 4000000;
+
+    struct Distribution {
+        const char* name;
+        int32_t stride;
+    };
+
+    Distribution distributions[] = {
+        { "dense", 1 },
+        { "sparse", 97 }
+    };
+
+    for (auto& distribution : distributions) {
+        std::vector<int32_t> ids;
+        for (uint32_t i = 0; i < recordCount; i++) {
+            ids.push_back(1 + i * distribution.stride);
+        }
+
+        MpqFixture fixture;
+        AddDbc(fixture, Cfg_ConfigsRec::GetFilename(), Cfg_ConfigsRec::GetNumColumns(), MakeConfigRows(ids), std::string(1, '\0'));
+        fixture.Write("WowClientDBTest.mpq");
+
+        SArchive* archive;
+        REQUIRE(SFile::OpenArchive("WowClientDBTest.mpq", 0, 0, &archive));
+
+        WowClientDB<Cfg_ConfigsRec> db;
+        db.Load(__FILE__, __LINE__);
+
+        // Dense pointer array the table would have used before hashing
+        auto denseBytes = sizeof(void*) * (db.m_maxID - db.m_minID + 1);
+        auto indexBytes = db.m_idHash ? sizeof(WowClientDB_Base::IdSlot) * db.m_idHashSize : denseBytes;
+
+        // Half the probes hit, half land between IDs or outside the range
+        int64_t sum = 0;
+        auto start = std::chrono::steady_clock::now();
+
+        for (uint32_t i = 0; i < lookups; i++) {
+            auto index = (i * 7919) % recordCount;
+            auto id = i & 1 ? ids[index] : ids[index] + distribution.stride / 2 + 1;
+
+            if (auto record = db.GetRecord(id)) {
+                sum += record->m_realmType;
+            }
+        }
+
+        auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+        WARN(
+            distribution.name << " IDs (" << recordCount << " records, stride " << distribution.stride << "): "
+            << elapsed / lookups << " ns per lookup, index " << indexBytes / 1024 << " KB (dense array "
+            << denseBytes / 1024 << " KB), checksum " << sum
+        );
+
+        SFile::CloseArchive(archive);
+        remove("WowClientDBTest.mpq");
+    }
+}
@@ -0,0 +1,370 @@
+#include "catch.hpp"
+#include "DbcFixture.hpp"
+#include "db/WowClientDB.hpp"
+#include "db/WowClientDB_Cache.hpp"
+#include "db/rec/Cfg_ConfigsRec.hpp"
+#include "db/rec/MapRec.hpp"
+#include "util/Locale.hpp"
+#include "util/SFile.hpp"
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#if defined(WHOA_SYSTEM_MAC) || defined(WHOA_SYSTEM_LINUX)
+#include <sys/stat.h>
+#include <utime.h>
+#endif
+
+static const std::string s_cacheStrings("\0World\\Maps\\Azeroth\0Eastern Kingdoms\0Kalimdor\0Fly\0", 50);
+
+// Map.dbc rows with the directory, name and description columns pointing at
+// the strings above and the remaining columns derived from the ID
+static std::vector<uint32_t> MakeCacheMapRow(uint32_t id) {
+    std::vector<uint32_t> row(MapRec::GetNumColumns(), 0);
+
+    row[0] = id;
+    row[1] = id % 2 ? 1 : 0;
+    row[5 + CURRENT_LANGUAGE] = id % 3 ? 20 : 37;
+    row[22] = id + 1000;
+    row[23 + CURRENT_LANGUAGE] = 46;
+    row[MapRec::GetNumColumns() - 1] = id % 40;
+
+    return row;
+}
+
+static void WriteCacheArchive(const std::vector<uint32_t>& ids) {
+    std::vector<std::vector<uint32_t>> rows;
+    for (auto id : ids) {
+        rows.push_back(MakeCacheMapRow(id));
+    }
+
+    MpqFixture fixture;
+    AddDbc(fixture, MapRec::GetFilename(), MapRec::GetNumColumns(), rows, s_cacheStrings);
+    fixture.Write("WowClientDBCacheTest.mpq");
+}
+
+// Moves the archive's time stamp, as copying or patching the client would
+static void TouchCacheArchive(int64_t seconds) {
+#if defined(WHOA_SYSTEM_MAC) || defined(WHOA_SYSTEM_LINUX)
+    struct stat info;
+    REQUIRE(stat("WowClientDBCacheTest.mpq", &info) == 0);
+
+    struct utimbuf times;
+    times.actime = info.st_atime;
+    times.modtime = info.st_mtime + seconds;
+    REQUIRE(utime("WowClientDBCacheTest.mpq", &times) == 0);
+#endif
+}
+
+static std::vector<uint8_t> ReadCacheImage() {
+    char path[STORM_MAX_PATH];
+    WowClientDB_Cache::GetPath(MapRec::GetFilename(), path, sizeof(path));
+
+    std::ifstream stream(path, std::ios::in | std::ios::binary);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+}
+
+static void WriteCacheImage(std::vector<uint8_t>& image, bool fixChecksum) {
+    if (fixChecksum) {
+        WowClientDB_Cache::Header header;
+        memcpy(&header, image.data(), sizeof(header));
+
+        header.checksum = 0;
+        auto checksum = WowClientDB_Cache::Checksum(&header, sizeof(header), 0x811C9DC5);
+        header.checksum = WowClientDB_Cache::Checksum(&image[sizeof(header)], image.size() - sizeof(header), checksum);
+
+        memcpy(image.data(), &header, sizeof(header));
+    }
+
+    char path[STORM_MAX_PATH];
+    WowClientDB_Cache::GetPath(MapRec::GetFilename(), path, sizeof(path));
+
+    std::ofstream stream(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    stream.write(reinterpret_cast<char*>(image.data()), image.size());
+}
+
+static void CheckMapTable(WowClientDB<MapRec>& db, const std::vector<uint32_t>& ids) {
+    REQUIRE(db.m_loaded == 1);
+    REQUIRE(db.GetNumRecords() == static_cast<int32_t>(ids.size()));
+
+    for (auto id : ids) {
+        auto record = db.GetRecord(id);
+        REQUIRE(record != nullptr);
+        CHECK(record->m_ID == static_cast<int32_t>(id));
+        CHECK(std::string(record->m_directory) == (id % 2 ? "World\\Maps\\Azeroth" : ""));
+        CHECK(std::string(record->m_mapName) == (id % 3 ? "Eastern Kingdoms" : "Kalimdor"));
+        CHECK(std::string(record->m_mapDescription0) == "Fly");
+        CHECK(record->m_areaTableID == static_cast<int32_t>(id + 1000));
+        CHECK(record->m_maxPlayers == static_cast<int32_t>(id % 40));
+    }
+
+    CHECK(db.GetRecord(ids.back() + 1) == nullptr);
+}
+
+static void RemoveCacheFiles() {
+    char path[STORM_MAX_PATH];
+    WowClientDB_Cache::GetPath(MapRec::GetFilename(), path, sizeof(path));
+
+    remove(path);
+    remove("WowClientDBCacheTest.mpq");
+}
+
+TEST_CASE("WowClientDB_Cache", "[db]") {
+    WowClientDB_Cache::SetDirectory("WowClientDBCacheTest");
+    RemoveCacheFiles();
+
+    std::vector<uint32_t> denseIds = { 0, 1, 2, 3, 5, 8, 13 };
+    std::vector<uint32_t> sparseIds = { 1, 400, 9000, 70000 };
+
+    SECTION("writes an image on a miss and serves later loads from it") {
+        for (auto& ids : { denseIds, sparseIds }) {
+            WriteCacheArchive(ids);
+
+            SArchive* archive;
+            REQUIRE(SFile::OpenArchive("WowClientDBCacheTest.mpq", 0, 0, &archive));
+
+            // Tables can't be unloaded yet, so each load below leaks
+            WowClientDB<MapRec> first;
+            first.Load(__FILE__, __LINE__);
+            CheckMapTable(first, ids);
+
+            auto image = ReadCacheImage();
+            REQUIRE(image.size() > sizeof(WowClientDB_Cache::Header));
+
+            WowClientDB<MapRec> second;
+            second.Load(__FILE__, __LINE__);
+            CheckMapTable(second, ids);
+
+            // The hit shares nothing with the first table
+            CHECK(second.m_strings != first.m_strings);
+            CHECK(second.GetRecordByIndex(0) != first.GetRecordByIndex(0));
+
+            // Prove the hit came from the image by editing a record in it
+            WowClientDB_Cache::Header header;
+            memcpy(&header, image.data(), sizeof(header));
+
+            int32_t maxPlayers = 99;
+            memcpy(&image[header.recordsOffset + offsetof(MapRec, m_maxPlayers)], &maxPlayers, sizeof(maxPlayers));
+            WriteCacheImage(image, true);
+
+            WowClientDB<MapRec> edited;
+            edited.Load(__FILE__, __LINE__);
+            CHECK(edited.GetRecordByIndex(0)->m_maxPlayers == 99);
+            CHECK(std::string(edited.GetRecordByIndex(0)->m_mapDescription0) == "Fly");
+
+            SFile::CloseArchive(archive);
+            RemoveCacheFiles();
+        }
+    }
+
+    SECTION("misses when the source table changes") {
+        WriteCacheArchive(denseIds);
+
+        SArchive* archive;
+        REQUIRE(SFile::OpenArchive("WowClientDBCacheTest.mpq", 0, 0, &archive));
+
+        WowClientDB<MapRec> first;
+        first.Load(__FILE__, __LINE__);
+        CheckMapTable(first, denseIds);
+
+        SFile::CloseArchive(archive);
+
+        auto grown = denseIds;
+        grown.push_back(21);
+        WriteCacheArchive(grown);
+
+        REQUIRE(SFile::OpenArchive("WowClientDBCacheTest.mpq", 0, 0, &archive));
+
+        WowClientDB<MapRec> second;
+        second.Load(__FILE__, __LINE__);
+        CheckMapTable(second, grown);
+
+        SFile::CloseArchive(archive);
+        RemoveCacheFiles();
+    }
+
+    SECTION("misses when a row changes but the table's size doesn't") {
+        WriteCacheArchive(denseIds);
+
+        SArchive* archive;
+        REQUIRE(SFile::OpenArchive("WowClientDBCacheTest.mpq", 0, 0, &archive));
+
+        WowClientDB<MapRec> first;
+        first.Load(__FILE__, __LINE__);
+        CheckMapTable(first, denseIds);
+
+        SFile::CloseArchive(archive);
+
+        // Same header, same block in the archive and a newer time stamp; only
+        // a value inside one row differs
+        std::vector<std::vector<uint32_t>> rows;
+        for (auto id : denseIds) {
+            rows.push_back(MakeCacheMapRow(id));
+        }
+
+        rows[2][MapRec::GetNumColumns() - 1] = 33;
+
+        MpqFixture fixture;
+        AddDbc(fixture, MapRec::GetFilename(), MapRec::GetNumColumns(), rows, s_cacheStrings);
+        fixture.Write("WowClientDBCacheTest.mpq");
+        TouchCacheArchive(10);
+
+        REQUIRE(SFile::OpenArchive("WowClientDBCacheTest.mpq", 0, 0, &archive));
+
+        WowClientDB<MapRec> second;
+        second.Load(__FILE__, __LINE__);
+        CHECK(second.GetRecord(denseIds[2])->m_maxPlayers == 33);
+        CHECK(second.GetRecord(denseIds[3])->m_maxPlayers == static_cast<int32_t>(denseIds[3] % 40));
+
+        SFile::CloseArchive(archive);
+        RemoveCacheFiles();
+    }
+
+    SECTION("keeps serving a table whose time stamp alone changes") {
+        WriteCacheArchive(denseIds);
+
+        SArchive* archive;
+        REQUIRE(SFile::OpenArchive("WowClientDBCacheTest.mpq", 0, 0, &archive));
+
+        WowClientDB<MapRec> first;
+        first.Load(__FILE__, __LINE__);
+        CheckMapTable(first, denseIds);
+
+        // An edit only the image has shows which loads it served
+        auto image = ReadCacheImage();
+        WowClientDB_Cache::Header header;
+        memcpy(&header, image.data(), sizeof(header));
+
+        int32_t maxPlayers = 99;
+        memcpy(&image[header.recordsOffset + offsetof(MapRec, m_maxPlayers)], &maxPlayers, sizeof(maxPlayers));
+        WriteCacheImage(image, true);
+
+        SFile::CloseArchive(archive);
+        TouchCacheArchive(10);
+        REQUIRE(SFile::OpenArchive("WowClientDBCacheTest.mpq", 0, 0, &archive));
+
+        WowClientDB<MapRec> second;
+        second.Load(__FILE__, __LINE__);
+        CHECK(second.GetRecordByIndex(0)->m_maxPlayers == 99);
+
+        // The image took the new time stamp, so the next load needs no hash
+        auto stamped = ReadCacheImage();
+        WowClientDB_Cache::Header stampedHeader;
+        memcpy(&stampedHeader, stamped.data(), sizeof(stampedHeader));
+        CHECK(stampedHeader.sourceTime == header.sourceTime + 10);
+
+        WowClientDB<MapRec> third;
+        third.Load(__FILE__, __LINE__);
+        CHECK(third.GetRecordByIndex(0)->m_maxPlayers == 99);
+
+        SFile::CloseArchive(archive);
+        RemoveCacheFiles();
+    }
+
+    SECTION("misses when the record layout changes") {
+        WriteCacheArchive(denseIds);
+
+        SArchive* archive;
+        REQUIRE(SFile::OpenArchive("WowClientDBCacheTest.mpq", 0, 0, &archive));
+
+        WowClientDB<MapRec> first;
+        first.Load(__FILE__, __LINE__);
+
+        // An image written by a build with a different MapRec, edited so the
+        // difference would show if it were used
+        auto image = ReadCacheImage();
+        WowClientDB_Cache::Header header;
+        memcpy(&header, image.data(), sizeof(header));
+
+        auto layoutHash = header.layoutHash;
+        header.layoutHash ^= 1;
+        memcpy(image.data(), &header, sizeof(header));
+
+        int32_t maxPlayers = 99;
+        memcpy(&image[header.recordsOffset + offsetof(MapRec, m_maxPlayers)], &maxPlayers, sizeof(maxPlayers));
+        WriteCacheImage(image, true);
+
+        WowClientDB<MapRec> second;
+        second.Load(__FILE__, __LINE__);
+        CheckMapTable(second, denseIds);
+
+        // The stale image was replaced
+        auto rewritten = ReadCacheImage();
+        memcpy(&header, rewritten.data(), sizeof(header));
+        CHECK(header.layoutHash == layoutHash);
+
+        SFile::CloseArchive(archive);
+        RemoveCacheFiles();
+    }
+
+    SECTION("falls back to the source table when the image is corrupt") {
+        WriteCacheArchive(sparseIds);
+
+        SArchive* archive;
+        REQUIRE(SFile::OpenArchive("WowClientDBCacheTest.mpq", 0, 0, &archive));
+
+        WowClientDB<MapRec> first;
+        first.Load(__FILE__, __LINE__);
+
+        auto image = ReadCacheImage();
+        auto original = image;
+
+        WowClientDB_Cache::Header header;
+        memcpy(&header, image.data(), sizeof(header));
+
+        // A flipped bit in the string block, the index, and a truncated file
+        std::vector<std::vector<uint8_t>> damaged(3, image);
+        damaged[0][header.stringsOffset + 5] ^= 0x10;
+        damaged[1][header.indexOffset + 4] ^= 0x01;
+        damaged[2].resize(image.size() - 8);
+
+        for (auto& bad : damaged) {
+            WriteCacheImage(bad, false);
+
+            WowClientDB<MapRec> db;
+            db.Load(__FILE__, __LINE__);
+            CheckMapTable(db, sparseIds);
+
+            CHECK(ReadCacheImage().size() == original.size());
+        }
+
+        SFile::CloseArchive(archive);
+        RemoveCacheFiles();
+    }
+
+    SECTION("caches tables without strings") {
+        std::vector<std::vector<uint32_t>> rows;
+        for (uint32_t i = 1; i <= 4; i++) {
+            rows.push_back({ i, i * 10, i & 1, 0 });
+        }
+
+        MpqFixture fixture;
+        AddDbc(fixture, Cfg_ConfigsRec::GetFilename(), Cfg_ConfigsRec::GetNumColumns(), rows, std::string(1, '\0'));
+        fixture.Write("WowClientDBCacheTest.mpq");
+
+        SArchive* archive;
+        REQUIRE(SFile::OpenArchive("WowClientDBCacheTest.mpq", 0, 0, &archive));
+
+        for (uint32_t pass = 0; pass < 2; pass++) {
+            WowClientDB<Cfg_ConfigsRec> db;
+            db.Load(__FILE__, __LINE__);
+
+            REQUIRE(db.GetNumRecords() == 4);
+            CHECK(db.GetRecord(3)->m_realmType == 30);
+        }
+
+        char path[STORM_MAX_PATH];
+        WowClientDB_Cache::GetPath(Cfg_ConfigsRec::GetFilename(), path, sizeof(path));
+        CHECK(std::ifstream(path).good());
+        remove(path);
+
+        SFile::CloseArchive(archive);
+        RemoveCacheFiles();
+    }
+
+    WowClientDB_Cache::SetDirectory("");
+}
@@ -0,0 +1,191 @@
+#include "catch.hpp"
+#include "DbcFixture.hpp"
+#include "db/WowClientDB.hpp"
+#include "db/WowClientDB_Loader.hpp"
+#include "db/rec/AchievementRec.hpp"
+#include "db/rec/Cfg_CategoriesRec.hpp"
+#include "db/rec/Cfg_ConfigsRec.hpp"
+#include "db/rec/ChrRacesRec.hpp"
+#include "db/rec/MapRec.hpp"
+#include "util/SFile.hpp"
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Every byte offset into this block is a valid string, so generated columns
+// can be read back as either integers or string references
+static const std::string s_loaderStrings("\0Azeroth\0Kalimdor\0Outland\0Northrend\0", 36);
+
+static std::vector<std::vector<uint32_t>> MakeRows(uint32_t columnCount, uint32_t rowCount, uint32_t seed) {
+    std::vector<std::vector<uint32_t>> rows;
+
+    for (uint32_t i = 0; i < rowCount; i++) {
+        std::vector<uint32_t> row;
+        row.push_back(i * 3 + 1);
+
+        for (uint32_t c = 1; c < columnCount; c++) {
+            row.push_back((i * 31 + c * 7 + seed) % s_loaderStrings.size());
+        }
+
+        rows.push_back(row);
+    }
+
+    return rows;
+}
+
+template <class T>
+static void AddTable(MpqFixture& fixture, uint32_t rowCount, uint32_t seed) {
+    AddDbc(fixture, T::GetFilename(), T::GetNumColumns(), MakeRows(T::GetNumColumns(), rowCount, seed), s_loaderStrings);
+}
+
+struct LoaderTestTables {
+    WowClientDB<AchievementRec> achievement;
+    WowClientDB<Cfg_CategoriesRec> categories;
+    WowClientDB<Cfg_ConfigsRec> configs;
+    WowClientDB<ChrRacesRec> races;
+    WowClientDB<MapRec> map;
+
+    void Each(void (*loadFn)(WowClientDB_Base*, void*), void* param) {
+        loadFn(&this->achievement, param);
+        loadFn(&this->categories, param);
+        loadFn(&this->configs, param);
+        loadFn(&this->races, param);
+        loadFn(&this->map, param);
+    }
+};
+
+static void LoadSerial(WowClientDB_Base* db, void* param) {
+    db->Load(__FILE__, __LINE__);
+}
+
+static void QueueParallel(WowClientDB_Base* db, void* param) {
+    static_cast<WowClientDB_Loader*>(param)->Add(db, __FILE__, __LINE__);
+}
+
+static std::string String(const char* string) {
+    return string ? string : "(null)";
+}
+
+static void CheckSameTables(LoaderTestTables& serial, LoaderTestTables& parallel) {
+    REQUIRE(serial.achievement.GetNumRecords() == parallel.achievement.GetNumRecords());
+    REQUIRE(serial.categories.GetNumRecords() == parallel.categories.GetNumRecords());
+    REQUIRE(serial.configs.GetNumRecords() == parallel.configs.GetNumRecords());
+    REQUIRE(serial.races.GetNumRecords() == parallel.races.GetNumRecords());
+    REQUIRE(serial.map.GetNumRecords() == parallel.map.GetNumRecords());
+
+    for (int32_t i = 0; i < serial.achievement.GetNumRecords(); i++) {
+        auto a = serial.achievement.GetRecordByIndex(i);
+        auto b = parallel.achievement.GetRecord(a->m_ID);
+        REQUIRE(b != nullptr);
+        CHECK(a->m_points == b->m_points);
+        CHECK(String(a->m_title) == String(b->m_title));
+        CHECK(String(a->m_reward) == String(b->m_reward));
+    }
+
+    for (int32_t i = 0; i < serial.categories.GetNumRecords(); i++) {
+        auto a = serial.categories.GetRecordByIndex(i);
+        auto b = parallel.categories.GetRecord(a->m_ID);
+        REQUIRE(b != nullptr);
+        CHECK(a->m_flags == b->m_flags);
+        CHECK(String(a->m_name) == String(b->m_name));
+    }
+
+    for (int32_t i = 0; i < serial.configs.GetNumRecords(); i++) {
+        CHECK(memcmp(serial.configs.GetRecordByIndex(i), parallel.configs.GetRecordByIndex(i), sizeof(Cfg_ConfigsRec)) == 0);
+    }
+
+    for (int32_t i = 0; i < serial.races.GetNumRecords(); i++) {
+        auto a = serial.races.GetRecordByIndex(i);
+        auto b = parallel.races.GetRecord(a->m_ID);
+        REQUIRE(b != nullptr);
+        CHECK(a->m_requiredExpansion == b->m_requiredExpansion);
+        CHECK(String(a->m_clientPrefix) == String(b->m_clientPrefix));
+        CHECK(String(a->m_name) == String(b->m_name));
+        CHECK(String(a->m_facialHairCustomization[1]) == String(b->m_facialHairCustomization[1]));
+    }
+
+    for (int32_t i = 0; i < serial.map.GetNumRecords(); i++) {
+        auto a = serial.map.GetRecordByIndex(i);
+        auto b = parallel.map.GetRecord(a->m_ID);
+        REQUIRE(b != nullptr);
+        CHECK(a->m_areaTableID == b->m_areaTableID);
+        CHECK(a->m_maxPlayers == b->m_maxPlayers);
+        CHECK(String(a->m_directory) == String(b->m_directory));
+        CHECK(String(a->m_mapName) == String(b->m_mapName));
+    }
+}
+
+TEST_CASE("WowClientDB_Loader::Run", "[db]") {
+    SECTION("loads the same tables as a serial load") {
+        MpqFixture fixture;
+        AddTable<AchievementRec>(fixture, 400, 1);
+        AddTable<Cfg_CategoriesRec>(fixture, 20, 2);
+        AddTable<Cfg_ConfigsRec>(fixture, 10, 3);
+        AddTable<ChrRacesRec>(fixture, 12, 4);
+        AddTable<MapRec>(fixture, 150, 5);
+        fixture.Write("WowClientDBLoaderTest.mpq");
+
+        SArchive* archive;
+        REQUIRE(SFile::OpenArchive("WowClientDBLoaderTest.mpq", 0, 0, &archive));
+
+        // WowClientDB has no unload yet, so the tables below are leaked
+        LoaderTestTables serial;
+        serial.Each(&LoadSerial, nullptr);
+
+        REQUIRE(serial.map.m_loaded == 1);
+        REQUIRE(serial.map.m_error[0] == '\0');
+        REQUIRE(serial.achievement.GetNumRecords() == 400);
+
+        for (uint32_t threadCount : { 1u, 2u, 4u, 16u }) {
+            LoaderTestTables parallel;
+            WowClientDB_Loader loader;
+            parallel.Each(&QueueParallel, &loader);
+
+            REQUIRE(loader.Run(threadCount) == nullptr);
+
+            CheckSameTables(serial, parallel);
+        }
+
+        SFile::CloseArchive(archive);
+        remove("WowClientDBLoaderTest.mpq");
+    }
+
+    SECTION("reports the first failure in queue order") {
+        // Cfg_Categories has the wrong column count and Map is missing. Map
+        // is queued after Cfg_Categories, so its error must never win, no
+        // matter which worker fails first.
+        MpqFixture fixture;
+        AddTable<AchievementRec>(fixture, 400, 1);
+        AddDbc(fixture, Cfg_CategoriesRec::GetFilename(), 3, MakeRows(3, 4, 2), s_loaderStrings);
+        AddTable<Cfg_ConfigsRec>(fixture, 10, 3);
+        AddTable<ChrRacesRec>(fixture, 12, 4);
+        fixture.Write("WowClientDBLoaderTest.mpq");
+
+        SArchive* archive;
+        REQUIRE(SFile::OpenArchive("WowClientDBLoaderTest.mpq", 0, 0, &archive));
+
+        LoaderTestTables serial;
+        serial.Each(&LoadSerial, nullptr);
+
+        REQUIRE(serial.categories.m_error[0] != '\0');
+        REQUIRE(serial.map.m_error[0] != '\0');
+        CHECK(std::string(serial.map.m_error) == "Unable to open DBFilesClient\\Map.dbc");
+
+        for (uint32_t run = 0; run < 8; run++) {
+            LoaderTestTables parallel;
+            WowClientDB_Loader loader;
+            parallel.Each(&QueueParallel, &loader);
+
+            auto failed = loader.Run(4);
+
+            REQUIRE(failed == &parallel.categories);
+            CHECK(std::string(failed->m_error) == serial.categories.m_error);
+            CHECK(std::string(parallel.map.m_error) == serial.map.m_error);
+            CHECK(parallel.achievement.m_loaded == 1);
+        }
+
+        SFile::CloseArchive(archive);
+        remove("WowClientDBLoaderTest.mpq");
+    }
+}
@@ -0,0 +1,441 @@
+#include "catch.hpp"
+#include "gx/texture/CTgaFile.hpp"
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <vector>
+
+struct TgaTestImage {
+    uint8_t imageType;
+    uint8_t pixelDepth;
+    uint8_t colorMapDepth;
+    uint8_t descriptor;
+};
+
+// Packs pixels, already in the file's pixel format and order, into packets:
+// repeats for runs of two or more, raw packets for everything else. Packets
+// run across scanlines.
+static std::vector<uint8_t> TgaTestEncodeRle(const std::vector<uint8_t>& pixels, uint32_t bytesPerPixel) {
+    std::vector<uint8_t> rle;
+    uint32_t count = pixels.size() / bytesPerPixel;
+
+    auto same = [&](uint32_t a, uint32_t b) {
+        return memcmp(&pixels[a * bytesPerPixel], &pixels[b * bytesPerPixel], bytesPerPixel) == 0;
+    };
+
+    for (uint32_t i = 0; i < count;) {
+        uint32_t run = 1;
+
+        while (i + run < count && run < 128 && same(i, i + run)) {
+            run++;
+        }
+
+        if (run > 1) {
+            rle.push_back(0x80 | (run - 1));
+            rle.insert(rle.end(), &pixels[i * bytesPerPixel], &pixels[(i + 1) * bytesPerPixel]);
+            i += run;
+            continue;
+        }
+
+        uint32_t raw = 1;
+
+        while (i + raw < count && raw < 128 && !(i + raw + 1 < count && same(i + raw, i + raw + 1))) {
+            raw++;
+        }
+
+        rle.push_back(raw - 1);
+        rle.insert(rle.end(), &pixels[i * bytesPerPixel], &pixels[(i + raw) * bytesPerPixel]);
+        i += raw;
+    }
+
+    return rle;
+}
+
+static std::vector<uint8_t> MakeTga(const TgaTestImage& desc, uint32_t width, uint32_t height, const std::vector<uint8_t>& pixels, const std::vector<uint8_t>& colorMap) {
+    std::vector<uint8_t> tga(18);
+
+    // An image ID ahead of the color map, which the reader has to skip
+    tga[0] = 3;
+    tga[1] = colorMap.empty() ? 0 : 1;
+    tga[2] = desc.imageType;
+
+    uint32_t colorMapLength = colorMap.empty() ? 0 : colorMap.size() / ((desc.colorMapDepth + 7) / 8);
+
+    // The map starts at index 2, so indices below it are outside the map
+    tga[3] = colorMap.empty() ? 0 : 2;
+    tga[5] = colorMapLength & 0xFF;
+    tga[6] = colorMapLength >> 8;
+    tga[7] = desc.colorMapDepth;
+    tga[12] = width & 0xFF;
+    tga[13] = width >> 8;
+    tga[14] = height & 0xFF;
+    tga[15] = height >> 8;
+    tga[16] = desc.pixelDepth;
+    tga[17] = desc.descriptor;
+
+    tga.insert(tga.end(), { 'i', 'd', '!' });
+    tga.insert(tga.end(), colorMap.begin(), colorMap.end());
+
+    if (desc.imageType >= TGA_RLE_COLORMAPPED) {
+        auto rle = TgaTestEncodeRle(pixels, (desc.pixelDepth + 7) / 8);
+        tga.insert(tga.end(), rle.begin(), rle.end());
+    } else {
+        tga.insert(tga.end(), pixels.begin(), pixels.end());
+    }
+
+    return tga;
+}
+
+// Random pixels with plenty of runs, so RLE files get both packet kinds
+static std::vector<uint8_t> MakeTgaPixels(uint32_t bytesPerPixel, uint32_t count, uint32_t seed) {
+    std::mt19937 random(seed);
+    std::vector<uint8_t> pixels;
+
+    while (pixels.size() < count * bytesPerPixel) {
+        uint8_t pixel[4];
+
+        for (auto& byte : pixel) {
+            byte = random();
+        }
+
+        uint32_t run = random() % 3 ? 1 : 1 + random() % 200;
+
+        for (uint32_t i = 0; i < run && pixels.size() < count * bytesPerPixel; i++) {
+            pixels.insert(pixels.end(), pixel, pixel + bytesPerPixel);
+        }
+    }
+
+    return pixels;
+}
+
+static uint32_t TgaTestColor(const unsigned char* src, uint32_t depth, uint32_t alphaBits) {
+    switch (depth) {
+        case 15:
+        case 16: {
+            uint32_t value = src[0] | (src[1] << 8);
+            uint32_t alpha = alphaBits && !(value & 0x8000) ? 0x00000000 : 0xFF000000;
+            auto expand = [](uint32_t v) { return (v << 3) | (v >> 2); };
+
+            return alpha | (expand((value >> 10) & 0x1F) << 16) | (expand((value >> 5) & 0x1F) << 8) | expand(value & 0x1F);
+        }
+
+        case 24:
+            return 0xFF000000 | (src[2] << 16) | (src[1] << 8) | src[0];
+
+        case 32:
+            return (alphaBits ? static_cast<uint32_t>(src[3]) << 24 : 0xFF000000) | (src[2] << 16) | (src[1] << 8) | src[0];
+
+        default:
+            return 0;
+    }
+}
+
+// Reference reader: decodes one pixel at a time straight from the file,
+// following packets and the color map as it goes
+static int32_t TgaTestLock(CTgaFile& image, uint32_t* dst) {
+    auto& header = image.m_header;
+    uint32_t width = header.width;
+    uint32_t height = header.height;
+    uint32_t bytesPerPixel = image.BytesPerPixel();
+    uint32_t depth = header.pixelDepth;
+    uint32_t type = header.imageType & 0x7;
+    auto src = image.m_image;
+
+    uint32_t packetCount = 0;
+    int32_t packetRepeats = 0;
+
+    for (uint32_t i = 0; i < width * height; i++) {
+        if (image.IsRle()) {
+            if (!packetCount) {
+                if (src >= image.m_imageEnd) {
+                    return 0;
+                }
+
+                packetRepeats = *src & 0x80;
+                packetCount = (*src & 0x7F) + 1;
+                src++;
+            } else if (packetRepeats) {
+                src -= bytesPerPixel;
+            }
+
+            packetCount--;
+        }
+
+        if (static_cast<uint32_t>(image.m_imageEnd - src) < bytesPerPixel) {
+            return 0;
+        }
+
+        uint32_t color;
+
+        if (type == TGA_COLORMAPPED) {
+            uint32_t entry = *src - header.colorMapStart;
+            auto entrySize = (header.colorMapDepth + 7) / 8;
+
+            color = *src >= header.colorMapStart && entry < header.colorMapLength
+                ? TgaTestColor(image.m_colorMap + entry * entrySize, header.colorMapDepth, image.m_alphaBits)
+                : 0;
+        } else if (type == TGA_GREY) {
+            uint32_t alpha = depth == 16 && image.m_alphaBits ? static_cast<uint32_t>(src[1]) << 24 : 0xFF000000;
+            color = alpha | (src[0] * 0x010101);
+        } else {
+            color = TgaTestColor(src, depth, image.m_alphaBits);
+        }
+
+        src += bytesPerPixel;
+
+        uint32_t x = i % width;
+        uint32_t y = i / width;
+
+        if (header.descriptor & 0x10) {
+            x = width - 1 - x;
+        }
+
+        if (!(header.descriptor & 0x20)) {
+            y = height - 1 - y;
+        }
+
+        dst[y * width + x] = color;
+    }
+
+    return 1;
+}
+
+TEST_CASE("CTgaFile::Source", "[gx]") {
+    SECTION("rejects unsupported images") {
+        std::vector<uint8_t> pixels(4 * 4 * 4);
+        CTgaFile image;
+
+        auto tga = MakeTga({ TGA_TRUECOLOR, 32, 0, 0x28 }, 4, 4, pixels, {});
+        CHECK(image.Source(tga.data(), tga.size()));
+
+        // Truncated header and pixels
+        CHECK_FALSE(image.Source(tga.data(), 17));
+        CHECK_FALSE(image.Source(tga.data(), tga.size() - 1));
+
+        // Unknown type, odd depth, empty image
+        tga[2] = 4;
+        CHECK_FALSE(image.Source(tga.data(), tga.size()));
+
+        tga[2] = TGA_TRUECOLOR;
+        tga[16] = 12;
+        CHECK_FALSE(image.Source(tga.data(), tga.size()));
+
+        tga[16] = 32;
+        tga[12] = 0;
+        CHECK_FALSE(image.Source(tga.data(), tga.size()));
+
+        // Color mapped without a map
+        auto mapped = MakeTga({ TGA_COLORMAPPED, 8, 24, 0 }, 4, 4, std::vector<uint8_t>(16), {});
+        CHECK_FALSE(image.Source(mapped.data(), mapped.size()));
+    }
+
+    SECTION("fails on truncated RLE data") {
+        auto pixels = MakeTgaPixels(3, 16 * 16, 1);
+        auto tga = MakeTga({ TGA_RLE_TRUECOLOR, 24, 0, 0 }, 16, 16, pixels, {});
+
+        tga.resize(tga.size() - 2);
+
+        std::vector<uint32_t> dst(16 * 16);
+        CTgaFile image;
+
+        REQUIRE(image.Source(tga.data(), tga.size()));
+        CHECK_FALSE(image.Lock(dst.data()));
+        CHECK_FALSE(TgaTestLock(image, dst.data()));
+    }
+}
+
+TEST_CASE("CTgaFile::Lock", "[gx]") {
+    SECTION("decodes known pixels of every kind") {
+        // 2x2 images stored bottom row first: blue first color, 1555 color,
+        // grey with alpha, and color map indices
+        uint32_t expected[] = { 0x80102030, 0xFF405060, 0x00708090, 0xFFA0B0C0 };
+
+        auto tga32 = MakeTga({ TGA_TRUECOLOR, 32, 0, 0x08 }, 2, 2, {
+            0x90, 0x80, 0x70, 0x00, 0xC0, 0xB0, 0xA0, 0xFF,
+            0x30, 0x20, 0x10, 0x80, 0x60, 0x50, 0x40, 0xFF,
+        }, {});
+
+        uint32_t expected16[] = { 0xFFFF0000, 0x0000FF00, 0xFF0000FF, 0xFFFFFFFF };
+
+        auto tga16 = MakeTga({ TGA_TRUECOLOR, 16, 0, 0x01 }, 2, 2, {
+            0x1F, 0x80, 0xFF, 0xFF,
+            0x00, 0xFC, 0xE0, 0x03,
+        }, {});
+
+        uint32_t expectedGrey[] = { 0xFF111111, 0x80EEEEEE, 0x00000000, 0x40777777 };
+
+        auto tgaGrey = MakeTga({ TGA_GREY, 16, 0, 0x28 }, 2, 2, {
+            0x11, 0xFF, 0xEE, 0x80,
+            0x00, 0x00, 0x77, 0x40,
+        }, {});
+
+        // Index 1 is below the map's first entry, so it's black and clear
+        uint32_t expectedMapped[] = { 0xFF0000FF, 0x00000000, 0xFF00FF00, 0xFFFF0000 };
+
+        auto tgaMapped = MakeTga({ TGA_COLORMAPPED, 8, 24, 0x20 }, 2, 2, { 4, 1, 3, 2 }, {
+            0x00, 0x00, 0xFF, 0x00, 0xFF, 0x00, 0xFF, 0x00, 0x00,
+        });
+
+        struct {
+            std::vector<uint8_t>& tga;
+            uint32_t* expected;
+        } cases[] = {
+            { tga32, expected },
+            { tga16, expected16 },
+            { tgaGrey, expectedGrey },
+            { tgaMapped, expectedMapped },
+        };
+
+        for (auto& test : cases) {
+            CTgaFile image;
+            REQUIRE(image.Source(test.tga.data(), test.tga.size()));
+
+            uint32_t dst[4];
+            REQUIRE(image.Lock(dst));
+
+            for (uint32_t i = 0; i < 4; i++) {
+                INFO("type " << static_cast<uint32_t>(image.m_header.imageType) << " depth " << static_cast<uint32_t>(image.m_header.pixelDepth) << " pixel " << i);
+                CHECK(dst[i] == test.expected[i]);
+            }
+        }
+    }
+
+    SECTION("matches the scalar reader for every type, depth and origin") {
+        TgaTestImage kinds[] = {
+            { TGA_TRUECOLOR, 32, 0, 0x08 },
+            { TGA_TRUECOLOR, 32, 0, 0x00 },
+            { TGA_TRUECOLOR, 24, 0, 0x00 },
+            { TGA_TRUECOLOR, 16, 0, 0x01 },
+            { TGA_TRUECOLOR, 15, 0, 0x00 },
+            { TGA_GREY, 8, 0, 0x00 },
+            { TGA_GREY, 16, 0, 0x08 },
+            { TGA_COLORMAPPED, 8, 32, 0x08 },
+            { TGA_COLORMAPPED, 8, 24, 0x00 },
+            { TGA_COLORMAPPED, 8, 16, 0x01 },
+        };
+
+        uint32_t width = 37;
+        uint32_t height = 23;
+        uint32_t seed = 0;
+
+        for (auto kind : kinds) {
+            auto bytesPerPixel = (kind.pixelDepth + 7) / 8u;
+            auto pixels = MakeTgaPixels(bytesPerPixel, width * height, ++seed);
+
+            std::vector<uint8_t> colorMap;
+
+            if (kind.imageType == TGA_COLORMAPPED) {
+                colorMap = MakeTgaPixels((kind.colorMapDepth + 7) / 8, 200, ++seed);
+            }
+
+            for (uint32_t origin = 0; origin < 4; origin++) {
+                kind.descriptor = (kind.descriptor & 0xF) | (origin << 4);
+
+                auto plainKind = kind;
+                auto rleKind = kind;
+                rleKind.imageType += 8;
+
+                auto plain = MakeTga(plainKind, width, height, pixels, colorMap);
+                auto rle = MakeTga(rleKind, width, height, pixels, colorMap);
+
+                CTgaFile plainImage;
+                CTgaFile rleImage;
+
+                REQUIRE(plainImage.Source(plain.data(), plain.size()));
+                REQUIRE(rleImage.Source(rle.data(), rle.size()));
+
+                std::vector<uint32_t> expected(width * height);
+                std::vector<uint32_t> fast(width * height);
+                std::vector<uint32_t> fastRle(width * height);
+                std::vector<uint32_t> scalarRle(width * height);
+
+                REQUIRE(TgaTestLock(plainImage, expected.data()));
+                REQUIRE(plainImage.Lock(fast.data()));
+                REQUIRE(rleImage.Lock(fastRle.data()));
+                REQUIRE(TgaTestLock(rleImage, scalarRle.data()));
+
+                INFO("type " << static_cast<uint32_t>(kind.imageType) << " depth " << static_cast<uint32_t>(kind.pixelDepth) << " descriptor " << static_cast<uint32_t>(kind.descriptor));
+                CHECK(rle.size() < plain.size());
+                CHECK(fast == expected);
+                CHECK(fastRle == expected);
+                CHECK(scalarRle == expected);
+            }
+        }
+    }
+
+    SECTION("places rows by origin") {
+        // One row per value, stored first to last
+        std::vector<uint8_t> pixels = { 1, 1, 1, 2, 2, 2 };
+        std::vector<uint32_t> dst(6);
+
+        auto bottom = MakeTga({ TGA_GREY, 8, 0, 0x00 }, 3, 2, pixels, {});
+        auto top = MakeTga({ TGA_GREY, 8, 0, 0x20 }, 3, 2, pixels, {});
+
+        CTgaFile image;
+
+        REQUIRE(image.Source(bottom.data(), bottom.size()));
+        REQUIRE(image.Lock(dst.data()));
+        CHECK(dst[0] == 0xFF020202);
+        CHECK(dst[5] == 0xFF010101);
+
+        REQUIRE(image.Source(top.data(), top.size()));
+        REQUIRE(image.Lock(dst.data()));
+        CHECK(dst[0] == 0xFF010101);
+        CHECK(dst[5] == 0xFF020202);
+     }
+
+    SECTION("rejects images too large to unpack") {
+        // 65535x65535 at 4 bytes per pixel doesn't fit a 32 bit size
+        std::vector<uint8_t> pixels = { 1, 2, 3, 4 };
+        auto tga = MakeTga({ TGA_RLE_TRUECOLOR, 32, 0, 0x08 }, 0xFFFF, 0xFFFF, pixels, {});
+
+        CTgaFile image;
+
+        REQUIRE(image.Source(tga.data(), tga.size()));
+        CHECK_FALSE(image.Lock(nullptr));
+    }
+}
+
+TEST_CASE("CTgaFile::Lock throughput", "[gx][!benchmark]") {
+    const uint32_t size = 1024;
+    const uint32_t passes = 8;
+
+    TgaTestImage kinds[] = {
+        { TGA_RLE_TRUECOLOR, 32, 0, 0x28 },
+        { TGA_RLE_TRUECOLOR, 24, 0, 0x00 },
+        { TGA_RLE_GREY, 8, 0, 0x00 },
+        { TGA_TRUECOLOR, 32, 0, 0x28 },
+    };
+
+    std::vector<uint32_t> dst(size * size);
+
+    for (auto kind : kinds) {
+        auto pixels = MakeTgaPixels((kind.pixelDepth + 7) / 8, size * size, 1);
+        auto tga = MakeTga(kind, size, size, pixels, {});
+
+        CTgaFile image;
+        REQUIRE(image.Source(tga.data(), tga.size()));
+
+        double mpixels[2];
+
+        for (uint32_t scalar = 0; scalar < 2; scalar++) {
+            auto start = std::chrono::steady_clock::now();
+
+            for (uint32_t pass = 0; pass < passes; pass++) {
+                if (scalar) {
+                    TgaTestLock(image, dst.data());
+                } else {
+                    image.Lock(dst.data());
+                }
+            }
+
+            auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            mpixels[scalar] = static_cast<double>(size) * size * passes / elapsed / 1000000.0;
+        }
+
+        WARN(
+            "type " << static_cast<uint32_t>(kind.imageType) << " depth " << static_cast<uint32_t>(kind.pixelDepth) << ": "
+            << mpixels[0] << " MPixels/s, scalar " << mpixels[1] << " MPixels/s (" << mpixels[0] / mpixels[1] << "x)"
+        );
+    }
+}
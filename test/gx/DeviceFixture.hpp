@@ -0,0 +1,99 @@
+#ifndef TEST_GX_DEVICE_FIXTURE_HPP
+#define TEST_GX_DEVICE_FIXTURE_HPP
+
+#include "gx/CGxDevice.hpp"
+#include "gx/Device.hpp"
+#include "gx/Texture.hpp"
+#include "gx/texture/CGxTex.hpp"
+#include <algorithm>
+#include <map>
+#include <vector>
+
+// Device without a backend. It installs itself as the current device, and
+// texture updates latch every level the way a real upload would, keeping a
+// copy of the texels per CGxTex.
+class CGxDeviceNull : public CGxDevice {
+    public:
+        // Member variables
+        CGxDevice* m_prevDevice;
+        std::map<CGxTex*, std::vector<std::vector<uint8_t>>> m_uploads;
+
+        // Virtual member functions
+        virtual void ITexMarkAsUpdated(CGxTex* texId) {
+            if (texId->m_needsUpdate && texId->m_userFunc) {
+                this->ITexUpload(texId);
+            }
+
+            CGxDevice::ITexMarkAsUpdated(texId);
+        }
+
+        virtual void IRsSendToHw(EGxRenderState) {};
+        virtual void* DeviceWindow() { return nullptr; };
+        virtual void DeviceWM(EGxWM wm, uintptr_t param1, uintptr_t param2) {};
+        virtual void CapsWindowSize(CRect&) {};
+        virtual void CapsWindowSizeInScreenCoords(CRect& dst) {};
+        virtual void PoolSizeSet(CGxPool*, uint32_t) {};
+        virtual void IShaderCreate(CGxShader*) {};
+        virtual int32_t StereoEnabled() { return 0; };
+
+        virtual void TexDestroy(CGxTex* texId) {
+            this->m_uploads.erase(texId);
+            CGxDevice::TexDestroy(texId);
+        }
+
+        // Member functions
+        CGxDeviceNull() {
+            for (int32_t i = 0; i < GxTexFormats_Last; i++) {
+                this->m_caps.m_texFmt[i] = 1;
+            }
+
+            for (int32_t i = 0; i < GxTexTargets_Last; i++) {
+                this->m_caps.m_texTarget[i] = 1;
+                this->m_caps.m_texMaxSize[i] = 4096;
+            }
+
+            this->m_prevDevice = g_theGxDevicePtr;
+            g_theGxDevicePtr = this;
+        }
+
+        ~CGxDeviceNull() {
+            g_theGxDevicePtr = this->m_prevDevice;
+        }
+
+        void ITexUpload(CGxTex* texId) {
+            uint32_t texelStrideInBytes;
+            const void* texels = nullptr;
+
+            texId->m_userFunc(GxTex_Lock, texId->m_width, texId->m_height, 0, 0, texId->m_userArg, texelStrideInBytes, texels);
+
+            uint32_t width, height, baseMip, mipCount;
+            this->ITexWHDStartEnd(texId, width, height, baseMip, mipCount);
+
+            auto compressed = texId->m_dataFormat == GxTex_Dxt1 || texId->m_dataFormat == GxTex_Dxt3 || texId->m_dataFormat == GxTex_Dxt5;
+            auto& levels = this->m_uploads[texId];
+            levels.clear();
+
+            int32_t numFace = texId->m_target == GxTex_CubeMap ? 6 : 1;
+
+            for (int32_t face = 0; face < numFace; face++) {
+                for (uint32_t mipLevel = baseMip; mipLevel < mipCount; mipLevel++) {
+                    texels = nullptr;
+
+                    texId->m_userFunc(GxTex_Latch, texId->m_width >> mipLevel, texId->m_height >> mipLevel, face, mipLevel, texId->m_userArg, texelStrideInBytes, texels);
+
+                    auto rows = std::max(texId->m_height >> mipLevel, 1u);
+
+                    if (compressed) {
+                        rows = (rows + 3) / 4;
+                    }
+
+                    auto bytes = static_cast<const uint8_t*>(texels);
+                    levels.emplace_back(bytes, bytes + (bytes ? texelStrideInBytes * rows : 0));
+                }
+            }
+
+            texId->m_userFunc(GxTex_Unlock, texId->m_width, texId->m_height, 0, 0, texId->m_userArg, texelStrideInBytes, texels);
+        }
+};
+
+#endif
@@ -0,0 +1,188 @@
+#include "catch.hpp"
+#include "gx/texture/Dxt.hpp"
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <vector>
+
+static std::vector<uint8_t> MakeDxtImage(PIXEL_FORMAT format, uint32_t width, uint32_t height, uint32_t seed) {
+    auto blockSize = format == PIXEL_DXT1 ? 8 : 16;
+    auto blocks = ((width + 3) / 4) * ((height + 3) / 4);
+
+    // Random endpoints land in both DXT1 color modes and both DXT5 alpha
+    // modes about equally often
+    std::mt19937 random(seed);
+    std::vector<uint8_t> image(blocks * blockSize);
+
+    for (auto& byte : image) {
+        byte = random();
+    }
+
+    return image;
+}
+
+static std::vector<uint8_t> DecodeDxt(PIXEL_FORMAT srcFormat, uint32_t width, uint32_t height, const std::vector<uint8_t>& src, PIXEL_FORMAT dstFormat, bool scalar) {
+    auto pixelSize = dstFormat == PIXEL_ARGB8888 ? 4 : 2;
+
+    // One guard byte past the image catches overruns at the edges
+    std::vector<uint8_t> dst(width * height * pixelSize + 1, 0xCD);
+
+    auto result = scalar
+        ? DxtDecompressScalar(srcFormat, width, height, src.data(), dstFormat, dst.data())
+        : DxtDecompress(srcFormat, width, height, src.data(), dstFormat, dst.data());
+
+    REQUIRE(result == 1);
+    REQUIRE(dst.back() == 0xCD);
+
+    return dst;
+}
+
+static uint32_t DecodeDxtPixel(PIXEL_FORMAT srcFormat, const uint8_t* block, uint32_t x, uint32_t y) {
+    uint32_t pixels[16];
+    REQUIRE(DxtDecompress(srcFormat, 4, 4, block, PIXEL_ARGB8888, pixels) == 1);
+
+    return pixels[y * 4 + x];
+}
+
+TEST_CASE("DxtDecompress", "[gx]") {
+    PIXEL_FORMAT srcFormats[] = { PIXEL_DXT1, PIXEL_DXT3, PIXEL_DXT5 };
+    PIXEL_FORMAT dstFormats[] = { PIXEL_ARGB8888, PIXEL_ARGB4444, PIXEL_ARGB1555, PIXEL_RGB565 };
+
+    SECTION("matches the scalar reference for every format and size") {
+        uint32_t sizes[][2] = { { 1, 1 }, { 2, 2 }, { 4, 4 }, { 8, 4 }, { 20, 12 }, { 64, 64 }, { 36, 6 } };
+
+        for (auto srcFormat : srcFormats) {
+            for (auto& size : sizes) {
+                auto src = MakeDxtImage(srcFormat, size[0], size[1], size[0] * 31 + size[1]);
+
+                for (auto dstFormat : dstFormats) {
+                    auto expected = DecodeDxt(srcFormat, size[0], size[1], src, dstFormat, true);
+                    auto actual = DecodeDxt(srcFormat, size[0], size[1], src, dstFormat, false);
+
+                    INFO("src " << srcFormat << " dst " << dstFormat << " " << size[0] << "x" << size[1]);
+                    CHECK(actual == expected);
+                }
+            }
+        }
+    }
+
+    SECTION("decodes DXT1 color blocks") {
+        // Red and black endpoints with pixels 0-3 of the first row using
+        // each index
+        uint8_t fourColor[8] = { 0x00, 0xF8, 0x00, 0x00, 0xE4, 0x00, 0x00, 0x00 };
+
+        CHECK(DecodeDxtPixel(PIXEL_DXT1, fourColor, 0, 0) == 0xFFFF0000);
+        CHECK(DecodeDxtPixel(PIXEL_DXT1, fourColor, 1, 0) == 0xFF000000);
+        CHECK(DecodeDxtPixel(PIXEL_DXT1, fourColor, 2, 0) == 0xFFAA0000);
+        CHECK(DecodeDxtPixel(PIXEL_DXT1, fourColor, 3, 0) == 0xFF550000);
+        CHECK(DecodeDxtPixel(PIXEL_DXT1, fourColor, 3, 3) == 0xFFFF0000);
+
+        // Swapped endpoints select three colors and transparent black
+        uint8_t threeColor[8] = { 0x00, 0x00, 0x00, 0xF8, 0xE4, 0x00, 0x00, 0x00 };
+
+        CHECK(DecodeDxtPixel(PIXEL_DXT1, threeColor, 0, 0) == 0xFF000000);
+        CHECK(DecodeDxtPixel(PIXEL_DXT1, threeColor, 1, 0) == 0xFFFF0000);
+        CHECK(DecodeDxtPixel(PIXEL_DXT1, threeColor, 2, 0) == 0xFF7F0000);
+        CHECK(DecodeDxtPixel(PIXEL_DXT1, threeColor, 3, 0) == 0x00000000);
+    }
+
+    SECTION("decodes DXT3 explicit alpha") {
+        uint8_t block[16] = {
+            0x50, 0xFA, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+            0xE0, 0x07, 0xE0, 0x07, 0xFF, 0xFF, 0xFF, 0xFF
+        };
+
+        CHECK(DecodeDxtPixel(PIXEL_DXT3, block, 0, 0) == 0x0000FF00);
+        CHECK(DecodeDxtPixel(PIXEL_DXT3, block, 1, 0) == 0x5500FF00);
+        CHECK(DecodeDxtPixel(PIXEL_DXT3, block, 2, 0) == 0xAA00FF00);
+        CHECK(DecodeDxtPixel(PIXEL_DXT3, block, 3, 0) == 0xFF00FF00);
+    }
+
+    SECTION("decodes DXT5 interpolated alpha") {
+        // Alpha indices 0, 1, 2 and 7 across the first row
+        uint8_t eightAlpha[16] = {
+            0xFF, 0x00, 0x88, 0x0E, 0x00, 0x00, 0x00, 0x00,
+            0x1F, 0x00, 0x1F, 0x00, 0x00, 0x00, 0x00, 0x00
+        };
+
+        CHECK(DecodeDxtPixel(PIXEL_DXT5, eightAlpha, 0, 0) == 0xFF0000FF);
+        CHECK(DecodeDxtPixel(PIXEL_DXT5, eightAlpha, 1, 0) == 0x000000FF);
+        CHECK(DecodeDxtPixel(PIXEL_DXT5, eightAlpha, 2, 0) == 0xDA0000FF);
+        CHECK(DecodeDxtPixel(PIXEL_DXT5, eightAlpha, 3, 0) == 0x240000FF);
+
+        // Swapped endpoints reserve indices 6 and 7 for 0 and 255
+        uint8_t sixAlpha[16] = {
+            0x00, 0xFF, 0x88, 0x6E, 0x00, 0x00, 0x00, 0x00,
+            0x1F, 0x00, 0x1F, 0x00, 0x00, 0x00, 0x00, 0x00
+        };
+
+        CHECK(DecodeDxtPixel(PIXEL_DXT5, sixAlpha, 2, 0) == 0x330000FF);
+        CHECK(DecodeDxtPixel(PIXEL_DXT5, sixAlpha, 3, 0) == 0xFF0000FF);
+        CHECK(DecodeDxtPixel(PIXEL_DXT5, sixAlpha, 0, 1) == 0x000000FF);
+    }
+
+    SECTION("packs 16-bit formats") {
+        uint8_t block[16] = {
+            0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+            0x1F, 0xF8, 0x1F, 0xF8, 0x00, 0x00, 0x00, 0x00
+        };
+
+        uint16_t pixels[16];
+
+        REQUIRE(DxtDecompress(PIXEL_DXT3, 4, 4, block, PIXEL_ARGB4444, pixels) == 1);
+        CHECK(pixels[5] == 0x0F0F);
+
+        REQUIRE(DxtDecompress(PIXEL_DXT3, 4, 4, block, PIXEL_ARGB1555, pixels) == 1);
+        CHECK(pixels[5] == 0x7C1F);
+
+        REQUIRE(DxtDecompress(PIXEL_DXT3, 4, 4, block, PIXEL_RGB565, pixels) == 1);
+        CHECK(pixels[5] == 0xF81F);
+    }
+
+    SECTION("rejects unsupported formats") {
+        uint8_t block[16] = {};
+        uint32_t pixels[16];
+
+        CHECK(DxtDecompress(PIXEL_ARGB8888, 4, 4, block, PIXEL_ARGB8888, pixels) == 0);
+        CHECK(DxtDecompress(PIXEL_DXT1, 4, 4, block, PIXEL_DXT5, pixels) == 0);
+        CHECK(DxtDecompress(PIXEL_DXT1, 4, 4, block, PIXEL_A8, pixels) == 0);
+    }
+}
+
+TEST_CASE("DxtDecompress throughput", "[gx][!benchmark]") {
+    const uint32_t size = 1024;
+    const uint32_t passes = 8;
+
+    PIXEL_FORMAT srcFormats[] = { PIXEL_DXT1, PIXEL_DXT3, PIXEL_DXT5 };
+    PIXEL_FORMAT dstFormats[] = { PIXEL_ARGB8888, PIXEL_RGB565 };
+
+    std::vector<uint8_t> dst(size * size * 4);
+
+    for (auto srcFormat : srcFormats) {
+        auto src = MakeDxtImage(srcFormat, size, size, 1);
+
+        for (auto dstFormat : dstFormats) {
+            double mpixels[2];
+
+            for (uint32_t scalar = 0; scalar < 2; scalar++) {
+                auto start = std::chrono::steady_clock::now();
+
+                for (uint32_t pass = 0; pass < passes; pass++) {
+                    if (scalar) {
+                        DxtDecompressScalar(srcFormat, size, size, src.data(), dstFormat, dst.data());
+                    } else {
+                        DxtDecompress(srcFormat, size, size, src.data(), dstFormat, dst.data());
+                    }
+                }
+
+                auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                mpixels[scalar] = static_cast<double>(size) * size * passes / elapsed / 1000000.0;
+            }
+
+            WARN(
+                "format " << srcFormat << " to " << dstFormat << ": " << mpixels[0] << " MPixels/s, scalar "
+                << mpixels[1] << " MPixels/s (" << mpixels[0] / mpixels[1] << "x)"
+            );
+        }
+    }
+}
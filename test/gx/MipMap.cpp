@@ -0,0 +1,349 @@
+#include "catch.hpp"
+#include "gx/Texture.hpp"
+#include "gx/texture/CBLPFile.hpp"
+#include "gx/texture/MipMap.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <storm/Memory.hpp>
+#include <vector>
+
+static const MipMapAlgorithm s_algorithms[] = { MMA_BOX, MMA_CUBIC, MMA_FULLDFT, MMA_KAISER, MMA_LINEARLIGHTKAISER };
+
+static double RefSinc(double x) {
+    return x == 0.0 ? 1.0 : sin(x * 3.14159265358979323846) / (x * 3.14159265358979323846);
+}
+
+static double RefBesselI0(double x) {
+    double sum = 0.0;
+    double factorial = 1.0;
+
+    for (int32_t k = 0; k < 30; k++) {
+        factorial *= k ? k : 1;
+        sum += pow(x / 2.0, 2.0 * k) / (factorial * factorial);
+    }
+
+    return sum;
+}
+
+// Kernels in destination pixels, written out from their textbook forms
+static double RefKernel(MipMapAlgorithm algorithm, double x, double& radius) {
+    x = fabs(x);
+
+    switch (algorithm) {
+        case MMA_CUBIC:
+            radius = 2.0;
+            if (x < 1.0) {
+                return (-0.5 + 2.0) * x * x * x - (-0.5 + 3.0) * x * x + 1.0;
+            }
+            return x < 2.0 ? -0.5 * (x * x * x - 5.0 * x * x + 8.0 * x - 4.0) : 0.0;
+
+        case MMA_FULLDFT:
+            radius = 4.0;
+            return x < 4.0 ? RefSinc(x) * RefSinc(x / 4.0) : 0.0;
+
+        case MMA_KAISER:
+        case MMA_LINEARLIGHTKAISER:
+            radius = 3.0;
+            return x < 3.0 ? RefSinc(x) * RefBesselI0(4.0 * sqrt(1.0 - (x / 3.0) * (x / 3.0))) / RefBesselI0(4.0) : 0.0;
+
+        default:
+            radius = 0.5;
+            return x < 0.5 ? 1.0 : 0.0;
+    }
+}
+
+struct RefTap {
+    int32_t offset;
+    double weight;
+};
+
+static std::vector<RefTap> RefTaps(MipMapAlgorithm algorithm, uint32_t size) {
+    if (size == 1) {
+        return { { 0, 1.0 } };
+    }
+
+    double radius;
+    RefKernel(algorithm, 0.0, radius);
+
+    // Destination pixel x is centered on source coordinate 2x + 1
+    std::vector<RefTap> taps;
+    double sum = 0.0;
+    int32_t count = static_cast<int32_t>(radius * 4.0);
+
+    for (int32_t k = 0; k < count; k++) {
+        int32_t offset = 1 - count / 2 + k;
+        double weight = RefKernel(algorithm, (offset + 0.5 - 1.0) / 2.0, radius);
+
+        taps.push_back({ offset, weight });
+        sum += weight;
+    }
+
+    for (auto& tap : taps) {
+        tap.weight /= sum;
+    }
+
+    return taps;
+}
+
+static double RefToLinear(double value) {
+    return value <= 0.04045 ? value / 12.92 : pow((value + 0.055) / 1.055, 2.4);
+}
+
+static double RefFromLinear(double value) {
+    return value <= 0.0031308 ? value * 12.92 : 1.055 * pow(value, 1.0 / 2.4) - 0.055;
+}
+
+// Direct 2D convolution in double precision
+static std::vector<C4Pixel> RefReduce(MipMapAlgorithm algorithm, bool gammaCorrect, uint32_t width, uint32_t height, const std::vector<C4Pixel>& src) {
+    auto linear = gammaCorrect || algorithm == MMA_LINEARLIGHTKAISER;
+    auto dstWidth = std::max(width >> 1, 1u);
+    auto dstHeight = std::max(height >> 1, 1u);
+    auto tapsX = RefTaps(algorithm, width);
+    auto tapsY = RefTaps(algorithm, height);
+    auto stepX = width == 1 ? 0 : 2;
+    auto stepY = height == 1 ? 0 : 2;
+
+    std::vector<C4Pixel> dst(dstWidth * dstHeight);
+
+    for (uint32_t y = 0; y < dstHeight; y++) {
+        for (uint32_t x = 0; x < dstWidth; x++) {
+            double sum[4] = {};
+
+            for (auto& tapY : tapsY) {
+                int32_t sy = std::min(std::max(static_cast<int32_t>(stepY * y) + tapY.offset, 0), static_cast<int32_t>(height) - 1);
+
+                for (auto& tapX : tapsX) {
+                    int32_t sx = std::min(std::max(static_cast<int32_t>(stepX * x) + tapX.offset, 0), static_cast<int32_t>(width) - 1);
+                    auto& pixel = src[sy * width + sx];
+                    uint8_t channels[4] = {
+                        static_cast<uint8_t>(pixel.b),
+                        static_cast<uint8_t>(pixel.g),
+                        static_cast<uint8_t>(pixel.r),
+                        static_cast<uint8_t>(pixel.a)
+                    };
+
+                    for (uint32_t c = 0; c < 4; c++) {
+                        double value = channels[c] / 255.0;
+                        sum[c] += tapX.weight * tapY.weight * (linear && c < 3 ? RefToLinear(value) : value);
+                    }
+                }
+            }
+
+            uint8_t out[4];
+
+            for (uint32_t c = 0; c < 4; c++) {
+                double value = linear && c < 3 ? RefFromLinear(std::min(std::max(sum[c], 0.0), 1.0)) : sum[c];
+                out[c] = static_cast<uint8_t>(std::min(std::max(floor(value * 255.0 + 0.5), 0.0), 255.0));
+            }
+
+            dst[y * dstWidth + x] = { static_cast<char>(out[0]), static_cast<char>(out[1]), static_cast<char>(out[2]), static_cast<char>(out[3]) };
+        }
+    }
+
+    return dst;
+}
+
+// Noise over smooth gradients, so both flat areas and edges are covered
+static std::vector<C4Pixel> MakeMipImage(uint32_t width, uint32_t height, uint32_t seed) {
+    std::mt19937 random(seed);
+    std::vector<C4Pixel> image(width * height);
+
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            auto& pixel = image[y * width + x];
+            auto noise = random();
+
+            pixel.b = static_cast<char>(x * 255 / std::max(width - 1, 1u));
+            pixel.g = static_cast<char>(noise);
+            pixel.r = static_cast<char>((x + y) % 16 < 8 ? 240 : 10);
+            pixel.a = static_cast<char>(y * 255 / std::max(height - 1, 1u) ^ (noise >> 8 & 0x7));
+        }
+    }
+
+    return image;
+}
+
+static int32_t MaxChannelError(const C4Pixel* a, const C4Pixel* b, uint32_t count) {
+    int32_t error = 0;
+
+    for (uint32_t i = 0; i < count; i++) {
+        auto pa = reinterpret_cast<const uint8_t*>(&a[i]);
+        auto pb = reinterpret_cast<const uint8_t*>(&b[i]);
+
+        for (uint32_t c = 0; c < 4; c++) {
+            error = std::max(error, std::abs(pa[c] - pb[c]));
+        }
+    }
+
+    return error;
+}
+
+TEST_CASE("MipMapReduce", "[gx]") {
+    SECTION("matches a double precision reference for every kernel") {
+        uint32_t sizes[][2] = { { 2, 2 }, { 8, 4 }, { 1, 16 }, { 16, 1 }, { 37, 21 }, { 64, 32 }, { 160, 6 } };
+
+        for (auto algorithm : s_algorithms) {
+            for (auto gammaCorrect : { false, true }) {
+                for (auto& size : sizes) {
+                    auto src = MakeMipImage(size[0], size[1], size[0] * size[1]);
+                    auto expected = RefReduce(algorithm, gammaCorrect, size[0], size[1], src);
+
+                    std::vector<C4Pixel> actual(expected.size());
+                    MipMapReduce(algorithm, gammaCorrect, size[0], size[1], src.data(), actual.data());
+
+                    INFO("algorithm " << algorithm << " gamma " << gammaCorrect << " " << size[0] << "x" << size[1]);
+                    CHECK(MaxChannelError(actual.data(), expected.data(), expected.size()) <= 1);
+                }
+            }
+        }
+    }
+
+    SECTION("box filters average 2x2 blocks") {
+        std::vector<C4Pixel> src = {
+            { 0, 0, 0, 0 }, { 100, 0, 0, static_cast<char>(255) },
+            { 0, 40, 0, static_cast<char>(255) }, { 0, 0, 20, static_cast<char>(255) }
+        };
+
+        C4Pixel dst;
+        MipMapReduce(MMA_BOX, 0, 2, 2, src.data(), &dst);
+
+        CHECK(static_cast<uint8_t>(dst.b) == 25);
+        CHECK(static_cast<uint8_t>(dst.g) == 10);
+        CHECK(static_cast<uint8_t>(dst.r) == 5);
+        CHECK(static_cast<uint8_t>(dst.a) == 191);
+
+        // Black and white average to mid grey only in linear light
+        std::vector<C4Pixel> checker = {
+            { 0, 0, 0, static_cast<char>(255) }, { -1, -1, -1, -1 },
+            { -1, -1, -1, -1 }, { 0, 0, 0, static_cast<char>(255) }
+        };
+
+        MipMapReduce(MMA_BOX, 0, 2, 2, checker.data(), &dst);
+        CHECK(static_cast<uint8_t>(dst.g) == 128);
+
+        MipMapReduce(MMA_BOX, 1, 2, 2, checker.data(), &dst);
+        CHECK(static_cast<uint8_t>(dst.g) == 188);
+        CHECK(static_cast<uint8_t>(dst.a) == 255);
+    }
+
+    SECTION("keeps flat images flat") {
+        std::vector<C4Pixel> src(48 * 24, { 12, 34, 56, 78 });
+
+        for (auto algorithm : s_algorithms) {
+            std::vector<C4Pixel> dst(24 * 12);
+            MipMapReduce(algorithm, 1, 48, 24, src.data(), dst.data());
+
+            INFO("algorithm " << algorithm);
+            CHECK(MaxChannelError(dst.data(), std::vector<C4Pixel>(dst.size(), { 12, 34, 56, 78 }).data(), dst.size()) <= 1);
+        }
+    }
+}
+
+TEST_CASE("CBLPFile::LockChain2 mip generation", "[gx]") {
+    // A 32x16 palettized BLP without mips
+    uint32_t width = 32;
+    uint32_t height = 16;
+
+    std::vector<uint8_t> blp(20 + 16 * 4 + 16 * 4 + 256 * 4);
+    std::vector<uint32_t> palette(256);
+
+    for (uint32_t i = 0; i < 256; i++) {
+        palette[i] = 0xFF000000 | (i * 0x00010101);
+    }
+
+    uint32_t fields[] = { 0x32504C42, 1 };
+    memcpy(&blp[0], fields, sizeof(fields));
+    blp[8] = COLOR_PAL;
+    blp[9] = 0;
+    blp[10] = PIXEL_ARGB8888;
+    blp[11] = 0;
+    memcpy(&blp[12], &width, sizeof(width));
+    memcpy(&blp[16], &height, sizeof(height));
+
+    uint32_t offset = blp.size();
+    uint32_t size = width * height;
+    memcpy(&blp[20], &offset, sizeof(offset));
+    memcpy(&blp[20 + 16 * 4], &size, sizeof(size));
+    memcpy(&blp[20 + 16 * 4 + 16 * 4], palette.data(), 256 * 4);
+
+    std::vector<C4Pixel> level0(width * height);
+
+    for (uint32_t i = 0; i < size; i++) {
+        uint8_t index = (i % width) * 8 + (i / width) * 3;
+        blp.push_back(index);
+        level0[i] = { static_cast<char>(index), static_cast<char>(index), static_cast<char>(index), static_cast<char>(255) };
+    }
+
+    auto levelCount = CalcLevelCount(width, height);
+
+    for (auto format : { PIXEL_ARGB8888, PIXEL_RGB565 }) {
+        CBLPFile file;
+        REQUIRE(file.Source(blp.data()));
+        REQUIRE(file.m_numLevels == 1);
+
+        file.m_mipMapAlgorithm = MMA_KAISER;
+
+        MipBits* images = nullptr;
+        REQUIRE(file.LockChain2("MipTest.blp", format, images, 0, 0));
+        CHECK(file.m_numLevels == levelCount);
+
+        auto levels = reinterpret_cast<MipBits**>(images);
+        auto expected = level0;
+
+        for (uint32_t level = 1; level < levelCount; level++) {
+            auto srcWidth = std::max(width >> (level - 1), 1u);
+            auto srcHeight = std::max(height >> (level - 1), 1u);
+            auto count = std::max(width >> level, 1u) * std::max(height >> level, 1u);
+
+            std::vector<C4Pixel> next(count);
+            MipMapReduce(MMA_KAISER, 0, srcWidth, srcHeight, expected.data(), next.data());
+            expected = next;
+
+            INFO("format " << format << " level " << level);
+
+            if (format == PIXEL_ARGB8888) {
+                CHECK(memcmp(levels[level], expected.data(), count * sizeof(C4Pixel)) == 0);
+            } else {
+                auto packed = reinterpret_cast<uint16_t*>(levels[level]);
+
+                for (uint32_t i = 0; i < count; i++) {
+                    auto& pixel = expected[i];
+                    uint16_t rgb565 = (static_cast<uint8_t>(pixel.r) >> 3 << 11) | (static_cast<uint8_t>(pixel.g) >> 2 << 5) | (static_cast<uint8_t>(pixel.b) >> 3);
+                    REQUIRE(packed[i] == rgb565);
+                }
+            }
+        }
+
+        SMemFree(images, __FILE__, __LINE__, 0);
+    }
+}
+
+TEST_CASE("MipMapGenerateChain throughput", "[gx][!benchmark]") {
+    for (uint32_t size : { 1024u, 2048u }) {
+        auto src = MakeMipImage(size, size, size);
+        auto images = MippedImgAllocA(PIXEL_ARGB8888, size, size, __FILE__, __LINE__);
+        memcpy(reinterpret_cast<MipBits**>(images)[0], src.data(), src.size() * sizeof(C4Pixel));
+
+        for (auto algorithm : s_algorithms) {
+            for (int32_t gammaCorrect = 0; gammaCorrect < 2; gammaCorrect++) {
+                if (algorithm == MMA_LINEARLIGHTKAISER && !gammaCorrect) {
+                    continue;
+                }
+
+                auto start = std::chrono::steady_clock::now();
+                MipMapGenerateChain(algorithm, gammaCorrect, size, size, images);
+                auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+                WARN(
+                    size << "x" << size << " algorithm " << algorithm << (gammaCorrect ? " gamma correct" : "") << ": "
+                    << elapsed << " ms per chain, " << size * size / elapsed / 1000.0 << " MPixels/s"
+                );
+            }
+        }
+
+        SMemFree(images, __FILE__, __LINE__, 0);
+    }
+}
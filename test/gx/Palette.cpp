@@ -0,0 +1,227 @@
+#include "catch.hpp"
+#include "gx/texture/CBLPFile.hpp"
+#include "gx/texture/Palette.hpp"
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <vector>
+
+// BLP2 header fields up to and including the palette
+#define PAL_BLP_HEADER_SIZE (20 + 16 * 4 + 16 * 4 + 256 * 4)
+
+static std::vector<uint32_t> MakePalette() {
+    std::vector<uint32_t> palette(256);
+
+    // The fourth byte of each entry is padding and must not leak into alpha
+    for (uint32_t i = 0; i < 256; i++) {
+        palette[i] = ((i * 0x9E3779B9) & 0x00FFFFFF) | ((i & 0x3) << 24);
+    }
+
+    return palette;
+}
+
+static std::vector<uint8_t> MakePalImage(uint32_t alphaSize, uint32_t width, uint32_t height, uint32_t seed) {
+    auto count = width * height;
+
+    std::mt19937 random(seed);
+    std::vector<uint8_t> image(count + (count * alphaSize + 7) / 8);
+
+    for (auto& byte : image) {
+        byte = random();
+    }
+
+    return image;
+}
+
+// Expected alpha for pixel i, written out independently of the decoder
+static uint32_t PalGoldenAlpha(uint32_t alphaSize, const uint8_t* alpha, uint32_t i) {
+    if (alphaSize == 1) {
+        return (alpha[i / 8] & (1 << (i % 8))) ? 255 : 0;
+    }
+
+    if (alphaSize == 4) {
+        return ((i % 2 ? alpha[i / 2] >> 4 : alpha[i / 2]) & 0xF) * 17;
+    }
+
+    if (alphaSize == 8) {
+        return alpha[i];
+    }
+
+    return 255;
+}
+
+static std::vector<uint8_t> MakePalBlp(uint32_t alphaSize, uint32_t width, uint32_t height, const std::vector<uint32_t>& palette, const std::vector<std::vector<uint8_t>>& mips) {
+    std::vector<uint8_t> blp(PAL_BLP_HEADER_SIZE);
+
+    uint32_t fields[] = { 0x32504C42, 1 };
+    memcpy(&blp[0], fields, sizeof(fields));
+
+    blp[8] = COLOR_PAL;
+    blp[9] = alphaSize;
+    blp[10] = PIXEL_ARGB8888;
+    blp[11] = mips.size() > 1 ? 1 : 0;
+
+    memcpy(&blp[12], &width, sizeof(width));
+    memcpy(&blp[16], &height, sizeof(height));
+    memcpy(&blp[20 + 16 * 4 + 16 * 4], palette.data(), 256 * 4);
+
+    for (uint32_t level = 0; level < mips.size(); level++) {
+        uint32_t offset = blp.size();
+        uint32_t size = mips[level].size();
+
+        memcpy(&blp[20 + level * 4], &offset, sizeof(offset));
+        memcpy(&blp[20 + 16 * 4 + level * 4], &size, sizeof(size));
+
+        blp.insert(blp.end(), mips[level].begin(), mips[level].end());
+    }
+
+    return blp;
+}
+
+TEST_CASE("PalDecompress", "[gx]") {
+    auto palette = MakePalette();
+
+    SECTION("decodes a hand-built 4x2 image with 4-bit alpha") {
+        std::vector<uint32_t> colors(256, 0);
+        colors[0] = 0x00112233;
+        colors[1] = 0xFF445566;
+        colors[255] = 0x12ABCDEF;
+
+        uint8_t image[] = {
+            0, 1, 255, 0,
+            1, 1, 0, 255,
+            0xF0, 0x5A, 0x00, 0x9F
+        };
+
+        uint32_t pixels[8];
+        REQUIRE(PalDecompress(colors.data(), 4, 4, 2, image, PIXEL_ARGB8888, pixels) == 1);
+
+        uint32_t expected[] = {
+            0x00112233, 0xFF445566, 0xAAABCDEF, 0x55112233,
+            0x00445566, 0x00445566, 0xFF112233, 0x99ABCDEF
+        };
+
+        for (uint32_t i = 0; i < 8; i++) {
+            CHECK(pixels[i] == expected[i]);
+        }
+    }
+
+    SECTION("matches golden pixels through CBLPFile::Lock2 at every alpha depth") {
+        for (uint32_t alphaSize : { 0, 1, 4, 8 }) {
+            uint32_t width = 40;
+            uint32_t height = 24;
+
+            std::vector<std::vector<uint8_t>> mips = {
+                MakePalImage(alphaSize, width, height, alphaSize + 1),
+                MakePalImage(alphaSize, width / 2, height / 2, alphaSize + 2)
+            };
+
+            auto blp = MakePalBlp(alphaSize, width, height, palette, mips);
+
+            CBLPFile file;
+            REQUIRE(file.Source(blp.data()));
+
+            for (uint32_t level = 0; level < mips.size(); level++) {
+                auto levelWidth = width >> level;
+                auto levelHeight = height >> level;
+                auto count = levelWidth * levelHeight;
+
+                std::vector<uint32_t> pixels(count);
+                uint32_t stride = level;
+                REQUIRE(file.Lock2("PalTest.blp", PIXEL_ARGB8888, level, reinterpret_cast<unsigned char*>(pixels.data()), stride));
+
+                auto& mip = mips[level];
+
+                for (uint32_t i = 0; i < count; i++) {
+                    auto expected = (palette[mip[i]] & 0x00FFFFFF) | (PalGoldenAlpha(alphaSize, &mip[count], i) << 24);
+
+                    INFO("alpha " << alphaSize << " level " << level << " pixel " << i);
+                    REQUIRE(pixels[i] == expected);
+                }
+
+                // 16-bit locks agree with the scalar reference
+                for (auto format : { PIXEL_ARGB4444, PIXEL_ARGB1555, PIXEL_RGB565 }) {
+                    std::vector<uint16_t> actual(count);
+                    std::vector<uint16_t> reference(count);
+
+                    REQUIRE(file.Lock2("PalTest.blp", format, level, reinterpret_cast<unsigned char*>(actual.data()), stride));
+                    REQUIRE(PalDecompressScalar(palette.data(), alphaSize, levelWidth, levelHeight, mip.data(), format, reference.data()));
+
+                    CHECK(actual == reference);
+                }
+            }
+
+            file.m_inMemoryImage = nullptr;
+        }
+    }
+
+    SECTION("matches the scalar reference for odd sizes") {
+        uint32_t sizes[][2] = { { 1, 1 }, { 3, 1 }, { 5, 3 }, { 16, 1 }, { 17, 15 }, { 256, 2 }, { 300, 7 } };
+
+        for (uint32_t alphaSize : { 0, 1, 4, 8 }) {
+            for (auto& size : sizes) {
+                auto image = MakePalImage(alphaSize, size[0], size[1], size[0] + size[1]);
+                auto count = size[0] * size[1];
+
+                for (auto format : { PIXEL_ARGB8888, PIXEL_ARGB4444, PIXEL_ARGB1555, PIXEL_RGB565 }) {
+                    auto pixelSize = format == PIXEL_ARGB8888 ? 4 : 2;
+
+                    // One guard byte past the image catches overruns
+                    std::vector<uint8_t> actual(count * pixelSize + 1, 0xCD);
+                    std::vector<uint8_t> expected(count * pixelSize + 1, 0xCD);
+
+                    REQUIRE(PalDecompress(palette.data(), alphaSize, size[0], size[1], image.data(), format, actual.data()));
+                    REQUIRE(PalDecompressScalar(palette.data(), alphaSize, size[0], size[1], image.data(), format, expected.data()));
+
+                    INFO("alpha " << alphaSize << " format " << format << " " << size[0] << "x" << size[1]);
+                    CHECK(actual == expected);
+                    CHECK(actual.back() == 0xCD);
+                }
+            }
+        }
+    }
+
+    SECTION("rejects unsupported formats and alpha depths") {
+        uint8_t image[8] = {};
+        uint32_t pixels[4];
+
+        CHECK(PalDecompress(palette.data(), 2, 2, 2, image, PIXEL_ARGB8888, pixels) == 0);
+        CHECK(PalDecompress(palette.data(), 8, 2, 2, image, PIXEL_DXT1, pixels) == 0);
+    }
+}
+
+TEST_CASE("PalDecompress throughput", "[gx][!benchmark]") {
+    const uint32_t size = 1024;
+    const uint32_t passes = 8;
+
+    auto palette = MakePalette();
+    std::vector<uint8_t> dst(size * size * 4);
+
+    for (uint32_t alphaSize : { 0, 1, 4, 8 }) {
+        auto image = MakePalImage(alphaSize, size, size, alphaSize);
+
+        for (auto format : { PIXEL_ARGB8888, PIXEL_ARGB4444 }) {
+            double mpixels[2];
+
+            for (uint32_t scalar = 0; scalar < 2; scalar++) {
+                auto start = std::chrono::steady_clock::now();
+
+                for (uint32_t pass = 0; pass < passes; pass++) {
+                    if (scalar) {
+                        PalDecompressScalar(palette.data(), alphaSize, size, size, image.data(), format, dst.data());
+                    } else {
+                        PalDecompress(palette.data(), alphaSize, size, size, image.data(), format, dst.data());
+                    }
+                }
+
+                auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                mpixels[scalar] = static_cast<double>(size) * size * passes / elapsed / 1000000.0;
+            }
+
+            WARN(
+                alphaSize << "-bit alpha to format " << format << ": " << mpixels[0] << " MPixels/s, scalar "
+                << mpixels[1] << " MPixels/s (" << mpixels[0] / mpixels[1] << "x)"
+            );
+        }
+    }
+}
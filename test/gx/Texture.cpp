@@ -0,0 +1,819 @@
+#include "catch.hpp"
+#include "DeviceFixture.hpp"
+#include "../async/AsyncFixture.hpp"
+#include "async/AsyncFileRead.hpp"
+#include "gx/Texture.hpp"
+#include "gx/texture/CTextureAtlas.hpp"
+#include "util/CStatus.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <utility>
+#include <vector>
+#include <storm/String.hpp>
+
+// BLP2 header fields up to and including the palette
+#define TEXTURE_BLP_HEADER_SIZE (20 + 16 * 4 + 16 * 4 + 256 * 4)
+
+struct BlpTestImage {
+    uint8_t colorEncoding;
+    uint8_t alphaSize;
+    uint8_t preferredFormat;
+    uint32_t width;
+    uint32_t height;
+    uint32_t hasMips;
+};
+
+static std::vector<uint8_t> MakeBlp(const BlpTestImage& desc, uint32_t seed) {
+    std::mt19937 random(seed);
+    std::vector<uint8_t> blp(TEXTURE_BLP_HEADER_SIZE);
+
+    uint32_t fields[] = { 0x32504C42, 1 };
+    memcpy(&blp[0], fields, sizeof(fields));
+
+    blp[8] = desc.colorEncoding;
+    blp[9] = desc.alphaSize;
+    blp[10] = desc.preferredFormat;
+    blp[11] = desc.hasMips;
+
+    memcpy(&blp[12], &desc.width, sizeof(desc.width));
+    memcpy(&blp[16], &desc.height, sizeof(desc.height));
+
+    for (uint32_t i = 20 + 16 * 4 + 16 * 4; i < TEXTURE_BLP_HEADER_SIZE; i++) {
+        blp[i] = random();
+    }
+
+    auto levels = desc.hasMips ? CalcLevelCount(desc.width, desc.height) : 1;
+
+    for (uint32_t level = 0; level < levels; level++) {
+        auto width = std::max(desc.width >> level, 1u);
+        auto height = std::max(desc.height >> level, 1u);
+
+        uint32_t size;
+
+        if (desc.colorEncoding == COLOR_PAL) {
+            size = width * height + (width * height * desc.alphaSize + 7) / 8;
+        } else {
+            auto blockSize = desc.preferredFormat == PIXEL_DXT1 ? 8 : 16;
+            size = ((width + 3) / 4) * ((height + 3) / 4) * blockSize;
+        }
+
+        uint32_t offset = blp.size();
+
+        memcpy(&blp[20 + level * 4], &offset, sizeof(offset));
+        memcpy(&blp[20 + 16 * 4 + level * 4], &size, sizeof(size));
+
+        for (uint32_t i = 0; i < size; i++) {
+            blp.push_back(random());
+        }
+    }
+
+    return blp;
+}
+
+static void WriteTestFile(const char* path, const std::vector<uint8_t>& contents) {
+    auto file = fopen(path, "wb");
+    fwrite(contents.data(), 1, contents.size(), file);
+    fclose(file);
+}
+
+static HTEXTURE CreateTestTexture(const char* path, int32_t async) {
+    Texture::s_createBlpAsync = async;
+
+    CStatus status;
+    CGxTexFlags texFlags = CGxTexFlags(GxTex_LinearMipLinear, 0, 0, 0, 0, 0, 1);
+    auto texture = TextureCreate(path, texFlags, &status, 0);
+
+    Texture::s_createBlpAsync = 0;
+
+    return texture;
+}
+
+static void TextureTestStart() {
+    static bool s_started;
+
+    if (!Texture::s_mipBits) {
+        TextureInitialize();
+    }
+
+    AsyncFileReadTestStart();
+
+    // Extra disk threads so several decodes run at once
+    if (!s_started) {
+        for (int32_t i = 0; i < 3; i++) {
+            AsyncFileReadCreateThread(AsyncFileRead::s_asyncQueues[0], AsyncFileRead::s_asyncQueueNames[0]);
+        }
+
+        s_started = true;
+    }
+}
+
+static void TextureTestUpdate(EGxTexCommand cmd, uint32_t width, uint32_t height, uint32_t depth, uint32_t mipLevel, void* userArg, uint32_t& texelStrideInBytes, const void*& texels) {
+}
+
+static uint32_t TextureCacheTestCount() {
+    TextureCacheStats stats;
+    TextureCacheGetStats(stats);
+
+    return stats.textures;
+}
+
+TEST_CASE("CreateBlpAsync", "[gx]") {
+    CGxDeviceNull device;
+    TextureTestStart();
+
+    BlpTestImage images[] = {
+        { COLOR_PAL, 0, PIXEL_ARGB8888, 64, 64, 1 },
+        { COLOR_PAL, 1, PIXEL_ARGB8888, 32, 16, 1 },
+        { COLOR_PAL, 4, PIXEL_ARGB8888, 128, 128, 1 },
+        { COLOR_PAL, 8, PIXEL_ARGB8888, 256, 64, 1 },
+        { COLOR_PAL, 8, PIXEL_ARGB8888, 64, 128, 0 },
+        { COLOR_PAL, 8, PIXEL_UNSPECIFIED, 1024, 1024, 1 },
+        { COLOR_DXT, 0, PIXEL_DXT1, 64, 64, 1 },
+        { COLOR_DXT, 1, PIXEL_DXT1, 128, 32, 1 },
+        { COLOR_DXT, 8, PIXEL_DXT3, 32, 32, 1 },
+        { COLOR_DXT, 8, PIXEL_DXT5, 256, 256, 1 },
+        { COLOR_DXT, 8, PIXEL_DXT5, 8, 8, 0 }
+    };
+
+    const uint32_t copies = 6;
+
+    // With DXT disabled the compressed images are decoded to 16-bit on the
+    // read threads too
+    for (int32_t dxt = 1; dxt >= 0; dxt--) {
+        device.m_caps.m_texFmt[GxTex_Dxt1] = dxt;
+        device.m_caps.m_texFmt[GxTex_Dxt3] = dxt;
+        device.m_caps.m_texFmt[GxTex_Dxt5] = dxt;
+
+        char path[STORM_MAX_PATH];
+        std::vector<HTEXTURE> syncTextures;
+        std::vector<HTEXTURE> asyncTextures;
+
+        for (uint32_t i = 0; i < copies * sizeof(images) / sizeof(images[0]); i++) {
+            auto blp = MakeBlp(images[i % (sizeof(images) / sizeof(images[0]))], i);
+
+            SStrPrintf(path, sizeof(path), "TextureTestSync_%d_%u.blp", dxt, i);
+            WriteTestFile(path, blp);
+            syncTextures.push_back(CreateTestTexture(path, 0));
+
+            SStrPrintf(path, sizeof(path), "TextureTestAsync_%d_%u.blp", dxt, i);
+            WriteTestFile(path, blp);
+            asyncTextures.push_back(CreateTestTexture(path, 1));
+        }
+
+        // Everything is queued before the first load lands
+        for (auto handle : asyncTextures) {
+            auto texture = TextureGetTexturePtr(handle);
+
+            REQUIRE(texture->asyncObject);
+            CHECK(texture->gxTex == nullptr);
+            CHECK(TextureGetDimensions(handle, nullptr, nullptr, 0) == 0);
+        }
+
+        auto pending = asyncTextures.size();
+
+        while (pending) {
+            AsyncFileReadPollHandler(nullptr, nullptr);
+
+            pending = 0;
+
+            for (auto handle : asyncTextures) {
+                pending += TextureGetTexturePtr(handle)->asyncObject != nullptr;
+            }
+        }
+
+        for (uint32_t i = 0; i < asyncTextures.size(); i++) {
+            auto syncTexture = TextureGetTexturePtr(syncTextures[i]);
+            auto asyncTexture = TextureGetTexturePtr(asyncTextures[i]);
+
+            INFO("dxt " << dxt << " image " << i);
+
+            REQUIRE(syncTexture->gxTex);
+            REQUIRE(asyncTexture->gxTex);
+
+            CHECK(asyncTexture->flags == syncTexture->flags);
+            CHECK(asyncTexture->alphaBits == syncTexture->alphaBits);
+            CHECK(asyncTexture->gxWidth == syncTexture->gxWidth);
+            CHECK(asyncTexture->gxHeight == syncTexture->gxHeight);
+            CHECK(asyncTexture->gxTexFormat == syncTexture->gxTexFormat);
+            CHECK(asyncTexture->dataFormat == syncTexture->dataFormat);
+
+            auto& expected = device.m_uploads[syncTexture->gxTex];
+            auto& actual = device.m_uploads[asyncTexture->gxTex];
+
+            REQUIRE(!expected.empty());
+            CHECK(actual == expected);
+        }
+
+        for (uint32_t i = 0; i < asyncTextures.size(); i++) {
+            HandleClose(syncTextures[i]);
+            HandleClose(asyncTextures[i]);
+
+            SStrPrintf(path, sizeof(path), "TextureTestSync_%d_%u.blp", dxt, i);
+            remove(path);
+
+            SStrPrintf(path, sizeof(path), "TextureTestAsync_%d_%u.blp", dxt, i);
+            remove(path);
+        }
+    }
+
+    TextureCacheFlush();
+}
+
+TEST_CASE("AsyncTextureWait", "[gx]") {
+    CGxDeviceNull device;
+    TextureTestStart();
+
+    SECTION("finishes a pending load on demand") {
+        BlpTestImage image = { COLOR_PAL, 8, PIXEL_ARGB8888, 128, 64, 1 };
+        WriteTestFile("TextureTestWait.blp", MakeBlp(image, 1));
+
+        auto handle = CreateTestTexture("TextureTestWait.blp", 1);
+        auto texture = TextureGetTexturePtr(handle);
+
+        REQUIRE(texture->asyncObject);
+
+        CStatus status;
+        auto gxTex = TextureGetGxTex(texture, 1, &status);
+
+        CHECK(texture->asyncObject == nullptr);
+        REQUIRE(gxTex);
+        CHECK(gxTex->m_width == 128);
+        CHECK(gxTex->m_height == 64);
+        CHECK(device.m_uploads[gxTex].size() == CalcLevelCount(128, 64));
+
+        HandleClose(handle);
+        remove("TextureTestWait.blp");
+    }
+
+    SECTION("falls back to a solid texture for a bad file") {
+        std::vector<uint8_t> blp(TEXTURE_BLP_HEADER_SIZE, 0xAB);
+        WriteTestFile("TextureTestBad.blp", blp);
+
+        auto handle = CreateTestTexture("TextureTestBad.blp", 1);
+
+        uint32_t width = 0;
+        uint32_t height = 0;
+
+        CHECK(TextureGetDimensions(handle, &width, &height, 1) == 1);
+        CHECK(width == 8);
+        CHECK(height == 8);
+        CHECK(TextureGetTexturePtr(handle)->gxTex);
+
+        HandleClose(handle);
+        remove("TextureTestBad.blp");
+    }
+
+    TextureCacheFlush();
+}
+
+TEST_CASE("TextureCacheUpdate", "[gx]") {
+    CGxDeviceNull device;
+    TextureTestStart();
+    TextureCacheFlush();
+
+    auto cacheSize = Texture::s_cacheSize;
+    auto base = Texture::s_residentBytes;
+
+    BlpTestImage image = { COLOR_PAL, 8, PIXEL_ARGB8888, 64, 64, 1 };
+    const char* paths[] = { "TextureCacheA.blp", "TextureCacheB.blp", "TextureCacheC.blp" };
+
+    for (uint32_t i = 0; i < 3; i++) {
+        WriteTestFile(paths[i], MakeBlp(image, i));
+    }
+
+    TextureCacheSetSize(0xFFFFFFFF);
+
+    SECTION("counts the bytes of every uploaded level") {
+        auto handle = CreateTestTexture(paths[0], 0);
+        auto gxTex = TextureGetTexturePtr(handle)->gxTex;
+
+        uint32_t uploaded = 0;
+
+        for (auto& level : device.m_uploads[gxTex]) {
+            uploaded += level.size();
+        }
+
+        CHECK(device.m_uploads[gxTex].size() == CalcLevelCount(64, 64));
+        CHECK(TextureCalcGxTexSize(gxTex) == uploaded);
+        CHECK(Texture::s_residentBytes == base + uploaded);
+
+        HandleClose(handle);
+
+        // Closing the last handle leaves the texture to the cache
+        CHECK(TextureCacheTestCount() == 1);
+        CHECK(Texture::s_residentBytes == base + uploaded);
+    }
+
+    SECTION("evicts unreferenced textures in least recently used order") {
+        HTEXTURE handles[3];
+        CTexture* textures[3];
+
+        for (uint32_t i = 0; i < 3; i++) {
+            handles[i] = CreateTestTexture(paths[i], 0);
+            textures[i] = TextureGetTexturePtr(handles[i]);
+        }
+
+        auto size = TextureCalcGxTexSize(textures[0]->gxTex);
+
+        // Leaves B as the oldest, then A, then C
+        TextureCacheUpdate();
+        TextureGetGxTex(textures[0], 0, nullptr);
+        TextureCacheUpdate();
+        TextureGetGxTex(textures[2], 0, nullptr);
+        TextureCacheUpdate();
+
+        for (auto handle : handles) {
+            HandleClose(handle);
+        }
+
+        auto evictions = Texture::s_evictions;
+
+        TextureCacheSetSize(base + 2 * size);
+        TextureCacheUpdate();
+
+        // B gives back its memory and stays cached, cold
+        CHECK(Texture::s_evictions == evictions + 1);
+        CHECK(Texture::s_residentBytes == base + 2 * size);
+        CHECK(textures[1]->gxTex == nullptr);
+        CHECK(textures[1]->evicted);
+        CHECK(textures[0]->gxTex);
+        CHECK(TextureCacheTestCount() == 3);
+
+        // Cold entries go altogether once they come up again
+        TextureCacheSetSize(base + size);
+        TextureCacheUpdate();
+
+        CHECK(Texture::s_evictions == evictions + 3);
+        CHECK(Texture::s_residentBytes == base + size);
+        CHECK(Texture::s_cacheList.Head() == textures[0]);
+        CHECK(textures[0]->evicted);
+        CHECK(TextureCacheTestCount() == 2);
+
+        // A texture in use this frame stays, whatever the budget
+        TextureGetGxTex(textures[2], 0, nullptr);
+        TextureCacheSetSize(base + 1);
+        TextureCacheUpdate();
+
+        CHECK(TextureCacheTestCount() == 1);
+        CHECK(textures[2]->gxTex);
+
+        TextureCacheUpdate();
+
+        CHECK(textures[2]->gxTex == nullptr);
+        CHECK(Texture::s_residentBytes == base);
+    }
+
+    SECTION("treats a zero budget as no limit") {
+        auto handle = CreateTestTexture(paths[0], 0);
+        auto texture = TextureGetTexturePtr(handle);
+
+        HandleClose(handle);
+
+        auto evictions = Texture::s_evictions;
+
+        TextureCacheSetSize(0);
+
+        for (uint32_t i = 0; i < 4; i++) {
+            TextureCacheUpdate();
+        }
+
+        CHECK(texture->gxTex);
+        CHECK(Texture::s_evictions == evictions);
+        CHECK(TextureCacheTestCount() == 1);
+    }
+
+    SECTION("keeps textures with live handles whatever the budget") {
+        auto handle = CreateTestTexture(paths[0], 0);
+        auto texture = TextureGetTexturePtr(handle);
+        auto gxTex = texture->gxTex;
+
+        auto evictions = Texture::s_evictions;
+
+        TextureCacheSetSize(base + 1);
+
+        for (uint32_t i = 0; i < 4; i++) {
+            TextureCacheUpdate();
+        }
+
+        CHECK(texture->gxTex == gxTex);
+        CHECK(Texture::s_evictions == evictions);
+        CHECK(Texture::s_residentBytes == base + TextureCalcGxTexSize(gxTex));
+
+        HandleClose(handle);
+        TextureCacheUpdate();
+
+        CHECK(texture->evicted);
+        CHECK(Texture::s_residentBytes == base);
+    }
+
+    SECTION("streams cold textures back in at reduced mip levels") {
+        auto handle = CreateTestTexture(paths[0], 0);
+        auto texture = TextureGetTexturePtr(handle);
+
+        HandleClose(handle);
+
+        auto reloads = Texture::s_reloads;
+
+        TextureCacheSetSize(base + 1);
+        TextureCacheUpdate();
+        TextureCacheUpdate();
+
+        REQUIRE(texture->evicted);
+
+        // Coming back costs it the top level
+        handle = CreateTestTexture(paths[0], 0);
+
+        REQUIRE(TextureGetTexturePtr(handle) == texture);
+        CHECK_FALSE(texture->evicted);
+        CHECK(Texture::s_reloads == reloads + 1);
+
+        auto gxTex = TextureGetGxTex(texture, 0, nullptr);
+
+        REQUIRE(gxTex);
+        CHECK(gxTex->m_width == 32);
+        CHECK(gxTex->m_height == 32);
+        CHECK(texture->gxWidth == 32);
+        CHECK(device.m_uploads[gxTex].size() == CalcLevelCount(32, 32));
+        CHECK(Texture::s_residentBytes == base + TextureCalcGxTexSize(gxTex));
+
+        // A second eviction costs another level, and the async path waits for
+        // the read when asked to
+        HandleClose(handle);
+        TextureCacheUpdate();
+        TextureCacheUpdate();
+
+        REQUIRE(texture->evicted);
+
+        handle = CreateTestTexture(paths[0], 1);
+
+        CHECK(texture->asyncObject);
+
+        CStatus status;
+        gxTex = TextureGetGxTex(texture, 1, &status);
+
+        REQUIRE(gxTex);
+        CHECK(texture->asyncObject == nullptr);
+        CHECK(gxTex->m_width == 16);
+        CHECK(Texture::s_reloads == reloads + 2);
+
+        HandleClose(handle);
+    }
+
+    SECTION("leaves textures outside the cache out of the budget") {
+        CGxTexFlags flags(GxTex_Linear, 0, 0, 0, 0, 0, 1);
+        auto handle = TextureCreate(64, 64, GxTex_Argb8888, GxTex_Argb8888, flags, nullptr, &TextureTestUpdate, "TextureCacheUnique", 0);
+
+        REQUIRE(TextureGetTexturePtr(handle)->gxTex);
+        CHECK(Texture::s_residentBytes == base);
+
+        HandleClose(handle);
+
+        CHECK(Texture::s_residentBytes == base);
+    }
+
+    SECTION("returns no texture when nothing is loading") {
+        CTexture texture;
+
+        CHECK(TextureGetGxTex(&texture, 2, nullptr) == nullptr);
+        CHECK(TextureGetGxTex(&texture, 1, nullptr) == nullptr);
+    }
+
+    TextureCacheSetSize(cacheSize);
+    TextureCacheFlush();
+
+    for (auto path : paths) {
+        remove(path);
+    }
+}
+
+TEST_CASE("CreateBlpTexture atlas", "[gx]") {
+    CGxDeviceNull device;
+    TextureTestStart();
+
+    // Only files flagged for it in the header go on an atlas
+    BlpTestImage atlasImage = { COLOR_PAL, 8, PIXEL_ARGB8888, 64, 32, 0x11 };
+    BlpTestImage plainImage = { COLOR_PAL, 8, PIXEL_ARGB8888, 64, 32, 0x1 };
+
+    WriteTestFile("TextureTestAtlas.blp", MakeBlp(atlasImage, 5));
+    WriteTestFile("TextureTestPlain.blp", MakeBlp(plainImage, 5));
+
+    CStatus status;
+    CGxTexFlags texFlags = CGxTexFlags(GxTex_LinearMipLinear, 0, 0, 0, 0, 0, 1);
+
+    auto atlasHandle = TextureCreate("TextureTestAtlas.blp", texFlags, &status, 0x4);
+    auto plainHandle = TextureCreate("TextureTestPlain.blp", texFlags, &status, 0x4);
+
+    auto atlasTexture = TextureGetTexturePtr(atlasHandle);
+    auto plainTexture = TextureGetTexturePtr(plainHandle);
+
+    REQUIRE(atlasTexture->atlas);
+    CHECK(atlasTexture->gxTex == nullptr);
+    CHECK(plainTexture->atlas == nullptr);
+    CHECK_FALSE(plainTexture->flags & 0x4);
+
+    auto page = atlasTexture->atlas;
+
+    CHECK(TextureGetGxTex(atlasTexture, 1, nullptr) == page->m_gxTex);
+    CHECK(TextureGetGxTex(plainTexture, 1, nullptr) == plainTexture->gxTex);
+
+    // The block holds the same texels the texture would have had on its own
+    C2Vector offset, scale;
+    TextureGetAtlasOffsetAndScale(atlasTexture, offset, scale);
+
+    CHECK(scale.x * page->m_size == 64.0f);
+    CHECK(scale.y * page->m_size == 32.0f);
+
+    auto& expected = device.m_uploads[plainTexture->gxTex];
+    auto& pageLevels = device.m_uploads[page->m_gxTex];
+
+    REQUIRE(!expected.empty());
+    REQUIRE(!pageLevels.empty());
+
+    auto x = static_cast<uint32_t>(offset.x * page->m_size);
+    auto y = static_cast<uint32_t>(offset.y * page->m_size);
+
+    for (uint32_t row = 0; row < 32; row++) {
+        INFO("row " << row);
+        CHECK(memcmp(&pageLevels[0][((y + row) * page->m_size + x) * 4], &expected[0][row * 64 * 4], 64 * 4) == 0);
+    }
+
+    HandleClose(atlasHandle);
+    HandleClose(plainHandle);
+
+    TextureCacheFlush();
+
+    // The cache let go of the texture, and with it the page
+    CHECK(CTextureAtlas::s_atlasList.Head() == nullptr);
+
+    remove("TextureTestAtlas.blp");
+    remove("TextureTestPlain.blp");
+}
+
+TEST_CASE("CreateTgaTexture", "[gx]") {
+    CGxDeviceNull device;
+    TextureTestStart();
+
+    // 64x32 RLE true color, top row first, in runs of eight texels
+    std::vector<uint8_t> tga = { 0, 0, 10, 0, 0, 0, 0, 0, 0, 0, 0, 0, 64, 0, 32, 0, 32, 0x28 };
+    std::vector<uint8_t> expected;
+
+    for (uint32_t i = 0; i < 64 * 32 / 8; i++) {
+        uint8_t texel[] = { static_cast<uint8_t>(i), static_cast<uint8_t>(i * 3), static_cast<uint8_t>(i * 7), static_cast<uint8_t>(255 - i) };
+
+        tga.push_back(0x80 | 7);
+        tga.insert(tga.end(), texel, texel + 4);
+
+        for (uint32_t j = 0; j < 8; j++) {
+            expected.insert(expected.end(), texel, texel + 4);
+        }
+    }
+
+    WriteTestFile("TextureTestImage.tga", tga);
+
+    auto handle = CreateTestTexture("TextureTestImage.tga", 0);
+    auto texture = TextureGetTexturePtr(handle);
+
+    CHECK(texture->gxWidth == 64);
+    CHECK(texture->gxHeight == 32);
+    CHECK(texture->alphaBits == 8);
+    CHECK_FALSE(texture->flags & 0x1);
+    CHECK(texture->dataFormat == GxTex_Argb8888);
+
+    // Uploaded like a BLP, with the mips the file doesn't carry generated
+    auto& levels = device.m_uploads[TextureGetGxTex(texture, 1, nullptr)];
+
+    REQUIRE(levels.size() == CalcLevelCount(64, 32));
+    CHECK(levels[0] == expected);
+    CHECK(levels[levels.size() - 1].size() == 4);
+
+    HandleClose(handle);
+    TextureCacheFlush();
+
+    remove("TextureTestImage.tga");
+}
+
+TEST_CASE("CreateTgaTexture unsupported sizes", "[gx]") {
+    CGxDeviceNull device;
+    TextureTestStart();
+
+    // Sizes GxTexCreate can't take fall back to the solid texture
+    auto size = GENERATE(std::make_pair(100, 50), std::make_pair(4, 4));
+
+    uint32_t width = size.first;
+    uint32_t height = size.second;
+
+    std::vector<uint8_t> tga = { 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, static_cast<uint8_t>(width), 0, static_cast<uint8_t>(height), 0, 32, 0x28 };
+    tga.resize(tga.size() + width * height * 4, 0x7F);
+
+    WriteTestFile("TextureTestSize.tga", tga);
+
+    auto handle = CreateTestTexture("TextureTestSize.tga", 0);
+    auto texture = TextureGetTexturePtr(handle);
+
+    CHECK(texture->gxWidth == 8);
+    CHECK(texture->gxHeight == 8);
+    CHECK(texture->gxTex);
+
+    HandleClose(handle);
+    TextureCacheFlush();
+
+    remove("TextureTestSize.tga");
+}
+
+// Refuses atlas pages, as a device out of texture memory would
+class CGxDeviceNoPages : public CGxDeviceNull {
+    public:
+        virtual int32_t TexCreate(EGxTexTarget target, uint32_t width, uint32_t height, uint32_t depth, EGxTexFormat format, EGxTexFormat dataFormat, CGxTexFlags flags, void* userArg, TEXTURE_CALLBACK* userFunc, const char* name, CGxTex*& texId) {
+            if (width == CTextureAtlas::s_pageSize) {
+                texId = nullptr;
+                return 0;
+            }
+
+            return CGxDeviceNull::TexCreate(target, width, height, depth, format, dataFormat, flags, userArg, userFunc, name, texId);
+        }
+};
+
+TEST_CASE("TextureCreateSolid", "[gx]") {
+    CGxDeviceNull device;
+    TextureTestStart();
+
+    auto residentBytes = Texture::s_residentBytes;
+    auto cached = TextureCacheTestCount();
+
+    CImVector red = { 0x00, 0x00, 0xFF, 0xFF };
+    CImVector clear = { 0x00, 0x00, 0xFF, 0x80 };
+
+    SECTION("shares one texture per color") {
+        auto first = TextureCreateSolid(red);
+        auto second = TextureCreateSolid(red);
+        auto other = TextureCreateSolid(clear);
+
+        auto texture = TextureGetTexturePtr(first);
+
+        CHECK(TextureGetTexturePtr(second) == texture);
+        CHECK(TextureGetTexturePtr(other) != texture);
+        CHECK(texture->m_refcount == 2);
+        CHECK(texture->flags & 0x1);
+        CHECK_FALSE(TextureGetTexturePtr(other)->flags & 0x1);
+
+        // Solid textures stay out of the budgeted cache
+        CHECK(TextureCacheTestCount() == cached);
+
+        CHECK(TextureGetGxTex(texture, 1, nullptr) == texture->gxTex);
+
+        HandleClose(first);
+        HandleClose(other);
+
+        auto lookup = TextureCacheGetTexture(red);
+
+        CHECK(TextureGetTexturePtr(lookup) == texture);
+        CHECK(texture->m_refcount == 2);
+
+        HandleClose(lookup);
+        HandleClose(second);
+    }
+
+    SECTION("releases textures with their last handle") {
+        auto handle = TextureCreateSolid(red);
+
+        // Solid textures aren't budgeted
+        CHECK(TextureGetTexturePtr(handle)->gxTex);
+        CHECK(Texture::s_residentBytes == residentBytes);
+
+        HandleClose(handle);
+
+        CHECK(TextureCacheGetTexture(red) == nullptr);
+        CHECK(Texture::s_residentBytes == residentBytes);
+    }
+
+    SECTION("puts colors on a shared palette page") {
+        std::vector<HTEXTURE> handles;
+
+        for (uint32_t i = 0; i < 64; i++) {
+            CImVector color;
+            color.value = 0xFF000000 | (i * 0x040302);
+
+            handles.push_back(TextureCreateSolid(color, 0x4));
+        }
+
+        auto page = TextureGetTexturePtr(handles[0])->atlas;
+
+        REQUIRE(page);
+
+        for (uint32_t i = 0; i < handles.size(); i++) {
+            auto texture = TextureGetTexturePtr(handles[i]);
+
+            REQUIRE(texture->atlas == page);
+            CHECK(TextureGetGxTex(texture, 1, nullptr) == page->m_gxTex);
+
+            // The texel and its gutters all hold the color
+            C2Vector offset, scale;
+            TextureGetAtlasOffsetAndScale(texture, offset, scale);
+
+            auto x = static_cast<uint32_t>(offset.x * page->m_size);
+            auto y = static_cast<uint32_t>(offset.y * page->m_size);
+            auto texels = reinterpret_cast<uint32_t**>(page->m_images)[0];
+
+            CHECK(scale.x * page->m_size == 1.0f);
+            CHECK(texels[y * page->m_size + x] == (0xFF000000 | (i * 0x040302)));
+            CHECK(texels[(y - 1) * page->m_size + x + 1] == (0xFF000000 | (i * 0x040302)));
+
+            // Palette entries and standalone textures are cached apart
+            CImVector color;
+            color.value = 0xFF000000 | (i * 0x040302);
+
+            auto palette = TextureCreateSolid(color, 0x4);
+            auto plain = TextureCreateSolid(color);
+
+            CHECK(TextureGetTexturePtr(palette) == texture);
+            CHECK(TextureGetTexturePtr(plain) != texture);
+
+            HandleClose(palette);
+            HandleClose(plain);
+        }
+
+        for (auto handle : handles) {
+            HandleClose(handle);
+        }
+
+        CHECK(CTextureAtlas::s_atlasList.Head() == nullptr);
+    }
+
+    SECTION("shares the standalone texture when no page can be made") {
+        CGxDeviceNoPages noPages;
+
+        auto first = TextureCreateSolid(red, 0x4);
+        auto plain = TextureCreateSolid(red);
+        auto again = TextureCreateSolid(red, 0x4);
+
+        auto texture = TextureGetTexturePtr(first);
+
+        CHECK(texture->atlas == nullptr);
+        CHECK_FALSE(texture->flags & 0x4);
+        CHECK(texture->flags & 0x1);
+        CHECK(texture->gxTex);
+        CHECK(TextureGetTexturePtr(plain) == texture);
+        CHECK(TextureGetTexturePtr(again) == texture);
+        CHECK(texture->m_refcount == 3);
+
+        // File lookups never see solid textures
+        HASHKEY_TEXTUREFILE key = { texture->filename, texture->gxTexFlags };
+        CHECK(Texture::s_textureCache.Ptr(SStrHashHT(texture->filename), key) == nullptr);
+
+        HandleClose(first);
+        HandleClose(plain);
+        HandleClose(again);
+
+        CHECK(TextureCacheGetTexture(red) == nullptr);
+        CHECK(CTextureAtlas::s_atlasList.Head() == nullptr);
+    }
+}
+
+TEST_CASE("TextureCreateSolid throughput", "[gx][!benchmark]") {
+    CGxDeviceNull device;
+    TextureTestStart();
+
+    const uint32_t count = 4096;
+    std::vector<HTEXTURE> handles(count);
+
+    for (int32_t createFlags : { 0x0, 0x4 }) {
+        auto start = std::chrono::steady_clock::now();
+
+        for (uint32_t i = 0; i < count; i++) {
+            CImVector color;
+            color.value = 0xFF000000 | (i * 0x9E3779B9 & 0xFFFFFF);
+
+            handles[i] = TextureCreateSolid(color, createFlags);
+        }
+
+        auto created = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        start = std::chrono::steady_clock::now();
+
+        for (uint32_t i = 0; i < count; i++) {
+            CImVector color;
+            color.value = 0xFF000000 | (i * 0x9E3779B9 & 0xFFFFFF);
+
+            HandleClose(TextureCreateSolid(color, createFlags));
+        }
+
+        auto shared = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        uint32_t pages = 0;
+
+        for (auto atlas = CTextureAtlas::s_atlasList.Head(); atlas; atlas = CTextureAtlas::s_atlasList.Next(atlas)) {
+            pages++;
+        }
+
+        WARN(
+            count << (createFlags ? " palette" : " standalone") << " colors: " << created << " ms to create, "
+            << shared << " ms to share, " << Texture::s_residentBytes / 1024 << " KB resident, " << pages << " pages"
+        );
+
+        for (auto handle : handles) {
+            HandleClose(handle);
+        }
+    }
+}
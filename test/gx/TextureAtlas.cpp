@@ -0,0 +1,315 @@
+#include "catch.hpp"
+#include "DeviceFixture.hpp"
+#include "gx/Texture.hpp"
+#include "gx/texture/CTextureAtlas.hpp"
+#include <cmath>
+#include <new>
+#include <random>
+#include <vector>
+#include <storm/Memory.hpp>
+
+// Texel at (x, y) of level of texture id, so every texel in a page says where
+// it came from
+static uint32_t AtlasTestTexel(uint32_t id, uint32_t level, uint32_t x, uint32_t y) {
+    return (id << 24) | (level << 16) | (y << 8) | x;
+}
+
+struct AtlasTestTexture {
+    CTexture* texture;
+    MipBits* images;
+    uint32_t id;
+};
+
+static AtlasTestTexture NewAtlasTestTexture(uint32_t id, uint32_t width, uint32_t height, EGxTexFilter filter) {
+    auto m = SMemAlloc(sizeof(CTexture), __FILE__, __LINE__, 0x0);
+    auto texture = new (m) CTexture();
+    HandleCreate(texture);
+
+    texture->flags |= 0x4;
+    texture->gxWidth = width;
+    texture->gxHeight = height;
+    texture->gxTexFormat = GxTex_Argb8888;
+    texture->dataFormat = GxTex_Argb8888;
+    texture->gxTexFlags = CGxTexFlags(filter, 0, 0, 0, 0, 0, 1);
+
+    auto images = MippedImgAllocA(PIXEL_ARGB8888, width, height, __FILE__, __LINE__);
+
+    for (uint32_t level = 0; level < CalcLevelCount(width, height); level++) {
+        auto levelWidth = std::max(width >> level, 1u);
+        auto levelHeight = std::max(height >> level, 1u);
+        auto texels = reinterpret_cast<uint32_t**>(images)[level];
+
+        for (uint32_t y = 0; y < levelHeight; y++) {
+            for (uint32_t x = 0; x < levelWidth; x++) {
+                texels[y * levelWidth + x] = AtlasTestTexel(id, level, x, y);
+            }
+        }
+    }
+
+    return { texture, images, id };
+}
+
+static void DeleteAtlasTestTexture(AtlasTestTexture& test) {
+    SMemFree(test.images, __FILE__, __LINE__, 0);
+    HandleClose(test.texture);
+}
+
+static uint32_t AtlasTestPageTexel(CTextureAtlas* atlas, uint32_t level, uint32_t x, uint32_t y) {
+    auto size = std::max(atlas->m_size >> level, 1u);
+    return reinterpret_cast<uint32_t**>(atlas->m_images)[level][y * size + x];
+}
+
+// Samples every texel center of the texture through its remapped coordinates
+static void CheckAtlasTestTexture(const AtlasTestTexture& test) {
+    auto texture = test.texture;
+
+    REQUIRE(TextureOnAtlas(texture));
+
+    C2Vector offset, scale;
+    TextureGetAtlasOffsetAndScale(texture, offset, scale);
+
+    auto atlas = texture->atlas;
+    auto size = static_cast<float>(atlas->m_size);
+
+    for (uint32_t y = 0; y < texture->gxHeight; y++) {
+        for (uint32_t x = 0; x < texture->gxWidth; x++) {
+            float u = (x + 0.5f) / texture->gxWidth;
+            float v = (y + 0.5f) / texture->gxHeight;
+
+            auto pageX = static_cast<uint32_t>(std::floor((offset.x + u * scale.x) * size));
+            auto pageY = static_cast<uint32_t>(std::floor((offset.y + v * scale.y) * size));
+
+            INFO("texture " << test.id << " texel " << x << "," << y);
+            REQUIRE(AtlasTestPageTexel(atlas, 0, pageX, pageY) == AtlasTestTexel(test.id, 0, x, y));
+        }
+    }
+}
+
+TEST_CASE("CTextureAtlas", "[gx]") {
+    CGxDeviceNull device;
+
+    auto pageSize = CTextureAtlas::s_pageSize;
+    CTextureAtlas::s_pageSize = 512;
+
+    SECTION("packs random small textures densely") {
+        std::mt19937 random(7);
+        std::vector<AtlasTestTexture> tests;
+
+        auto residentBytes = Texture::s_residentBytes;
+
+        // Icons, borders and buttons: power of two sides from 8 to 128
+        for (uint32_t id = 0; id < 256; id++) {
+            auto test = NewAtlasTestTexture(id, 8u << (random() % 5), 8u << (random() % 5), GxTex_Linear);
+            auto atlas = CTextureAtlas::Get(test.texture);
+
+            REQUIRE(atlas);
+            REQUIRE(atlas->Insert(test.texture, test.images));
+            tests.push_back(test);
+        }
+
+        for (auto& test : tests) {
+            CheckAtlasTestTexture(test);
+        }
+
+        // Every page but the one still filling up
+        uint32_t pages = 0;
+        uint64_t usedArea = 0;
+
+        for (auto atlas = CTextureAtlas::s_atlasList.Head(); atlas != CTextureAtlas::s_atlasList.Tail(); atlas = CTextureAtlas::s_atlasList.Next(atlas)) {
+            pages++;
+            usedArea += atlas->m_usedArea;
+        }
+
+        REQUIRE(pages >= 2);
+
+        // Pages aren't part of the texture cache's budget
+        CHECK(Texture::s_residentBytes == residentBytes);
+
+        auto density = static_cast<double>(usedArea) / (pages * 512.0 * 512.0);
+
+        INFO(pages << " full pages at " << density * 100.0 << "%");
+        CHECK(density > 0.8);
+
+        // Everything drawn from a page shares its CGxTex
+        for (auto& test : tests) {
+            CHECK(TextureGetGxTex(test.texture, 1, nullptr) == test.texture->atlas->m_gxTex);
+        }
+
+        for (auto& test : tests) {
+            DeleteAtlasTestTexture(test);
+        }
+
+        // The last release frees the page
+        CHECK(CTextureAtlas::s_atlasList.Head() == nullptr);
+    }
+
+    SECTION("repeats edges into gutters at every mip level") {
+        auto test = NewAtlasTestTexture(1, 32, 16, GxTex_LinearMipLinear);
+        auto atlas = CTextureAtlas::Get(test.texture);
+
+        REQUIRE(atlas);
+        REQUIRE(atlas->Insert(test.texture, test.images));
+
+        CHECK(atlas->m_levelCount == CalcLevelCount(512, 512));
+        CHECK(atlas->m_padding == 4);
+
+        auto& block = atlas->m_blocks[test.texture->atlasBlockIndex];
+
+        CHECK(block.x % 4 == 0);
+        CHECK(block.y % 4 == 0);
+
+        for (uint32_t level = 0; level < 3; level++) {
+            auto gutter = atlas->m_padding >> level;
+            auto x = (block.x + atlas->m_padding) >> level;
+            auto y = (block.y + atlas->m_padding) >> level;
+            auto width = 32u >> level;
+            auto height = 16u >> level;
+
+            INFO("level " << level);
+
+            CHECK(AtlasTestPageTexel(atlas, level, x, y) == AtlasTestTexel(1, level, 0, 0));
+            CHECK(AtlasTestPageTexel(atlas, level, x + width - 1, y + height - 1) == AtlasTestTexel(1, level, width - 1, height - 1));
+
+            CHECK(AtlasTestPageTexel(atlas, level, x - gutter, y) == AtlasTestTexel(1, level, 0, 0));
+            CHECK(AtlasTestPageTexel(atlas, level, x + width + gutter - 1, y + 1) == AtlasTestTexel(1, level, width - 1, 1));
+            CHECK(AtlasTestPageTexel(atlas, level, x + 2, y - gutter) == AtlasTestTexel(1, level, 2, 0));
+            CHECK(AtlasTestPageTexel(atlas, level, x - gutter, y + height + gutter - 1) == AtlasTestTexel(1, level, 0, height - 1));
+        }
+
+        // The page went up with the texture in it
+        auto& levels = device.m_uploads[atlas->m_gxTex];
+
+        REQUIRE(levels.size() == atlas->m_levelCount);
+        CHECK(levels[0].size() == 512 * 512 * 4);
+
+        DeleteAtlasTestTexture(test);
+    }
+
+    SECTION("fills page levels past the end of a texture's chain") {
+        auto test = NewAtlasTestTexture(1, 8, 8, GxTex_LinearMipLinear);
+        auto atlas = CTextureAtlas::Get(test.texture);
+
+        REQUIRE(atlas);
+        REQUIRE(atlas->Insert(test.texture, test.images));
+
+        auto& block = atlas->m_blocks[test.texture->atlasBlockIndex];
+
+        REQUIRE(block.x == 0);
+        REQUIRE(block.y == 0);
+        REQUIRE(block.width == 16);
+
+        // An 8x8 texture has four levels; the 16x16 block still covers a
+        // texel at the fifth, which takes the color of the last one
+        CHECK(CalcLevelCount(8, 8) == 4);
+        CHECK(AtlasTestPageTexel(atlas, 4, 0, 0) == AtlasTestTexel(1, 3, 0, 0));
+
+        DeleteAtlasTestTexture(test);
+    }
+
+    SECTION("compacts pages as textures are released") {
+        std::mt19937 random(11);
+        std::vector<AtlasTestTexture> tests;
+
+        for (uint32_t id = 0; id < 40; id++) {
+            auto test = NewAtlasTestTexture(id, 16 + random() % 48, 16 + random() % 48, GxTex_Linear);
+            auto atlas = CTextureAtlas::Get(test.texture);
+
+            REQUIRE(atlas);
+            REQUIRE(atlas->Insert(test.texture, test.images));
+            tests.push_back(test);
+        }
+
+        auto atlas = tests[0].texture->atlas;
+
+        REQUIRE(CTextureAtlas::s_atlasList.Next(atlas) == nullptr);
+
+        auto skylineTop = [atlas]() {
+            uint32_t top = 0;
+
+            for (uint32_t i = 0; i < atlas->m_skyline.Count(); i++) {
+                top = std::max(top, static_cast<uint32_t>(atlas->m_skyline[i].y));
+            }
+
+            return top;
+        };
+
+        auto top = skylineTop();
+
+        // Release all but every fourth texture
+        std::vector<AtlasTestTexture> kept;
+
+        for (auto& test : tests) {
+            if (test.id % 4) {
+                DeleteAtlasTestTexture(test);
+            } else {
+                kept.push_back(test);
+            }
+        }
+
+        // Nothing moves mid-frame, where batches may have baked the layout
+        std::vector<C2Vector> offsets;
+
+        for (auto& test : kept) {
+            C2Vector offset, scale;
+            TextureGetAtlasOffsetAndScale(test.texture, offset, scale);
+            offsets.push_back(offset);
+        }
+
+        CHECK(atlas->m_compactPending);
+        CHECK(skylineTop() == top);
+
+        auto generation = CTextureAtlas::s_generation;
+
+        CTextureAtlas::Update();
+
+        CHECK(CTextureAtlas::s_generation == generation + 1);
+        CHECK_FALSE(atlas->m_compactPending);
+
+        uint32_t moved = 0;
+
+        for (uint32_t i = 0; i < kept.size(); i++) {
+            C2Vector offset, scale;
+            TextureGetAtlasOffsetAndScale(kept[i].texture, offset, scale);
+            moved += offset.x != offsets[i].x || offset.y != offsets[i].y;
+        }
+
+        CHECK(moved > 0);
+        CHECK(atlas->m_usedArea * 2 >= atlas->m_packedArea);
+        CHECK(atlas->m_liveCount == kept.size());
+        CHECK(skylineTop() < top);
+
+        for (auto& test : kept) {
+            CheckAtlasTestTexture(test);
+        }
+
+        // Room won back by repacking takes new textures on the same page
+        auto test = NewAtlasTestTexture(200, 128, 128, GxTex_Linear);
+
+        CHECK(CTextureAtlas::Get(test.texture) == atlas);
+
+        DeleteAtlasTestTexture(test);
+
+        for (auto& test : kept) {
+            DeleteAtlasTestTexture(test);
+        }
+    }
+
+    SECTION("leaves out textures it can't hold") {
+        auto large = NewAtlasTestTexture(1, 256, 64, GxTex_Linear);
+        CHECK(CTextureAtlas::Get(large.texture) == nullptr);
+        DeleteAtlasTestTexture(large);
+
+        auto wrapped = NewAtlasTestTexture(2, 64, 64, GxTex_Linear);
+        wrapped.texture->gxTexFlags.m_wrapU = 1;
+        CHECK(CTextureAtlas::Get(wrapped.texture) == nullptr);
+        DeleteAtlasTestTexture(wrapped);
+
+        auto compressed = NewAtlasTestTexture(3, 64, 64, GxTex_Linear);
+        compressed.texture->gxTexFormat = GxTex_Dxt1;
+        compressed.texture->dataFormat = GxTex_Dxt1;
+        CHECK(CTextureAtlas::Get(compressed.texture) == nullptr);
+        DeleteAtlasTestTexture(compressed);
+    }
+
+    CTextureAtlas::s_pageSize = pageSize;
+}
@@ -0,0 +1,343 @@
+#include "catch.hpp"
+#include "M2Fixture.hpp"
+#include "../async/AsyncFixture.hpp"
+#include "async/AsyncFileRead.hpp"
+#include "model/CM2Cache.hpp"
+#include "model/CM2Model.hpp"
+#include "model/CM2Scene.hpp"
+#include "model/CM2Shared.hpp"
+#include <cstdio>
+#include <vector>
+#include <storm/Atomic.hpp>
+#include <storm/String.hpp>
+
+TEST_CASE("CM2Cache::CreateShared", "[model]") {
+    M2FixtureWrite("m2cachetest.m2");
+
+    AsyncFileReadTestStart();
+
+    CM2Cache cache;
+
+    SECTION("shares one load between every request for a model") {
+        std::vector<CM2Shared*> shared;
+
+        shared.push_back(cache.CreateShared("m2cachetest.mdx", 0));
+
+        REQUIRE(shared.front());
+
+        // With the file gone, any request that opened it again would fail
+        remove("m2cachetest.m2");
+
+        // Everything asked for before the read lands queues on the pending load
+        for (uint32_t i = 1; i < 100; i++) {
+            auto s = cache.CreateShared("m2cachetest.mdx", 0);
+
+            REQUIRE(s);
+            shared.push_back(s);
+        }
+
+        CHECK(shared.front()->asyncObject);
+
+        for (auto s : shared) {
+            CHECK(s == shared.front());
+        }
+
+        CHECK(shared.front()->m_refCount == 100);
+        CHECK(cache.m_sharedLoads == 1);
+
+        while (shared.front()->asyncObject) {
+            AsyncFileReadPollHandler(nullptr, nullptr);
+        }
+
+        CHECK(shared.front()->m_m2DataLoaded);
+        CHECK(shared.front()->m_skinProfileLoaded);
+
+        // Paths differ only by case and extension after conversion
+        auto loaded = cache.CreateShared("M2CacheTest.M2", 0);
+
+        CHECK(loaded == shared.front());
+        CHECK(cache.m_sharedLoads == 1);
+
+        loaded->Release();
+
+        for (auto s : shared) {
+            s->Release();
+        }
+
+        // Once collected, the model is read again
+        cache.GarbageCollect(1);
+
+        M2FixtureWrite("m2cachetest.m2");
+
+        auto reloaded = cache.CreateShared("m2cachetest.m2", 0);
+
+        REQUIRE(reloaded);
+        CHECK(reloaded->m_refCount == 1);
+        CHECK(cache.m_sharedLoads == 2);
+
+        reloaded->Release();
+    }
+
+    SECTION("cancels a pending load when collected") {
+        auto shared = cache.CreateShared("m2cachetest.m2", 0);
+
+        REQUIRE(shared);
+        REQUIRE(shared->asyncObject);
+
+        shared->Release();
+        cache.GarbageCollect(1);
+
+        CHECK(cache.m_sharedHash.Head() == nullptr);
+
+        // Nothing left to land
+        AsyncFileReadPollHandler(nullptr, nullptr);
+    }
+
+    SECTION("fails for missing models") {
+        CHECK(cache.CreateShared("m2cachemissing.m2", 0) == nullptr);
+        CHECK(cache.m_sharedLoads == 0);
+    }
+
+    SECTION("drops failed loads and tells every waiting model") {
+        M2FixtureModelPool();
+
+        // A header M2Init rejects
+        std::vector<uint8_t> bad(sizeof(M2Data), 0);
+        auto file = fopen("m2cachebad.m2", "wb");
+        fwrite(bad.data(), 1, bad.size(), file);
+        fclose(file);
+
+        CM2Scene scene(&cache);
+
+        uint32_t calls = 0;
+        auto loaded = [](CM2Model* model, void* arg) {
+            CHECK_FALSE(model->m_loaded);
+            (*static_cast<uint32_t*>(arg))++;
+        };
+
+        auto first = scene.CreateModel("m2cachebad.m2", 0);
+        auto second = scene.CreateModel("m2cachebad.m2", 0);
+
+        REQUIRE(first);
+        REQUIRE(second);
+        REQUIRE(first->m_shared == second->m_shared);
+
+        auto shared = first->m_shared;
+
+        first->SetLoadedCallback(loaded, &calls);
+        second->SetLoadedCallback(loaded, &calls);
+
+        while (shared->asyncObject) {
+            AsyncFileReadPollHandler(nullptr, nullptr);
+        }
+
+        CHECK(calls == 2);
+        CHECK(shared->m_loadFailed);
+        CHECK(shared->m_callbackList == nullptr);
+        CHECK(cache.m_sharedHash.Head() == nullptr);
+
+        // The next request reads the file again
+        auto retry = cache.CreateShared("m2cachebad.m2", 0);
+
+        REQUIRE(retry);
+        CHECK(retry != shared);
+        CHECK(cache.m_sharedLoads == 2);
+
+        retry->Release();
+        first->Release();
+        second->Release();
+
+        cache.GarbageCollect(1);
+
+        remove("m2cachebad.m2");
+    }
+
+    cache.GarbageCollect(1);
+
+    M2FixtureRemove("m2cachetest.m2");
+}
+
+TEST_CASE("CM2Cache::SetThreadCount", "[model]") {
+    CM2Cache cache;
+    struct {
+        ATOMIC32 count = 0;
+    } runs;
+
+    auto work = [](void* arg) {
+        SInterlockedIncrement(&static_cast<decltype(runs)*>(arg)->count);
+    };
+
+    SECTION("resizes the pool and joins the workers it drops") {
+        cache.SetThreadCount(4);
+
+        REQUIRE(cache.m_threadCount == 4);
+
+        cache.BeginThread(work, &runs);
+        cache.WaitThread();
+
+        CHECK(runs.count == 4);
+
+        cache.SetThreadCount(2);
+
+        REQUIRE(cache.m_threadCount == 2);
+
+        // Only the new workers answer
+        cache.BeginThread(work, &runs);
+        cache.WaitThread();
+
+        CHECK(runs.count == 6);
+
+        cache.Shutdown();
+
+        CHECK(cache.m_threadCount == 0);
+
+        // Without workers nothing runs
+        cache.BeginThread(work, &runs);
+        cache.WaitThread();
+
+        CHECK(runs.count == 6);
+    }
+}
+
+TEST_CASE("CM2Cache::GarbageCollect", "[model]") {
+    const uint32_t modelCount = 8;
+
+    char path[STORM_MAX_PATH];
+
+    for (uint32_t i = 0; i < modelCount; i++) {
+        SStrPrintf(path, sizeof(path), "m2gctest%02u.m2", i);
+        M2FixtureWrite(path);
+    }
+
+    AsyncFileReadTestStart();
+    M2FixtureModelPool();
+
+    CM2Cache cache;
+    cache.m_gcTimeout = 60000;
+    cache.m_gcTimeBudget = 60000;
+
+    auto pending = [&cache]() {
+        uint32_t count = 0;
+
+        for (auto shared = cache.m_gcSharedList; shared; shared = shared->m_gcNext) {
+            count++;
+        }
+
+        return count;
+    };
+
+    SECTION("revives released models without reading them again") {
+        auto shared = cache.CreateShared("m2gctest00.m2", 0);
+
+        REQUIRE(shared);
+
+        shared->Release();
+
+        CHECK(shared->m_refCount == 0);
+        CHECK(cache.m_gcSharedList == shared);
+
+        // Still within the idle timeout
+        cache.GarbageCollect(0);
+
+        CHECK(cache.m_gcSharedList == shared);
+
+        CHECK(cache.CreateShared("m2gctest00.m2", 0) == shared);
+        CHECK(shared->m_refCount == 1);
+        CHECK(cache.m_gcSharedList == nullptr);
+        CHECK(cache.m_sharedLoads == 1);
+
+        shared->Release();
+    }
+
+    SECTION("frees idle models within the byte budget") {
+        std::vector<CM2Shared*> shared;
+
+        for (uint32_t i = 0; i < modelCount; i++) {
+            SStrPrintf(path, sizeof(path), "m2gctest%02u.m2", i);
+
+            auto s = cache.CreateShared(path, 0);
+
+            REQUIRE(s);
+            shared.push_back(s);
+        }
+
+        for (auto s : shared) {
+            s->Release();
+        }
+
+        cache.m_gcTimeout = 0;
+        cache.m_gcByteBudget = 3 * sizeof(M2Data);
+
+        cache.GarbageCollect(0);
+        CHECK(pending() == modelCount - 3);
+
+        // Oldest first
+        CHECK(cache.m_gcSharedList == shared[3]);
+
+        // A budget below one model still makes progress
+        cache.m_gcByteBudget = 1;
+
+        cache.GarbageCollect(0);
+        CHECK(pending() == modelCount - 4);
+
+        cache.m_gcByteBudget = 0x100000;
+
+        cache.GarbageCollect(0);
+        CHECK(pending() == 0);
+        CHECK(cache.m_sharedHash.Head() == nullptr);
+    }
+
+    SECTION("defers freeing released model instances") {
+        CM2Scene scene(&cache);
+
+        auto model = scene.CreateModel("m2gctest00.m2", 0);
+
+        REQUIRE(model);
+
+        auto shared = model->m_shared;
+
+        CHECK(shared->m_refCount == 1);
+
+        model->Release();
+
+        CHECK(scene.m_modelList == nullptr);
+        CHECK(shared->m_callbackList == nullptr);
+        CHECK(cache.m_gcModelList == model);
+
+        // Freeing the model releases its shared data, which then ages
+        cache.GarbageCollect(0);
+
+        CHECK(cache.m_gcModelList == nullptr);
+        CHECK(shared->m_refCount == 0);
+        CHECK(cache.m_gcSharedList == shared);
+    }
+
+    SECTION("flushes everything at shutdown") {
+        CM2Scene scene(&cache);
+
+        for (uint32_t i = 0; i < modelCount; i++) {
+            SStrPrintf(path, sizeof(path), "m2gctest%02u.m2", i);
+
+            auto model = scene.CreateModel(path, 0);
+
+            REQUIRE(model);
+
+            model->Release();
+        }
+
+        cache.m_gcByteBudget = 1;
+
+        cache.GarbageCollect(1);
+
+        CHECK(cache.m_gcModelList == nullptr);
+        CHECK(cache.m_gcSharedList == nullptr);
+        CHECK(cache.m_sharedHash.Head() == nullptr);
+    }
+
+    cache.GarbageCollect(1);
+
+    for (uint32_t i = 0; i < modelCount; i++) {
+        SStrPrintf(path, sizeof(path), "m2gctest%02u.m2", i);
+        M2FixtureRemove(path);
+    }
+}
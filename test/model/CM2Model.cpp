@@ -0,0 +1,235 @@
+#include "catch.hpp"
+#include "M2Fixture.hpp"
+#include "../async/AsyncFixture.hpp"
+#include "model/CM2Cache.hpp"
+#include "model/CM2Model.hpp"
+#include "model/CM2Scene.hpp"
+#include "model/M2Model.hpp"
+#include <chrono>
+#include <cstddef>
+#include <random>
+#include <vector>
+
+// Lays out a track with one key time array per sequence, with the relative
+// offsets M2Init leaves behind
+static M2TrackBase& CM2ModelTestTrack(std::vector<uint8_t>& blob, const std::vector<std::vector<uint32_t>>& sequences, uint16_t loopIndex) {
+    auto trackOffset = M2FixtureAppend(blob, sizeof(M2TrackBase));
+    auto timesOffset = M2FixtureAppend(blob, sizeof(M2SequenceTimes) * sequences.size());
+
+    std::vector<uint32_t> dataOffsets;
+
+    for (auto& times : sequences) {
+        dataOffsets.push_back(M2FixtureAppend(blob, sizeof(uint32_t) * times.size()));
+    }
+
+    auto& track = M2FixtureAt<M2TrackBase>(blob, trackOffset);
+    track.trackType = 1;
+    track.loopIndex = loopIndex;
+    track.sequenceTimes = { static_cast<uint32_t>(sequences.size()), static_cast<uint32_t>(timesOffset - trackOffset - offsetof(M2TrackBase, sequenceTimes)) };
+
+    for (uint32_t i = 0; i < sequences.size(); i++) {
+        auto seqTimesOffset = timesOffset + sizeof(M2SequenceTimes) * i;
+
+        M2FixtureAt<M2SequenceTimes>(blob, seqTimesOffset).times = { static_cast<uint32_t>(sequences[i].size()), dataOffsets[i] - seqTimesOffset };
+
+        for (uint32_t j = 0; j < sequences[i].size(); j++) {
+            M2FixtureAt<uint32_t>(blob, dataOffsets[i] + sizeof(uint32_t) * j) = sequences[i][j];
+        }
+    }
+
+    return track;
+}
+
+// Keys every step ms, with a little jitter so the spacing is uneven
+static std::vector<uint32_t> CM2ModelTestTimes(uint32_t count, uint32_t step, uint32_t seed) {
+    std::mt19937 random(seed);
+    std::vector<uint32_t> times;
+    uint32_t time = 0;
+
+    for (uint32_t i = 0; i < count; i++) {
+        times.push_back(time);
+        time += step + random() % step;
+    }
+
+    return times;
+}
+
+// What FindKey must find, by walking every key
+static void CM2ModelTestExpectKey(const std::vector<uint32_t>& times, uint32_t time, uint32_t& key, uint32_t& nextKey, float& ratio) {
+    key = 0;
+
+    while (key + 1 < times.size() && times[key + 1] <= time) {
+        key++;
+    }
+
+    if (key + 1 >= times.size() || time < times[key]) {
+        nextKey = key;
+        ratio = 0.0f;
+    } else {
+        nextKey = key + 1;
+        ratio = static_cast<float>(time - times[key]) / static_cast<float>(times[key + 1] - times[key]);
+    }
+}
+
+static void CM2ModelTestCheckKey(CM2Model* model, M2ModelBoneSeq& sequence, const M2TrackBase& track, M2ModelTrackBase& modelTrack, const std::vector<uint32_t>& times, uint32_t time) {
+    uint32_t nextKey;
+    float ratio;
+    model->FindKey(&sequence, track, modelTrack, nextKey, ratio);
+
+    uint32_t expectedKey;
+    uint32_t expectedNextKey;
+    float expectedRatio;
+    CM2ModelTestExpectKey(times, time, expectedKey, expectedNextKey, expectedRatio);
+
+    INFO("time " << time);
+    REQUIRE(modelTrack.currentKey == expectedKey);
+    REQUIRE(nextKey == expectedNextKey);
+    REQUIRE(ratio == expectedRatio);
+}
+
+static CM2Model* CM2ModelTestLoad(CM2Scene& scene) {
+    M2FixtureModelPool();
+    M2FixtureWriteSkeleton("cm2modeltest.m2", 1, 2, 100);
+
+    AsyncFileReadTestStart();
+
+    return M2FixtureLoad(scene, "cm2modeltest.m2")[0];
+}
+
+TEST_CASE("CM2Model::FindKey", "[model]") {
+    CM2Cache cache;
+    CM2Scene scene(&cache);
+    auto model = CM2ModelTestLoad(scene);
+
+    auto times0 = CM2ModelTestTimes(300, 10, 1);
+    auto times1 = CM2ModelTestTimes(40, 50, 2);
+
+    std::vector<uint8_t> blob;
+    auto& track = CM2ModelTestTrack(blob, { times0, times1 }, 0xFFFF);
+
+    M2ModelBoneSeq sequence;
+    sequence.uint4 = 0;
+
+    M2ModelTrackBase modelTrack;
+
+    SECTION("follows playback across wraparound") {
+        for (uint32_t loop = 0; loop < 3; loop++) {
+            for (uint32_t time = 0; time < times0.back() + 40; time += 7 + loop) {
+                sequence.uint0 = time;
+                CM2ModelTestCheckKey(model, sequence, track, modelTrack, times0, time);
+            }
+        }
+    }
+
+    SECTION("finds the key after backward and forward seeks") {
+        std::mt19937 random(3);
+
+        for (uint32_t i = 0; i < 2000; i++) {
+            auto time = random() % (times0.back() + 100);
+
+            sequence.uint0 = time;
+            CM2ModelTestCheckKey(model, sequence, track, modelTrack, times0, time);
+
+            // A few frames of playback from where the seek landed
+            for (uint32_t frame = 0; frame < 3; frame++) {
+                time += 16;
+                sequence.uint0 = time;
+                CM2ModelTestCheckKey(model, sequence, track, modelTrack, times0, time);
+            }
+        }
+    }
+
+    SECTION("searches again when the sequence changes") {
+        for (uint32_t time = 0; time < times1.back(); time += 13) {
+            sequence.uint0 = time;
+            sequence.uint4 = (time / 130) % 2;
+
+            CM2ModelTestCheckKey(model, sequence, track, modelTrack, sequence.uint4 ? times1 : times0, time);
+            CHECK(modelTrack.currentSequence == sequence.uint4);
+        }
+    }
+
+    SECTION("plays global loops from the model's loop times") {
+        std::vector<uint8_t> loopBlob;
+        auto& loopTrack = CM2ModelTestTrack(loopBlob, { times1 }, 0);
+
+        uint32_t loops[] = { 0 };
+        auto modelLoops = model->m_loops;
+        model->m_loops = loops;
+
+        for (uint32_t time = 0; time < times1.back() * 3; time += 11) {
+            loops[0] = time % times1.back();
+            CM2ModelTestCheckKey(model, sequence, loopTrack, modelTrack, times1, loops[0]);
+        }
+
+        model->m_loops = modelLoops;
+    }
+
+    SECTION("holds the only key of single key tracks") {
+        std::vector<uint8_t> singleBlob;
+        auto& singleTrack = CM2ModelTestTrack(singleBlob, { { 0 } }, 0xFFFF);
+
+        sequence.uint0 = 500;
+        modelTrack.currentKey = 7;
+
+        uint32_t nextKey;
+        float ratio;
+        model->FindKey(&sequence, singleTrack, modelTrack, nextKey, ratio);
+
+        CHECK(modelTrack.currentKey == 0);
+        CHECK(nextKey == 0);
+        CHECK(ratio == 0.0f);
+    }
+
+    model->Release();
+    cache.GarbageCollect(1);
+}
+
+TEST_CASE("CM2Model::FindKey throughput", "[model][!benchmark]") {
+    CM2Cache cache;
+    CM2Scene scene(&cache);
+    auto model = CM2ModelTestLoad(scene);
+
+    // A long track: 16384 keys over about four minutes
+    auto times = CM2ModelTestTimes(16384, 10, 4);
+
+    std::vector<uint8_t> blob;
+    auto& track = CM2ModelTestTrack(blob, { times }, 0xFFFF);
+
+    std::mt19937 random(5);
+    std::vector<uint32_t> seeks;
+
+    for (uint32_t i = 0; i < 4096; i++) {
+        seeks.push_back(random() % times.back());
+    }
+
+    auto time = [&](bool seek) {
+        M2ModelBoneSeq sequence;
+        sequence.uint4 = 0;
+
+        M2ModelTrackBase modelTrack;
+        uint32_t nextKey;
+        float ratio;
+        uint32_t lookups = 0;
+
+        auto start = std::chrono::steady_clock::now();
+
+        for (uint32_t pass = 0; pass < 20; pass++) {
+            for (uint32_t i = 0; i < seeks.size(); i++) {
+                sequence.uint0 = seek ? seeks[i] : (i * 16 + pass) % times.back();
+                model->FindKey(&sequence, track, modelTrack, nextKey, ratio);
+                lookups++;
+            }
+        }
+
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / lookups;
+    };
+
+    auto playback = time(false);
+    auto seek = time(true);
+
+    WARN("16384 keys: " << playback << " ns per lookup during playback, " << seek << " ns per lookup after a seek");
+
+    model->Release();
+    cache.GarbageCollect(1);
+}
@@ -0,0 +1,479 @@
+#include "catch.hpp"
+#include "M2Fixture.hpp"
+#include "../async/AsyncFixture.hpp"
+#include "../gx/DeviceFixture.hpp"
+#include "gx/Transform.hpp"
+#include "model/CM2Cache.hpp"
+#include "model/CM2Model.hpp"
+#include "model/CM2Scene.hpp"
+#include "model/CM2Shared.hpp"
+#include "model/M2Model.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+#include <tempest/Math.hpp>
+
+// A camera at the origin looking down z, seeing 45 degrees to either side
+static void M2SceneTestCamera() {
+    C44Matrix projection;
+    GxuXformCreateProjection_Exact(CMath::PI * 0.5f, 1.0f, 0.1f, 1000.0f, projection);
+    GxXformSetProjection(projection);
+
+    C44Matrix view;
+    GxXformSetView(view);
+}
+
+// Bezier (2) or Hermite (3) between two keys, in the basis form
+static float M2SceneTestSpline(uint16_t trackType, float p0, float outTan, float inTan, float p1, float t) {
+    float s = 1.0f - t;
+
+    if (trackType == 2) {
+        return s * s * s * p0 + 3.0f * s * s * t * outTan + 3.0f * s * t * t * inTan + t * t * t * p1;
+    }
+
+    float t2 = t * t;
+    float t3 = t2 * t;
+
+    return (2.0f * t3 - 3.0f * t2 + 1.0f) * p0 + (t3 - 2.0f * t2 + t) * outTan + (-2.0f * t3 + 3.0f * t2) * p1 + (t3 - t2) * inTan;
+}
+
+TEST_CASE("CM2Scene::Animate", "[model]") {
+    CGxDeviceNull device;
+    M2FixtureModelPool();
+    M2FixtureWriteSkeleton("m2scenetest.m2", 31, 12, 1000);
+
+    AsyncFileReadTestStart();
+
+    SECTION("animates the same bones on one thread and on many") {
+        CM2Cache singleCache;
+        singleCache.m_flags |= 0x4;
+
+        CM2Cache threadedCache;
+        threadedCache.m_flags |= 0x4;
+        threadedCache.SetThreadCount(4);
+
+        REQUIRE(threadedCache.m_threadCount == 4);
+
+        CM2Scene singleScene(&singleCache);
+        CM2Scene threadedScene(&threadedCache);
+
+        auto singleModels = M2FixtureModels(singleScene, "m2scenetest.m2", 96);
+        auto threadedModels = M2FixtureModels(threadedScene, "m2scenetest.m2", 96);
+
+        for (uint32_t frame = 0; frame < 20; frame++) {
+            M2FixtureFrame(singleScene, singleModels, 33 + frame);
+            M2FixtureFrame(threadedScene, threadedModels, 33 + frame);
+
+            for (uint32_t i = 0; i < singleModels.size(); i++) {
+                INFO("frame " << frame << " model " << i);
+                REQUIRE(memcmp(singleModels[i]->m_boneMatrices, threadedModels[i]->m_boneMatrices, sizeof(C44Matrix) * 31) == 0);
+            }
+        }
+
+        // Something actually moved
+        CHECK(memcmp(&singleModels[0]->m_boneMatrices[30], &singleModels[1]->m_boneMatrices[30], sizeof(C44Matrix)) != 0);
+
+        M2FixtureRelease(singleCache, singleModels);
+        M2FixtureRelease(threadedCache, threadedModels);
+
+        threadedCache.Shutdown();
+
+        CHECK(threadedCache.m_threadCount == 0);
+    }
+
+    SECTION("spreads chunks over every slice") {
+        CM2Cache cache;
+        CM2Scene scene(&cache);
+
+        auto models = M2FixtureModels(scene, "m2scenetest.m2", 40);
+
+        for (auto model : models) {
+            model->SetAnimating(1);
+        }
+
+        scene.SplitAnimateList(5);
+
+        REQUIRE(scene.m_animateModels.Count() == 40);
+        CHECK(scene.m_animateChunks.Count() > 5);
+
+        for (uint32_t i = 0; i < 5; i++) {
+            CHECK(scene.m_animateSlices[i].end > scene.m_animateSlices[i].next);
+        }
+
+        CHECK(scene.m_animateSlices[4].end == scene.m_animateChunks.Count() - 1);
+
+        for (auto model : models) {
+            model->SetAnimating(0);
+        }
+
+        M2FixtureRelease(cache, models);
+    }
+}
+
+TEST_CASE("CM2Scene::Animate spline bone tracks", "[model]") {
+    CGxDeviceNull device;
+    M2FixtureModelPool();
+
+    AsyncFileReadTestStart();
+
+    auto trackType = GENERATE(static_cast<uint16_t>(2), static_cast<uint16_t>(3));
+    INFO("track type " << trackType);
+
+    const uint32_t keyCount = 5;
+    const uint32_t duration = 1000;
+    const uint32_t keyTime = duration / (keyCount - 1);
+
+    M2FixtureWriteSkeleton("m2scenespline.m2", 1, keyCount, duration, trackType);
+
+    CM2Cache cache;
+    CM2Scene scene(&cache);
+
+    auto models = M2FixtureModels(scene, "m2scenespline.m2", 1);
+    auto& bone = models[0]->m_bones[0];
+
+    uint32_t curved = 0;
+
+    for (uint32_t frame = 0; frame < 40; frame++) {
+        M2FixtureFrame(scene, models, 29);
+
+        uint32_t time = bone.sequence.uint0;
+        uint32_t key = std::min(time / keyTime, keyCount - 2);
+        float t = static_cast<float>(time - key * keyTime) / keyTime;
+
+        auto start = M2FixtureSplineTranslation(0, key);
+        auto end = M2FixtureSplineTranslation(0, key + 1);
+
+        C3Vector expected = {
+            M2SceneTestSpline(trackType, start.value.x, start.outTan.x, end.inTan.x, end.value.x, t),
+            M2SceneTestSpline(trackType, start.value.y, start.outTan.y, end.inTan.y, end.value.y, t),
+            M2SceneTestSpline(trackType, start.value.z, start.outTan.z, end.inTan.z, end.value.z, t)
+        };
+
+        INFO("frame " << frame << " time " << time);
+
+        auto& value = bone.translationTrack.currentValue;
+        CHECK(value.x == Approx(expected.x).margin(1e-4));
+        CHECK(value.y == Approx(expected.y).margin(1e-4));
+        CHECK(value.z == Approx(expected.z).margin(1e-4));
+
+        float linearX = start.value.x + t * (end.value.x - start.value.x);
+        curved += fabsf(value.x - linearX) > 1e-2f;
+    }
+
+    // Not just the straight line between the keys
+    CHECK(curved > 0);
+
+    M2FixtureRelease(cache, models);
+    M2FixtureRemove("m2scenespline.m2");
+}
+
+TEST_CASE("CM2Scene::Animate levels of detail", "[model]") {
+    CGxDeviceNull device;
+    M2FixtureModelPool();
+    M2FixtureWriteSkeleton("m2scenelod.m2", 15, 12, 1000);
+    M2SceneTestCamera();
+
+    AsyncFileReadTestStart();
+
+    // Four close by, three past the reduced distance, one past the skip
+    // distance, one behind the camera and one off to the side
+    C3Vector positions[] = {
+        { 0.0f, 0.0f, 10.0f },
+        { 2.0f, 0.0f, 15.0f },
+        { -3.0f, 1.0f, 20.0f },
+        { 0.0f, -2.0f, 25.0f },
+        { 0.0f, 0.0f, 100.0f },
+        { 20.0f, 0.0f, 120.0f },
+        { 0.0f, 30.0f, 150.0f },
+        { 0.0f, 0.0f, 500.0f },
+        { 0.0f, 0.0f, -20.0f },
+        { 100.0f, 0.0f, 10.0f }
+    };
+
+    CM2Cache referenceCache;
+    CM2Cache lodCache;
+    lodCache.m_animateCull = 1;
+    lodCache.m_animateReducedDistance = 50.0f;
+    lodCache.m_animateReducedInterval = 100;
+    lodCache.m_animateSkipDistance = 200.0f;
+
+    CM2Scene referenceScene(&referenceCache);
+    CM2Scene lodScene(&lodCache);
+
+    auto referenceModels = M2FixtureModels(referenceScene, "m2scenelod.m2", 10);
+    auto lodModels = M2FixtureModels(lodScene, "m2scenelod.m2", 10);
+
+    for (uint32_t i = 0; i < 10; i++) {
+        referenceModels[i]->SetWorldTransform(positions[i], 0.0f, 1.0f);
+        lodModels[i]->SetWorldTransform(positions[i], 0.0f, 1.0f);
+    }
+
+    SECTION("sorts models by where they are in view") {
+        M2FixtureFrame(lodScene, lodModels, 20);
+
+        CHECK(lodScene.m_animateCounts[M2ANIMATE_FULL] == 4);
+        CHECK(lodScene.m_animateCounts[M2ANIMATE_REDUCED] == 3);
+        CHECK(lodScene.m_animateCounts[M2ANIMATE_SKIPPED] == 3);
+
+        for (uint32_t i = 0; i < 10; i++) {
+            INFO("model " << i);
+            CHECK(lodModels[i]->m_animateLod == (i < 4 ? M2ANIMATE_FULL : i < 7 ? M2ANIMATE_REDUCED : M2ANIMATE_SKIPPED));
+        }
+
+        // Threaded scenes only hand out the models to animate
+        lodCache.m_flags |= 0x4;
+        M2FixtureFrame(lodScene, lodModels, 20);
+
+        CHECK(lodScene.m_animateModels.Count() == 7);
+        CHECK(lodScene.m_animateCounts[M2ANIMATE_SKIPPED] == 3);
+    }
+
+    SECTION("animates close models as the reference and blends distant ones") {
+        C44Matrix rest;
+
+        for (uint32_t frame = 0; frame < 20; frame++) {
+            M2FixtureFrame(referenceScene, referenceModels, 20);
+            M2FixtureFrame(lodScene, lodModels, 20);
+
+            for (uint32_t i = 0; i < 4; i++) {
+                INFO("frame " << frame << " model " << i);
+                REQUIRE(memcmp(referenceModels[i]->m_boneMatrices, lodModels[i]->m_boneMatrices, sizeof(C44Matrix) * 15) == 0);
+            }
+
+            // Distant models start from the current pose, then trail it by
+            // no more than one update
+            for (uint32_t i = 4; i < 7; i++) {
+                INFO("frame " << frame << " model " << i);
+
+                if (frame == 0) {
+                    CHECK(M2FixtureBoneError(referenceModels[i], lodModels[i], 15) < 1e-3f);
+                } else {
+                    CHECK(M2FixtureBoneError(referenceModels[i], lodModels[i], 15) > 0.0f);
+                }
+            }
+
+            for (uint32_t i = 7; i < 10; i++) {
+                INFO("frame " << frame << " model " << i);
+                REQUIRE(memcmp(&lodModels[i]->m_boneMatrices[14], &rest, sizeof(C44Matrix)) == 0);
+            }
+        }
+
+        // Between updates, distant models move a little every frame
+        C44Matrix before = lodModels[4]->m_boneMatrices[14];
+        M2FixtureFrame(referenceScene, referenceModels, 20);
+        M2FixtureFrame(lodScene, lodModels, 20);
+
+        CHECK(memcmp(&before, &lodModels[4]->m_boneMatrices[14], sizeof(C44Matrix)) != 0);
+    }
+
+    SECTION("blends distant bones as rotations") {
+        for (uint32_t frame = 0; frame < 20; frame++) {
+            M2FixtureFrame(lodScene, lodModels, 20);
+
+            // The bones only scale uniformly, so a blended rotation leaves
+            // every axis square to the others and the same length
+            for (uint32_t i = 4; i < 7; i++) {
+                for (uint32_t j = 0; j < 15; j++) {
+                    INFO("frame " << frame << " model " << i << " bone " << j);
+
+                    auto& matrix = lodModels[i]->m_boneMatrices[j];
+                    C3Vector a = { matrix.a0, matrix.a1, matrix.a2 };
+                    C3Vector b = { matrix.b0, matrix.b1, matrix.b2 };
+                    C3Vector c = { matrix.c0, matrix.c1, matrix.c2 };
+
+                    float length = a.Mag();
+                    CHECK(b.Mag() == Approx(length).epsilon(1e-4));
+                    CHECK(c.Mag() == Approx(length).epsilon(1e-4));
+
+                    CHECK(fabsf(a.x * b.x + a.y * b.y + a.z * b.z) < 1e-4f * length * length);
+                    CHECK(fabsf(a.x * c.x + a.y * c.y + a.z * c.z) < 1e-4f * length * length);
+                    CHECK(fabsf(b.x * c.x + b.y * c.y + b.z * c.z) < 1e-4f * length * length);
+                }
+            }
+        }
+    }
+
+    SECTION("gives attachments the level of detail of the model they hang off") {
+        auto attachments = M2FixtureModels(lodScene, "m2scenelod.m2", 4);
+
+        attachments[0]->m_attachParent = lodModels[0];
+        attachments[1]->m_attachParent = lodModels[4];
+        attachments[2]->m_attachParent = lodModels[7];
+        attachments[3]->m_attachParent = attachments[2];
+
+        auto models = lodModels;
+        models.insert(models.end(), attachments.begin(), attachments.end());
+
+        M2FixtureFrame(lodScene, models, 20);
+
+        CHECK(attachments[0]->m_animateLod == M2ANIMATE_FULL);
+        CHECK(attachments[1]->m_animateLod == M2ANIMATE_REDUCED);
+        CHECK(attachments[2]->m_animateLod == M2ANIMATE_SKIPPED);
+        CHECK(attachments[3]->m_animateLod == M2ANIMATE_SKIPPED);
+
+        CHECK(lodScene.m_animateCounts[M2ANIMATE_FULL] == 5);
+        CHECK(lodScene.m_animateCounts[M2ANIMATE_REDUCED] == 4);
+        CHECK(lodScene.m_animateCounts[M2ANIMATE_SKIPPED] == 5);
+
+        for (auto attachment : attachments) {
+            attachment->m_attachParent = nullptr;
+        }
+
+        M2FixtureRelease(lodCache, attachments);
+    }
+
+    SECTION("starts reduced models over when they drop back from full") {
+        // Reduced updates at 25 and 125, then full for one and a half
+        // intervals, so the last update is less than two intervals old
+        for (uint32_t frame = 0; frame < 5; frame++) {
+            M2FixtureFrame(referenceScene, referenceModels, 25);
+            M2FixtureFrame(lodScene, lodModels, 25);
+        }
+
+        C3Vector close = { 0.0f, 0.0f, 10.0f };
+        lodModels[4]->SetWorldTransform(close, 0.0f, 1.0f);
+        referenceModels[4]->SetWorldTransform(close, 0.0f, 1.0f);
+
+        for (uint32_t frame = 0; frame < 6; frame++) {
+            M2FixtureFrame(referenceScene, referenceModels, 25);
+            M2FixtureFrame(lodScene, lodModels, 25);
+        }
+
+        REQUIRE(lodModels[4]->m_animateLod == M2ANIMATE_FULL);
+
+        lodModels[4]->SetWorldTransform(positions[4], 0.0f, 1.0f);
+        referenceModels[4]->SetWorldTransform(positions[4], 0.0f, 1.0f);
+
+        M2FixtureFrame(referenceScene, referenceModels, 25);
+        M2FixtureFrame(lodScene, lodModels, 25);
+
+        REQUIRE(lodModels[4]->m_animateLod == M2ANIMATE_REDUCED);
+        CHECK(memcmp(referenceModels[4]->m_boneMatrices, lodModels[4]->m_boneMatrices, sizeof(C44Matrix) * 15) == 0);
+    }
+
+    SECTION("catches skipped models up when they come back into view") {
+        for (uint32_t frame = 0; frame < 10; frame++) {
+            M2FixtureFrame(referenceScene, referenceModels, 33);
+            M2FixtureFrame(lodScene, lodModels, 33);
+        }
+
+        C3Vector inView = { 0.0f, 0.0f, 30.0f };
+        referenceModels[8]->SetWorldTransform(inView, 0.0f, 1.0f);
+        lodModels[8]->SetWorldTransform(inView, 0.0f, 1.0f);
+
+        C3Vector closer = { 0.0f, 0.0f, 60.0f };
+        referenceModels[7]->SetWorldTransform(closer, 0.0f, 1.0f);
+        lodModels[7]->SetWorldTransform(closer, 0.0f, 1.0f);
+
+        M2FixtureFrame(referenceScene, referenceModels, 33);
+        M2FixtureFrame(lodScene, lodModels, 33);
+
+        CHECK(lodScene.m_animateCounts[M2ANIMATE_FULL] == 5);
+        CHECK(lodScene.m_animateCounts[M2ANIMATE_REDUCED] == 4);
+        CHECK(lodScene.m_animateCounts[M2ANIMATE_SKIPPED] == 1);
+
+        CHECK(memcmp(referenceModels[8]->m_boneMatrices, lodModels[8]->m_boneMatrices, sizeof(C44Matrix) * 15) == 0);
+        CHECK(M2FixtureBoneError(referenceModels[7], lodModels[7], 15) < 1e-3f);
+    }
+
+    M2FixtureRelease(referenceCache, referenceModels);
+    M2FixtureRelease(lodCache, lodModels);
+}
+
+TEST_CASE("CM2Scene::Animate throughput", "[model][!benchmark]") {
+    CGxDeviceNull device;
+    M2FixtureModelPool();
+    M2FixtureWriteSkeleton("m2scenebench.m2", 63, 24, 2000);
+
+    AsyncFileReadTestStart();
+
+    auto animate = [](uint32_t threads) {
+        CM2Cache cache;
+        cache.m_flags |= 0x4;
+        cache.SetThreadCount(threads);
+
+        CM2Scene scene(&cache);
+
+        auto models = M2FixtureModels(scene, "m2scenebench.m2", 400);
+
+        auto start = std::chrono::steady_clock::now();
+
+        for (uint32_t frame = 0; frame < 100; frame++) {
+            M2FixtureFrame(scene, models, 16);
+        }
+
+        auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        M2FixtureRelease(cache, models);
+        cache.Shutdown();
+
+        return elapsed / 100.0;
+    };
+
+    auto single = animate(0);
+    auto threaded = animate(3);
+
+    WARN("400 models, 63 bones: " << single << " ms per frame on one thread, " << threaded << " ms on four");
+}
+
+TEST_CASE("CM2Scene::Animate levels of detail throughput", "[model][!benchmark]") {
+    CGxDeviceNull device;
+    M2FixtureModelPool();
+    M2FixtureWriteSkeleton("m2scenelodbench.m2", 63, 24, 2000);
+    M2SceneTestCamera();
+
+    AsyncFileReadTestStart();
+
+    auto animate = [](int32_t lod, uint32_t* counts) {
+        CM2Cache cache;
+
+        if (lod) {
+            cache.m_animateCull = 1;
+            cache.m_animateReducedDistance = 60.0f;
+            cache.m_animateReducedInterval = 100;
+            cache.m_animateSkipDistance = 150.0f;
+        }
+
+        CM2Scene scene(&cache);
+
+        auto models = M2FixtureModels(scene, "m2scenelodbench.m2", 400);
+
+        // Scattered all around the camera, out to 150 yards
+        std::mt19937 random(1);
+        std::uniform_real_distribution<float> unit(-150.0f, 150.0f);
+
+        for (auto model : models) {
+            C3Vector position = { unit(random), unit(random) * 0.1f, unit(random) };
+            model->SetWorldTransform(position, 0.0f, 1.0f);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+
+        for (uint32_t frame = 0; frame < 100; frame++) {
+            M2FixtureFrame(scene, models, 16);
+        }
+
+        auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        for (uint32_t i = 0; i < M2ANIMATE_COUNT; i++) {
+            counts[i] = scene.m_animateCounts[i];
+        }
+
+        M2FixtureRelease(cache, models);
+
+        return elapsed / 100.0;
+    };
+
+    uint32_t counts[M2ANIMATE_COUNT];
+
+    auto full = animate(0, counts);
+    auto lod = animate(1, counts);
+
+    WARN(
+        "400 models, 63 bones: " << full << " ms per frame animating all of them, " << lod << " ms with "
+        << counts[M2ANIMATE_FULL] << " full, " << counts[M2ANIMATE_REDUCED] << " reduced and " << counts[M2ANIMATE_SKIPPED] << " skipped"
+    );
+}
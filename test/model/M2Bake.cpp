@@ -0,0 +1,234 @@
+#include "catch.hpp"
+#include "M2Fixture.hpp"
+#include "../async/AsyncFixture.hpp"
+#include "model/CM2Cache.hpp"
+#include "model/CM2Model.hpp"
+#include "model/CM2Scene.hpp"
+#include "model/CM2Shared.hpp"
+#include "model/M2Animate.hpp"
+#include "model/M2Bake.hpp"
+#include "model/M2Model.hpp"
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+
+TEST_CASE("M2BakeHalf", "[model]") {
+    SECTION("keeps values a half holds exactly") {
+        for (float value : { 0.0f, -0.0f, 1.0f, -2.5f, 0.333251953125f, 65504.0f, 6.103515625e-05f, 5.9604644775390625e-08f }) {
+            INFO(value);
+            CHECK(M2BakeFloat(M2BakeHalf(value)) == value);
+        }
+    }
+
+    SECTION("rounds everything else to the nearest half") {
+        std::mt19937 random(1);
+        std::uniform_real_distribution<float> unit(-1000.0f, 1000.0f);
+
+        for (uint32_t i = 0; i < 10000; i++) {
+            float value = unit(random);
+
+            INFO(value);
+            CHECK(fabsf(M2BakeFloat(M2BakeHalf(value)) - value) <= fabsf(value) * (1.0f / 2048.0f));
+        }
+    }
+
+    SECTION("saturates past the largest half") {
+        CHECK(std::isinf(M2BakeFloat(M2BakeHalf(1.0e6f))));
+        CHECK(M2BakeFloat(M2BakeHalf(1.0e-10f)) == 0.0f);
+    }
+}
+
+TEST_CASE("M2BakeSequence", "[model]") {
+    M2FixtureModelPool();
+    // The fixture's keys turn sharply, so sampling them closely enough for
+    // the default tolerance would take a 2 ms interval
+    M2FixtureWriteSkeleton("m2baketest.m2", 31, 12, 1000);
+
+    AsyncFileReadTestStart();
+
+    SECTION("animates bones as exact evaluation does") {
+        CM2Cache exactCache;
+        CM2Cache bakedCache;
+        bakedCache.m_bakeInterval = 5;
+        bakedCache.m_bakeTolerance = 0.02f;
+
+        CM2Scene exactScene(&exactCache);
+        CM2Scene bakedScene(&bakedCache);
+
+        auto exactModels = M2FixtureModels(exactScene, "m2baketest.m2", 8);
+        auto bakedModels = M2FixtureModels(bakedScene, "m2baketest.m2", 8);
+
+        auto shared = bakedModels[0]->m_shared;
+        auto baked = shared->GetBakedSequence(0);
+
+        REQUIRE(baked);
+        CHECK(baked->m_sampleCount == 202);
+        CHECK(bakedCache.m_bakeSize == baked->m_size);
+        CHECK(exactModels[0]->m_shared->GetBakedSequence(0) == nullptr);
+
+        float largestError = 0.0f;
+
+        for (uint32_t frame = 0; frame < 60; frame++) {
+            M2FixtureFrame(exactScene, exactModels, 33 + frame);
+            M2FixtureFrame(bakedScene, bakedModels, 33 + frame);
+
+            for (uint32_t i = 0; i < exactModels.size(); i++) {
+                largestError = std::max(largestError, M2FixtureBoneError(exactModels[i], bakedModels[i], 31));
+            }
+        }
+
+        // Errors compound down the five levels of the skeleton
+        CHECK(largestError > 0.0f);
+        CHECK(largestError < 0.05f);
+
+        M2FixtureRelease(exactCache, exactModels);
+        M2FixtureRelease(bakedCache, bakedModels);
+
+        CHECK(bakedCache.m_bakeSize == 0);
+    }
+
+    SECTION("samples the keys within the tolerance") {
+        CM2Cache cache;
+        cache.m_bakeInterval = 5;
+        cache.m_bakeTolerance = 0.02f;
+
+        CM2Scene scene(&cache);
+        auto models = M2FixtureModels(scene, "m2baketest.m2", 1);
+        auto data = models[0]->m_shared->m_data;
+        auto baked = models[0]->m_shared->GetBakedSequence(0);
+
+        REQUIRE(baked);
+
+        // Keys fall every 1000 / 11 ms, so on them and between two samples is
+        // where the bake strays from them the most
+        std::vector<uint32_t> times;
+
+        for (uint32_t time = 0; time <= 1000; time += 3) {
+            times.push_back(time);
+        }
+
+        auto& keyTimes = data->bones[0].translationTrack.sequenceTimes[0].times;
+
+        for (uint32_t i = 0; i < keyTimes.Count(); i++) {
+            times.push_back(keyTimes[i]);
+        }
+
+        for (auto time : times) {
+            for (uint32_t i = 0; i < 31; i++) {
+                C4Quaternion rotationStart;
+                C4Quaternion rotationEnd;
+                float ratio;
+                C3Vector translation;
+                C3Vector scale;
+                baked->Sample(i, time, rotationStart, rotationEnd, ratio, translation, scale);
+
+                auto rotation = C4Quaternion::Nlerp(ratio, rotationStart, rotationEnd);
+
+                // Every track of the fixture shares the same key times
+                auto& bone = data->bones[i];
+                auto& boneTimes = bone.translationTrack.sequenceTimes[0].times;
+
+                uint32_t key = 0;
+
+                while (key + 2 < boneTimes.Count() && boneTimes[key + 1] <= time) {
+                    key++;
+                }
+
+                float keyRatio = std::min(static_cast<float>(time - boneTimes[key]) / static_cast<float>(boneTimes[key + 1] - boneTimes[key]), 1.0f);
+
+                auto& translationKeys = bone.translationTrack.sequenceKeys[0].keys;
+                C3Vector exactTranslation;
+                M2InterpolateLinear(translationKeys[key], translationKeys[key + 1], keyRatio, exactTranslation);
+
+                auto& rotationKeys = bone.rotationTrack.sequenceKeys[0].keys;
+                C4Quaternion exactRotation;
+                M2InterpolateLinear(rotationKeys[key], rotationKeys[key + 1], keyRatio, exactRotation);
+
+                auto& scaleKeys = bone.scaleTrack.sequenceKeys[0].keys;
+                C3Vector exactScale;
+                M2InterpolateLinear(scaleKeys[key], scaleKeys[key + 1], keyRatio, exactScale);
+
+                // Either side of the sphere is the same rotation
+                float sign = rotation.x * exactRotation.x + rotation.y * exactRotation.y + rotation.z * exactRotation.z + rotation.w * exactRotation.w < 0.0f ? -1.0f : 1.0f;
+
+                INFO("time " << time << " bone " << i);
+                CHECK(translation.x == Approx(exactTranslation.x).margin(cache.m_bakeTolerance));
+                CHECK(translation.y == Approx(exactTranslation.y).margin(cache.m_bakeTolerance));
+                CHECK(translation.z == Approx(exactTranslation.z).margin(cache.m_bakeTolerance));
+                CHECK(rotation.x == Approx(sign * exactRotation.x).margin(cache.m_bakeTolerance));
+                CHECK(rotation.y == Approx(sign * exactRotation.y).margin(cache.m_bakeTolerance));
+                CHECK(rotation.z == Approx(sign * exactRotation.z).margin(cache.m_bakeTolerance));
+                CHECK(rotation.w == Approx(sign * exactRotation.w).margin(cache.m_bakeTolerance));
+
+                // The tolerance is relative past 1
+                float scaleMargin = cache.m_bakeTolerance * std::max(fabsf(exactScale.x), 1.0f);
+                CHECK(scale.x == Approx(exactScale.x).margin(scaleMargin));
+                CHECK(scale.y == Approx(exactScale.y).margin(scaleMargin));
+                CHECK(scale.z == Approx(exactScale.z).margin(scaleMargin));
+            }
+        }
+
+        M2FixtureRelease(cache, models);
+    }
+
+    SECTION("leaves sequences past the tolerance or the size limit to their keys") {
+        CM2Cache tightCache;
+        tightCache.m_bakeInterval = 5;
+        tightCache.m_bakeTolerance = 1.0e-6f;
+
+        CM2Cache smallCache;
+        smallCache.m_bakeInterval = 5;
+        smallCache.m_bakeSizeLimit = 1024;
+
+        CM2Scene tightScene(&tightCache);
+        CM2Scene smallScene(&smallCache);
+
+        auto tightModels = M2FixtureModels(tightScene, "m2baketest.m2", 1);
+        auto smallModels = M2FixtureModels(smallScene, "m2baketest.m2", 1);
+
+        CHECK(tightModels[0]->m_shared->GetBakedSequence(0) == nullptr);
+        CHECK(smallModels[0]->m_shared->GetBakedSequence(0) == nullptr);
+        CHECK(tightCache.m_bakeSize == 0);
+        CHECK(smallCache.m_bakeSize == 0);
+
+        M2FixtureRelease(tightCache, tightModels);
+        M2FixtureRelease(smallCache, smallModels);
+    }
+}
+
+TEST_CASE("M2BakeSequence throughput", "[model][!benchmark]") {
+    M2FixtureModelPool();
+    M2FixtureWriteSkeleton("m2bakebench.m2", 63, 96, 16000);
+
+    AsyncFileReadTestStart();
+
+    auto animate = [](uint32_t interval) {
+        CM2Cache cache;
+        cache.m_bakeInterval = interval;
+        cache.m_bakeTolerance = 0.05f;
+
+        CM2Scene scene(&cache);
+
+        auto models = M2FixtureModels(scene, "m2bakebench.m2", 400);
+
+        REQUIRE((models[0]->m_shared->GetBakedSequence(0) != nullptr) == (interval != 0));
+
+        auto start = std::chrono::steady_clock::now();
+
+        for (uint32_t frame = 0; frame < 100; frame++) {
+            M2FixtureFrame(scene, models, 16);
+        }
+
+        auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        M2FixtureRelease(cache, models);
+
+        return elapsed / 100.0;
+    };
+
+    auto exact = animate(0);
+    auto baked = animate(10);
+
+    WARN("400 models, 63 bones, 96 keys: " << exact << " ms per frame from keys, " << baked << " ms baked at 100 Hz");
+}
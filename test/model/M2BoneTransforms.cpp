@@ -0,0 +1,149 @@
+#include "catch.hpp"
+#include "M2Fixture.hpp"
+#include "../async/AsyncFixture.hpp"
+#include "model/CM2Cache.hpp"
+#include "model/CM2Model.hpp"
+#include "model/CM2Scene.hpp"
+#include "model/M2BoneTransforms.hpp"
+#include "model/M2Model.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <random>
+
+// Fills count bones with random unit rotations, half of them blending across
+// the long arc, and random scales, translations and pivots
+static void M2BoneTransformsTestFill(M2BoneTransforms& transforms, uint32_t count, uint32_t seed) {
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    auto rotation = [&]() {
+        C4Quaternion q = { unit(random), unit(random), unit(random), unit(random) };
+        float length = sqrtf(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+
+        return C4Quaternion { q.x / length, q.y / length, q.z / length, q.w / length };
+    };
+
+    transforms.SetCount(count);
+
+    for (uint32_t i = 0; i < count; i++) {
+        C3Vector translation = { unit(random) * 4.0f, unit(random) * 4.0f, unit(random) * 4.0f };
+        C3Vector scale = { 1.0f + unit(random) * 0.5f, 1.0f + unit(random) * 0.5f, 1.0f + unit(random) * 0.5f };
+        C3Vector pivot = { unit(random) * 2.0f, unit(random) * 2.0f, unit(random) * 2.0f };
+
+        transforms.Set(i, rotation(), rotation(), (unit(random) + 1.0f) * 0.5f, translation, scale, pivot);
+    }
+}
+
+TEST_CASE("M2BoneTransforms::Build", "[model]") {
+    SECTION("matches the scalar build for every bone") {
+        for (uint32_t count : { 1u, 3u, 4u, 9u, 200u }) {
+            M2BoneTransforms batched;
+            M2BoneTransforms scalar;
+
+            M2BoneTransformsTestFill(batched, count, count);
+            M2BoneTransformsTestFill(scalar, count, count);
+
+            batched.Build();
+            scalar.BuildScalar();
+
+            for (uint32_t i = 0; i < count; i++) {
+                INFO(count << " bones, bone " << i);
+
+                auto rotationA = batched.Rotation(i);
+                auto rotationB = scalar.Rotation(i);
+
+                CHECK(rotationA.x == Approx(rotationB.x).margin(1e-6));
+                CHECK(rotationA.y == Approx(rotationB.y).margin(1e-6));
+                CHECK(rotationA.z == Approx(rotationB.z).margin(1e-6));
+                CHECK(rotationA.w == Approx(rotationB.w).margin(1e-6));
+
+                auto a = batched.m_matrices[i].M();
+                auto b = scalar.m_matrices[i].M();
+
+                for (uint32_t j = 0; j < 16; j++) {
+                    INFO("element " << j);
+                    CHECK(a[j] == Approx(b[j]).margin(1e-5));
+                }
+            }
+        }
+    }
+
+    SECTION("builds identity for bones at rest") {
+        M2BoneTransforms transforms;
+        transforms.SetCount(5);
+
+        C4Quaternion identity = { 0.0f, 0.0f, 0.0f, 1.0f };
+        C3Vector zero = { 0.0f, 0.0f, 0.0f };
+        C3Vector one = { 1.0f, 1.0f, 1.0f };
+        C3Vector pivot = { 1.0f, 2.0f, 3.0f };
+
+        for (uint32_t i = 0; i < 5; i++) {
+            transforms.Set(i, identity, identity, 0.5f, zero, one, pivot);
+        }
+
+        transforms.Build();
+
+        C44Matrix expected;
+
+        for (uint32_t i = 0; i < 5; i++) {
+            CHECK(memcmp(&transforms.m_matrices[i], &expected, sizeof(C44Matrix)) == 0);
+        }
+    }
+}
+
+TEST_CASE("M2BoneTransforms::Build throughput", "[model][!benchmark]") {
+    M2BoneTransforms source;
+    M2BoneTransforms transforms;
+
+    M2BoneTransformsTestFill(source, 200, 1);
+    transforms.SetCount(200);
+
+    // Build blends rotations in place, so every pass starts from a copy
+    auto time = [&](void (M2BoneTransforms::*build)()) {
+        auto start = std::chrono::steady_clock::now();
+
+        for (uint32_t i = 0; i < 10000; i++) {
+            memcpy(transforms.m_data.Ptr(), source.m_data.Ptr(), source.m_data.Count() * sizeof(float));
+            (transforms.*build)();
+        }
+
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / 10000.0;
+    };
+
+    auto batched = time(&M2BoneTransforms::Build);
+    auto scalar = time(&M2BoneTransforms::BuildScalar);
+
+    WARN("200 bones: " << batched << " us batched, " << scalar << " us scalar");
+
+    // The whole bone pass of a 200 bone skeleton
+    M2FixtureModelPool();
+    M2FixtureWriteSkeleton("m2bonebench.m2", 200, 32, 3000);
+
+    AsyncFileReadTestStart();
+
+    CM2Cache cache;
+    CM2Scene scene(&cache);
+
+    auto model = M2FixtureLoad(scene, "m2bonebench.m2")[0];
+
+    M2SequenceFallback fallback = { 0, 0 };
+    model->SetPrimaryBoneSequence(0, 0, fallback, 0, 1.0f, 0);
+
+    C3Vector a3 = { 1.0f, 1.0f, 1.0f };
+    C3Vector a4 = { 0.0f, 0.0f, 0.0f };
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (uint32_t i = 0; i < 10000; i++) {
+        scene.m_time += 7;
+        model->AnimateMT(&scene.m_view, a3, a4, 1.0f, 1.0f);
+    }
+
+    auto animate = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / 10000.0;
+
+    WARN("200 bones: " << animate << " us per AnimateMT");
+
+    model->Release();
+    cache.GarbageCollect(1);
+}
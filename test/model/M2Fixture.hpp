@@ -0,0 +1,263 @@
+#ifndef TEST_MODEL_M2_FIXTURE_HPP
+#define TEST_MODEL_M2_FIXTURE_HPP
+
+#include "catch.hpp"
+#include "async/AsyncFileRead.hpp"
+#include "model/CM2Cache.hpp"
+#include "model/CM2Model.hpp"
+#include "model/CM2Scene.hpp"
+#include "model/M2Data.hpp"
+#include "model/M2Internal.hpp"
+#include "model/M2Model.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <common/ObjectAlloc.hpp>
+
+// Writes the empty skin profile a model at path loads first: model.m2 reads
+// model00.skin
+inline void M2FixtureWriteSkin(const char* path) {
+    M2SkinProfile skinProfile;
+    memset(&skinProfile, 0, sizeof(skinProfile));
+    skinProfile.magic = 0x4E494B53; // SKIN
+
+    std::string skinPath = path;
+    skinPath = skinPath.substr(0, skinPath.rfind('.')) + "00.skin";
+
+    auto file = fopen(skinPath.c_str(), "wb");
+    fwrite(&skinProfile, 1, sizeof(skinProfile), file);
+    fclose(file);
+}
+
+inline void M2FixtureRemove(const char* path) {
+    std::string skinPath = path;
+    skinPath = skinPath.substr(0, skinPath.rfind('.')) + "00.skin";
+
+    remove(path);
+    remove(skinPath.c_str());
+}
+
+// Writes the smallest .m2 M2Init accepts, a header with every array empty,
+// and its skin profile
+inline void M2FixtureWrite(const char* path) {
+    M2Data data;
+    memset(&data, 0, sizeof(data));
+
+    data.MD20 = 0x3032444D; // MD20
+    data.version = 264;
+    data.numSkinProfiles = 1;
+
+    auto file = fopen(path, "wb");
+    fwrite(&data, 1, sizeof(data), file);
+    fclose(file);
+
+    M2FixtureWriteSkin(path);
+}
+
+// Appends size zeroed bytes to blob, returning their offset
+inline uint32_t M2FixtureAppend(std::vector<uint8_t>& blob, size_t size) {
+    auto offset = static_cast<uint32_t>(blob.size());
+    blob.resize(blob.size() + size);
+
+    return offset;
+}
+
+template<class T>
+T& M2FixtureAt(std::vector<uint8_t>& blob, uint32_t offset) {
+    return *reinterpret_cast<T*>(&blob[offset]);
+}
+
+inline uint32_t M2FixtureCompQuatComponent(float value) {
+    return static_cast<uint32_t>((value + 1.0f) * 32767.0f + 0.5f);
+}
+
+// Appends a track of keyCount keys spread evenly over the one sequence.
+// Every array lands after what points at it, as M2Init expects.
+template<class T>
+void M2FixtureTrack(std::vector<uint8_t>& blob, uint32_t trackOffset, uint32_t keyCount, uint32_t duration, T (*key)(uint32_t, uint32_t), uint32_t seed, uint16_t trackType = 1) {
+    auto timesOffset = M2FixtureAppend(blob, sizeof(M2SequenceTimes));
+    auto keysOffset = M2FixtureAppend(blob, sizeof(M2SequenceKeys<T>));
+    auto timeDataOffset = M2FixtureAppend(blob, sizeof(uint32_t) * keyCount);
+    auto keyDataOffset = M2FixtureAppend(blob, sizeof(T) * keyCount);
+
+    auto& track = M2FixtureAt<M2Track<T>>(blob, trackOffset);
+    track.trackType = trackType;
+    track.loopIndex = 0xFFFF;
+    track.sequenceTimes = { 1, timesOffset };
+    track.sequenceKeys = { 1, keysOffset };
+
+    M2FixtureAt<M2SequenceTimes>(blob, timesOffset).times = { keyCount, timeDataOffset };
+    M2FixtureAt<M2SequenceKeys<T>>(blob, keysOffset).keys = { keyCount, keyDataOffset };
+
+    for (uint32_t i = 0; i < keyCount; i++) {
+        M2FixtureAt<uint32_t>(blob, timeDataOffset + sizeof(uint32_t) * i) = keyCount > 1 ? i * duration / (keyCount - 1) : 0;
+        M2FixtureAt<T>(blob, keyDataOffset + sizeof(T) * i) = key(seed, i);
+    }
+}
+
+inline C3Vector M2FixtureTranslation(uint32_t seed, uint32_t i) {
+    return C3Vector { sinf(seed + i * 0.7f), cosf(seed * 0.3f + i), 0.01f * i };
+}
+
+// The same translations, leaving and entering each key along a tilted slope
+inline M2SplineKey<C3Vector> M2FixtureSplineTranslation(uint32_t seed, uint32_t i) {
+    M2SplineKey<C3Vector> key;
+    key.value = M2FixtureTranslation(seed, i);
+    key.inTan = { 0.5f * cosf(i * 1.3f), -0.4f, 0.2f * i };
+    key.outTan = { -0.3f, 0.6f * sinf(i + 0.5f), 0.1f };
+
+    return key;
+}
+
+// Writes a model with boneCount animated bones in a binary tree, and the
+// empty skin profile it needs to finish loading. Every bone has translation,
+// rotation and scale tracks of keyCount keys over one looping sequence.
+// A Bezier (2) or Hermite (3) trackType gives the translations tangents.
+inline void M2FixtureWriteSkeleton(const char* path, uint32_t boneCount, uint32_t keyCount, uint32_t duration, uint16_t trackType = 1) {
+    std::vector<uint8_t> blob;
+
+    M2FixtureAppend(blob, sizeof(M2Data));
+    auto sequencesOffset = M2FixtureAppend(blob, sizeof(M2Sequence));
+    auto bonesOffset = M2FixtureAppend(blob, sizeof(M2CompBone) * boneCount);
+
+    auto& data = M2FixtureAt<M2Data>(blob, 0);
+    data.MD20 = 0x3032444D; // MD20
+    data.version = 264;
+    data.numSkinProfiles = 1;
+    data.sequences = { 1, sequencesOffset };
+    data.bones = { boneCount, bonesOffset };
+    data.bounds.extent.b = { -1.0f, -1.0f, 0.0f };
+    data.bounds.extent.t = { 1.0f, 1.0f, 2.0f };
+    data.bounds.radius = sqrtf(3.0f);
+
+    auto& sequence = M2FixtureAt<M2Sequence>(blob, sequencesOffset);
+    sequence.duration = duration;
+    sequence.flags = 0x20; // keys in this file
+
+    for (uint32_t i = 0; i < boneCount; i++) {
+        auto boneOffset = bonesOffset + sizeof(M2CompBone) * i;
+
+        auto& bone = M2FixtureAt<M2CompBone>(blob, boneOffset);
+        bone.boneId = i;
+        bone.flags = 0x200;
+        bone.parentIndex = i ? (i - 1) / 2 : 0xFFFF;
+        bone.pivot = { 0.1f * i, 0.05f * i, 0.0f };
+
+        if (trackType == 1) {
+            M2FixtureTrack<C3Vector>(blob, boneOffset + offsetof(M2CompBone, translationTrack), keyCount, duration, M2FixtureTranslation, i);
+        } else {
+            M2FixtureTrack<M2SplineKey<C3Vector>>(blob, boneOffset + offsetof(M2CompBone, translationTrack), keyCount, duration, M2FixtureSplineTranslation, i, trackType);
+        }
+
+        M2FixtureTrack<M2CompQuat>(blob, boneOffset + offsetof(M2CompBone, rotationTrack), keyCount, duration, [](uint32_t seed, uint32_t i) {
+            float angle = 0.4f * i + 0.1f * seed;
+            float x = sinf(angle) * 0.6f;
+            float y = sinf(angle) * 0.48f;
+            float z = sinf(angle) * 0.64f;
+            float w = cosf(angle);
+
+            M2CompQuat value;
+            value.auCompQ[0] = M2FixtureCompQuatComponent(x) | (M2FixtureCompQuatComponent(y) << 16);
+            value.auCompQ[1] = M2FixtureCompQuatComponent(z) | (M2FixtureCompQuatComponent(w) << 16);
+
+            return value;
+        }, i);
+
+        M2FixtureTrack<C3Vector>(blob, boneOffset + offsetof(M2CompBone, scaleTrack), keyCount, duration, [](uint32_t seed, uint32_t i) {
+            float scale = 1.0f + 0.1f * sinf(seed + i * 0.5f);
+
+            return C3Vector { scale, scale, scale };
+        }, i);
+    }
+
+    auto file = fopen(path, "wb");
+    fwrite(blob.data(), 1, blob.size(), file);
+    fclose(file);
+
+    M2FixtureWriteSkin(path);
+}
+
+// Sets up the CM2Model heap M2Initialize would, for scenes built in tests
+inline void M2FixtureModelPool() {
+    static uint32_t s_heapId;
+
+    if (!g_modelPool) {
+        s_heapId = ObjectAllocAddHeap(sizeof(CM2Model), 256, "CM2Model", 1);
+        g_modelPool = &s_heapId;
+    }
+}
+
+// Creates count models of file and polls the read queues until they load
+inline std::vector<CM2Model*> M2FixtureLoad(CM2Scene& scene, const char* file, uint32_t count = 1) {
+    std::vector<CM2Model*> models;
+
+    for (uint32_t i = 0; i < count; i++) {
+        auto model = scene.CreateModel(file, 0);
+
+        REQUIRE(model);
+        models.push_back(model);
+    }
+
+    while (!models.back()->m_loaded) {
+        AsyncFileReadPollHandler(nullptr, nullptr);
+    }
+
+    for (auto model : models) {
+        REQUIRE(model->m_loaded);
+    }
+
+    return models;
+}
+
+// Creates count loaded models of file, each playing the sequence from a
+// different start time
+inline std::vector<CM2Model*> M2FixtureModels(CM2Scene& scene, const char* file, uint32_t count) {
+    auto models = M2FixtureLoad(scene, file, count);
+
+    for (uint32_t i = 0; i < count; i++) {
+        M2SequenceFallback fallback = { 0, 0 };
+        models[i]->SetPrimaryBoneSequence(0, 0, fallback, i * 37, 1.0f, 0);
+    }
+
+    return models;
+}
+
+inline void M2FixtureFrame(CM2Scene& scene, std::vector<CM2Model*>& models, uint32_t elapsed) {
+    scene.AdvanceTime(elapsed);
+
+    for (auto model : models) {
+        model->SetAnimating(1);
+    }
+
+    C3Vector cameraPos = { 0.0f, 0.0f, 0.0f };
+    scene.Animate(cameraPos);
+}
+
+inline void M2FixtureRelease(CM2Cache& cache, std::vector<CM2Model*>& models) {
+    for (auto model : models) {
+        model->Release();
+    }
+
+    cache.GarbageCollect(1);
+}
+
+// Largest difference between the bone matrices of two models
+inline float M2FixtureBoneError(CM2Model* a, CM2Model* b, uint32_t boneCount) {
+    float error = 0.0f;
+
+    for (uint32_t i = 0; i < boneCount; i++) {
+        auto matrixA = a->m_boneMatrices[i].M();
+        auto matrixB = b->m_boneMatrices[i].M();
+
+        for (uint32_t j = 0; j < 16; j++) {
+            error = std::max(error, fabsf(matrixA[j] - matrixB[j]));
+        }
+    }
+
+    return error;
+}
+
+#endif
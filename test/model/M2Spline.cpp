@@ -0,0 +1,163 @@
+#include "catch.hpp"
+#include "model/M2Spline.hpp"
+#include <cmath>
+#include <random>
+#include <tempest/Math.hpp>
+
+static float M2SplineTestBezier(float p0, float p1, float p2, float p3, float t) {
+    float s = 1.0f - t;
+
+    return s * s * s * p0 + 3.0f * s * s * t * p1 + 3.0f * s * t * t * p2 + t * t * t * p3;
+}
+
+static float M2SplineTestHermite(float p0, float m0, float m1, float p1, float t) {
+    float t2 = t * t;
+    float t3 = t2 * t;
+
+    return (2.0f * t3 - 3.0f * t2 + 1.0f) * p0 + (t3 - 2.0f * t2 + t) * m0 + (-2.0f * t3 + 3.0f * t2) * p1 + (t3 - t2) * m1;
+}
+
+template<class T>
+static M2SplineKey<T> M2SplineTestKey(const T& value, const T& inTan, const T& outTan) {
+    M2SplineKey<T> key;
+    key.value = value;
+    key.inTan = inTan;
+    key.outTan = outTan;
+
+    return key;
+}
+
+TEST_CASE("M2InterpolateCubicBezier", "[model]") {
+    SECTION("traces t^3 from its control points") {
+        auto startKey = M2SplineTestKey(0.0f, 0.0f, 0.0f);
+        auto endKey = M2SplineTestKey(1.0f, 0.0f, 0.0f);
+
+        M2SplineSegment<float> segment;
+        M2InterpolateCubicBezier(startKey, endKey, segment);
+
+        for (uint32_t i = 0; i <= 16; i++) {
+            float t = i / 16.0f;
+            float value;
+            M2InterpolateCubic(segment, t, value);
+
+            CHECK(value == Approx(t * t * t).margin(1e-6));
+        }
+    }
+
+    SECTION("matches the Bernstein form on every axis") {
+        std::mt19937 random(1);
+        std::uniform_real_distribution<float> unit(-10.0f, 10.0f);
+
+        for (uint32_t i = 0; i < 100; i++) {
+            auto startKey = M2SplineTestKey(
+                C3Vector { unit(random), unit(random), unit(random) },
+                C3Vector { unit(random), unit(random), unit(random) },
+                C3Vector { unit(random), unit(random), unit(random) }
+            );
+
+            auto endKey = M2SplineTestKey(
+                C3Vector { unit(random), unit(random), unit(random) },
+                C3Vector { unit(random), unit(random), unit(random) },
+                C3Vector { unit(random), unit(random), unit(random) }
+            );
+
+            M2SplineSegment<C3Vector> segment;
+            M2InterpolateCubicBezier(startKey, endKey, segment);
+
+            for (uint32_t j = 0; j <= 8; j++) {
+                float t = j / 8.0f;
+                C3Vector value;
+                M2InterpolateCubic(segment, t, value);
+
+                CHECK(value.x == Approx(M2SplineTestBezier(startKey.value.x, startKey.outTan.x, endKey.inTan.x, endKey.value.x, t)).margin(1e-4));
+                CHECK(value.y == Approx(M2SplineTestBezier(startKey.value.y, startKey.outTan.y, endKey.inTan.y, endKey.value.y, t)).margin(1e-4));
+                CHECK(value.z == Approx(M2SplineTestBezier(startKey.value.z, startKey.outTan.z, endKey.inTan.z, endKey.value.z, t)).margin(1e-4));
+            }
+        }
+    }
+}
+
+TEST_CASE("M2InterpolateCubicHermite", "[model]") {
+    SECTION("traces t^3 from its end slopes") {
+        auto startKey = M2SplineTestKey(0.0f, 0.0f, 0.0f);
+        auto endKey = M2SplineTestKey(1.0f, 3.0f, 0.0f);
+
+        M2SplineSegment<float> segment;
+        M2InterpolateCubicHermite(startKey, endKey, segment);
+
+        for (uint32_t i = 0; i <= 16; i++) {
+            float t = i / 16.0f;
+            float value;
+            M2InterpolateCubic(segment, t, value);
+
+            CHECK(value == Approx(t * t * t).margin(1e-6));
+        }
+    }
+
+    SECTION("approximates a quarter circle") {
+        // The usual circle slopes, three times the 4/3 tan(pi/8) Bezier handle
+        float slope = 4.0f * tanf(CMath::PI / 8.0f);
+
+        auto startKey = M2SplineTestKey(
+            C3Vector { 1.0f, 0.0f, 2.0f },
+            C3Vector { 0.0f, 0.0f, 0.0f },
+            C3Vector { 0.0f, slope, 0.0f }
+        );
+
+        auto endKey = M2SplineTestKey(
+            C3Vector { 0.0f, 1.0f, 2.0f },
+            C3Vector { -slope, 0.0f, 0.0f },
+            C3Vector { 0.0f, 0.0f, 0.0f }
+        );
+
+        M2SplineSegment<C3Vector> segment;
+        M2InterpolateCubicHermite(startKey, endKey, segment);
+
+        for (uint32_t i = 0; i <= 16; i++) {
+            C3Vector value;
+            M2InterpolateCubic(segment, i / 16.0f, value);
+
+            CHECK(sqrtf(value.x * value.x + value.y * value.y) == Approx(1.0f).margin(3e-4));
+            CHECK(value.z == 2.0f);
+        }
+    }
+
+    SECTION("matches the basis form on every axis") {
+        std::mt19937 random(2);
+        std::uniform_real_distribution<float> unit(-10.0f, 10.0f);
+
+        for (uint32_t i = 0; i < 100; i++) {
+            auto startKey = M2SplineTestKey(
+                C3Vector { unit(random), unit(random), unit(random) },
+                C3Vector { unit(random), unit(random), unit(random) },
+                C3Vector { unit(random), unit(random), unit(random) }
+            );
+
+            auto endKey = M2SplineTestKey(
+                C3Vector { unit(random), unit(random), unit(random) },
+                C3Vector { unit(random), unit(random), unit(random) },
+                C3Vector { unit(random), unit(random), unit(random) }
+            );
+
+            M2SplineSegment<C3Vector> segment;
+            M2InterpolateCubicHermite(startKey, endKey, segment);
+
+            for (uint32_t j = 0; j <= 8; j++) {
+                float t = j / 8.0f;
+                C3Vector value;
+                M2InterpolateCubic(segment, t, value);
+
+                CHECK(value.x == Approx(M2SplineTestHermite(startKey.value.x, startKey.outTan.x, endKey.inTan.x, endKey.value.x, t)).margin(1e-4));
+                CHECK(value.y == Approx(M2SplineTestHermite(startKey.value.y, startKey.outTan.y, endKey.inTan.y, endKey.value.y, t)).margin(1e-4));
+                CHECK(value.z == Approx(M2SplineTestHermite(startKey.value.z, startKey.outTan.z, endKey.inTan.z, endKey.value.z, t)).margin(1e-4));
+
+                C3Vector scalar;
+                M2InterpolateCubicScalar(segment, t, scalar);
+
+                CHECK(value.x == Approx(scalar.x).margin(1e-5));
+                CHECK(value.y == Approx(scalar.y).margin(1e-5));
+                CHECK(value.z == Approx(scalar.z).margin(1e-5));
+            }
+        }
+    }
+}
@@ -0,0 +1,129 @@
+#ifndef TEST_UTIL_MPQ_FIXTURE_HPP
+#define TEST_UTIL_MPQ_FIXTURE_HPP
+
+#include "util/SArchive.hpp"
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Builds a minimal MPQ v1 archive with 512 byte sectors
+class MpqFixture {
+    public:
+        struct Entry {
+            std::string name;
+            uint32_t flags;
+            uint32_t fileSize;
+            std::vector<std::vector<uint8_t>> sectors;
+            uint16_t locale;
+        };
+
+        std::vector<Entry> entries;
+
+        void Add(const char* name, uint32_t flags, uint32_t fileSize, const std::vector<std::vector<uint8_t>>& sectors, uint16_t locale = 0) {
+            this->entries.push_back({ name, flags | MPQ_FILE_EXISTS, fileSize, sectors, locale });
+        }
+
+        void Write(const char* path) {
+            uint32_t hashEntries = 16;
+
+            while (hashEntries < this->entries.size() * 2) {
+                hashEntries *= 2;
+            }
+
+            std::vector<uint8_t> data(0x20);
+            std::vector<SArchive::HashEntry> hashTable(hashEntries);
+            std::vector<SArchive::BlockEntry> blockTable;
+
+            memset(hashTable.data(), 0xFF, hashTable.size() * sizeof(SArchive::HashEntry));
+
+            for (auto& entry : this->entries) {
+                SArchive::BlockEntry block;
+                block.offset = data.size();
+                block.fileSize = entry.fileSize;
+                block.flags = entry.flags;
+
+                uint32_t key = 0;
+                if (entry.flags & MPQ_FILE_ENCRYPTED) {
+                    auto name = entry.name.substr(entry.name.rfind('\\') + 1);
+                    key = SArchive::HashString(name.c_str(), MPQ_HASH_FILE_KEY);
+
+                    if (entry.flags & MPQ_FILE_FIX_KEY) {
+                        key = (key + block.offset) ^ block.fileSize;
+                    }
+                }
+
+                std::vector<uint8_t> payload;
+                std::vector<uint32_t> offsets;
+
+                auto hasTable = (entry.flags & MPQ_FILE_COMPRESS) && !(entry.flags & MPQ_FILE_SINGLE_UNIT);
+                uint32_t position = hasTable ? (entry.sectors.size() + 1) * sizeof(uint32_t) : 0;
+
+                for (uint32_t i = 0; i < entry.sectors.size(); i++) {
+                    auto sector = entry.sectors[i];
+
+                    if (entry.flags & MPQ_FILE_ENCRYPTED) {
+                        SArchive::Encrypt(sector.data(), sector.size(), key + i);
+                    }
+
+                    offsets.push_back(position);
+                    position += sector.size();
+                    payload.insert(payload.end(), sector.begin(), sector.end());
+                }
+
+                offsets.push_back(position);
+
+                if (hasTable) {
+                    if (entry.flags & MPQ_FILE_ENCRYPTED) {
+                        SArchive::Encrypt(offsets.data(), offsets.size() * sizeof(uint32_t), key - 1);
+                    }
+
+                    auto table = reinterpret_cast<uint8_t*>(offsets.data());
+                    payload.insert(payload.begin(), table, table + offsets.size() * sizeof(uint32_t));
+                }
+
+                block.compressedSize = payload.size();
+                data.insert(data.end(), payload.begin(), payload.end());
+
+                auto index = SArchive::HashString(entry.name.c_str(), MPQ_HASH_TABLE_INDEX) & (hashEntries - 1);
+                while (hashTable[index].blockIndex != MPQ_HASH_ENTRY_EMPTY) {
+                    index = (index + 1) & (hashEntries - 1);
+                }
+
+                hashTable[index].nameA = SArchive::HashString(entry.name.c_str(), MPQ_HASH_NAME_A);
+                hashTable[index].nameB = SArchive::HashString(entry.name.c_str(), MPQ_HASH_NAME_B);
+                hashTable[index].locale = entry.locale;
+                hashTable[index].platform = 0;
+                hashTable[index].blockIndex = blockTable.size();
+
+                blockTable.push_back(block);
+            }
+
+            auto hashTableBytes = hashTable.size() * sizeof(SArchive::HashEntry);
+            auto blockTableBytes = blockTable.size() * sizeof(SArchive::BlockEntry);
+
+            SArchive::Encrypt(hashTable.data(), hashTableBytes, SArchive::HashString("(hash table)", MPQ_HASH_FILE_KEY));
+            SArchive::Encrypt(blockTable.data(), blockTableBytes, SArchive::HashString("(block table)", MPQ_HASH_FILE_KEY));
+
+            SArchive::Header header = {};
+            header.signature = MPQ_HEADER_SIGNATURE;
+            header.headerSize = 0x20;
+            header.formatVersion = 0;
+            header.sectorSizeShift = 0;
+            header.hashTableOffset = data.size();
+            header.blockTableOffset = data.size() + hashTableBytes;
+            header.hashTableEntries = hashEntries;
+            header.blockTableEntries = blockTable.size();
+            header.archiveSize = data.size() + hashTableBytes + blockTableBytes;
+
+            memcpy(data.data(), &header, 0x20);
+
+            auto file = fopen(path, "wb");
+            fwrite(data.data(), 1, data.size(), file);
+            fwrite(hashTable.data(), 1, hashTableBytes, file);
+            fwrite(blockTable.data(), 1, blockTableBytes, file);
+            fclose(file);
+        }
+};
+
+#endif
@@ -0,0 +1,283 @@
+#include "catch.hpp"
+#include "MpqFixture.hpp"
+#include "util/SArchive.hpp"
+#include "util/SComp.hpp"
+#include "util/SFile.hpp"
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static std::vector<uint8_t> MakePattern(uint32_t size, uint32_t seed) {
+    std::vector<uint8_t> data(size);
+
+    for (uint32_t i = 0; i < size; i++) {
+        data[i] = (i * 7 + seed) & 0xFF;
+    }
+
+    return data;
+}
+
+// PKWARE DCL stream of "AIAIAIAIAIAIA"
+static const uint8_t s_imploded[] = { 0x00, 0x04, 0x82, 0x24, 0x25, 0x8F, 0x80, 0x7F };
+static const char* s_exploded = "AIAIAIAIAIAIA";
+
+TEST_CASE("SCompExplode", "[util]") {
+    SECTION("decodes a PKWARE DCL stream") {
+        char buffer[32];
+        uint32_t size = sizeof(buffer);
+
+        REQUIRE(SCompExplode(buffer, &size, s_imploded, sizeof(s_imploded)) == 1);
+        REQUIRE(size == 13);
+        REQUIRE(memcmp(buffer, s_exploded, 13) == 0);
+    }
+
+    SECTION("fails when the output does not fit") {
+        char buffer[8];
+        uint32_t size = sizeof(buffer);
+
+        REQUIRE(SCompExplode(buffer, &size, s_imploded, sizeof(s_imploded)) == 0);
+    }
+}
+
+TEST_CASE("SFile::OpenEx", "[util]") {
+    auto stored = MakePattern(1300, 0);
+    auto patched = MakePattern(700, 1);
+
+    // Two full sectors stored raw followed by a compressed tail
+    std::vector<uint8_t> compressedTail(1, SCOMP_TYPE_PKWARE);
+    compressedTail.insert(compressedTail.end(), s_imploded, s_imploded + sizeof(s_imploded));
+
+    auto sectorData = MakePattern(1024, 2);
+    std::vector<uint8_t> expectedCompressed(sectorData);
+    expectedCompressed.insert(expectedCompressed.end(), s_exploded, s_exploded + 13);
+
+    MpqFixture base;
+    base.Add(
+        "Data\\Stored.txt",
+        0,
+        stored.size(),
+        {
+            std::vector<uint8_t>(stored.begin(), stored.begin() + 512),
+            std::vector<uint8_t>(stored.begin() + 512, stored.begin() + 1024),
+            std::vector<uint8_t>(stored.begin() + 1024, stored.end())
+        }
+    );
+    base.Add(
+        "Data\\Compressed.dbc",
+        MPQ_FILE_COMPRESS | MPQ_FILE_ENCRYPTED | MPQ_FILE_FIX_KEY,
+        expectedCompressed.size(),
+        {
+            std::vector<uint8_t>(sectorData.begin(), sectorData.begin() + 512),
+            std::vector<uint8_t>(sectorData.begin() + 512, sectorData.end()),
+            compressedTail
+        }
+    );
+    base.Add(
+        "Data\\Imploded.bls",
+        MPQ_FILE_IMPLODE | MPQ_FILE_SINGLE_UNIT,
+        13,
+        { std::vector<uint8_t>(s_imploded, s_imploded + sizeof(s_imploded)) }
+    );
+    base.Add(
+        "Data\\Removed.txt",
+        0,
+        4,
+        { { 'b', 'a', 's', 'e' } }
+    );
+    base.Write("SFileTestBase.mpq");
+
+    MpqFixture patch;
+    patch.Add("Data\\Stored.txt", 0, patched.size(), { std::vector<uint8_t>(patched.begin(), patched.begin() + 512), std::vector<uint8_t>(patched.begin() + 512, patched.end()) });
+    patch.Add("Data\\Removed.txt", MPQ_FILE_DELETE_MARKER, 0, {});
+    patch.Write("SFileTestPatch.mpq");
+
+    SArchive* baseArchive;
+    REQUIRE(SFile::OpenArchive("SFileTestBase.mpq", 0, 0, &baseArchive) == 1);
+
+    SECTION("reads a stored file across sector boundaries") {
+        SFile* file;
+        REQUIRE(SFile::OpenEx(nullptr, "data/stored.txt", 0, &file) == 1);
+        REQUIRE(SFile::GetFileSize(file, nullptr) == stored.size());
+
+        std::vector<uint8_t> buffer(stored.size());
+        size_t bytesRead;
+
+        REQUIRE(SFile::Read(file, buffer.data(), 500, &bytesRead, nullptr, nullptr) == 1);
+        REQUIRE(bytesRead == 500);
+        REQUIRE(SFile::Read(file, buffer.data() + 500, 2000, &bytesRead, nullptr, nullptr) == 1);
+        REQUIRE(bytesRead == 800);
+        REQUIRE(buffer == stored);
+
+        SFile::Close(file);
+    }
+
+    SECTION("loads an encrypted file with compressed sectors") {
+        void* buffer;
+        size_t bytes;
+
+        REQUIRE(SFile::Load(nullptr, "Data\\Compressed.dbc", &buffer, &bytes, 0, 0, nullptr) == 1);
+        REQUIRE(bytes == expectedCompressed.size());
+        REQUIRE(memcmp(buffer, expectedCompressed.data(), bytes) == 0);
+
+        SFile::Unload(buffer);
+    }
+
+    SECTION("loads an imploded single unit file") {
+        void* buffer;
+        size_t bytes;
+
+        REQUIRE(SFile::Load(nullptr, "Data\\Imploded.bls", &buffer, &bytes, 0, 0, nullptr) == 1);
+        REQUIRE(bytes == 13);
+        REQUIRE(memcmp(buffer, s_exploded, 13) == 0);
+
+        SFile::Unload(buffer);
+    }
+
+    SECTION("fails for a missing file") {
+        SFile* file;
+        REQUIRE(SFile::OpenEx(baseArchive, "Data\\Missing.txt", 0, &file) == 0);
+    }
+
+    SECTION("searches patch archives first") {
+        SArchive* patchArchive;
+        REQUIRE(SFile::OpenArchive("SFileTestPatch.mpq", 1, 0, &patchArchive) == 1);
+
+        SFile* file;
+        REQUIRE(SFile::OpenEx(nullptr, "Data\\Stored.txt", 0, &file) == 1);
+        REQUIRE(SFile::GetFileSize(file, nullptr) == patched.size());
+        SFile::Close(file);
+
+        REQUIRE(SFile::OpenEx(nullptr, "Data\\Removed.txt", 0, &file) == 0);
+
+        SFile::CloseArchive(patchArchive);
+
+        REQUIRE(SFile::OpenEx(nullptr, "Data\\Removed.txt", 0, &file) == 1);
+        REQUIRE(SFile::GetFileSize(file, nullptr) == 4);
+        SFile::Close(file);
+    }
+
+    SECTION("prefers the entry for the current locale") {
+        MpqFixture localized;
+        localized.Add("Data\\Greeting.txt", 0, 5, { { 'h', 'e', 'l', 'l', 'o' } });
+        localized.Add("Data\\Greeting.txt", 0, 5, { { 'h', 'a', 'l', 'l', 'o' } }, 0x407);
+        localized.Write("SFileTestLocale.mpq");
+
+        SArchive* localizedArchive;
+        REQUIRE(SFile::OpenArchive("SFileTestLocale.mpq", 1, 0, &localizedArchive) == 1);
+
+        auto read = []() {
+            SFile* file;
+            REQUIRE(SFile::OpenEx(nullptr, "Data\\Greeting.txt", 0, &file) == 1);
+
+            std::string contents(5, '\0');
+            REQUIRE(SFile::Read(file, &contents[0], 5, nullptr, nullptr, nullptr) == 1);
+            SFile::Close(file);
+
+            return contents;
+        };
+
+        SFile::SetLocale(0x407);
+        CHECK(read() == "hallo");
+
+        // Locales the archive doesn't carry fall back to the neutral entry
+        SFile::SetLocale(0x409);
+        CHECK(read() == "hello");
+
+        SFile::SetLocale(0);
+        CHECK(read() == "hello");
+
+        SFile::CloseArchive(localizedArchive);
+        remove("SFileTestLocale.mpq");
+    }
+
+    SECTION("rejects tables that run past the end of the archive") {
+        auto file = fopen("SFileTestBase.mpq", "r+b");
+        REQUIRE(file);
+
+        // 2^28 hash entries are 4 GB, which wraps to nothing in 32 bits
+        uint32_t hashTableEntries = 0x10000000;
+        fseek(file, offsetof(SArchive::Header, hashTableEntries), SEEK_SET);
+        fwrite(&hashTableEntries, sizeof(hashTableEntries), 1, file);
+        fclose(file);
+
+        SArchive* archive;
+        CHECK(SFile::OpenArchive("SFileTestBase.mpq", 0, 0, &archive) == 0);
+    }
+
+    SFile::CloseArchive(baseArchive);
+
+    remove("SFileTestBase.mpq");
+    remove("SFileTestPatch.mpq");
+}
+
+TEST_CASE("SFile::Load", "[util]") {
+    auto contents = MakePattern(3000, 3);
+
+    auto output = fopen("SFileTestLoose.txt", "wb");
+    fwrite(contents.data(), 1, contents.size(), output);
+    fclose(output);
+
+    SECTION("loads a loose file with zeroed extra bytes") {
+        void* buffer;
+        size_t bytes;
+
+        REQUIRE(SFile::Load(nullptr, "SFileTestLoose.txt", &buffer, &bytes, 1, 0, nullptr) == 1);
+        REQUIRE(bytes == contents.size());
+        REQUIRE(memcmp(buffer, contents.data(), bytes) == 0);
+        REQUIRE(static_cast<uint8_t*>(buffer)[bytes] == 0);
+
+        SFile::Unload(buffer);
+    }
+
+    SECTION("keeps each caller's writes to itself") {
+        void* first;
+        void* second;
+        size_t bytes;
+
+        REQUIRE(SFile::Load(nullptr, "SFileTestLoose.txt", &first, &bytes, 0, 0, nullptr) == 1);
+        REQUIRE(SFile::Load(nullptr, "SFileTestLoose.txt", &second, &bytes, 0, 0, nullptr) == 1);
+        REQUIRE(first != second);
+
+        memset(first, 0xAB, bytes);
+        REQUIRE(memcmp(second, contents.data(), bytes) == 0);
+
+        SFile::Unload(first);
+        REQUIRE(memcmp(second, contents.data(), bytes) == 0);
+        SFile::Unload(second);
+
+        // Nor do they reach the file
+        REQUIRE(SFile::Load(nullptr, "SFileTestLoose.txt", &first, &bytes, 0, 0, nullptr) == 1);
+        REQUIRE(memcmp(first, contents.data(), bytes) == 0);
+        SFile::Unload(first);
+    }
+
+    remove("SFileTestLoose.txt");
+}
+
+TEST_CASE("SFile::OpenMemory", "[util]") {
+    auto contents = MakePattern(100, 5);
+
+    SFile* file;
+    REQUIRE(SFile::OpenMemory(contents.data(), contents.size(), &file) == 1);
+    CHECK(SFile::GetFileSize(file, nullptr) == contents.size());
+
+    uint8_t buffer[64];
+    size_t bytes;
+
+    REQUIRE(SFile::Read(file, buffer, 60, &bytes, nullptr, nullptr) == 1);
+    CHECK(bytes == 60);
+    CHECK(memcmp(buffer, contents.data(), 60) == 0);
+
+    // Reads stop at the end of the block
+    REQUIRE(SFile::Read(file, buffer, 64, &bytes, nullptr, nullptr) == 1);
+    CHECK(bytes == 40);
+    CHECK(memcmp(buffer, &contents[60], 40) == 0);
+
+    REQUIRE(SFile::SetFilePointer(file, 10) == 1);
+    REQUIRE(SFile::Read(file, buffer, 4, &bytes, nullptr, nullptr) == 1);
+    CHECK(memcmp(buffer, &contents[10], 4) == 0);
+
+    SFile::Close(file);
+}